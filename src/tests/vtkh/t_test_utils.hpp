@@ -11,6 +11,29 @@
 #define BASE_SIZE 32
 typedef vtkm::cont::ArrayHandleUniformPointCoordinates UniformCoords;
 
+// cheap deterministic noise (a linear congruential generator)
+struct Noise
+{
+  unsigned int m_state;
+  Noise(const unsigned int seed) : m_state(seed) {}
+  // all 32 bits of the next state
+  unsigned int raw()
+  {
+    m_state = m_state * 1664525u + 1013904223u;
+    return m_state;
+  }
+  // the high 24 bits, the low bits of an lcg are not very random
+  unsigned int next()
+  {
+    return raw() >> 8;
+  }
+  // uniform in [0,1)
+  float unit()
+  {
+    return static_cast<float>(next()) / static_cast<float>(1 << 24);
+  }
+};
+
 struct SpatialDivision
 {
   int m_mins[3];
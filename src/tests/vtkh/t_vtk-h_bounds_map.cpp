@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_bounds_map.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/filters/communication/BoundsMap.hpp>
+#include "t_test_utils.hpp"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// a dims^3 grid of blocks over [0,dims)^3. With ghost > 0 neighboring
+// blocks overlap
+void build_blocks(vtkh::BoundsMap &bmap, const int dims, const double ghost)
+{
+  bmap.Clear();
+  int id = 0;
+  for(int z = 0; z < dims; ++z)
+    for(int y = 0; y < dims; ++y)
+      for(int x = 0; x < dims; ++x)
+      {
+        vtkm::Bounds bounds(x - ghost, x + 1 + ghost,
+                            y - ghost, y + 1 + ghost,
+                            z - ghost, z + 1 + ghost);
+        // non-contiguous ids
+        bmap.AddBlock(id * 3 + 1, bounds);
+        id++;
+      }
+  bmap.Build();
+}
+
+std::vector<vtkh::Particle> random_particles(const int count, const int dims)
+{
+  Noise noise(7);
+  std::vector<vtkh::Particle> particles;
+  for(int i = 0; i < count; ++i)
+  {
+    // include points outside of the blocks
+    vtkm::Vec3f pos(noise.unit() * (dims + 2) - 1.f,
+                    noise.unit() * (dims + 2) - 1.f,
+                    noise.unit() * (dims + 2) - 1.f);
+    particles.push_back(vtkh::Particle(pos, i));
+  }
+  // points exactly on block boundaries
+  for(int i = 0; i <= dims; ++i)
+  {
+    vtkm::Vec3f pos(static_cast<float>(i), 0.5f, static_cast<float>(dims - i));
+    particles.push_back(vtkh::Particle(pos, count + i));
+  }
+  return particles;
+}
+
+void check_lookups(const vtkh::BoundsMap &bmap,
+                   std::vector<vtkh::Particle> &particles)
+{
+  // current block of every other particle is ignored
+  for(size_t i = 0; i < particles.size(); i += 2)
+  {
+    std::vector<int> ids;
+    bmap.FindBlockLinear(particles[i].p.Pos, -1, ids);
+    if(!ids.empty())
+    {
+      particles[i].blockIds.push_back(ids.back());
+    }
+  }
+
+  std::vector<std::vector<int>> block_ids;
+  bmap.FindBlockIDs(particles, block_ids);
+  ASSERT_EQ(block_ids.size(), particles.size());
+
+  int found = 0;
+  for(size_t i = 0; i < particles.size(); ++i)
+  {
+    const vtkh::Particle &p = particles[i];
+    std::vector<int> expected;
+    bmap.FindBlockLinear(p.p.Pos, p.blockIds.empty() ? -1 : p.blockIds[0], expected);
+    EXPECT_EQ(block_ids[i], expected);
+    EXPECT_EQ(bmap.FindBlock(p, true), expected);
+    found += expected.empty() ? 0 : 1;
+  }
+  // make sure we are not just comparing empty results
+  EXPECT_GT(found, 0);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_bounds_map, vtkh_regular_blocks)
+{
+  const int dims = 16;
+  vtkh::BoundsMap bmap;
+  build_blocks(bmap, dims, 0.);
+  EXPECT_TRUE(bmap.IsRegular());
+
+  std::vector<vtkh::Particle> particles = random_particles(5000, dims);
+  check_lookups(bmap, particles);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_bounds_map, vtkh_overlapping_blocks)
+{
+  const int dims = 16;
+  vtkh::BoundsMap bmap;
+  build_blocks(bmap, dims, 0.1);
+  EXPECT_FALSE(bmap.IsRegular());
+
+  std::vector<vtkh::Particle> particles = random_particles(5000, dims);
+  check_lookups(bmap, particles);
+
+  // the copy used by the messengers has to keep the index
+  vtkh::BoundsMap copy(bmap);
+  check_lookups(copy, particles);
+}
+
+//-----------------------------------------------------------------------------
+// timing only, run with --gtest_also_run_disabled_tests
+TEST(vtkh_bounds_map, DISABLED_vtkh_bounds_map_benchmark)
+{
+  const int dims = 20;
+  const int num_particles = 10000;
+  const double ghosts[2] = {0., 0.1};
+
+  for(int g = 0; g < 2; ++g)
+  {
+    vtkh::BoundsMap bmap;
+    vtkh::Timer timer;
+    build_blocks(bmap, dims, ghosts[g]);
+    const double build_time = timer.elapsed();
+
+    std::vector<vtkh::Particle> particles = random_particles(num_particles, dims);
+    std::vector<int> ids;
+
+    timer.reset();
+    for(size_t i = 0; i < particles.size(); ++i)
+    {
+      bmap.FindBlockLinear(particles[i].p.Pos, -1, ids);
+    }
+    const double linear_time = timer.elapsed();
+
+    timer.reset();
+    for(size_t i = 0; i < particles.size(); ++i)
+    {
+      bmap.FindBlock(particles[i].p.Pos, -1, ids);
+    }
+    const double index_time = timer.elapsed();
+
+    timer.reset();
+    std::vector<std::vector<int>> block_ids;
+    bmap.FindBlockIDs(particles, block_ids);
+    const double batch_time = timer.elapsed();
+
+    const double count = static_cast<double>(particles.size());
+    std::cout<<dims * dims * dims<<" blocks "
+             <<(bmap.IsRegular() ? "regular" : "overlapping")
+             <<" build: "<<build_time<<" s"
+             <<" linear: "<<count / linear_time<<" lookups/s"
+             <<" index: "<<count / index_time<<" lookups/s"
+             <<" batch: "<<count / batch_time<<" lookups/s\n";
+  }
+}
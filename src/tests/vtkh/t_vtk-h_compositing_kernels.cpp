@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_compositing_kernels.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/compositing/CompositingKernels.hpp>
+#include "t_test_utils.hpp"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+struct TestImage
+{
+  std::vector<unsigned char> m_pixels;
+  std::vector<float>         m_depths;
+
+  TestImage(const int size, const unsigned int seed)
+    : m_pixels(size * 4),
+      m_depths(size)
+  {
+    // noise with some background (depth > 1)
+    Noise noise(seed);
+    for(int i = 0; i < size; ++i)
+    {
+      const unsigned int state = noise.raw();
+      for(int c = 0; c < 4; ++c)
+      {
+        m_pixels[i * 4 + c] = static_cast<unsigned char>((state >> (c * 8)) & 0xFF);
+      }
+      m_depths[i] = static_cast<float>((state >> 8) % 300) / 200.f;
+    }
+  }
+};
+
+typedef vtkh::CompositingKernels Kernels;
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_compositing_kernels, vtkh_kernels_match_scalar)
+{
+  // odd size to exercise the scalar remainder loops
+  const int size = 1000003;
+  TestImage front(size, 1);
+  TestImage back(size, 2);
+  // equal depths take the back fragment
+  for(int i = 0; i < size; i += 7)
+  {
+    back.m_depths[i] = front.m_depths[i];
+  }
+  const unsigned char bg_color[4] = {10, 200, 255, 128};
+
+  const Kernels::InstructionSet supported = Kernels::GetSupportedInstructionSet();
+  std::cout<<"supported instruction set: "
+           <<Kernels::GetInstructionSetName(supported)<<"\n";
+
+  Kernels::SetInstructionSet(Kernels::SCALAR);
+  TestImage z_expected = front;
+  Kernels::ZBuffer(&z_expected.m_pixels[0], &z_expected.m_depths[0],
+                   &back.m_pixels[0], &back.m_depths[0], size);
+  TestImage blend_expected = front;
+  Kernels::Blend(&blend_expected.m_pixels[0], &blend_expected.m_depths[0],
+                 &back.m_pixels[0], &back.m_depths[0], size);
+  TestImage bg_expected = front;
+  Kernels::Background(&bg_expected.m_pixels[0], bg_color, size);
+
+  for(int i = Kernels::SSE; i <= supported; ++i)
+  {
+    Kernels::SetInstructionSet(static_cast<Kernels::InstructionSet>(i));
+    std::cout<<"checking "<<Kernels::GetInstructionSetName(Kernels::GetInstructionSet())<<"\n";
+
+    TestImage z_res = front;
+    Kernels::ZBuffer(&z_res.m_pixels[0], &z_res.m_depths[0],
+                     &back.m_pixels[0], &back.m_depths[0], size);
+    EXPECT_TRUE(z_res.m_pixels == z_expected.m_pixels);
+    EXPECT_TRUE(z_res.m_depths == z_expected.m_depths);
+
+    TestImage blend_res = front;
+    Kernels::Blend(&blend_res.m_pixels[0], &blend_res.m_depths[0],
+                   &back.m_pixels[0], &back.m_depths[0], size);
+    EXPECT_TRUE(blend_res.m_pixels == blend_expected.m_pixels);
+    EXPECT_TRUE(blend_res.m_depths == blend_expected.m_depths);
+
+    TestImage bg_res = front;
+    Kernels::Background(&bg_res.m_pixels[0], bg_color, size);
+    EXPECT_TRUE(bg_res.m_pixels == bg_expected.m_pixels);
+  }
+  Kernels::SetInstructionSet(supported);
+}
+
+//-----------------------------------------------------------------------------
+// timing only, run with --gtest_also_run_disabled_tests
+TEST(vtkh_compositing_kernels, DISABLED_vtkh_kernels_benchmark)
+{
+  const int dims[3] = {1024, 2048, 4096};
+  const int iterations = 10;
+  const unsigned char bg_color[4] = {0, 0, 0, 255};
+  const Kernels::InstructionSet supported = Kernels::GetSupportedInstructionSet();
+
+  for(int d = 0; d < 3; ++d)
+  {
+    const int size = dims[d] * dims[d];
+    TestImage front(size, 3);
+    TestImage back(size, 4);
+
+    for(int i = Kernels::SCALAR; i <= supported; ++i)
+    {
+      Kernels::SetInstructionSet(static_cast<Kernels::InstructionSet>(i));
+      const std::string name = Kernels::GetInstructionSetName(Kernels::GetInstructionSet());
+
+      vtkh::Timer timer;
+      for(int n = 0; n < iterations; ++n)
+      {
+        Kernels::ZBuffer(&front.m_pixels[0], &front.m_depths[0],
+                         &back.m_pixels[0], &back.m_depths[0], size);
+      }
+      const double z_time = timer.elapsed();
+
+      timer.reset();
+      for(int n = 0; n < iterations; ++n)
+      {
+        Kernels::Blend(&front.m_pixels[0], &front.m_depths[0],
+                       &back.m_pixels[0], &back.m_depths[0], size);
+      }
+      const double blend_time = timer.elapsed();
+
+      timer.reset();
+      for(int n = 0; n < iterations; ++n)
+      {
+        Kernels::Background(&front.m_pixels[0], bg_color, size);
+      }
+      const double bg_time = timer.elapsed();
+
+      const double pixels = static_cast<double>(size) * iterations;
+      std::cout<<dims[d]<<"x"<<dims[d]<<" "<<name
+               <<" zbuffer: "<<pixels / z_time<<" pixels/s"
+               <<" blend: "<<pixels / blend_time<<" pixels/s"
+               <<" background: "<<pixels / bg_time<<" pixels/s\n";
+    }
+  }
+  Kernels::SetInstructionSet(supported);
+}
@@ -65,3 +65,70 @@ TEST(vtkh_dataset, vtkh_range)
   EXPECT_EQ(3, topo_dims);
 
 }
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_dataset, vtkh_coalesce)
+{
+  vtkh::DataSet data_set;
+
+  const int base_size = 4;
+  const int num_blocks = 16;
+
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    data_set.AddDomain(CreateTestData(i, num_blocks, base_size), i);
+  }
+
+  const vtkm::Id dom_cells = data_set.GetDomain(0).GetCellSet().GetNumberOfCells();
+  const vtkm::Id dom_points =
+    data_set.GetDomain(0).GetCoordinateSystem().GetData().GetNumberOfValues();
+
+  // three domains fit in a batch
+  vtkh::DataSet coalesced = data_set.Coalesce(dom_cells * 3);
+  EXPECT_EQ(coalesced.GetNumberOfDomains(), 6);
+  EXPECT_EQ(coalesced.GetNumberOfCells(), data_set.GetNumberOfCells());
+  EXPECT_TRUE(coalesced.FieldExists("point_data_Float64"));
+  EXPECT_TRUE(coalesced.FieldExists("cell_data_Float32"));
+
+  std::vector<vtkm::Id> domain_ids = coalesced.GetDomainIds();
+  for(vtkm::Id i = 0; i < coalesced.GetNumberOfDomains(); ++i)
+  {
+    EXPECT_EQ(domain_ids[i], i * 3);
+    vtkm::cont::Field ids = coalesced.GetField(vtkh::DataSet::DOMAIN_ID_FIELD, i);
+    auto portal = ids.GetData().Cast<vtkm::cont::ArrayHandle<vtkm::Id>>().ReadPortal();
+    ASSERT_EQ(portal.GetNumberOfValues(),
+              coalesced.GetDomain(i).GetCellSet().GetNumberOfCells());
+    for(vtkm::Id c = 0; c < portal.GetNumberOfValues(); ++c)
+    {
+      EXPECT_EQ(portal.Get(c), i * 3 + c / dom_cells);
+    }
+  }
+
+  vtkh::DataSet split = coalesced.Split(data_set.GetDomainIds());
+  ASSERT_EQ(split.GetNumberOfDomains(), num_blocks);
+  EXPECT_FALSE(split.FieldExists(vtkh::DataSet::DOMAIN_ID_FIELD));
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    vtkm::cont::DataSet dom;
+    vtkm::Id domain_id;
+    split.GetDomain(i, dom, domain_id);
+    EXPECT_EQ(domain_id, i);
+    EXPECT_EQ(dom.GetCellSet().GetNumberOfCells(), dom_cells);
+    EXPECT_EQ(dom.GetCoordinateSystem().GetData().GetNumberOfValues(), dom_points);
+    EXPECT_EQ(split.GetDomainBounds(i), data_set.GetDomainBounds(i));
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Range> range = split.GetRange("point_data_Float64");
+  vtkm::cont::ArrayHandle<vtkm::Range> expected = data_set.GetRange("point_data_Float64");
+  EXPECT_EQ(range.ReadPortal().Get(0), expected.ReadPortal().Get(0));
+
+  // domains at or above the threshold are passed through
+  vtkh::DataSet passed = data_set.Coalesce(dom_cells);
+  EXPECT_EQ(passed.GetNumberOfDomains(), num_blocks);
+  int topo_dims;
+  EXPECT_TRUE(passed.IsStructured(topo_dims));
+
+  vtkh::DataSet single = data_set.Coalesce(data_set.GetNumberOfCells());
+  EXPECT_EQ(single.GetNumberOfDomains(), 1);
+  EXPECT_EQ(single.Split(data_set.GetDomainIds()).GetNumberOfDomains(), num_blocks);
+}
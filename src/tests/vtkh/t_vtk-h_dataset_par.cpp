@@ -61,6 +61,28 @@ TEST(vtkh_dataset_par, vtkh_range_par)
   scalar_range = data_set.GetGlobalRange("point_data_Float64");
   EXPECT_EQ(1, scalar_range.GetNumberOfValues());
 
+  std::vector<std::string> field_names;
+  field_names.push_back("point_data_Float64");
+  field_names.push_back("vector_data_Float64");
+  field_names.push_back("bananas");
+  vtkh::DataSet::GlobalMetadata meta = data_set.GetGlobalMetadata(field_names);
+
+  EXPECT_EQ(meta.m_bounds.X.Min, min_val);
+  EXPECT_EQ(meta.m_bounds.Z.Max, max_val);
+  EXPECT_EQ(meta.m_num_domains, num_blocks);
+  EXPECT_EQ(meta.m_num_cells, data_set.GetGlobalNumberOfCells());
+  EXPECT_EQ(true, meta.m_fields["point_data_Float64"].m_exists);
+  EXPECT_EQ(1, meta.m_fields["point_data_Float64"].m_num_components);
+  EXPECT_EQ(vtkm::cont::Field::Association::POINTS,
+            meta.m_fields["point_data_Float64"].m_association);
+  EXPECT_EQ(3, static_cast<int>(meta.m_fields["vector_data_Float64"].m_ranges.size()));
+  EXPECT_EQ(false, meta.m_fields["bananas"].m_exists);
+
+  vtkm::Range batched_range = meta.m_fields["point_data_Float64"].m_ranges[0];
+  vtkm::Range single_range = scalar_range.ReadPortal().Get(0);
+  EXPECT_EQ(single_range.Min, batched_range.Min);
+  EXPECT_EQ(single_range.Max, batched_range.Max);
+
   int topo_dims;
   EXPECT_EQ(true, data_set.IsStructured(topo_dims));
   EXPECT_EQ(3, topo_dims);
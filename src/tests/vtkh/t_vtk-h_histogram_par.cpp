@@ -12,6 +12,7 @@
 #include "t_test_utils.hpp"
 
 #include <iostream>
+#include <map>
 #include <mpi.h>
 
 //----------------------------------------------------------------------------
@@ -49,5 +50,38 @@ TEST(vtkh_histogram_par, vtkh_histogram_clamp_range)
 
   if(rank == 0) res.Print(std::cout);
 
+  // fused histogram of several fields with global ranges
+  std::vector<std::string> fields = {"point_data_Float64",
+                                     "cell_data_Float64",
+                                     "point_data_Float32"};
+  vtkh::Histogram fused;
+  fused.SetNumBins(64);
+  std::map<std::string, vtkh::Histogram::HistogramResult> results;
+  results = fused.Run(data_set, fields);
+  EXPECT_EQ(results.size(), fields.size());
+
+  const vtkm::Id num_points = results["point_data_Float64"].totalCount();
+  EXPECT_EQ(results["point_data_Float32"].totalCount(), num_points);
+  EXPECT_EQ(results["cell_data_Float64"].totalCount(), data_set.GetGlobalNumberOfCells());
+
+  for(const auto &field : fields)
+  {
+    vtkh::Histogram single;
+    single.SetNumBins(64);
+    vtkh::Histogram::HistogramResult expected = single.Run(data_set, field);
+    vtkh::Histogram::HistogramResult &actual = results[field];
+
+    vtkm::Range range = data_set.GetGlobalRange(field).ReadPortal().Get(0);
+    EXPECT_EQ(actual.m_range.Min, range.Min);
+    EXPECT_EQ(actual.m_range.Max, range.Max);
+    ASSERT_EQ(actual.m_bins.GetNumberOfValues(), 64);
+    auto expected_bins = expected.m_bins.ReadPortal();
+    auto actual_bins = actual.m_bins.ReadPortal();
+    for(vtkm::Id i = 0; i < 64; ++i)
+    {
+      EXPECT_EQ(actual_bins.Get(i), expected_bins.Get(i));
+    }
+  }
+
   MPI_Finalize();
 }
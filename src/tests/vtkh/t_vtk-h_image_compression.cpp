@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_image_compression.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/compositing/ImageCompression.hpp>
+#include "t_test_utils.hpp"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+void
+check_round_trip(const std::vector<unsigned char> &pixels,
+                 const std::vector<float> &depths,
+                 const int pixel_bytes,
+                 const bool expect_compressed)
+{
+  const int num_pixels = static_cast<int>(depths.size());
+  std::vector<unsigned char> buffer;
+  bool compressed = vtkh::ImageCompression::Encode(pixels.data(),
+                                                   depths.data(),
+                                                   num_pixels,
+                                                   pixel_bytes,
+                                                   buffer);
+  EXPECT_EQ(compressed, expect_compressed);
+  if(!compressed)
+  {
+    return;
+  }
+
+  const size_t raw_size = pixels.size() + depths.size() * sizeof(float);
+  EXPECT_LT(buffer.size(), raw_size);
+  std::cout<<"raw "<<raw_size<<" bytes encoded "<<buffer.size()<<" bytes\n";
+
+  std::vector<unsigned char> res_pixels(pixels.size());
+  std::vector<float> res_depths(depths.size());
+  vtkh::ImageCompression::Decode(buffer,
+                                 num_pixels,
+                                 pixel_bytes,
+                                 res_pixels.data(),
+                                 res_depths.data());
+  EXPECT_TRUE(res_pixels == pixels);
+  EXPECT_TRUE(res_depths == depths);
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_image_compression, vtkh_rle_round_trip)
+{
+  vtkh::ImageCompression::SetEnabled(true);
+  const int width = 512;
+  const int height = 512;
+  const int size = width * height;
+
+  // a disk of covered pixels on a background canvas
+  std::vector<unsigned char> pixels(size * 4, 0);
+  std::vector<float> depths(size, 1.01f);
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      const int dx = x - width / 2;
+      const int dy = y - height / 2;
+      if(dx * dx + dy * dy < 100 * 100)
+      {
+        const int i = y * width + x;
+        pixels[i * 4 + 0] = static_cast<unsigned char>(x);
+        pixels[i * 4 + 1] = static_cast<unsigned char>(y);
+        pixels[i * 4 + 2] = static_cast<unsigned char>(x + y);
+        pixels[i * 4 + 3] = 255;
+        depths[i] = static_cast<float>(x + y) / static_cast<float>(width + height);
+      }
+    }
+  }
+  check_round_trip(pixels, depths, 4, true);
+
+  // payload images use other pixel sizes
+  std::vector<unsigned char> payload(size * 12, 7);
+  for(int i = 0; i < size; i += 3)
+  {
+    payload[i * 12] = static_cast<unsigned char>(i);
+  }
+  std::vector<float> payload_depths(size, 0.5f);
+  check_round_trip(payload, payload_depths, 12, true);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_image_compression, vtkh_rle_fallback)
+{
+  vtkh::ImageCompression::SetEnabled(true);
+  // noise does not compress so the raw image is sent
+  const int size = 4096;
+  std::vector<unsigned char> pixels(size * 4);
+  std::vector<float> depths(size);
+  Noise noise(1);
+  for(int i = 0; i < size; ++i)
+  {
+    const unsigned int state = noise.raw();
+    for(int c = 0; c < 4; ++c)
+    {
+      pixels[i * 4 + c] = static_cast<unsigned char>((state >> (c * 8)) & 0xFF);
+    }
+    depths[i] = static_cast<float>(state % 1000) / 1000.f;
+  }
+  check_round_trip(pixels, depths, 4, false);
+
+  std::vector<unsigned char> empty_pixels(size * 4, 0);
+  std::vector<float> empty_depths(size, 1.01f);
+  vtkh::ImageCompression::SetEnabled(false);
+  check_round_trip(empty_pixels, empty_depths, 4, false);
+  vtkh::ImageCompression::SetEnabled(true);
+  check_round_trip(empty_pixels, empty_depths, 4, true);
+}
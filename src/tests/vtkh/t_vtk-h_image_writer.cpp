@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_image_writer.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/utils/ImageWriter.hpp>
+#include <vtkh/utils/PNGEncoder.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+std::vector<float> make_image(const int width, const int height, const int seed)
+{
+  std::vector<float> rgba(width * height * 4);
+  for(int i = 0; i < width * height; ++i)
+  {
+    rgba[i * 4 + 0] = static_cast<float>((i + seed) % width) / width;
+    rgba[i * 4 + 1] = static_cast<float>((i / width + seed) % height) / height;
+    rgba[i * 4 + 2] = 0.5f;
+    rgba[i * 4 + 3] = 1.f;
+  }
+  return rgba;
+}
+
+std::vector<char> read_file(const std::string &filename)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  return std::vector<char>((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_image_writer, vtkh_async_write)
+{
+  const int width = 256;
+  const int height = 128;
+  const int num_images = 12;
+
+  vtkh::ImageWriter writer(2, 3);
+  EXPECT_EQ(writer.GetMaxQueued(), 3);
+  vtkh::Timer timer;
+  for(int i = 0; i < num_images; ++i)
+  {
+    std::vector<float> rgba = make_image(width, height, i);
+    std::stringstream name;
+    name<<"image_writer_"<<i<<".png";
+    // the buffer can be released once push returns
+    writer.Push(&rgba[0], width, height, name.str());
+  }
+  writer.Wait();
+  std::cout<<num_images<<" images in "<<timer.elapsed()<<" s\n";
+  EXPECT_EQ(writer.GetNumberOfWritten(), num_images);
+
+  // same bytes as the synchronous encoder
+  for(int i = 0; i < num_images; i += 5)
+  {
+    std::vector<float> rgba = make_image(width, height, i);
+    vtkh::PNGEncoder encoder;
+    encoder.Encode(&rgba[0], width, height);
+    encoder.Save("image_writer_sync.png");
+
+    std::stringstream name;
+    name<<"image_writer_"<<i<<".png";
+    std::vector<char> async_bytes = read_file(name.str());
+    EXPECT_FALSE(async_bytes.empty());
+    EXPECT_EQ(async_bytes, read_file("image_writer_sync.png"));
+  }
+}
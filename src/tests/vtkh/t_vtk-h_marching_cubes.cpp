@@ -15,6 +15,36 @@
 
 #include <iostream>
 
+// the coalesced output must list the same domains with the same cells
+void ExpectSameDomains(vtkh::DataSet &expected, vtkh::DataSet &actual)
+{
+  EXPECT_EQ(actual.GetNumberOfCells(), expected.GetNumberOfCells());
+  EXPECT_EQ(actual.GetDomainIds(), expected.GetDomainIds());
+  const vtkm::Id num_domains = expected.GetNumberOfDomains();
+  ASSERT_EQ(actual.GetNumberOfDomains(), num_domains);
+  for(vtkm::Id i = 0; i < num_domains; ++i)
+  {
+    EXPECT_EQ(actual.GetDomain(i).GetCellSet().GetNumberOfCells(),
+              expected.GetDomain(i).GetCellSet().GetNumberOfCells());
+  }
+}
+
+// a point field of the given type holding the distance from the origin
+template<typename T>
+void AddMagnitudeField(vtkm::cont::DataSet &dom, const std::string &name)
+{
+  auto coords = dom.GetCoordinateSystem().GetData().ReadPortal();
+  const vtkm::Id size = coords.GetNumberOfValues();
+  vtkm::cont::ArrayHandle<T> data;
+  data.Allocate(size);
+  auto portal = data.WritePortal();
+  for(vtkm::Id i = 0; i < size; ++i)
+  {
+    portal.Set(i, static_cast<T>(vtkm::Magnitude(coords.Get(i)) + 1.f));
+  }
+  dom.AddField(vtkm::cont::Field(name, vtkm::cont::Field::Association::POINTS, data));
+}
+
 
 
 //----------------------------------------------------------------------------
@@ -166,3 +196,146 @@ TEST(vtkh_marching_cubes, vtkh_marching_cubes_recenter)
 
   delete iso_output;
 }
+//----------------------------------------------------------------------------
+TEST(vtkh_marching_cubes, vtkh_domain_parallel)
+{
+  vtkh::DataSet data_set;
+
+  // many small domains, like the patches of an amr mesh
+  const int base_size = 8;
+  const int num_blocks = 64;
+
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    data_set.AddDomain(CreateTestData(i, num_blocks, base_size), i);
+  }
+
+  const double iso_val = (float)base_size * (float)num_blocks * 0.5f;
+
+  vtkh::MarchingCubes serial_marcher;
+  serial_marcher.SetInput(&data_set);
+  serial_marcher.SetField("point_data_Float64");
+  serial_marcher.SetIsoValue(iso_val);
+  serial_marcher.SetDomainParallel(false);
+  serial_marcher.Update();
+  vtkh::DataSet *serial_output = serial_marcher.GetOutput();
+
+  vtkh::MarchingCubes marcher;
+  marcher.SetInput(&data_set);
+  marcher.SetField("point_data_Float64");
+  marcher.SetIsoValue(iso_val);
+  marcher.SetDomainParallel(true);
+  marcher.SetDomainBatchCells(1000);
+  EXPECT_TRUE(marcher.GetDomainParallel());
+  marcher.Update();
+  vtkh::DataSet *output = marcher.GetOutput();
+
+  // same domains in the same order
+  ASSERT_EQ(output->GetNumberOfDomains(), serial_output->GetNumberOfDomains());
+  for(int i = 0; i < output->GetNumberOfDomains(); ++i)
+  {
+    vtkm::cont::DataSet serial_dom, dom;
+    vtkm::Id serial_id, id;
+    serial_output->GetDomain(i, serial_dom, serial_id);
+    output->GetDomain(i, dom, id);
+    EXPECT_EQ(id, serial_id);
+    EXPECT_EQ(dom.GetCellSet().GetNumberOfCells(),
+              serial_dom.GetCellSet().GetNumberOfCells());
+  }
+  EXPECT_EQ(output->GetNumberOfCells(), serial_output->GetNumberOfCells());
+
+  delete serial_output;
+  delete output;
+}
+
+//----------------------------------------------------------------------------
+TEST(vtkh_marching_cubes, vtkh_coalesce)
+{
+  vtkh::DataSet data_set;
+
+  // many small domains, like the patches of an amr mesh
+  const int base_size = 8;
+  const int num_blocks = 64;
+
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    data_set.AddDomain(CreateTestData(i, num_blocks, base_size), i);
+  }
+
+  const double iso_val = (float)base_size * (float)num_blocks * 0.5f;
+
+  vtkh::MarchingCubes plain_marcher;
+  plain_marcher.SetInput(&data_set);
+  plain_marcher.SetField("point_data_Float64");
+  plain_marcher.SetIsoValue(iso_val);
+  plain_marcher.SetCoalesceCells(0);
+  plain_marcher.Update();
+  vtkh::DataSet *plain_output = plain_marcher.GetOutput();
+
+  vtkh::MarchingCubes marcher;
+  marcher.SetInput(&data_set);
+  marcher.SetField("point_data_Float64");
+  marcher.SetIsoValue(iso_val);
+  marcher.AddMapField("cell_data_Float64");
+  marcher.SetCoalesceCells(10000);
+  EXPECT_EQ(marcher.GetCoalesceCells(), 10000);
+  marcher.Update();
+  vtkh::DataSet *output = marcher.GetOutput();
+
+  // split back to the domains of the input
+  EXPECT_FALSE(output->FieldExists(vtkh::DataSet::DOMAIN_ID_FIELD));
+  EXPECT_TRUE(output->FieldExists("cell_data_Float64"));
+  ExpectSameDomains(*plain_output, *output);
+
+  delete plain_output;
+  delete output;
+}
+
+//----------------------------------------------------------------------------
+TEST(vtkh_marching_cubes, vtkh_coalesce_mixed_types)
+{
+  vtkh::DataSet data_set;
+
+  const int base_size = 8;
+  const int num_blocks = 32;
+
+  // runs of four domains alternate between a 64 and a 32 bit field
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    vtkm::cont::DataSet dom = CreateTestData(i, num_blocks, base_size);
+    if((i / 4) % 2 == 0)
+    {
+      AddMagnitudeField<vtkm::Float64>(dom, "point_data_mixed");
+    }
+    else
+    {
+      AddMagnitudeField<vtkm::Float32>(dom, "point_data_mixed");
+    }
+    data_set.AddDomain(dom, i);
+  }
+
+  const double iso_val = (float)base_size * (float)num_blocks * 0.5f;
+
+  vtkh::MarchingCubes plain_marcher;
+  plain_marcher.SetInput(&data_set);
+  plain_marcher.SetField("point_data_mixed");
+  plain_marcher.SetIsoValue(iso_val);
+  plain_marcher.SetCoalesceCells(0);
+  plain_marcher.Update();
+  vtkh::DataSet *plain_output = plain_marcher.GetOutput();
+
+  vtkh::MarchingCubes marcher;
+  marcher.SetInput(&data_set);
+  marcher.SetField("point_data_mixed");
+  marcher.SetIsoValue(iso_val);
+  marcher.SetCoalesceCells(10000);
+  marcher.Update();
+  vtkh::DataSet *output = marcher.GetOutput();
+
+  EXPECT_GT(plain_output->GetNumberOfCells(), 0);
+  EXPECT_TRUE(output->FieldExists("point_data_mixed"));
+  ExpectSameDomains(*plain_output, *output);
+
+  delete plain_output;
+  delete output;
+}
@@ -0,0 +1,331 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_partial_compositor.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/compositing/PartialCompositor.hpp>
+#include <vtkh/compositing/RadixSort.hpp>
+#include "t_test_utils.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+void set_payload(vtkh::VolumePartial<float> &partial, Noise &noise, const int)
+{
+  partial.m_alpha = noise.unit() * 0.5f;
+  partial.m_pixel[0] = noise.unit() * partial.m_alpha;
+  partial.m_pixel[1] = noise.unit() * partial.m_alpha;
+  partial.m_pixel[2] = noise.unit() * partial.m_alpha;
+}
+
+void set_payload(vtkh::AbsorptionPartial<float> &partial, Noise &noise, const int num_bins)
+{
+  partial.m_bins.resize(num_bins);
+  for(int b = 0; b < num_bins; ++b)
+  {
+    partial.m_bins[b] = 0.5f + noise.unit() * 0.5f;
+  }
+}
+
+void set_payload(vtkh::EmissionPartial<float> &partial, Noise &noise, const int num_bins)
+{
+  partial.m_bins.resize(num_bins);
+  partial.m_emission_bins.resize(num_bins);
+  for(int b = 0; b < num_bins; ++b)
+  {
+    partial.m_bins[b] = 0.5f + noise.unit() * 0.5f;
+    partial.m_emission_bins[b] = noise.unit();
+  }
+}
+
+// several partials per pixel, split over a few partial images
+template<typename PartialType>
+std::vector<std::vector<PartialType>>
+make_partials(const int count, const int num_pixels, const int num_bins)
+{
+  Noise noise(7);
+  std::vector<std::vector<PartialType>> images(3);
+  for(int i = 0; i < count; ++i)
+  {
+    PartialType partial;
+    partial.m_pixel_id = static_cast<int>(noise.next() % num_pixels);
+    // unique depths so the order of a pixel is well defined
+    partial.m_depth = static_cast<float>(i % 1000) + noise.unit() * 0.5f;
+    set_payload(partial, noise, num_bins);
+    images[i % 3].push_back(partial);
+  }
+  return images;
+}
+
+template<typename PartialType>
+bool pixel_order(const PartialType &a, const PartialType &b)
+{
+  return a.m_pixel_id < b.m_pixel_id;
+}
+
+template<typename PartialType>
+std::vector<PartialType>
+composite(std::vector<std::vector<PartialType>> images)
+{
+  vtkh::PartialCompositor<PartialType> compositor;
+  std::vector<PartialType> output;
+  compositor.composite(images, output);
+  std::sort(output.begin(), output.end(), pixel_order<PartialType>);
+  return output;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor, vtkh_radix_sort)
+{
+  Noise noise(3);
+  const int size = 200000;
+  std::vector<unsigned int> pixel_keys(size);
+  std::vector<unsigned long long> depth_keys(size);
+  std::vector<int> index(size);
+  std::vector<std::pair<int,float>> expected(size);
+  for(int i = 0; i < size; ++i)
+  {
+    const int pixel = static_cast<int>(noise.next() % 5000) - 100;
+    const float depth = (noise.unit() - 0.5f) * 100.f;
+    pixel_keys[i] = vtkh::RadixSort::PixelKey(pixel);
+    depth_keys[i] = vtkh::RadixSort::DepthKey(depth);
+    index[i] = i;
+    expected[i] = std::make_pair(pixel, depth);
+  }
+  std::vector<std::pair<int,float>> values = expected;
+  std::stable_sort(expected.begin(), expected.end());
+
+  vtkh::RadixSort::SortByKey(pixel_keys, depth_keys, index);
+  for(int i = 0; i < size; ++i)
+  {
+    ASSERT_EQ(values[index[i]], expected[i]);
+  }
+
+  std::vector<unsigned char> flags(size);
+  for(int i = 0; i < size; ++i)
+  {
+    flags[i] = static_cast<unsigned char>(i % 3 == 0);
+  }
+  std::vector<int> offsets;
+  EXPECT_EQ(vtkh::RadixSort::ExclusiveScan(flags, offsets), (size + 2) / 3);
+  for(int i = 0; i < size; ++i)
+  {
+    ASSERT_EQ(offsets[i], (i + 2) / 3);
+  }
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor, vtkh_volume_partials)
+{
+  typedef vtkh::VolumePartial<float> Partial;
+  const int num_pixels = 5000;
+  std::vector<std::vector<Partial>> images = make_partials<Partial>(40000, num_pixels, 0);
+
+  // reference: front to back blending of each pixel
+  std::vector<Partial> all;
+  for(const auto &image : images)
+  {
+    all.insert(all.end(), image.begin(), image.end());
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<Partial> expected;
+  for(const auto &partial : all)
+  {
+    if(expected.empty() || expected.back().m_pixel_id != partial.m_pixel_id)
+    {
+      expected.push_back(partial);
+    }
+    else
+    {
+      expected.back().blend(partial);
+    }
+  }
+
+  std::vector<Partial> output = composite(images);
+  ASSERT_EQ(output.size(), expected.size());
+  for(size_t i = 0; i < output.size(); ++i)
+  {
+    ASSERT_EQ(output[i].m_pixel_id, expected[i].m_pixel_id);
+    EXPECT_FLOAT_EQ(output[i].m_alpha, expected[i].m_alpha);
+    EXPECT_FLOAT_EQ(output[i].m_pixel[0], expected[i].m_pixel[0]);
+  }
+
+  // a single partial
+  std::vector<std::vector<Partial>> single(1, std::vector<Partial>(1, all[0]));
+  output = composite(single);
+  ASSERT_EQ(output.size(), 1);
+  EXPECT_EQ(output[0].m_pixel_id, all[0].m_pixel_id);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor, vtkh_volume_partial_arrays)
+{
+  typedef vtkh::VolumePartial<float> Partial;
+  std::vector<std::vector<Partial>> images = make_partials<Partial>(40000, 5000, 0);
+
+  // the same partials in structure of arrays form
+  std::vector<vtkh::VolumePartialArrays> arrays(images.size());
+  for(size_t i = 0; i < images.size(); ++i)
+  {
+    const int size = static_cast<int>(images[i].size());
+    arrays[i].resize(size);
+    for(int p = 0; p < size; ++p)
+    {
+      arrays[i].m_pixel_ids[p] = images[i][p].m_pixel_id;
+      arrays[i].m_depths[p] = images[i][p].m_depth;
+      arrays[i].m_colors[p * 4 + 0] = images[i][p].m_pixel[0];
+      arrays[i].m_colors[p * 4 + 1] = images[i][p].m_pixel[1];
+      arrays[i].m_colors[p * 4 + 2] = images[i][p].m_pixel[2];
+      arrays[i].m_colors[p * 4 + 3] = images[i][p].m_alpha;
+    }
+  }
+
+  std::vector<Partial> expected = composite(images);
+
+  vtkh::PartialCompositor<Partial> compositor;
+  std::vector<Partial> output;
+  vtkh::composite_arrays(compositor, arrays, output);
+  std::sort(output.begin(), output.end(), pixel_order<Partial>);
+
+  ASSERT_EQ(output.size(), expected.size());
+  for(size_t i = 0; i < output.size(); ++i)
+  {
+    ASSERT_EQ(output[i].m_pixel_id, expected[i].m_pixel_id);
+    EXPECT_EQ(output[i].m_alpha, expected[i].m_alpha);
+    EXPECT_EQ(output[i].m_pixel[0], expected[i].m_pixel[0]);
+    EXPECT_EQ(output[i].m_pixel[2], expected[i].m_pixel[2]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor, vtkh_absorption_partials)
+{
+  typedef vtkh::AbsorptionPartial<float> Partial;
+  const int num_pixels = 3000;
+  const int num_bins = 4;
+  std::vector<std::vector<Partial>> images = make_partials<Partial>(20000, num_pixels, num_bins);
+
+  std::vector<std::vector<double>> expected(num_pixels, std::vector<double>(num_bins, 1.));
+  std::vector<int> counts(num_pixels, 0);
+  for(const auto &image : images)
+  {
+    for(const auto &partial : image)
+    {
+      counts[partial.m_pixel_id]++;
+      for(int b = 0; b < num_bins; ++b)
+      {
+        expected[partial.m_pixel_id][b] *= partial.m_bins[b];
+      }
+    }
+  }
+
+  std::vector<Partial> output = composite(images);
+  const int num_hit = static_cast<int>(num_pixels - std::count(counts.begin(), counts.end(), 0));
+  ASSERT_EQ(static_cast<int>(output.size()), num_hit);
+  for(const auto &partial : output)
+  {
+    for(int b = 0; b < num_bins; ++b)
+    {
+      EXPECT_NEAR(partial.m_bins[b], expected[partial.m_pixel_id][b], 1e-5);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor, vtkh_emission_partials)
+{
+  typedef vtkh::EmissionPartial<float> Partial;
+  const int num_pixels = 3000;
+  const int num_bins = 2;
+  std::vector<std::vector<Partial>> images = make_partials<Partial>(20000, num_pixels, num_bins);
+
+  // reference: sum of the emission of each segment attenuated by
+  // the segments between it and the detector (the deepest segment)
+  std::vector<Partial> all;
+  for(const auto &image : images)
+  {
+    all.insert(all.end(), image.begin(), image.end());
+  }
+  std::sort(all.begin(), all.end());
+  std::vector<int> pixels;
+  std::vector<std::vector<double>> expected;
+  size_t begin = 0;
+  while(begin < all.size())
+  {
+    size_t end = begin;
+    while(end < all.size() && all[end].m_pixel_id == all[begin].m_pixel_id) end++;
+    std::vector<double> emission(num_bins, 0.);
+    for(int b = 0; b < num_bins; ++b)
+    {
+      double absorption = 1.;
+      for(size_t i = end; i > begin; --i)
+      {
+        emission[b] += all[i - 1].m_emission_bins[b] * absorption;
+        absorption *= all[i - 1].m_bins[b];
+      }
+    }
+    pixels.push_back(all[begin].m_pixel_id);
+    expected.push_back(emission);
+    begin = end;
+  }
+
+  std::vector<Partial> output = composite(images);
+  ASSERT_EQ(output.size(), pixels.size());
+  for(size_t i = 0; i < output.size(); ++i)
+  {
+    ASSERT_EQ(output[i].m_pixel_id, pixels[i]);
+    for(int b = 0; b < num_bins; ++b)
+    {
+      EXPECT_NEAR(output[i].m_emission_bins[b], expected[i][b], 1e-4);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// partials per second for 1M partials. Larger counts (up to 100M) can
+// be requested with VTKH_PARTIAL_BENCHMARK_MAX=<count>
+//-----------------------------------------------------------------------------
+template<typename PartialType>
+void benchmark(const std::string &name, const int num_bins)
+{
+  long long max_count = 1000000;
+  const char *max_env = std::getenv("VTKH_PARTIAL_BENCHMARK_MAX");
+  if(max_env != nullptr)
+  {
+    max_count = std::atoll(max_env);
+  }
+
+  for(long long count = 1000000; count <= max_count && count <= 100000000; count *= 10)
+  {
+    const int num_pixels = 2048 * 2048;
+    std::vector<std::vector<PartialType>> images =
+      make_partials<PartialType>(static_cast<int>(count), num_pixels, num_bins);
+
+    vtkh::PartialCompositor<PartialType> compositor;
+    std::vector<PartialType> output;
+    vtkh::Timer timer;
+    compositor.composite(images, output);
+    const double time = timer.elapsed();
+    std::cout<<name<<" "<<count<<" partials: "<<count / time<<" partials/s\n";
+  }
+}
+
+// timing only, run with --gtest_also_run_disabled_tests
+TEST(vtkh_partial_compositor, DISABLED_vtkh_partial_benchmark)
+{
+  benchmark<vtkh::VolumePartial<float>>("volume", 0);
+  benchmark<vtkh::AbsorptionPartial<float>>("absorption", 4);
+  benchmark<vtkh::EmissionPartial<float>>("emission", 4);
+}
@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_partial_compositor_par.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/compositing/PartialCompositor.hpp>
+#include "t_test_utils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <mpi.h>
+
+namespace
+{
+
+typedef vtkh::VolumePartial<float> Partial;
+
+// most of the partials land in the first tenth of the image
+std::vector<std::vector<Partial>> make_partials(const int rank)
+{
+  const int num_pixels = 10000;
+  Noise noise(17 + rank);
+  std::vector<std::vector<Partial>> images(1);
+  for(int i = 0; i < 20000; ++i)
+  {
+    const int pixel = static_cast<int>(noise.next());
+    Partial partial;
+    partial.m_pixel_id = (i % 10 == 0) ? pixel % num_pixels : pixel % (num_pixels / 10);
+    partial.m_depth = static_cast<float>(rank * 20000 + i);
+    partial.m_alpha = 0.1f;
+    partial.m_pixel[0] = 0.1f;
+    partial.m_pixel[1] = 0.05f;
+    partial.m_pixel[2] = 0.f;
+    images[0].push_back(partial);
+  }
+  return images;
+}
+
+bool pixel_order(const Partial &a, const Partial &b)
+{
+  return a.m_pixel_id < b.m_pixel_id;
+}
+
+} // namespace
+
+//----------------------------------------------------------------------------
+TEST(vtkh_partial_compositor_par, vtkh_balanced_redistribution)
+{
+  MPI_Init(NULL, NULL);
+  int comm_size, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  vtkh::SetMPICommHandle(MPI_Comm_c2f(MPI_COMM_WORLD));
+
+  std::vector<Partial> outputs[2];
+  float imbalance[2];
+  const vtkh::PartialCompositor<Partial>::RedistributionMode modes[2] =
+    {vtkh::PartialCompositor<Partial>::EVEN_PIXELS,
+     vtkh::PartialCompositor<Partial>::BALANCED_PARTIALS};
+
+  for(int i = 0; i < 2; ++i)
+  {
+    std::vector<std::vector<Partial>> images = make_partials(rank);
+    vtkh::PartialCompositor<Partial> compositor;
+    compositor.set_comm_handle(MPI_Comm_c2f(MPI_COMM_WORLD));
+    compositor.set_redistribution_mode(modes[i]);
+    compositor.composite(images, outputs[i]);
+    imbalance[i] = compositor.get_imbalance();
+    std::sort(outputs[i].begin(), outputs[i].end(), pixel_order);
+  }
+
+  if(rank == 0)
+  {
+    std::cout<<"imbalance even "<<imbalance[0]<<" balanced "<<imbalance[1]<<"\n";
+  }
+  EXPECT_LE(imbalance[1], imbalance[0]);
+  EXPECT_LT(imbalance[1], 1.25f);
+
+  // the split of the image does not change the result
+  ASSERT_EQ(outputs[0].size(), outputs[1].size());
+  for(size_t i = 0; i < outputs[0].size(); ++i)
+  {
+    ASSERT_EQ(outputs[0][i].m_pixel_id, outputs[1][i].m_pixel_id);
+    EXPECT_FLOAT_EQ(outputs[0][i].m_alpha, outputs[1][i].m_alpha);
+  }
+
+  MPI_Finalize();
+}
@@ -83,6 +83,32 @@ TEST(vtkh_particle_advection, vtkh_serial_particle_advection)
   checkValidity(streamline_output, maxAdvSteps);
   writeDataSet(streamline_output, "advection_SeedsRandomWhole", rank);
 
+  // every seed produces at least one polyline
+  long long int num_lines = 0;
+  for(int i = 0; i < streamline_output->GetNumberOfDomains(); i++)
+  {
+    vtkm::cont::DataSet dom = streamline_output->GetDomain(i);
+    EXPECT_TRUE(dom.HasField("steps"));
+    EXPECT_TRUE(dom.HasField("time"));
+    EXPECT_TRUE(dom.HasField("seed_id"));
+    num_lines += dom.GetCellSet().GetNumberOfCells();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &num_lines, 1, MPI_LONG_LONG_INT, MPI_SUM, MPI_COMM_WORLD);
+  EXPECT_GE(num_lines, 500);
+
+  // same seeds traced by several worker threads per rank
+  vtkh::ParticleAdvection threaded;
+  threaded.SetInput(&data_set);
+  threaded.SetField("vector_data_Float64");
+  threaded.SetMaxSteps(maxAdvSteps);
+  threaded.SetStepSize(0.1);
+  threaded.SetSeedsRandomWhole(500);
+  threaded.SetUseThreadedVersion(true);
+  threaded.SetNumberOfWorkerThreads(4);
+  threaded.Update();
+
+  checkValidity(threaded.GetOutput(), maxAdvSteps);
+
   MPI_Barrier(MPI_COMM_WORLD);
   MPI_Finalize();
 }
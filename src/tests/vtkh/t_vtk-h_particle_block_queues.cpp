@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_particle_block_queues.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/filters/ParticleBlockQueues.hpp>
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+vtkh::Particle make_particle(const int id, const int block)
+{
+  vtkh::Particle p(vtkm::Vec3f(0.f, 0.f, 0.f), id);
+  p.blockIds.push_back(block);
+  return p;
+}
+
+// blocks 0..3 with 1, 4, 2 and 3 particles inserted interleaved
+std::vector<vtkh::Particle> make_particles()
+{
+  const int blocks[10] = {2, 1, 3, 1, 0, 3, 1, 2, 3, 1};
+  std::vector<vtkh::Particle> particles;
+  for(int i = 0; i < 10; ++i)
+  {
+    particles.push_back(make_particle(i, blocks[i]));
+  }
+  return particles;
+}
+
+std::vector<int> block_order(vtkh::ParticleBlockQueues &queues)
+{
+  std::vector<int> order;
+  std::vector<vtkh::Particle> batch;
+  while(queues.Get(batch))
+  {
+    for(const auto &p : batch)
+    {
+      EXPECT_EQ(p.blockIds[0], batch[0].blockIds[0]);
+    }
+    order.push_back(batch[0].blockIds[0]);
+  }
+  return order;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_block_queues, vtkh_round_robin)
+{
+  vtkh::ParticleBlockQueues queues;
+  queues.Insert(make_particles());
+  EXPECT_EQ(queues.Size(), 10);
+  EXPECT_EQ(queues.GetNumberOfBlocks(), 4);
+
+  std::vector<int> expected = {2, 1, 3, 0};
+  EXPECT_EQ(block_order(queues), expected);
+  EXPECT_TRUE(queues.Empty());
+  EXPECT_EQ(queues.GetNumberOfBlocks(), 0);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_block_queues, vtkh_largest_first)
+{
+  vtkh::ParticleBlockQueues queues(vtkh::ParticleBlockQueues::LARGEST_FIRST);
+  queues.Insert(make_particles());
+
+  std::vector<vtkh::Particle> batch;
+  ASSERT_TRUE(queues.Get(batch));
+  EXPECT_EQ(batch.size(), 4);
+  EXPECT_EQ(batch[0].blockIds[0], 1);
+  // particle order within a block is kept
+  EXPECT_EQ(batch[0].p.ID, 1);
+  EXPECT_EQ(batch[3].p.ID, 9);
+
+  // block 0 grows to the largest block
+  for(int i = 0; i < 5; ++i)
+  {
+    queues.Insert(make_particle(100 + i, 0));
+  }
+  std::vector<int> expected = {0, 3, 2};
+  EXPECT_EQ(block_order(queues), expected);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_block_queues, vtkh_locality)
+{
+  vtkh::ParticleBlockQueues queues;
+  queues.Insert(make_particles());
+  // the policy can be switched with particles in the queues
+  queues.SetPolicy(vtkh::ParticleBlockQueues::LOCALITY);
+
+  std::vector<vtkh::Particle> batch;
+  ASSERT_TRUE(queues.Get(batch));
+  EXPECT_EQ(batch[0].blockIds[0], 2);
+
+  // particles that stay in the block are processed next
+  queues.Insert(make_particle(50, 2));
+  ASSERT_TRUE(queues.Get(batch));
+  EXPECT_EQ(batch[0].blockIds[0], 2);
+  EXPECT_EQ(batch.size(), 1);
+
+  std::vector<int> expected = {1, 3, 0};
+  EXPECT_EQ(block_order(queues), expected);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_block_queues, vtkh_many_particles)
+{
+  const int num_particles = 2000000;
+  const int num_blocks = 1000;
+  const vtkh::ParticleBlockQueues::SelectionPolicy policies[3] =
+    {vtkh::ParticleBlockQueues::ROUND_ROBIN,
+     vtkh::ParticleBlockQueues::LARGEST_FIRST,
+     vtkh::ParticleBlockQueues::LOCALITY};
+
+  std::vector<vtkh::Particle> particles;
+  for(int i = 0; i < num_particles; ++i)
+  {
+    particles.push_back(make_particle(i, static_cast<int>((i * 7919LL) % num_blocks)));
+  }
+
+  for(int i = 0; i < 3; ++i)
+  {
+    vtkh::Timer timer;
+    vtkh::ParticleBlockQueues queues(policies[i]);
+    queues.Insert(particles);
+    EXPECT_EQ(queues.GetNumberOfBlocks(), num_blocks);
+
+    size_t total = 0;
+    int batches = 0;
+    std::vector<vtkh::Particle> batch;
+    while(queues.Get(batch))
+    {
+      total += batch.size();
+      batches++;
+    }
+    EXPECT_EQ(total, num_particles);
+    EXPECT_EQ(batches, num_blocks);
+    std::cout<<"policy "<<policies[i]<<": "<<num_particles<<" particles in "
+             <<timer.elapsed()<<" s\n";
+  }
+}
@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_particle_work_queue.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/filters/ParticleWorkQueue.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::vector<vtkh::Particle> make_particles(const int count, const int num_blocks)
+{
+  std::vector<vtkh::Particle> particles;
+  for(int i = 0; i < count; ++i)
+  {
+    vtkh::Particle p(vtkm::Vec3f(0.f, 0.f, 0.f), i);
+    p.blockIds.push_back(i % num_blocks);
+    particles.push_back(p);
+  }
+  return particles;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_work_queue, vtkh_batches_by_block)
+{
+  vtkh::ParticleWorkQueue queue;
+  queue.Init(2);
+  queue.Insert(make_particles(100, 7));
+  EXPECT_EQ(queue.Size(), 100);
+
+  int total = 0;
+  std::vector<vtkh::Particle> batch;
+  bool stolen;
+  // worker 0 drains its own blocks and then steals the rest
+  while(queue.TryGet(0, batch, stolen))
+  {
+    ASSERT_FALSE(batch.empty());
+    const int block = batch[0].blockIds[0];
+    for(const auto &p : batch)
+    {
+      EXPECT_EQ(p.blockIds[0], block);
+    }
+    EXPECT_EQ(stolen, block % 2 != 0);
+    total += static_cast<int>(batch.size());
+  }
+  EXPECT_EQ(total, 100);
+  EXPECT_TRUE(queue.Empty());
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_work_queue, vtkh_blocks_in_flight)
+{
+  vtkh::ParticleWorkQueue queue;
+  queue.Init(2);
+  queue.Insert(make_particles(10, 1));
+
+  std::vector<vtkh::Particle> batch;
+  bool stolen;
+  ASSERT_TRUE(queue.TryGet(0, batch, stolen));
+  EXPECT_EQ(batch.size(), 10);
+
+  // particles of block 0 arrive while worker 0 advects it
+  queue.Insert(make_particles(5, 1));
+  EXPECT_EQ(queue.Size(), 5);
+  EXPECT_FALSE(queue.TryGet(0, batch, stolen));
+  EXPECT_FALSE(queue.TryGet(1, batch, stolen));
+
+  queue.Release(0);
+  ASSERT_TRUE(queue.TryGet(1, batch, stolen));
+  EXPECT_TRUE(stolen);
+  EXPECT_EQ(batch.size(), 5);
+  EXPECT_TRUE(queue.Empty());
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_particle_work_queue, vtkh_threaded_workers)
+{
+  const int num_workers = 4;
+  const int num_particles = 20000;
+  const int num_blocks = 13;
+  const int num_rounds = 3;
+
+  vtkh::ParticleWorkQueue queue;
+  queue.Init(num_workers);
+
+  std::vector<std::atomic<int>> visits(num_particles);
+  for(auto &v : visits)
+  {
+    v = 0;
+  }
+  std::vector<std::atomic<int>> in_block(num_blocks);
+  for(auto &b : in_block)
+  {
+    b = 0;
+  }
+  std::atomic<int> finished(0);
+  std::atomic<int> steals(0);
+  std::atomic<int> shared_blocks(0);
+
+  // every particle is processed num_rounds times: workers push particles
+  // back into the queue (moving them to the next block) until then
+  auto work = [&](int id)
+  {
+    std::vector<vtkh::Particle> batch;
+    bool stolen, waited;
+    while(queue.Get(id, batch, stolen, waited))
+    {
+      const int block = batch[0].blockIds[0];
+      // no other worker may hold the same block
+      shared_blocks += ++in_block[block] == 1 ? 0 : 1;
+      steals += stolen ? 1 : 0;
+      std::vector<vtkh::Particle> again;
+      for(auto &p : batch)
+      {
+        const int count = ++visits[p.p.ID];
+        if(count < num_rounds)
+        {
+          p.blockIds[0] = (p.blockIds[0] + 1) % num_blocks;
+          again.push_back(p);
+        }
+        else
+        {
+          finished++;
+        }
+      }
+      queue.Insert(again);
+      in_block[block]--;
+      queue.Release(block);
+      if(finished == num_particles)
+      {
+        queue.SetDone();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for(int i = 0; i < num_workers; ++i)
+  {
+    threads.push_back(std::thread(work, i));
+  }
+  queue.Insert(make_particles(num_particles, num_blocks));
+  for(auto &t : threads)
+  {
+    t.join();
+  }
+
+  EXPECT_EQ(finished, num_particles);
+  EXPECT_EQ(shared_blocks, 0);
+  EXPECT_TRUE(queue.Empty());
+  for(int i = 0; i < num_particles; ++i)
+  {
+    EXPECT_EQ(visits[i], num_rounds);
+  }
+  std::cout<<"steals: "<<steals<<"\n";
+}
@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_perf_summary_par.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <mpi.h>
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Logger.hpp>
+#include <vtkh/PerfSummary.hpp>
+#include <vtkh/StatisticsDB.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+//----------------------------------------------------------------------------
+TEST(vtkh_perf_summary_par, vtkh_perf_summary)
+{
+  MPI_Init(NULL, NULL);
+  int comm_size, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  vtkh::SetMPICommHandle(MPI_Comm_c2f(MPI_COMM_WORLD));
+
+  vtkh::PerfSummary summary;
+  // rank r spends r + 1 seconds in two calls
+  summary.Add("work", 0.5 * (rank + 1));
+  summary.Add("work", 0.5 * (rank + 1));
+  // only the odd ranks have this one
+  if(rank % 2 == 1)
+  {
+    summary.Add("odd", 1.0);
+  }
+
+  vtkh::DataLogger *logger = vtkh::DataLogger::GetInstance();
+  logger->SetYAMLEnabled(false);
+  logger->SetSummaryEnabled(true);
+  logger->ResetRegionTimes();
+  logger->OpenLogEntry("outer");
+  logger->OpenLogEntry("inner");
+  logger->CloseLogEntry();
+  logger->OpenLogEntry("inner");
+  logger->CloseLogEntry();
+  logger->CloseLogEntry();
+  summary.AddDataLog();
+
+  vtkh::StatisticsDB db;
+  db.AddTimer("timer");
+  summary.AddStatistics(db, "stats_");
+
+  std::vector<vtkh::PerfSummary::Region> regions = summary.Reduce();
+
+  if(rank == 0)
+  {
+    ASSERT_EQ(regions.size(), comm_size > 1 ? 5 : 4);
+    // sorted by the max time
+    EXPECT_EQ(regions[0].m_name, std::string("work"));
+    const vtkh::PerfSummary::Region &work = regions[0];
+    const double n = comm_size;
+    EXPECT_EQ(work.m_ranks, comm_size);
+    EXPECT_EQ(work.m_calls, 2 * comm_size);
+    EXPECT_EQ(work.m_min, 1.0);
+    EXPECT_EQ(work.m_min_rank, 0);
+    EXPECT_EQ(work.m_max, n);
+    EXPECT_EQ(work.m_max_rank, comm_size - 1);
+    EXPECT_TRUE(std::abs(work.m_mean - (n + 1.) / 2.) < 1e-12);
+    EXPECT_TRUE(std::abs(work.m_stddev - std::sqrt((n * n - 1.) / 12.)) < 1e-12);
+
+    for(const auto &region : regions)
+    {
+      if(region.m_name == "odd")
+      {
+        EXPECT_EQ(region.m_ranks, comm_size / 2);
+        EXPECT_EQ(region.m_min_rank, 1);
+        EXPECT_EQ(region.m_stddev, 0.);
+      }
+      else if(region.m_name == "inner")
+      {
+        EXPECT_EQ(region.m_calls, 2 * comm_size);
+      }
+      else if(region.m_name == "work" || region.m_name == "outer" ||
+              region.m_name == "stats_timer")
+      {
+        EXPECT_EQ(region.m_ranks, comm_size);
+      }
+      else
+      {
+        EXPECT_TRUE(false) << region.m_name;
+      }
+    }
+  }
+  else
+  {
+    EXPECT_EQ(regions.size(), 0);
+  }
+
+  summary.Write("tout_perf_summary.yaml");
+  if(rank == 0)
+  {
+    std::ifstream file("tout_perf_summary.yaml");
+    std::stringstream ss;
+    ss<<file.rdbuf();
+    const std::string yaml = ss.str();
+    std::cout<<yaml;
+    EXPECT_EQ(yaml.find("ranks: " + std::to_string(comm_size) + "\n"), 0);
+    EXPECT_TRUE(yaml.find("  - {name: \"work\", ranks: ") != std::string::npos);
+  }
+
+  logger->SetSummaryEnabled(false);
+  MPI_Finalize();
+}
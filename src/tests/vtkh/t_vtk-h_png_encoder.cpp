@@ -0,0 +1,140 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_png_encoder.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/utils/PNGEncoder.hpp>
+#include "t_test_utils.hpp"
+#include <lodepng.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+// smooth gradients with some noise, like a rendered image
+std::vector<float> make_image(const int width, const int height)
+{
+  std::vector<float> rgba(width * height * 4);
+  Noise noise(11);
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      const int offset = (y * width + x) * 4;
+      rgba[offset + 0] = static_cast<float>(x) / width;
+      rgba[offset + 1] = static_cast<float>(y) / height;
+      rgba[offset + 2] = static_cast<float>(noise.next() % 16) / 255.f;
+      rgba[offset + 3] = 1.f;
+    }
+  }
+  return rgba;
+}
+
+// the pixels a png of the image should decode to
+std::vector<unsigned char> expected_pixels(const std::vector<float> &rgba,
+                                           const int width,
+                                           const int height)
+{
+  std::vector<unsigned char> pixels(rgba.size());
+  for(int y = 0; y < height; ++y)
+  {
+    for(int i = 0; i < width * 4; ++i)
+    {
+      pixels[(height - y - 1) * width * 4 + i] =
+        static_cast<unsigned char>(rgba[y * width * 4 + i] * 255.f);
+    }
+  }
+  return pixels;
+}
+
+// the encoder before stripes: one single threaded deflate
+double reference_encode(const std::vector<unsigned char> &pixels,
+                        const int width,
+                        const int height,
+                        size_t &size)
+{
+  vtkh::Timer timer;
+  vtkh::LodePNGState state;
+  vtkh::lodepng_state_init(&state);
+  state.encoder.zlibsettings.btype = 2;
+  state.encoder.zlibsettings.use_lz77 = 0;
+  unsigned char *buffer = NULL;
+  vtkh::lodepng_encode(&buffer, &size, &pixels[0], width, height, &state);
+  vtkh::lodepng_state_cleanup(&state);
+  free(buffer);
+  return timer.elapsed();
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_png_encoder, vtkh_round_trip)
+{
+  const int width = 640;
+  const int height = 480;
+  std::vector<float> rgba = make_image(width, height);
+  std::vector<unsigned char> expected = expected_pixels(rgba, width, height);
+
+  const int levels[4] = {0, 1, 2, 6};
+  for(int l = 0; l < 4; ++l)
+  {
+    for(int fast = 0; fast < 2; ++fast)
+    {
+      vtkh::PNGEncoder encoder;
+      encoder.SetCompressionLevel(levels[l]);
+      encoder.SetFastMode(fast == 1);
+      encoder.Encode(&rgba[0], width, height);
+
+      unsigned char *decoded = NULL;
+      unsigned decoded_width, decoded_height;
+      unsigned error = vtkh::lodepng_decode32(&decoded,
+                                              &decoded_width,
+                                              &decoded_height,
+                                              (unsigned char*) encoder.PngBuffer(),
+                                              encoder.PngBufferSize());
+      ASSERT_EQ(error, 0u);
+      ASSERT_EQ(decoded_width, width);
+      ASSERT_EQ(decoded_height, height);
+      std::vector<unsigned char> pixels(decoded, decoded + expected.size());
+      free(decoded);
+      EXPECT_EQ(pixels, expected);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// timing only, run with --gtest_also_run_disabled_tests
+TEST(vtkh_png_encoder, DISABLED_vtkh_png_benchmark)
+{
+  // 4k image
+  const int width = 3840;
+  const int height = 2160;
+  std::vector<float> rgba = make_image(width, height);
+  std::vector<unsigned char> pixels = expected_pixels(rgba, width, height);
+
+  size_t reference_size;
+  const double reference_time = reference_encode(pixels, width, height, reference_size);
+  std::cout<<"reference: "<<reference_time<<" s "<<reference_size<<" bytes\n";
+
+  const int levels[3] = {1, 1, 4};
+  const bool fast[3] = {false, true, true};
+  for(int i = 0; i < 3; ++i)
+  {
+    vtkh::PNGEncoder encoder;
+    encoder.SetCompressionLevel(levels[i]);
+    encoder.SetFastMode(fast[i]);
+    vtkh::Timer timer;
+    encoder.Encode(&rgba[0], width, height);
+    std::cout<<"level "<<levels[i]<<(fast[i] ? " fast: " : ": ")
+             <<timer.elapsed()<<" s "<<encoder.PngBufferSize()<<" bytes\n";
+    EXPECT_GT(encoder.PngBufferSize(), 0);
+  }
+}
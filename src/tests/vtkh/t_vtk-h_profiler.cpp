@@ -0,0 +1,188 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_profiler.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Profiler.hpp>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+double busy(const int iterations)
+{
+  double sum = 0.;
+  for(int i = 0; i < iterations; ++i)
+  {
+    sum += 1. / (1. + i);
+  }
+  return sum;
+}
+
+void work(const int calls, double *res)
+{
+  VTKH_PROFILE_SCOPE("worker");
+  for(int i = 0; i < calls; ++i)
+  {
+    VTKH_PROFILE_SCOPE("step");
+    *res += busy(1000);
+  }
+}
+
+std::map<std::string, vtkh::Profiler::Region> regions_by_path()
+{
+  std::map<std::string, vtkh::Profiler::Region> res;
+  std::vector<vtkh::Profiler::Region> regions = vtkh::Profiler::GetInstance()->GetRegions();
+  for(const auto &region : regions)
+  {
+    res[region.m_path] = region;
+  }
+  return res;
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_profiler, vtkh_profile_paths)
+{
+  vtkh::Profiler *profiler = vtkh::Profiler::GetInstance();
+  profiler->Reset();
+  profiler->ClearRegions();
+  profiler->SetEnabled(true);
+  // uses the counters when the kernel allows it
+  profiler->SetCountersEnabled(true);
+
+  double res = 0.;
+  {
+    VTKH_PROFILE_SCOPE("Filter");
+    {
+      VTKH_PROFILE_SCOPE("Composite");
+      res += busy(100000);
+    }
+    {
+      VTKH_PROFILE_SCOPE("Composite");
+      res += busy(100000);
+    }
+  }
+  {
+    VTKH_PROFILE_SCOPE("Composite");
+    res += busy(100000);
+  }
+
+  // every thread starts its own paths
+  std::vector<double> thread_res(3, 0.);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 3; ++t)
+  {
+    threads.push_back(std::thread(work, 10, &thread_res[t]));
+  }
+  for(auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  std::map<std::string, vtkh::Profiler::Region> regions = regions_by_path();
+  profiler->Write(std::cout);
+  // the busy work has to be used or it is optimized away
+  EXPECT_GT(res, 0.);
+  for(const double thread_sum : thread_res)
+  {
+    EXPECT_GT(thread_sum, 0.);
+  }
+
+  ASSERT_EQ(regions.size(), 5);
+  EXPECT_EQ(regions["Filter"].m_calls, 1);
+  EXPECT_EQ(regions["Filter"].m_depth, 0);
+  EXPECT_EQ(regions["Filter/Composite"].m_calls, 2);
+  EXPECT_EQ(regions["Filter/Composite"].m_depth, 1);
+  EXPECT_EQ(regions["Composite"].m_calls, 1);
+  EXPECT_EQ(regions["worker"].m_calls, 3);
+  EXPECT_EQ(regions["worker/step"].m_calls, 30);
+  EXPECT_TRUE(regions["Filter"].m_time >= regions["Filter/Composite"].m_time);
+
+  if(profiler->GetCountersEnabled())
+  {
+    EXPECT_GT(regions["Filter/Composite"].m_counters[vtkh::Profiler::INSTRUCTIONS], 0);
+    EXPECT_TRUE(regions["Filter"].m_counters[vtkh::Profiler::INSTRUCTIONS] >=
+                regions["Filter/Composite"].m_counters[vtkh::Profiler::INSTRUCTIONS]);
+  }
+  else
+  {
+    EXPECT_EQ(regions["Filter"].m_counters[vtkh::Profiler::INSTRUCTIONS], -1);
+  }
+
+  // parents are listed before their children
+  std::vector<vtkh::Profiler::Region> ordered = profiler->GetRegions();
+  for(size_t i = 0; i < ordered.size(); ++i)
+  {
+    if(ordered[i].m_depth > 0)
+    {
+      ASSERT_GT(i, 0u);
+      EXPECT_EQ(ordered[i].m_path.find(ordered[i-1].m_path), 0);
+    }
+  }
+
+  profiler->SetCountersEnabled(false);
+  profiler->SetEnabled(false);
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_profiler, vtkh_profile_selected_regions)
+{
+  vtkh::Profiler *profiler = vtkh::Profiler::GetInstance();
+  profiler->Reset();
+  profiler->SetEnabled(true);
+  profiler->AddRegion("Contour");
+
+  double res = 0.;
+  {
+    VTKH_PROFILE_SCOPE("Threshold");
+    res += busy(1000);
+  }
+  {
+    VTKH_PROFILE_SCOPE("Contour");
+    VTKH_PROFILE_SCOPE("Composite");
+    res += busy(1000);
+  }
+  {
+    // regions under a listed region are kept
+    VTKH_PROFILE_SCOPE("Pipeline");
+    VTKH_PROFILE_SCOPE("Contour");
+    res += busy(1000);
+  }
+
+  std::map<std::string, vtkh::Profiler::Region> regions = regions_by_path();
+  EXPECT_EQ(regions.size(), 3);
+  EXPECT_EQ(regions.count("Threshold"), 0);
+  EXPECT_EQ(regions.count("Pipeline"), 0);
+  EXPECT_EQ(regions["Contour"].m_calls, 1);
+  EXPECT_EQ(regions["Contour/Composite"].m_calls, 1);
+  EXPECT_EQ(regions["Pipeline/Contour"].m_calls, 1);
+
+  // turning profiling off inside of a region keeps the stack balanced
+  {
+    VTKH_PROFILE_SCOPE("Contour");
+    profiler->SetEnabled(false);
+    VTKH_PROFILE_SCOPE("ignored");
+  }
+  profiler->SetEnabled(true);
+  {
+    VTKH_PROFILE_SCOPE("Contour");
+  }
+  regions = regions_by_path();
+  EXPECT_EQ(regions["Contour"].m_calls, 3);
+  EXPECT_EQ(regions.count("Contour/ignored"), 0);
+
+  profiler->ClearRegions();
+  profiler->SetEnabled(false);
+  EXPECT_GT(res, 0.);
+}
@@ -14,6 +14,7 @@
 #include "t_test_utils.hpp"
 
 #include <iostream>
+#include <limits>
 #include <mpi.h>
 
 
@@ -60,5 +61,113 @@ TEST(vtkh_scalar_renderer, vtkh_parallel_render)
     writer.WriteDataSet(result);
   }
 
+  //
+  // multiple cameras rendered in batches give the same
+  // images as one camera at a time
+  //
+  std::vector<vtkm::rendering::Camera> cameras;
+  for(int i = 0; i < 5; ++i)
+  {
+    vtkm::rendering::Camera view;
+    view.ResetToBounds(bounds);
+    view.Azimuth(-30.f + 20.f * i);
+    view.Elevation(-30.f);
+    cameras.push_back(view);
+  }
+
+  vtkh::ScalarRenderer batch_tracer;
+  batch_tracer.SetInput(&data_set);
+  batch_tracer.SetCameras(cameras);
+  batch_tracer.SetBatchSize(2);
+  EXPECT_EQ(batch_tracer.GetNumberOfCameras(), 5);
+  batch_tracer.Update();
+  vtkh::DataSet *batch_output = batch_tracer.GetOutput();
+
+  for(int i = 0; i < 5; ++i)
+  {
+    vtkh::ScalarRenderer single_tracer;
+    single_tracer.SetInput(&data_set);
+    single_tracer.SetCamera(cameras[i]);
+    single_tracer.Update();
+
+    if(vtkh::GetMPIRank() == 0)
+    {
+      ASSERT_EQ(batch_output->GetNumberOfDomains(), 5);
+      vtkm::cont::DataSet &single = single_tracer.GetOutput()->GetDomain(0);
+      vtkm::cont::DataSet batch;
+      vtkm::Id domain_id;
+      batch_output->GetDomain(i, batch, domain_id);
+      EXPECT_EQ(domain_id, i);
+
+      ASSERT_EQ(single.GetNumberOfFields(), batch.GetNumberOfFields());
+      for(vtkm::IdComponent f = 0; f < single.GetNumberOfFields(); ++f)
+      {
+        const std::string name = single.GetField(f).GetName();
+        vtkm::cont::ArrayHandle<vtkm::Float32> single_values;
+        vtkm::cont::ArrayHandle<vtkm::Float32> batch_values;
+        single.GetField(f).GetData().CopyTo(single_values);
+        batch.GetField(name).GetData().CopyTo(batch_values);
+        ASSERT_EQ(single_values.GetNumberOfValues(), batch_values.GetNumberOfValues());
+        auto single_portal = single_values.ReadPortal();
+        auto batch_portal = batch_values.ReadPortal();
+        for(vtkm::Id p = 0; p < single_values.GetNumberOfValues(); ++p)
+        {
+          const float a = single_portal.Get(p);
+          const float b = batch_portal.Get(p);
+          // background values can be nan
+          ASSERT_TRUE(a == b || (a != a && b != b)) << name;
+        }
+      }
+    }
+    delete single_tracer.GetOutput();
+  }
+  delete batch_output;
+
+  //
+  // rank 0 has no data, so it composites zero pixel images and
+  // gets the field names from another rank
+  //
+  if(comm_size > 1)
+  {
+    vtkh::DataSet partial_set;
+    if(rank != 0)
+    {
+      for(int i = 0; i < blocks_per_rank; ++i)
+      {
+        int domain_id = rank * blocks_per_rank + i;
+        partial_set.AddDomain(CreateTestData(domain_id, num_blocks, base_size), domain_id);
+      }
+    }
+
+    vtkh::ScalarRenderer partial_tracer;
+    partial_tracer.SetInput(&partial_set);
+    partial_tracer.SetCameras(cameras);
+    partial_tracer.SetBatchSize(2);
+    partial_tracer.Update();
+    vtkh::DataSet *partial_output = partial_tracer.GetOutput();
+
+    if(vtkh::GetMPIRank() == 0)
+    {
+      ASSERT_EQ(partial_output->GetNumberOfDomains(), 5);
+      vtkm::cont::DataSet &result = partial_output->GetDomain(0);
+      EXPECT_GT(result.GetNumberOfFields(), 1);
+      vtkm::cont::ArrayHandle<vtkm::Float32> depths;
+      result.GetField("depth").GetData().CopyTo(depths);
+      ASSERT_EQ(depths.GetNumberOfValues(), 1024 * 1024);
+      auto portal = depths.ReadPortal();
+      int hits = 0;
+      for(vtkm::Id p = 0; p < depths.GetNumberOfValues(); ++p)
+      {
+        const float depth = portal.Get(p);
+        if(depth == depth && depth < static_cast<float>(std::numeric_limits<int>::max()))
+        {
+          hits++;
+        }
+      }
+      EXPECT_GT(hits, 0);
+    }
+    delete partial_output;
+  }
+
   MPI_Finalize();
 }
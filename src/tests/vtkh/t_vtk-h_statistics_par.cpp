@@ -43,5 +43,21 @@ TEST(vtkh_statistics_par, vtkh_stats)
 
   if(rank == 0) res.Print(std::cout);
 
+  long long local_values = 0;
+  for(int i = 0; i < data_set.GetNumberOfDomains(); ++i)
+  {
+    local_values += data_set.GetDomain(i).GetField("point_data_Float64").GetNumberOfValues();
+  }
+  long long global_values = 0;
+  MPI_Allreduce(&local_values, &global_values, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  EXPECT_EQ(res.count, global_values);
+
+  vtkm::Range range = data_set.GetGlobalRange("point_data_Float64").ReadPortal().Get(0);
+  EXPECT_DOUBLE_EQ(res.min, range.Min);
+  EXPECT_DOUBLE_EQ(res.max, range.Max);
+  EXPECT_GE(res.mean, range.Min);
+  EXPECT_LE(res.mean, range.Max);
+  EXPECT_GT(res.variance, 0.);
+
   MPI_Finalize();
 }
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------
+///
+/// file: t_vtk-h_trace_logger.cpp
+///
+//-----------------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Timer.hpp>
+#include <vtkh/TraceLogger.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::string read_file(const std::string &filename)
+{
+  std::ifstream file(filename.c_str());
+  std::stringstream ss;
+  ss<<file.rdbuf();
+  return ss.str();
+}
+
+int count(const std::string &text, const std::string &pattern)
+{
+  int res = 0;
+  size_t pos = text.find(pattern);
+  while(pos != std::string::npos)
+  {
+    res++;
+    pos = text.find(pattern, pos + pattern.size());
+  }
+  return res;
+}
+
+void record(const int regions, const int thread)
+{
+  vtkh::TraceLogger *trace = vtkh::TraceLogger::GetInstance();
+  for(int i = 0; i < regions; ++i)
+  {
+    trace->Begin("outer");
+    trace->Begin("inner");
+    trace->AddValue("index", i);
+    trace->AddValue("ratio", 0.5f);
+    trace->AddValue("topology", "structured");
+    trace->End();
+    trace->AddValue("thread", thread);
+    trace->End();
+  }
+}
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_trace_logger, vtkh_trace_to_json)
+{
+  vtkh::TraceLogger *trace = vtkh::TraceLogger::GetInstance();
+  trace->SetPrefix("tout_trace");
+  trace->SetRank(0);
+  // small enough that the writer has to keep up with the threads
+  trace->SetBufferSize(64);
+  trace->SetFlushInterval(10);
+  trace->SetEnabled(true);
+  EXPECT_TRUE(vtkh::TraceLogger::IsEnabled());
+
+  const int regions = 1000;
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 3; ++t)
+  {
+    threads.push_back(std::thread(record, regions, t));
+  }
+  for(auto &thread : threads)
+  {
+    thread.join();
+  }
+  // an unclosed region is ended by the converter
+  trace->Begin("unclosed");
+  trace->Flush();
+
+  std::vector<std::string> files(1, "tout_trace_000000.trace");
+  vtkh::TraceLogger::ConvertToChromeTrace(files, "tout_trace.json");
+  const std::string json = read_file("tout_trace.json");
+
+  EXPECT_EQ(json.find("{\"traceEvents\":["), 0);
+  EXPECT_EQ(count(json, "\"name\":\"outer\",\"ph\":\"B\""), 3 * regions);
+  EXPECT_EQ(count(json, "\"name\":\"outer\",\"ph\":\"E\""), 3 * regions);
+  EXPECT_EQ(count(json, "\"name\":\"inner\",\"ph\":\"E\""), 3 * regions);
+  EXPECT_EQ(count(json, "\"topology\":\"structured\""), 3 * regions);
+  EXPECT_EQ(count(json, "\"ratio\":0.5"), 3 * regions);
+  EXPECT_EQ(count(json, "\"index\":999,"), 3);
+  EXPECT_EQ(count(json, "\"name\":\"unclosed\",\"ph\":\"E\""), 1);
+
+  trace->SetEnabled(false);
+  EXPECT_FALSE(vtkh::TraceLogger::IsEnabled());
+}
+
+//-----------------------------------------------------------------------------
+TEST(vtkh_trace_logger, vtkh_trace_overhead)
+{
+  vtkh::TraceLogger *trace = vtkh::TraceLogger::GetInstance();
+  trace->SetBufferSize(1 << 16);
+  trace->SetEnabled(true);
+
+  const int regions = 200000;
+  vtkh::Timer timer;
+  for(int i = 0; i < regions; ++i)
+  {
+    trace->Begin("region");
+    trace->AddValue("value", i);
+    trace->End();
+  }
+  trace->Flush();
+  std::cout<<"traced: "<<timer.elapsed() / (3. * regions) * 1e9<<" ns per event\n";
+  trace->SetEnabled(false);
+
+  timer.reset();
+  long long sum = 0;
+  for(int i = 0; i < regions; ++i)
+  {
+    if(vtkh::TraceLogger::IsEnabled())
+    {
+      trace->Begin("region");
+    }
+    sum += i;
+  }
+  std::cout<<"disabled: "<<timer.elapsed() / regions * 1e9<<" ns per check ("<<sum<<")\n";
+}
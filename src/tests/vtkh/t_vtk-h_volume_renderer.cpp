@@ -66,11 +66,62 @@ TEST(vtkh_volume_renderer, vtkh_parallel_render_ustructured)
   tracer.SetColorTable(color_map);
   tracer.SetInput(iso_output);
   tracer.SetField("point_data_Float64");
+  EXPECT_EQ(tracer.GetCacheHits(), 0);
+  const int num_wrappers = tracer.GetCacheMisses();
 
   vtkh::Scene scene;
   scene.AddRender(render);
   scene.AddRenderer(&tracer);
   scene.Render();
+
+  // the geometry did not change, so the next cycle reuses everything
+  tracer.SetInput(iso_output);
+  EXPECT_EQ(tracer.GetCacheHits(), num_wrappers);
+  EXPECT_EQ(tracer.GetCacheMisses(), 0);
+  scene.Render();
+
+  tracer.InvalidateCache();
+  tracer.SetInput(iso_output);
+  EXPECT_EQ(tracer.GetCacheMisses(), num_wrappers);
+
+  // with no memory only the state of the current input is kept
+  tracer.SetCacheMemoryLimit(0);
+  tracer.SetInput(iso_output);
+  EXPECT_EQ(tracer.GetCacheHits(), num_wrappers);
+  vtkh::DataSet empty;
+  tracer.SetInput(&empty);
+  tracer.SetInput(iso_output);
+  EXPECT_EQ(tracer.GetCacheHits(), 0);
+}
+
+//----------------------------------------------------------------------------
+TEST(vtkh_volume_renderer, vtkh_cache_remeshed)
+{
+  // the same points and counts with different cells
+  std::vector<vtkm::Vec3f> points = { vtkm::Vec3f(0.f, 0.f, 0.f),
+                                      vtkm::Vec3f(1.f, 0.f, 0.f),
+                                      vtkm::Vec3f(0.f, 1.f, 0.f),
+                                      vtkm::Vec3f(0.f, 0.f, 1.f),
+                                      vtkm::Vec3f(1.f, 1.f, 1.f) };
+  std::vector<vtkm::UInt8> shapes(2, vtkm::CELL_SHAPE_TETRA);
+  std::vector<vtkm::IdComponent> num_indices(2, 4);
+  std::vector<vtkm::Id> conn = { 0, 1, 2, 3, 1, 2, 3, 4 };
+  std::vector<vtkm::Id> remeshed_conn = { 0, 1, 2, 4, 0, 2, 3, 4 };
+
+  vtkm::cont::DataSetBuilderExplicit builder;
+  vtkh::DataSet data_set;
+  data_set.AddDomain(builder.Create(points, shapes, num_indices, conn), 0);
+  vtkh::DataSet remeshed;
+  remeshed.AddDomain(builder.Create(points, shapes, num_indices, remeshed_conn), 0);
+
+  vtkh::VolumeRenderer tracer;
+  tracer.SetInput(&data_set);
+  EXPECT_EQ(tracer.GetCacheMisses(), 1);
+  tracer.SetInput(&data_set);
+  EXPECT_EQ(tracer.GetCacheHits(), 1);
+  tracer.SetInput(&remeshed);
+  EXPECT_EQ(tracer.GetCacheHits(), 0);
+  EXPECT_EQ(tracer.GetCacheMisses(), 1);
 }
 
 TEST(vtkh_volume_renderer, vtkh_parallel_render)
@@ -6,13 +6,26 @@
 // FIXME:UDA: vtkm_dataset_info depends on vtkm::rendering
 #include <vtkh/utils/vtkm_dataset_info.hpp>
 // std includes
+#include <algorithm>
 #include <limits>
+#include <map>
+#include <set>
 #include <sstream>
+#include <typeinfo>
 //vtkm includes
 #include <vtkm/cont/Error.h>
+#include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayCopy.h>
 #include <vtkm/cont/ArrayHandleConstant.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/cont/ArrayHandlePermutation.h>
+#include <vtkm/cont/ArrayHandleZip.h>
+#include <vtkm/cont/CellSetExplicit.h>
 #include <vtkm/cont/TryExecute.h>
 #include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/DispatcherMapTopology.h>
+#include <vtkm/worklet/WorkletMapField.h>
+#include <vtkm/worklet/WorkletMapTopology.h>
 #ifdef VTKH_PARALLEL
   #include <mpi.h>
 #endif
@@ -66,6 +79,134 @@ bool GlobalSomeoneAgrees(bool local)
   return agreement;
 }
 
+//
+// Packs a heterogeneous set of min / max / sum reductions into a single
+// MPI_Allreduce. Each value travels with the operation that combines it.
+//
+class PackedReduction
+{
+public:
+  enum Operation { SUM = 0, MIN = 1, MAX = 2 };
+
+  int Add(const vtkm::Float64 value, Operation op)
+  {
+    m_values.push_back(static_cast<vtkm::Float64>(op));
+    m_values.push_back(value);
+    return static_cast<int>(m_values.size() / 2 - 1);
+  }
+
+  int AddSum(const vtkm::Float64 value) { return Add(value, SUM); }
+  int AddMin(const vtkm::Float64 value) { return Add(value, MIN); }
+  int AddMax(const vtkm::Float64 value) { return Add(value, MAX); }
+
+  vtkm::Float64 Get(const int index) const { return m_values[index * 2 + 1]; }
+
+  int Size() const { return static_cast<int>(m_values.size() / 2); }
+
+  void Reduce()
+  {
+#ifdef VTKH_PARALLEL
+    const int size = Size();
+    if(size == 0)
+    {
+      return;
+    }
+
+    MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+    // an (op, value) pair is one element so mpi never splits a pair
+    // when it segments the buffer
+    MPI_Datatype pair_type;
+    MPI_Type_contiguous(2, MPI_DOUBLE, &pair_type);
+    MPI_Type_commit(&pair_type);
+    MPI_Op op;
+    MPI_Op_create(&PackedReduction::Combine, 1, &op);
+
+    MPI_Allreduce(MPI_IN_PLACE, &m_values[0], size, pair_type, op, mpi_comm);
+
+    MPI_Op_free(&op);
+    MPI_Type_free(&pair_type);
+#endif
+  }
+
+protected:
+  std::vector<vtkm::Float64> m_values;
+
+#ifdef VTKH_PARALLEL
+  static void Combine(void *in, void *inout, int *len, MPI_Datatype *)
+  {
+    const vtkm::Float64 *a = static_cast<const vtkm::Float64*>(in);
+    vtkm::Float64 *b = static_cast<vtkm::Float64*>(inout);
+    for(int i = 0; i < *len; ++i)
+    {
+      const int op = static_cast<int>(b[i * 2]);
+      const vtkm::Float64 v1 = a[i * 2 + 1];
+      vtkm::Float64 &v2 = b[i * 2 + 1];
+      if(op == SUM)
+      {
+        v2 = v1 + v2;
+      }
+      else if(op == MIN)
+      {
+        v2 = std::min(v1, v2);
+      }
+      else
+      {
+        v2 = std::max(v1, v2);
+      }
+    }
+  }
+#endif
+};
+
+int AssociationToId(const vtkm::cont::Field::Association assoc)
+{
+  int assoc_id = -1;
+  if(assoc == vtkm::cont::Field::Association::ANY)
+  {
+    assoc_id = 0;
+  }
+  else if ( assoc == vtkm::cont::Field::Association::WHOLE_MESH)
+  {
+    assoc_id = 1;
+  }
+  else if ( assoc == vtkm::cont::Field::Association::POINTS)
+  {
+    assoc_id = 2;
+  }
+  else if ( assoc == vtkm::cont::Field::Association::CELL_SET)
+  {
+    assoc_id = 3;
+  }
+  return assoc_id;
+}
+
+vtkm::cont::Field::Association IdToAssociation(const int assoc_id)
+{
+  vtkm::cont::Field::Association assoc;
+
+  if(assoc_id == 0)
+  {
+    assoc = vtkm::cont::Field::Association::ANY;
+  }
+  else if ( assoc_id == 1)
+  {
+    assoc = vtkm::cont::Field::Association::WHOLE_MESH;
+  }
+  else if ( assoc_id == 2)
+  {
+    assoc = vtkm::cont::Field::Association::POINTS;
+  }
+  else if ( assoc_id == 3)
+  {
+    assoc = vtkm::cont::Field::Association::CELL_SET;
+  }
+  else
+  {
+    throw Error("Get association: unknown association");
+  }
+  return assoc;
+}
+
 template<typename T>
 class MemSetWorklet : public vtkm::worklet::WorkletMapField
 {
@@ -96,8 +237,446 @@ void MemSet(vtkm::cont::ArrayHandle<T> &array, const T value, const vtkm::Id num
     .Invoke(array);
 }
 
+//
+// shape and number of points of every cell of a domain, written at
+// cell_offset + index so the cells of a batch land next to each other
+//
+class CellInfoWorklet : public vtkm::worklet::WorkletVisitCellsWithPoints
+{
+protected:
+  vtkm::Id m_cell_offset;
+public:
+  VTKM_CONT
+  CellInfoWorklet(const vtkm::Id cell_offset)
+    : m_cell_offset(cell_offset)
+  {
+  }
+
+  typedef void ControlSignature(CellSetIn, WholeArrayInOut, WholeArrayInOut);
+  typedef void ExecutionSignature(CellShape, PointCount, WorkIndex, _2, _3);
+
+  template<typename ShapeTag, typename ShapePortal, typename CountPortal>
+  VTKM_EXEC
+  void operator()(const ShapeTag &shape,
+                  const vtkm::IdComponent &num_points,
+                  const vtkm::Id &index,
+                  ShapePortal &shapes,
+                  CountPortal &counts) const
+  {
+    shapes.Set(m_cell_offset + index, shape.Id);
+    counts.Set(m_cell_offset + index, static_cast<vtkm::Id>(num_points));
+  }
+}; //class CellInfoWorklet
+
+//
+// point ids of every cell of a domain shifted by point_offset, written
+// where offsets says the cell at cell_offset + index starts
+//
+class CellConnWorklet : public vtkm::worklet::WorkletVisitCellsWithPoints
+{
+protected:
+  vtkm::Id m_cell_offset;
+  vtkm::Id m_point_offset;
+public:
+  VTKM_CONT
+  CellConnWorklet(const vtkm::Id cell_offset, const vtkm::Id point_offset)
+    : m_cell_offset(cell_offset),
+      m_point_offset(point_offset)
+  {
+  }
+
+  typedef void ControlSignature(CellSetIn, WholeArrayIn, WholeArrayInOut);
+  typedef void ExecutionSignature(PointIndices, WorkIndex, _2, _3);
+
+  template<typename IndicesType, typename OffsetPortal, typename ConnPortal>
+  VTKM_EXEC
+  void operator()(const IndicesType &indices,
+                  const vtkm::Id &index,
+                  const OffsetPortal &offsets,
+                  ConnPortal &conn) const
+  {
+    const vtkm::Id start = offsets.Get(m_cell_offset + index);
+    const vtkm::IdComponent num_points = indices.GetNumberOfComponents();
+    for(vtkm::IdComponent i = 0; i < num_points; ++i)
+    {
+      conn.Set(start + i, indices[i] + m_point_offset);
+    }
+  }
+}; //class CellConnWorklet
+
+//
+// same as CellInfoWorklet for the cells listed in the input array,
+// written at their position in the list
+//
+class ExtractInfoWorklet : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn, WholeCellSetIn<>, WholeArrayInOut, WholeArrayInOut);
+  typedef void ExecutionSignature(_1, WorkIndex, _2, _3, _4);
+
+  template<typename CellSetType, typename ShapePortal, typename CountPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &cell,
+                  const vtkm::Id &index,
+                  const CellSetType &cell_set,
+                  ShapePortal &shapes,
+                  CountPortal &counts) const
+  {
+    shapes.Set(index, cell_set.GetCellShape(cell).Id);
+    counts.Set(index, static_cast<vtkm::Id>(cell_set.GetNumberOfIndices(cell)));
+  }
+}; //class ExtractInfoWorklet
+
+//
+// same as CellConnWorklet for the cells listed in the input array
+//
+class ExtractConnWorklet : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn, WholeCellSetIn<>, WholeArrayIn, WholeArrayInOut);
+  typedef void ExecutionSignature(_1, WorkIndex, _2, _3, _4);
+
+  template<typename CellSetType, typename OffsetPortal, typename ConnPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &cell,
+                  const vtkm::Id &index,
+                  const CellSetType &cell_set,
+                  const OffsetPortal &offsets,
+                  ConnPortal &conn) const
+  {
+    auto indices = cell_set.GetIndices(cell);
+    const vtkm::Id start = offsets.Get(index);
+    const vtkm::IdComponent num_points = indices.GetNumberOfComponents();
+    for(vtkm::IdComponent i = 0; i < num_points; ++i)
+    {
+      conn.Set(start + i, indices[i]);
+    }
+  }
+}; //class ExtractConnWorklet
+
+//
+// concatenates the cells of a batch of domains into one explicit cell
+// set. Everything runs on the device, structured domains included
+//
+vtkm::cont::CellSetExplicit<> MergeCells(const std::vector<vtkm::cont::DataSet> &doms,
+                                         const std::vector<vtkm::Id> &point_offsets,
+                                         const std::vector<vtkm::Id> &cell_offsets,
+                                         const vtkm::Id num_points,
+                                         const vtkm::Id num_cells)
+{
+  // one extra count so the scan below also yields the end offset
+  vtkm::cont::ArrayHandle<vtkm::UInt8> shapes;
+  vtkm::cont::ArrayHandle<vtkm::Id> counts;
+  shapes.Allocate(num_cells);
+  MemSet(counts, vtkm::Id(0), num_cells + 1);
+  for(size_t i = 0; i < doms.size(); ++i)
+  {
+    vtkm::worklet::DispatcherMapTopology<CellInfoWorklet>(CellInfoWorklet(cell_offsets[i]))
+      .Invoke(doms[i].GetCellSet(), shapes, counts);
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Id> offsets;
+  const vtkm::Id conn_size = vtkm::cont::Algorithm::ScanExclusive(counts, offsets);
+
+  vtkm::cont::ArrayHandle<vtkm::Id> conn;
+  conn.Allocate(conn_size);
+  for(size_t i = 0; i < doms.size(); ++i)
+  {
+    vtkm::worklet::DispatcherMapTopology<CellConnWorklet>(
+      CellConnWorklet(cell_offsets[i], point_offsets[i]))
+      .Invoke(doms[i].GetCellSet(), offsets, conn);
+  }
+
+  vtkm::cont::CellSetExplicit<> cell_set;
+  cell_set.Fill(num_points, shapes, conn, offsets);
+  return cell_set;
+}
+
+bool IsMeshField(const vtkm::cont::Field &field)
+{
+  return field.GetAssociation() == vtkm::cont::Field::Association::POINTS ||
+         field.GetAssociation() == vtkm::cont::Field::Association::CELL_SET;
+}
+
+//
+// concatenates one field of a batch of domains. The field is dropped if
+// one of the domains does not have it with the same array type
+//
+struct ConcatField
+{
+  vtkm::cont::DataSet &m_data_set;
+  const std::vector<vtkm::cont::DataSet> &m_in_data_sets;
+  const std::vector<vtkm::Id> &m_point_offsets;
+  const std::vector<vtkm::Id> &m_cell_offsets;
+  const vtkm::cont::Field &m_field;
+  vtkm::Id m_num_points;
+  vtkm::Id m_num_cells;
+
+  ConcatField(vtkm::cont::DataSet &data_set,
+              const std::vector<vtkm::cont::DataSet> &in_data_sets,
+              const std::vector<vtkm::Id> &point_offsets,
+              const std::vector<vtkm::Id> &cell_offsets,
+              const vtkm::cont::Field &field,
+              vtkm::Id num_points,
+              vtkm::Id num_cells)
+    : m_data_set(data_set),
+      m_in_data_sets(in_data_sets),
+      m_point_offsets(point_offsets),
+      m_cell_offsets(cell_offsets),
+      m_field(field),
+      m_num_points(num_points),
+      m_num_cells(num_cells)
+  {}
+
+  template<typename T, typename S>
+  void operator()(const vtkm::cont::ArrayHandle<T,S> &vtkmNotUsed(field)) const
+  {
+    const std::string &name = m_field.GetName();
+    const vtkm::cont::Field::Association assoc = m_field.GetAssociation();
+    for(size_t i = 0; i < m_in_data_sets.size(); ++i)
+    {
+      if(!m_in_data_sets[i].HasField(name, assoc) ||
+         !m_in_data_sets[i].GetField(name, assoc).GetData()
+           .IsType<vtkm::cont::ArrayHandle<T,S>>())
+      {
+        return;
+      }
+    }
+
+    const bool assoc_points = assoc == vtkm::cont::Field::Association::POINTS;
+    vtkm::cont::ArrayHandle<T> out;
+    out.Allocate(assoc_points ? m_num_points : m_num_cells);
+
+    for(size_t i = 0; i < m_in_data_sets.size(); ++i)
+    {
+      const vtkm::cont::Field &f = m_in_data_sets[i].GetField(name, assoc);
+      vtkm::cont::ArrayHandle<T,S> in = f.GetData().Cast<vtkm::cont::ArrayHandle<T,S>>();
+      vtkm::Id start = 0;
+      vtkm::Id copy_size = in.GetNumberOfValues();
+      vtkm::Id offset = assoc_points ? m_point_offsets[i] : m_cell_offsets[i];
+      vtkm::cont::Algorithm::CopySubRange(in, start, copy_size, out, offset);
+    }
+
+    m_data_set.AddField(vtkm::cont::Field(name, assoc, out));
+  }
+};
+
+vtkm::cont::DataSet MergeDomains(const std::vector<vtkm::cont::DataSet> &doms)
+{
+  const size_t num_doms = doms.size();
+  std::vector<vtkm::Id> point_offsets(num_doms);
+  std::vector<vtkm::Id> cell_offsets(num_doms);
+
+  vtkm::Id num_points = 0;
+  vtkm::Id num_cells = 0;
+  for(size_t i = 0; i < num_doms; ++i)
+  {
+    point_offsets[i] = num_points;
+    cell_offsets[i] = num_cells;
+    num_points += doms[i].GetCoordinateSystem().GetData().GetNumberOfValues();
+    num_cells += doms[i].GetCellSet().GetNumberOfCells();
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Vec3f> coords;
+  coords.Allocate(num_points);
+  for(size_t i = 0; i < num_doms; ++i)
+  {
+    auto in = doms[i].GetCoordinateSystem().GetData();
+    vtkm::Id start = 0;
+    vtkm::Id copy_size = in.GetNumberOfValues();
+    vtkm::cont::Algorithm::CopySubRange(in, start, copy_size, coords, point_offsets[i]);
+  }
+
+  vtkm::cont::DataSet res;
+  res.SetCellSet(MergeCells(doms, point_offsets, cell_offsets, num_points, num_cells));
+  res.AddCoordinateSystem(
+    vtkm::cont::CoordinateSystem(doms[0].GetCoordinateSystem().GetName(), coords));
+
+  const vtkm::IdComponent num_fields = doms[0].GetNumberOfFields();
+  for(vtkm::IdComponent f = 0; f < num_fields; ++f)
+  {
+    const vtkm::cont::Field &field = doms[0].GetField(f);
+    if(!IsMeshField(field))
+    {
+      continue;
+    }
+    ConcatField concat(res,
+                       doms,
+                       point_offsets,
+                       cell_offsets,
+                       field,
+                       num_points,
+                       num_cells);
+    field.GetData().CastAndCall(concat);
+  }
+  return res;
+}
+
+struct ArrayTypeName
+{
+  std::string &m_name;
+
+  ArrayTypeName(std::string &name)
+    : m_name(name)
+  {}
+
+  template<typename T, typename S>
+  void operator()(const vtkm::cont::ArrayHandle<T,S> &vtkmNotUsed(array)) const
+  {
+    m_name = typeid(vtkm::cont::ArrayHandle<T,S>).name();
+  }
+};
+
+// point and cell fields of a batch with their array types. The batch
+// breaks where they change, otherwise ConcatField would drop a field
+typedef std::map<std::pair<std::string, int>, std::string> FieldSignatureType;
+
+FieldSignatureType FieldSignature(const vtkm::cont::DataSet &dom)
+{
+  FieldSignatureType signature;
+  const vtkm::IdComponent num_fields = dom.GetNumberOfFields();
+  for(vtkm::IdComponent f = 0; f < num_fields; ++f)
+  {
+    const vtkm::cont::Field &field = dom.GetField(f);
+    if(IsMeshField(field))
+    {
+      std::string type_name;
+      field.GetData().CastAndCall(ArrayTypeName(type_name));
+      signature[std::make_pair(field.GetName(),
+                               static_cast<int>(field.GetAssociation()))] = type_name;
+    }
+  }
+  return signature;
+}
+
+// device copy of an id field of any scalar type
+struct CopyIds
+{
+  vtkm::cont::ArrayHandle<vtkm::Id> &m_ids;
+
+  CopyIds(vtkm::cont::ArrayHandle<vtkm::Id> &ids)
+    : m_ids(ids)
+  {}
+
+  template<typename T, typename S>
+  void operator()(const vtkm::cont::ArrayHandle<T,S> &array) const
+  {
+    vtkm::cont::ArrayCopy(array, m_ids);
+  }
+};
+
+struct GatherField
+{
+  const vtkm::cont::ArrayHandle<vtkm::Id> &m_indices;
+  vtkm::cont::VariantArrayHandle &m_output;
+
+  GatherField(const vtkm::cont::ArrayHandle<vtkm::Id> &indices,
+              vtkm::cont::VariantArrayHandle &output)
+    : m_indices(indices),
+      m_output(output)
+  {}
+
+  template<typename T, typename S>
+  void operator()(const vtkm::cont::ArrayHandle<T,S> &array) const
+  {
+    vtkm::cont::ArrayHandle<T> out;
+    vtkm::cont::ArrayCopy(vtkm::cont::make_ArrayHandlePermutation(m_indices, array), out);
+    m_output = out;
+  }
+};
+
+vtkm::cont::DataSet WithoutField(const vtkm::cont::DataSet &dom, const std::string &skip_field)
+{
+  vtkm::cont::DataSet res;
+  res.SetCellSet(dom.GetCellSet());
+  const vtkm::IdComponent num_coords = dom.GetNumberOfCoordinateSystems();
+  for(vtkm::IdComponent i = 0; i < num_coords; ++i)
+  {
+    res.AddCoordinateSystem(dom.GetCoordinateSystem(i));
+  }
+  const vtkm::IdComponent num_fields = dom.GetNumberOfFields();
+  for(vtkm::IdComponent i = 0; i < num_fields; ++i)
+  {
+    const vtkm::cont::Field &field = dom.GetField(i);
+    if(field.GetName() != skip_field)
+    {
+      res.AddField(field);
+    }
+  }
+  return res;
+}
+
+//
+// the cells of dom listed in cell_ids and the points they use. Points
+// keep their relative order
+//
+vtkm::cont::DataSet ExtractCells(const vtkm::cont::DataSet &dom,
+                                 const vtkm::cont::ArrayHandle<vtkm::Id> &cell_ids,
+                                 const std::string &skip_field)
+{
+  const vtkm::Id num_cells = cell_ids.GetNumberOfValues();
+  vtkm::cont::ArrayHandle<vtkm::UInt8> shapes;
+  vtkm::cont::ArrayHandle<vtkm::Id> counts;
+  shapes.Allocate(num_cells);
+  MemSet(counts, vtkm::Id(0), num_cells + 1);
+  vtkm::worklet::DispatcherMapField<ExtractInfoWorklet>()
+    .Invoke(cell_ids, dom.GetCellSet(), shapes, counts);
+
+  vtkm::cont::ArrayHandle<vtkm::Id> offsets;
+  const vtkm::Id conn_size = vtkm::cont::Algorithm::ScanExclusive(counts, offsets);
+
+  vtkm::cont::ArrayHandle<vtkm::Id> in_conn;
+  in_conn.Allocate(conn_size);
+  vtkm::worklet::DispatcherMapField<ExtractConnWorklet>()
+    .Invoke(cell_ids, dom.GetCellSet(), offsets, in_conn);
+
+  // the points used, and where each of them goes
+  vtkm::cont::ArrayHandle<vtkm::Id> point_ids;
+  vtkm::cont::ArrayCopy(in_conn, point_ids);
+  vtkm::cont::Algorithm::Sort(point_ids);
+  vtkm::cont::Algorithm::Unique(point_ids);
+  vtkm::cont::ArrayHandle<vtkm::Id> conn;
+  vtkm::cont::Algorithm::LowerBounds(point_ids, in_conn, conn);
+
+  vtkm::cont::CellSetExplicit<> cell_set;
+  cell_set.Fill(point_ids.GetNumberOfValues(), shapes, conn, offsets);
+
+  vtkm::cont::DataSet res;
+  res.SetCellSet(cell_set);
+
+  vtkm::cont::ArrayHandle<vtkm::Vec3f> coords;
+  vtkm::cont::ArrayCopy(
+    vtkm::cont::make_ArrayHandlePermutation(point_ids, dom.GetCoordinateSystem().GetData()),
+    coords);
+  res.AddCoordinateSystem(
+    vtkm::cont::CoordinateSystem(dom.GetCoordinateSystem().GetName(), coords));
+
+  const vtkm::IdComponent num_fields = dom.GetNumberOfFields();
+  for(vtkm::IdComponent f = 0; f < num_fields; ++f)
+  {
+    const vtkm::cont::Field &field = dom.GetField(f);
+    if(field.GetName() == skip_field)
+    {
+      continue;
+    }
+    if(!IsMeshField(field))
+    {
+      res.AddField(field);
+      continue;
+    }
+    const bool assoc_points = field.GetAssociation() == vtkm::cont::Field::Association::POINTS;
+    vtkm::cont::VariantArrayHandle gathered;
+    GatherField gather(assoc_points ? point_ids : cell_ids, gathered);
+    field.GetData().CastAndCall(gather);
+    res.AddField(vtkm::cont::Field(field.GetName(), field.GetAssociation(), gathered));
+  }
+  return res;
+}
+
 } // namespace detail
 
+const std::string DataSet::DOMAIN_ID_FIELD = "vtkh_domain_id";
+
 bool
 DataSet::OneDomainPerRank() const
 {
@@ -277,69 +856,21 @@ DataSet::GetGlobalBounds(vtkm::Id coordinate_system_index) const
   bounds = GetBounds(coordinate_system_index);
 
 #ifdef VTKH_PARALLEL
-  MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-
-  vtkm::Float64 x_min = bounds.X.Min;
-  vtkm::Float64 x_max = bounds.X.Max;
-  vtkm::Float64 y_min = bounds.Y.Min;
-  vtkm::Float64 y_max = bounds.Y.Max;
-  vtkm::Float64 z_min = bounds.Z.Min;
-  vtkm::Float64 z_max = bounds.Z.Max;
-  vtkm::Float64 global_x_min = 0;
-  vtkm::Float64 global_x_max = 0;
-  vtkm::Float64 global_y_min = 0;
-  vtkm::Float64 global_y_max = 0;
-  vtkm::Float64 global_z_min = 0;
-  vtkm::Float64 global_z_max = 0;
-
-  MPI_Allreduce((void *)(&x_min),
-                (void *)(&global_x_min),
-                1,
-                MPI_DOUBLE,
-                MPI_MIN,
-                mpi_comm);
-
-  MPI_Allreduce((void *)(&x_max),
-                (void *)(&global_x_max),
-                1,
-                MPI_DOUBLE,
-                MPI_MAX,
-                mpi_comm);
-
-  MPI_Allreduce((void *)(&y_min),
-                (void *)(&global_y_min),
-                1,
-                MPI_DOUBLE,
-                MPI_MIN,
-                mpi_comm);
-
-  MPI_Allreduce((void *)(&y_max),
-                (void *)(&global_y_max),
-                1,
-                MPI_DOUBLE,
-                MPI_MAX,
-                mpi_comm);
-
-  MPI_Allreduce((void *)(&z_min),
-                (void *)(&global_z_min),
-                1,
-                MPI_DOUBLE,
-                MPI_MIN,
-                mpi_comm);
-
-  MPI_Allreduce((void *)(&z_max),
-                (void *)(&global_z_max),
-                1,
-                MPI_DOUBLE,
-                MPI_MAX,
-                mpi_comm);
-
-  bounds.X.Min = global_x_min;
-  bounds.X.Max = global_x_max;
-  bounds.Y.Min = global_y_min;
-  bounds.Y.Max = global_y_max;
-  bounds.Z.Min = global_z_min;
-  bounds.Z.Max = global_z_max;
+  detail::PackedReduction reduction;
+  reduction.AddMin(bounds.X.Min);
+  reduction.AddMax(bounds.X.Max);
+  reduction.AddMin(bounds.Y.Min);
+  reduction.AddMax(bounds.Y.Max);
+  reduction.AddMin(bounds.Z.Min);
+  reduction.AddMax(bounds.Z.Max);
+  reduction.Reduce();
+
+  bounds.X.Min = reduction.Get(0);
+  bounds.X.Max = reduction.Get(1);
+  bounds.Y.Min = reduction.Get(2);
+  bounds.Y.Max = reduction.Get(3);
+  bounds.Z.Min = reduction.Get(4);
+  bounds.Z.Max = reduction.Get(5);
 #endif
   VTKH_DATA_CLOSE();
   return bounds;
@@ -401,100 +932,195 @@ DataSet::GetGlobalRange(const std::string &field_name) const
 {
   VTKH_DATA_OPEN("GetGlobalRange");
   vtkm::cont::ArrayHandle<vtkm::Range> range;
+#ifdef VTKH_PARALLEL
+  std::vector<std::string> field_names(1, field_name);
+  GlobalMetadata meta = ComputeGlobalMetadata(field_names, 0, true);
+  const std::vector<vtkm::Range> &ranges = meta.m_fields[field_name].m_ranges;
+  const vtkm::Id components = static_cast<vtkm::Id>(ranges.size());
+  range.Allocate(components);
+  auto portal = range.WritePortal();
+  for(vtkm::Id i = 0; i < components; ++i)
+  {
+    portal.Set(i, ranges[i]);
+  }
+#else
   range = GetRange(field_name);
+#endif
+  VTKH_DATA_CLOSE();
+  return range;
+}
 
-#ifdef VTKH_PARALLEL
-  vtkm::Id num_components = range.GetNumberOfValues();
-  MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-  //
-  // it is possible to have an empty dataset at one of the ranks
-  // so we must check for this so MPI comm does not hang.
-  // We also want to check for num components mis-match
-  //
-  int *global_components = new int[vtkh::GetMPISize()];
-  int comps = static_cast<int>(num_components);
+DataSet::GlobalMetadata
+DataSet::ComputeGlobalMetadata(const std::vector<std::string> &field_names,
+                               vtkm::Id coordinate_system_index,
+                               bool compute_ranges) const
+{
+  GlobalMetadata meta;
+  meta.m_bounds = GetBounds(coordinate_system_index);
+  meta.m_num_cells = GetNumberOfCells();
+  meta.m_num_domains = GetNumberOfDomains();
 
-  MPI_Allgather(&comps,
-                1,
-                MPI_INT,
-                global_components,
-                1,
-                MPI_INT,
-                mpi_comm);
+  const size_t num_fields = field_names.size();
+  std::vector<std::vector<vtkm::Range>> local_ranges(num_fields);
+  std::vector<int> local_assocs(num_fields, -1);
+  std::vector<vtkm::Id> local_comps(num_fields, 0);
+
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    const std::string &field_name = field_names[f];
+    const size_t num_domains = m_domains.size();
+    for(size_t i = 0; i < num_domains; ++i)
+    {
+      if(m_domains[i].HasField(field_name))
+      {
+        const vtkm::cont::Field &field = m_domains[i].GetField(field_name);
+        local_assocs[f] = detail::AssociationToId(field.GetAssociation());
+        local_comps[f] = field.GetData().GetNumberOfComponents();
+        break;
+      }
+    }
+
+    if(compute_ranges && local_assocs[f] != -1)
+    {
+      vtkm::cont::ArrayHandle<vtkm::Range> range = GetRange(field_name);
+      const vtkm::Id components = range.GetNumberOfValues();
+      auto portal = range.ReadPortal();
+      for(vtkm::Id c = 0; c < components; ++c)
+      {
+        local_ranges[f].push_back(portal.Get(c));
+      }
+      local_comps[f] = components;
+    }
+  }
 
-  int components = 0;
   //
-  // find the largest component
+  // first pass: everything that does not depend on the number of components.
+  // Ranks that do not have a field report neutral values so they do not
+  // participate in the min / max checks
   //
-  for(int i = 0; i < vtkh::GetMPISize(); ++i)
+  const vtkm::Float64 none = std::numeric_limits<vtkm::Float64>::max();
+  detail::PackedReduction reduction;
+  reduction.AddMin(meta.m_bounds.X.Min);
+  reduction.AddMax(meta.m_bounds.X.Max);
+  reduction.AddMin(meta.m_bounds.Y.Min);
+  reduction.AddMax(meta.m_bounds.Y.Max);
+  reduction.AddMin(meta.m_bounds.Z.Min);
+  reduction.AddMax(meta.m_bounds.Z.Max);
+  reduction.AddSum(static_cast<vtkm::Float64>(meta.m_num_cells));
+  reduction.AddSum(static_cast<vtkm::Float64>(meta.m_num_domains));
+
+  const int field_offset = reduction.Size();
+  const int values_per_field = 4;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    const vtkm::Id comps = local_comps[f];
+    const bool has_field = local_assocs[f] != -1;
+    reduction.AddMax(static_cast<vtkm::Float64>(comps));
+    reduction.AddMin(comps == 0 ? none : static_cast<vtkm::Float64>(comps));
+    reduction.AddMax(static_cast<vtkm::Float64>(local_assocs[f]));
+    reduction.AddMin(has_field ? static_cast<vtkm::Float64>(local_assocs[f]) : none);
+  }
+
+  reduction.Reduce();
+
+  meta.m_bounds.X.Min = reduction.Get(0);
+  meta.m_bounds.X.Max = reduction.Get(1);
+  meta.m_bounds.Y.Min = reduction.Get(2);
+  meta.m_bounds.Y.Max = reduction.Get(3);
+  meta.m_bounds.Z.Min = reduction.Get(4);
+  meta.m_bounds.Z.Max = reduction.Get(5);
+  meta.m_num_cells = static_cast<vtkm::Id>(reduction.Get(6));
+  meta.m_num_domains = static_cast<vtkm::Id>(reduction.Get(7));
+
+  bool need_ranges = false;
+  for(size_t f = 0; f < num_fields; ++f)
   {
-    if(components == 0 && global_components[i] != 0)
+    const std::string &field_name = field_names[f];
+    const int offset = field_offset + static_cast<int>(f) * values_per_field;
+    const vtkm::Id max_comps = static_cast<vtkm::Id>(reduction.Get(offset));
+    const vtkm::Float64 min_comps = reduction.Get(offset + 1);
+    const int max_assoc = static_cast<int>(reduction.Get(offset + 2));
+    const vtkm::Float64 min_assoc = reduction.Get(offset + 3);
+
+    if(max_comps != 0 && min_comps != static_cast<vtkm::Float64>(max_comps))
     {
-      components = global_components[i];
-      continue;
+      std::stringstream msg;
+      msg<<"GetRange call failed. The number of components in field "
+         <<field_name<<" does not match across ranks (min "<<min_comps
+         <<" max "<<max_comps<<")";
+      throw Error(msg.str());
     }
 
-    // verify that this matches are current components
-    if(global_components[i] != 0 && components != global_components[i])
+    if(max_assoc != -1 && min_assoc != static_cast<vtkm::Float64>(max_assoc))
     {
       std::stringstream msg;
-      msg<<"GetRange call failed. The number of components ("
-         <<global_components[i]<<") in field "
-         <<field_name<<" from rank"<<i<<" does not match the number of components in"
-         <<" the other ranks "<<components;
+      msg<<"field "<< field_name
+         <<" has inconsistent associations";
       throw Error(msg.str());
     }
+
+    FieldMetadata &field = meta.m_fields[field_name];
+    field.m_exists = max_assoc != -1;
+    field.m_num_components = max_comps;
+    field.m_association = field.m_exists ? detail::IdToAssociation(max_assoc)
+                                         : vtkm::cont::Field::Association::ANY;
+    need_ranges = need_ranges || max_comps != 0;
   }
 
-  // at least one rank has data. Find the global range
-  if(components != 0)
+  if(!compute_ranges || !need_ranges)
   {
-    range.Allocate(components);
-    for(int i = 0; i < components; ++i)
-    {
-
-      vtkm::Range c_range = range.ReadPortal().Get(i);
-
-      vtkm::Float64 local_min;
-      vtkm::Float64 local_max;
+    return meta;
+  }
 
-      if(num_components != 0)
-      {
-        local_min = c_range.Min;
-        local_max = c_range.Max;
-      }
-      else
+  //
+  // second pass: component ranges of every field that exists
+  //
+  detail::PackedReduction range_reduction;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    const vtkm::Id comps = meta.m_fields[field_names[f]].m_num_components;
+    const bool has_ranges = static_cast<vtkm::Id>(local_ranges[f].size()) == comps;
+    for(vtkm::Id c = 0; c < comps; ++c)
+    {
+      vtkm::Range c_range;
+      if(has_ranges)
       {
-        local_min = std::numeric_limits<vtkm::Float64>::max();
-        local_max = std::numeric_limits<vtkm::Float64>::lowest();
+        c_range = local_ranges[f][c];
       }
+      range_reduction.AddMin(c_range.Min);
+      range_reduction.AddMax(c_range.Max);
+    }
+  }
 
-      vtkm::Float64 global_min = 0;
-      vtkm::Float64 global_max = 0;
-
-      MPI_Allreduce((void *)(&local_min),
-                    (void *)(&global_min),
-                    1,
-                    MPI_DOUBLE,
-                    MPI_MIN,
-                    mpi_comm);
+  range_reduction.Reduce();
 
-      MPI_Allreduce((void *)(&local_max),
-                    (void *)(&global_max),
-                    1,
-                    MPI_DOUBLE,
-                    MPI_MAX,
-                    mpi_comm);
-      c_range.Min = global_min;
-      c_range.Max = global_max;
-      range.WritePortal().Set(i, c_range);
+  int index = 0;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    FieldMetadata &field = meta.m_fields[field_names[f]];
+    field.m_ranges.resize(field.m_num_components);
+    for(vtkm::Id c = 0; c < field.m_num_components; ++c)
+    {
+      field.m_ranges[c].Min = range_reduction.Get(index++);
+      field.m_ranges[c].Max = range_reduction.Get(index++);
     }
   }
 
-  delete[] global_components;
-#endif
+  return meta;
+}
+
+DataSet::GlobalMetadata
+DataSet::GetGlobalMetadata(const std::vector<std::string> &field_names,
+                           bool compute_ranges) const
+{
+  VTKH_DATA_OPEN("GetGlobalMetadata");
+  // sorted so every rank packs the fields in the same order
+  std::set<std::string> all_fields(field_names.begin(), field_names.end());
+  std::vector<std::string> names(all_fields.begin(), all_fields.end());
+  VTKH_DATA_ADD("fields", names.size());
+  GlobalMetadata meta = ComputeGlobalMetadata(names, 0, compute_ranges);
   VTKH_DATA_CLOSE();
-  return range;
+  return meta;
 }
 
 void
@@ -700,138 +1326,217 @@ DataSet::GlobalFieldExists(const std::string &field_name) const
 vtkm::cont::Field::Association
 DataSet::GetFieldAssociation(const std::string field_name, bool &valid_field) const
 {
-  valid_field = true;
-  if(!this->GlobalFieldExists(field_name))
+  std::vector<std::string> field_names(1, field_name);
+  GlobalMetadata meta = ComputeGlobalMetadata(field_names, 0, false);
+  const FieldMetadata &field = meta.m_fields[field_name];
+
+  valid_field = field.m_exists;
+  if(!valid_field)
   {
-    valid_field = false;
     return vtkm::cont::Field::Association::ANY;
   }
 
-  int assoc_id = -1;
-  if(this->FieldExists(field_name))
-  {
-    const size_t num_domains = m_domains.size();
-    vtkm::Bounds bounds;
+  return field.m_association;
+}
 
-    vtkm::cont::Field::Association local_assoc;
-    for(size_t i = 0; i < num_domains; ++i)
+vtkm::Id DataSet::NumberOfComponents(const std::string &field_name) const
+{
+  int num_components = 0;
+
+  const size_t num_domains = m_domains.size();
+  for(size_t i = 0; i < num_domains; ++i)
+  {
+    if(m_domains[i].HasField(field_name))
     {
-      vtkm::cont::DataSet dom = m_domains[i];
-      if(dom.HasField(field_name))
-      {
-        local_assoc = dom.GetField(field_name).GetAssociation();
-        if(local_assoc == vtkm::cont::Field::Association::ANY)
-        {
-          assoc_id = 0;
-        }
-        else if ( local_assoc == vtkm::cont::Field::Association::WHOLE_MESH)
-        {
-          assoc_id = 1;
-        }
-        else if ( local_assoc == vtkm::cont::Field::Association::POINTS)
-        {
-          assoc_id = 2;
-        }
-        else if ( local_assoc == vtkm::cont::Field::Association::CELL_SET)
-        {
-          assoc_id = 3;
-        }
-        break;
-      }
+      num_components = m_domains[i].GetField(field_name).GetData().GetNumberOfComponents();
+      break;
     }
   }
 
 #ifdef VTKH_PARALLEL
-
   MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
 
-
-  int *global_assocs = new int[vtkh::GetMPISize()];
-
-  MPI_Allgather(&assoc_id,
-                1,
-                MPI_INT,
-                global_assocs,
+  int global_comps;
+  MPI_Allreduce((void *)(&num_components),
+                (void *)(&global_comps),
                 1,
                 MPI_INT,
+                MPI_MAX,
                 mpi_comm);
 
-  int id = -1;
+  num_components = global_comps;
+#endif
+  return num_components;
+}
+
+DataSet
+DataSet::Coalesce(const vtkm::Id max_cells, const std::string &id_field) const
+{
+  VTKH_DATA_OPEN("Coalesce");
+  VTKH_DATA_ADD("input_domains", m_domains.size());
+  DataSet res;
+  res.SetCycle(m_cycle);
 
-  for(int i = 0; i < vtkh::GetMPISize(); ++i)
+  // every domain knows where its cells came from. A domain that already
+  // has the field came out of an earlier coalesce and keeps it
+  const size_t num_domains = m_domains.size();
+  std::vector<vtkm::cont::DataSet> domains(num_domains);
+  std::vector<vtkm::Id> num_cells(num_domains);
+  for(size_t i = 0; i < num_domains; ++i)
   {
-    if(global_assocs[i] != -1)
+    domains[i] = m_domains[i];
+    num_cells[i] = m_domains[i].GetCellSet().GetNumberOfCells();
+    if(!domains[i].HasField(id_field, vtkm::cont::Field::Association::CELL_SET))
     {
-      if(id != -1 && global_assocs[i] != id)
-      {
-        std::stringstream msg;
-        msg<<"field "<< field_name
-           <<" has inconsistent associations";;
-        throw Error(msg.str());
-      }
-      else
-      {
-        id = std::max(id, global_assocs[i]);
-      }
+      vtkm::cont::ArrayHandle<vtkm::Id> ids;
+      detail::MemSet(ids, m_domain_ids[i], num_cells[i]);
+      domains[i].AddField(
+        vtkm::cont::Field(id_field, vtkm::cont::Field::Association::CELL_SET, ids));
     }
   }
-  assoc_id = id;
-  delete[] global_assocs;
-#endif
 
-  vtkm::cont::Field::Association assoc;
+  std::vector<vtkm::cont::DataSet> batch;
+  vtkm::Id batch_id = 0;
+  vtkm::Id batch_cells = 0;
+  detail::FieldSignatureType batch_fields;
 
-  if(assoc_id == 0)
-  {
-    assoc = vtkm::cont::Field::Association::ANY;
-  }
-  else if ( assoc_id == 1)
-  {
-    assoc = vtkm::cont::Field::Association::WHOLE_MESH;
-  }
-  else if ( assoc_id == 2)
+  auto flush = [&]()
   {
-    assoc = vtkm::cont::Field::Association::POINTS;
-  }
-  else if ( assoc_id == 3)
-  {
-    assoc = vtkm::cont::Field::Association::CELL_SET;
-  }
-  else
+    if(batch.size() == 1)
+    {
+      res.AddDomain(batch[0], batch_id);
+    }
+    else if(batch.size() > 1)
+    {
+      res.AddDomain(detail::MergeDomains(batch), batch_id);
+    }
+    batch.clear();
+    batch_cells = 0;
+  };
+
+  for(size_t i = 0; i < num_domains; ++i)
   {
-    throw Error("Get association: unknown association");
+    if(num_cells[i] >= max_cells)
+    {
+      flush();
+      res.AddDomain(domains[i], m_domain_ids[i]);
+      continue;
+    }
+
+    detail::FieldSignatureType fields = detail::FieldSignature(domains[i]);
+    if(!batch.empty() &&
+       (batch_cells + num_cells[i] > max_cells || fields != batch_fields))
+    {
+      flush();
+    }
+    if(batch.empty())
+    {
+      batch_id = m_domain_ids[i];
+      batch_fields = fields;
+    }
+    batch.push_back(domains[i]);
+    batch_cells += num_cells[i];
   }
-  return assoc;
+  flush();
+
+  VTKH_DATA_ADD("output_domains", res.GetNumberOfDomains());
+  VTKH_DATA_CLOSE();
+  return res;
 }
 
-vtkm::Id DataSet::NumberOfComponents(const std::string &field_name) const
+DataSet
+DataSet::Split(const std::vector<vtkm::Id> &domain_ids, const std::string &id_field) const
 {
-  int num_components = 0;
+  VTKH_DATA_OPEN("Split");
+  DataSet res;
+  res.SetCycle(m_cycle);
 
+  std::map<vtkm::Id, vtkm::cont::DataSet> split;
   const size_t num_domains = m_domains.size();
   for(size_t i = 0; i < num_domains; ++i)
   {
-    if(m_domains[i].HasField(field_name))
+    const vtkm::cont::DataSet &dom = m_domains[i];
+    if(!dom.HasField(id_field, vtkm::cont::Field::Association::CELL_SET))
     {
-      num_components = m_domains[i].GetField(field_name).GetData().GetNumberOfComponents();
-      break;
+      split[m_domain_ids[i]] = dom;
+      continue;
+    }
+
+    vtkm::cont::ArrayHandle<vtkm::Id> ids;
+    detail::CopyIds copier(ids);
+    dom.GetField(id_field, vtkm::cont::Field::Association::CELL_SET).GetData()
+      .ResetTypes(vtkm::TypeListScalarAll()).CastAndCall(copier);
+
+    // the cells of one id end up next to each other, in their order
+    const vtkm::Id num_cells = ids.GetNumberOfValues();
+    vtkm::cont::ArrayHandle<vtkm::Id> cells;
+    vtkm::cont::ArrayCopy(vtkm::cont::ArrayHandleCounting<vtkm::Id>(0, 1, num_cells), cells);
+    auto id_cells = vtkm::cont::make_ArrayHandleZip(ids, cells);
+    vtkm::cont::Algorithm::Sort(id_cells);
+
+    vtkm::cont::ArrayHandle<vtkm::Id> out_ids;
+    vtkm::cont::ArrayHandle<vtkm::Id> id_counts;
+    vtkm::cont::Algorithm::ReduceByKey(ids,
+                                       vtkm::cont::make_ArrayHandleConstant(vtkm::Id(1), num_cells),
+                                       out_ids,
+                                       id_counts,
+                                       vtkm::Add());
+
+    const vtkm::Id num_ids = out_ids.GetNumberOfValues();
+    if(num_ids < 2)
+    {
+      const vtkm::Id domain_id = num_ids == 0 ? m_domain_ids[i] : out_ids.ReadPortal().Get(0);
+      split[domain_id] = detail::WithoutField(dom, id_field);
+      continue;
+    }
+
+    auto id_portal = out_ids.ReadPortal();
+    auto count_portal = id_counts.ReadPortal();
+    vtkm::Id start = 0;
+    for(vtkm::Id p = 0; p < num_ids; ++p)
+    {
+      const vtkm::Id count = count_portal.Get(p);
+      vtkm::cont::ArrayHandle<vtkm::Id> cell_ids;
+      vtkm::cont::Algorithm::CopySubRange(cells, start, count, cell_ids);
+      split[id_portal.Get(p)] = detail::ExtractCells(dom, cell_ids, id_field);
+      start += count;
     }
   }
 
-#ifdef VTKH_PARALLEL
-  MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+  // a batch is named after its first domain and holds the domains up to
+  // the next batch. Domains that lost all their cells are added empty
+  const vtkm::cont::ArrayHandle<vtkm::Id> no_cells;
+  const vtkm::cont::DataSet *batch = nullptr;
+  for(const vtkm::Id domain_id : domain_ids)
+  {
+    auto batch_it = std::find(m_domain_ids.begin(), m_domain_ids.end(), domain_id);
+    if(batch_it != m_domain_ids.end())
+    {
+      batch = &m_domains[batch_it - m_domain_ids.begin()];
+    }
 
-  int global_comps;
-  MPI_Allreduce((void *)(&num_components),
-                (void *)(&global_comps),
-                1,
-                MPI_INT,
-                MPI_MAX,
-                mpi_comm);
+    auto it = split.find(domain_id);
+    if(it != split.end())
+    {
+      res.AddDomain(it->second, domain_id);
+      split.erase(it);
+    }
+    else if(batch != nullptr &&
+            batch->HasField(id_field, vtkm::cont::Field::Association::CELL_SET))
+    {
+      res.AddDomain(detail::ExtractCells(*batch, no_cells, id_field), domain_id);
+    }
+  }
 
-  num_components = global_comps;
-#endif
-  return num_components;
+  // ids that were not asked for go last
+  for(auto &dom : split)
+  {
+    res.AddDomain(dom.second, dom.first);
+  }
+
+  VTKH_DATA_ADD("output_domains", res.GetNumberOfDomains());
+  VTKH_DATA_CLOSE();
+  return res;
 }
 
 } // namspace vtkh
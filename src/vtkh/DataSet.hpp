@@ -2,6 +2,7 @@
 #define VTK_H_DATA_SET_HPP
 
 
+#include <map>
 #include <vector>
 #include <string>
 
@@ -14,10 +15,42 @@ namespace vtkh
 
 class VTKH_API DataSet
 {
+public:
+  // cell field written by Coalesce naming the domain every cell came from
+  static const std::string DOMAIN_ID_FIELD;
+
+  // globally reduced information about a single field
+  struct FieldMetadata
+  {
+    // true if the field exists in at least one domain on any rank
+    bool m_exists;
+    // number of components (0 if the field does not exist)
+    vtkm::Id m_num_components;
+    // only meaningful if the field exists
+    vtkm::cont::Field::Association m_association;
+    // one range per component. Empty unless the field exists
+    std::vector<vtkm::Range> m_ranges;
+  };
+
+  // globally reduced information about the whole data set
+  struct GlobalMetadata
+  {
+    // bounds of coordinate system 0
+    vtkm::Bounds m_bounds;
+    vtkm::Id     m_num_cells;
+    vtkm::Id     m_num_domains;
+    std::map<std::string, FieldMetadata> m_fields;
+    bool IsEmpty() const { return m_num_cells == 0; }
+  };
+
 protected:
   std::vector<vtkm::cont::DataSet> m_domains;
   std::vector<vtkm::Id>            m_domain_ids;
   vtkm::UInt64                     m_cycle;
+
+  GlobalMetadata ComputeGlobalMetadata(const std::vector<std::string> &field_names,
+                                       vtkm::Id coordinate_system_index,
+                                       bool compute_ranges) const;
 public:
   DataSet();
   ~DataSet();
@@ -102,7 +135,50 @@ public:
 
   bool IsPointMesh() const;
 
+  /*! \brief GetGlobalMetadata returns the global bounds, cell and domain
+   *         counts and the existence, association, number of components
+   *         and range of every requested field using at most two
+   *         collectives, regardless of the number of fields.
+   *
+   *  This is a collective call and all ranks must call it with the same
+   *  field names. Without compute_ranges the field ranges are left empty
+   *  and a single collective is used.
+   */
+  GlobalMetadata GetGlobalMetadata(const std::vector<std::string> &field_names,
+                                   bool compute_ranges = true) const;
+
   void PrintSummary(std::ostream &stream) const;
+
+  /*! \brief Coalesce packs runs of consecutive domains with fewer than
+   *         max_cells cells into explicit domains of at most max_cells
+   *         cells, so per domain overhead (dispatch, allocation, clean
+   *         up) is paid once per batch instead of once per tiny patch.
+   *
+   *  Every output domain gets a cell field named id_field holding the
+   *  id of the domain each cell came from. A merged domain takes the id
+   *  of its first input domain. Larger domains are passed through as
+   *  they are, with the id field added. A batch ends where the point and
+   *  cell fields or their array types change, so every field is kept.
+   *  Points are not merged, so the result can feed any filter that works
+   *  cell by cell (MarchingCubes, Threshold, Slice) or a renderer.
+   *  This is local to the rank and does not communicate.
+   */
+  DataSet Coalesce(const vtkm::Id max_cells,
+                   const std::string &id_field = DOMAIN_ID_FIELD) const;
+
+  /*! \brief Split undoes Coalesce on a data set derived from its output:
+   *         every cell goes back to the domain named by its id_field
+   *         value and id_field is dropped. Domains without id_field are
+   *         passed through.
+   *
+   *  The result lists the domains in the order of domain_ids, usually
+   *  the ids of the data set that was coalesced. A domain that lost all
+   *  its cells (e.g. no isosurface) is added as an empty explicit
+   *  domain with the fields of its batch, like a filter run on that
+   *  domain alone would produce.
+   */
+  DataSet Split(const std::vector<vtkm::Id> &domain_ids,
+                const std::string &id_field = DOMAIN_ID_FIELD) const;
 };
 
 } // namespace vtkh
@@ -3,6 +3,7 @@
 
 #include <iomanip>
 #include <cstdlib>
+#include <vector>
 
 namespace vtkh
 {
@@ -50,6 +51,39 @@ Logger::Write(const int level, const std::string &message, const char *file, int
 
 // ---------------------------------------------------------------------------------------
 
+namespace detail
+{
+
+bool data_log_env_enabled()
+{
+  const char *data_log = std::getenv("VTKH_DATA_LOG");
+  return data_log == nullptr || std::atoi(data_log) != 0;
+}
+
+bool data_summary_env_enabled()
+{
+  const char *data_summary = std::getenv("VTKH_DATA_SUMMARY");
+  return data_summary != nullptr && std::atoi(data_summary) != 0;
+}
+
+// what OpenLogEntry did for an entry, so CloseLogEntry undoes exactly
+// that when logging is turned on or off inside the entry
+struct OpenEntry
+{
+  bool m_trace;
+  bool m_log;
+};
+
+std::vector<OpenEntry>& open_entries()
+{
+  thread_local std::vector<OpenEntry> entries;
+  return entries;
+}
+
+} // namespace detail
+
+bool DataLogger::YAMLEnabled = detail::data_log_env_enabled();
+bool DataLogger::SummaryEnabled = detail::data_summary_env_enabled();
 DataLogger DataLogger::Instance;
 
 DataLogger::DataLogger()
@@ -63,7 +97,10 @@ DataLogger::DataLogger()
 DataLogger::~DataLogger()
 {
 #ifdef VTKH_ENABLE_LOGGING
-  WriteLog();
+  if(!Stream.str().empty())
+  {
+    WriteLog();
+  }
 #endif
   Stream.str("");
 }
@@ -84,6 +121,43 @@ void
 DataLogger::SetRank(int rank)
 {
   Rank = rank;
+  TraceLogger::GetInstance()->SetRank(rank);
+}
+
+void
+DataLogger::SetYAMLEnabled(bool enabled)
+{
+  YAMLEnabled = enabled;
+}
+
+bool
+DataLogger::GetYAMLEnabled() const
+{
+  return YAMLEnabled;
+}
+
+void
+DataLogger::SetSummaryEnabled(bool enabled)
+{
+  SummaryEnabled = enabled;
+}
+
+bool
+DataLogger::GetSummaryEnabled() const
+{
+  return SummaryEnabled;
+}
+
+const std::map<std::string, DataLogger::RegionTime>&
+DataLogger::GetRegionTimes() const
+{
+  return RegionTimes;
+}
+
+void
+DataLogger::ResetRegionTimes()
+{
+  RegionTimes.clear();
 }
 
 void
@@ -139,23 +213,50 @@ DataLogger::WriteLog()
 void
 DataLogger::OpenLogEntry(const std::string &entryName)
 {
-    WriteIndent();
-    // ensure that we have unique keys for valid yaml
-    int key_count = KeyCounters.top()[entryName]++;
+    detail::OpenEntry entry;
+    entry.m_trace = TraceLogger::IsEnabled();
+    entry.m_log = IsEnabled();
+    if(entry.m_trace)
+    {
+      TraceLogger::GetInstance()->Begin(entryName);
+    }
 
-    if(key_count != 0)
+    // the first thread to open an entry owns the log until it is closed
+    if(entry.m_log && Timers.empty())
+    {
+      Owner = std::this_thread::get_id();
+    }
+    else if(entry.m_log && !IsOwner())
     {
-      Stream<<entryName<<"_"<<key_count<<":"<<"\n";
+      entry.m_log = false;
     }
-    else
+    detail::open_entries().push_back(entry);
+    if(!entry.m_log)
+    {
+      return;
+    }
+
+    // ensure that we have unique keys for valid yaml
+    int key_count = KeyCounters.top()[entryName]++;
+
+    if(YAMLEnabled)
     {
-      Stream<<entryName<<":"<<"\n";
+      WriteIndent();
+      if(key_count != 0)
+      {
+        Stream<<entryName<<"_"<<key_count<<":"<<"\n";
+      }
+      else
+      {
+        Stream<<entryName<<":"<<"\n";
+      }
     }
 
     int indent = this->CurrentBlock().Indent;
     Blocks.push(Block(indent+1));
     KeyCounters.push(std::map<std::string,int>());
 
+    Names.push(entryName);
     Timer timer;
     Timers.push(timer);
     AtBlockStart = true;
@@ -164,9 +265,35 @@ DataLogger::OpenLogEntry(const std::string &entryName)
 void
 DataLogger::CloseLogEntry()
 {
-  WriteIndent();
-  this->Stream<<"time : "<<Timers.top().elapsed()<<"\n";
+  std::vector<detail::OpenEntry> &entries = detail::open_entries();
+  if(entries.empty())
+  {
+    return;
+  }
+  const detail::OpenEntry entry = entries.back();
+  entries.pop_back();
+
+  if(entry.m_trace)
+  {
+    TraceLogger::GetInstance()->End();
+  }
+  if(!entry.m_log)
+  {
+    return;
+  }
+
+  const double elapsed = Timers.top().elapsed();
+  RegionTime &region = RegionTimes[Names.top()];
+  region.Time += elapsed;
+  region.Count++;
+
+  if(YAMLEnabled)
+  {
+    WriteIndent();
+    this->Stream<<"time : "<<elapsed<<"\n";
+  }
   Timers.pop();
+  Names.pop();
   Blocks.pop();
   KeyCounters.pop();
   AtBlockStart = false;
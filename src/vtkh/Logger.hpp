@@ -3,8 +3,10 @@
 
 #include <vtkh/vtkh_exports.h>
 #include <vtkh/Timer.hpp>
+#include <vtkh/TraceLogger.hpp>
 #include <vtkh/utils/StreamUtil.hpp>
 #include <stack>
+#include <thread>
 
 //from rover logging
 namespace vtkh
@@ -41,15 +43,53 @@ public:
     {  }
   };
 
+  // time and number of calls of the closed entries with one name
+  struct RegionTime
+  {
+    double Time;
+    long long Count;
+
+    RegionTime()
+      : Time(0.), Count(0)
+    {  }
+  };
+
   ~DataLogger();
   static DataLogger *GetInstance();
   void OpenLogEntry(const std::string &entryName);
   void CloseLogEntry();
   void SetRank(int rank);
 
+  // the entries go to the yaml log and / or the streaming trace
+  // (see TraceLogger). The yaml log is kept in memory until exit and
+  // can be turned off with VTKH_DATA_LOG=0. With both off the logging
+  // macros only test these flags and keep track of the open entries.
+  static bool IsEnabled()
+  {
+    return YAMLEnabled || SummaryEnabled || TraceLogger::IsEnabled();
+  }
+  void SetYAMLEnabled(bool enabled);
+  bool GetYAMLEnabled() const;
+  // keeps the entry times for a PerfSummary when the yaml log and the
+  // trace are off. Also turned on with VTKH_DATA_SUMMARY=1
+  void SetSummaryEnabled(bool enabled);
+  bool GetSummaryEnabled() const;
+
+  // totals by entry name since the last reset, kept whenever logging is on
+  const std::map<std::string, RegionTime>& GetRegionTimes() const;
+  void ResetRegionTimes();
+
   template<typename T>
   void AddLogData(const std::string key, const T &value)
   {
+    if(TraceLogger::IsEnabled())
+    {
+      TraceLogger::GetInstance()->AddValue(key, value);
+    }
+    if(!YAMLEnabled || (!Timers.empty() && !IsOwner()))
+    {
+      return;
+    }
     WriteIndent();
     this->Stream << key << ": " << value <<"\n";
     AtBlockStart = false;
@@ -62,23 +102,33 @@ protected:
 
   void WriteLog();
   void WriteIndent();
+  // the yaml log and the entry times follow one thread. Entries from
+  // other threads, e.g. domain parallel filters, only go to the trace
+  bool IsOwner() const { return std::this_thread::get_id() == Owner; }
   DataLogger::Block& CurrentBlock();
   std::stringstream Stream;
   static class DataLogger Instance;
+  static bool YAMLEnabled;
+  static bool SummaryEnabled;
   std::stack<Block> Blocks;
   std::stack<Timer> Timers;
+  std::stack<std::string> Names;
+  std::map<std::string, RegionTime> RegionTimes;
   std::stack<std::map<std::string,int>> KeyCounters;
   bool AtBlockStart;
   int Rank;
+  std::thread::id Owner;
 };
 
 #ifdef VTKH_ENABLE_LOGGING
 #define VTKH_INFO(msg) vtkh::Logger::GetInstance("info")->GetStream()<<msg<<std::endl;
 #define VTKH_WARN(msg) vtkh::Logger::GetInstance("warning")->GetStream()<<msg<<std::endl;
 #define VTKH_ERROR(msg) vtkh::Logger::GetInstance("error")->GetStream()<<msg<<std::endl;
+// entries are always opened and closed so they stay balanced when
+// logging is turned on or off inside of one
 #define VTKH_DATA_OPEN(key) vtkh::DataLogger::GetInstance()->OpenLogEntry(key);
 #define VTKH_DATA_CLOSE() vtkh::DataLogger::GetInstance()->CloseLogEntry();
-#define VTKH_DATA_ADD(key,value) vtkh::DataLogger::GetInstance()->AddLogData(key, value);
+#define VTKH_DATA_ADD(key,value) if(!vtkh::DataLogger::IsEnabled()) {} else vtkh::DataLogger::GetInstance()->AddLogData(key, value);
 
 #else
 #define VTKH_INFO(msg)
@@ -0,0 +1,297 @@
+#include <vtkh/PerfSummary.hpp>
+#include <vtkh/vtkh.hpp>
+#include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
+#include <vtkh/StatisticsDB.hpp>
+
+#ifdef VTKH_PARALLEL
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+// statistics of one region over a set of ranks. mean and m2 are merged
+// with Chan's formula so the stddev does not suffer from cancellation
+struct RegionStats
+{
+  int m_ranks;
+  int m_min_rank;
+  int m_max_rank;
+  int m_pad;
+  long long m_calls;
+  double m_mean;
+  double m_m2;
+  double m_min;
+  double m_max;
+
+  RegionStats()
+    : m_ranks(0), m_min_rank(-1), m_max_rank(-1), m_pad(0), m_calls(0),
+      m_mean(0.), m_m2(0.), m_min(0.), m_max(0.)
+  {}
+
+  RegionStats(const double time, const long long calls, const int rank)
+    : m_ranks(1), m_min_rank(rank), m_max_rank(rank), m_pad(0), m_calls(calls),
+      m_mean(time), m_m2(0.), m_min(time), m_max(time)
+  {}
+
+  void Merge(const RegionStats &other)
+  {
+    if(other.m_ranks == 0)
+    {
+      return;
+    }
+    if(m_ranks == 0)
+    {
+      *this = other;
+      return;
+    }
+    const double na = static_cast<double>(m_ranks);
+    const double nb = static_cast<double>(other.m_ranks);
+    const double n = na + nb;
+    const double delta = other.m_mean - m_mean;
+    m_mean += delta * nb / n;
+    m_m2 += other.m_m2 + delta * delta * na * nb / n;
+    m_ranks += other.m_ranks;
+    m_calls += other.m_calls;
+    // ties go to the lower rank so the result does not depend on the tree
+    if(other.m_min < m_min || (other.m_min == m_min && other.m_min_rank < m_min_rank))
+    {
+      m_min = other.m_min;
+      m_min_rank = other.m_min_rank;
+    }
+    if(other.m_max > m_max || (other.m_max == m_max && other.m_max_rank < m_max_rank))
+    {
+      m_max = other.m_max;
+      m_max_rank = other.m_max_rank;
+    }
+  }
+};
+
+typedef std::map<std::string, RegionStats> StatsMap;
+
+#ifdef VTKH_PARALLEL
+const int SUMMARY_TAG = 2101;
+
+// [int count] then per region: [int length][name][RegionStats]
+void pack_stats(const StatsMap &stats, std::vector<char> &buffer)
+{
+  size_t size = sizeof(int);
+  for(const auto &region : stats)
+  {
+    size += sizeof(int) + region.first.size() + sizeof(RegionStats);
+  }
+  buffer.resize(size);
+
+  char *ptr = &buffer[0];
+  const int count = static_cast<int>(stats.size());
+  std::memcpy(ptr, &count, sizeof(int));
+  ptr += sizeof(int);
+  for(const auto &region : stats)
+  {
+    const int length = static_cast<int>(region.first.size());
+    std::memcpy(ptr, &length, sizeof(int));
+    ptr += sizeof(int);
+    std::memcpy(ptr, region.first.data(), length);
+    ptr += length;
+    std::memcpy(ptr, &region.second, sizeof(RegionStats));
+    ptr += sizeof(RegionStats);
+  }
+}
+
+void unpack_merge_stats(const std::vector<char> &buffer, StatsMap &stats)
+{
+  const char *ptr = &buffer[0];
+  int count;
+  std::memcpy(&count, ptr, sizeof(int));
+  ptr += sizeof(int);
+  for(int i = 0; i < count; ++i)
+  {
+    int length;
+    std::memcpy(&length, ptr, sizeof(int));
+    ptr += sizeof(int);
+    const std::string name(ptr, length);
+    ptr += length;
+    RegionStats region;
+    std::memcpy(&region, ptr, sizeof(RegionStats));
+    ptr += sizeof(RegionStats);
+    stats[name].Merge(region);
+  }
+}
+#endif
+
+} // namespace detail
+
+PerfSummary::PerfSummary()
+{
+}
+
+void
+PerfSummary::Add(const std::string &name, double seconds, long long calls)
+{
+  auto it = m_regions.find(name);
+  if(it == m_regions.end())
+  {
+    Local local;
+    local.m_time = seconds;
+    local.m_calls = calls;
+    m_regions[name] = local;
+  }
+  else
+  {
+    it->second.m_time += seconds;
+    it->second.m_calls += calls;
+  }
+}
+
+void
+PerfSummary::AddDataLog()
+{
+  const auto &regions = DataLogger::GetInstance()->GetRegionTimes();
+  for(const auto &region : regions)
+  {
+    Add(region.first, region.second.Time, region.second.Count);
+  }
+}
+
+void
+PerfSummary::AddStatistics(const StatisticsDB &db, const std::string &prefix)
+{
+  const std::map<std::string,double> times = db.timerTimes();
+  for(const auto &timer : times)
+  {
+    Add(prefix + timer.first, timer.second, 1);
+  }
+}
+
+void
+PerfSummary::AddProfile()
+{
+  const std::vector<Profiler::Region> regions = Profiler::GetInstance()->GetRegions();
+  for(const auto &region : regions)
+  {
+    Add(region.m_path, region.m_time, region.m_calls);
+  }
+}
+
+void
+PerfSummary::Reset()
+{
+  m_regions.clear();
+}
+
+std::vector<PerfSummary::Region>
+PerfSummary::Reduce() const
+{
+  const int rank = vtkh::GetMPIRank();
+  detail::StatsMap stats;
+  for(const auto &region : m_regions)
+  {
+    stats[region.first] = detail::RegionStats(region.second.m_time,
+                                              region.second.m_calls,
+                                              rank);
+  }
+
+#ifdef VTKH_PARALLEL
+  // binomial tree towards rank 0. In round k the ranks with bit k set
+  // send what they have merged so far to rank - 2^k and drop out
+  MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+  const int size = vtkh::GetMPISize();
+  std::vector<char> buffer;
+  for(int mask = 1; mask < size; mask <<= 1)
+  {
+    if((rank & mask) != 0)
+    {
+      detail::pack_stats(stats, buffer);
+      MPI_Send(&buffer[0], static_cast<int>(buffer.size()), MPI_BYTE,
+               rank - mask, detail::SUMMARY_TAG, comm);
+      break;
+    }
+    const int child = rank + mask;
+    if(child < size)
+    {
+      MPI_Status status;
+      MPI_Probe(child, detail::SUMMARY_TAG, comm, &status);
+      int bytes;
+      MPI_Get_count(&status, MPI_BYTE, &bytes);
+      buffer.resize(bytes);
+      MPI_Recv(&buffer[0], bytes, MPI_BYTE, child, detail::SUMMARY_TAG, comm, &status);
+      detail::unpack_merge_stats(buffer, stats);
+    }
+  }
+#endif
+
+  std::vector<Region> res;
+  if(rank != 0)
+  {
+    return res;
+  }
+
+  for(const auto &region : stats)
+  {
+    const detail::RegionStats &s = region.second;
+    Region summary;
+    summary.m_name = region.first;
+    summary.m_ranks = s.m_ranks;
+    summary.m_calls = s.m_calls;
+    summary.m_min = s.m_min;
+    summary.m_max = s.m_max;
+    summary.m_mean = s.m_mean;
+    summary.m_stddev = std::sqrt(std::max(0., s.m_m2 / static_cast<double>(s.m_ranks)));
+    summary.m_min_rank = s.m_min_rank;
+    summary.m_max_rank = s.m_max_rank;
+    res.push_back(summary);
+  }
+
+  std::stable_sort(res.begin(), res.end(), [](const Region &a, const Region &b)
+  {
+    return a.m_max > b.m_max;
+  });
+  return res;
+}
+
+void
+PerfSummary::Write(const std::string &file_name) const
+{
+  std::vector<Region> regions = Reduce();
+  if(vtkh::GetMPIRank() != 0)
+  {
+    return;
+  }
+
+  std::ofstream stream(file_name.c_str(), std::ofstream::out);
+  if(!stream.is_open())
+  {
+    std::cerr<<"Warning: could not open the vtkh summary file "<<file_name<<"\n";
+    return;
+  }
+
+  stream<<"ranks: "<<vtkh::GetMPISize()<<"\n";
+  stream<<"regions:\n";
+  for(const auto &region : regions)
+  {
+    // max / mean, 1 is perfectly balanced
+    const double imbalance = region.m_mean > 0. ? region.m_max / region.m_mean : 1.;
+    stream<<"  - {name: \""<<region.m_name<<"\""
+          <<", ranks: "<<region.m_ranks
+          <<", calls: "<<region.m_calls
+          <<", min: "<<region.m_min
+          <<", min_rank: "<<region.m_min_rank
+          <<", max: "<<region.m_max
+          <<", max_rank: "<<region.m_max_rank
+          <<", mean: "<<region.m_mean
+          <<", stddev: "<<region.m_stddev
+          <<", imbalance: "<<imbalance<<"}\n";
+  }
+}
+
+} // namespace vtkh
@@ -0,0 +1,76 @@
+#ifndef VTK_H_PERF_SUMMARY_HPP
+#define VTK_H_PERF_SUMMARY_HPP
+
+#include <vtkh/vtkh_exports.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vtkh
+{
+
+class StatisticsDB;
+
+//
+// Reduces the time spent in named regions over all ranks to the
+// min / max / mean / stddev and the ranks of the extremes, so load
+// imbalance can be read from one file instead of one log per rank.
+// Each rank contributes the total time of a region (all calls summed).
+// The partial results are merged up a binomial tree, so every message
+// has one record per region no matter how many ranks there are.
+//
+//   vtkh::PerfSummary summary;
+//   summary.AddDataLog();           // VTKH_DATA_OPEN / CLOSE entries
+//   summary.AddStatistics(vtkh::stats);
+//   summary.AddProfile();           // VTKH_PROFILE_SCOPE regions
+//   summary.Write("vtkh_summary.yaml");
+//
+// Reduce and Write are collective over the vtkh communicator.
+//
+class VTKH_API PerfSummary
+{
+public:
+  struct Region
+  {
+    std::string m_name;
+    int m_ranks;        // ranks that recorded the region
+    long long m_calls;  // summed over the ranks
+    double m_min;
+    double m_max;
+    double m_mean;
+    double m_stddev;
+    int m_min_rank;
+    int m_max_rank;
+  };
+
+  PerfSummary();
+
+  // time in seconds, added to what this rank has for the name
+  void Add(const std::string &name, double seconds, long long calls = 1);
+  // the entry totals kept by the DataLogger since its last reset
+  void AddDataLog();
+  // the timers of a statistics db, e.g. vtkh::stats
+  void AddStatistics(const StatisticsDB &db, const std::string &prefix = "");
+  // the Profiler regions, named by their call path
+  void AddProfile();
+  void Reset();
+
+  // the result is only complete on rank 0. Regions are sorted by
+  // decreasing max time
+  std::vector<Region> Reduce() const;
+  // rank 0 writes the summary as a yaml list, one region per line
+  void Write(const std::string &file_name) const;
+
+protected:
+  struct Local
+  {
+    double m_time;
+    long long m_calls;
+  };
+  std::map<std::string, Local> m_regions;
+};
+
+} // namespace vtkh
+
+#endif //VTK_H_PERF_SUMMARY_HPP
@@ -0,0 +1,522 @@
+#include <vtkh/Profiler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+bool profile_env_flag(const char *name)
+{
+  const char *flag = std::getenv(name);
+  return flag != nullptr && std::atoi(flag) != 0;
+}
+
+std::vector<std::string> profile_env_regions()
+{
+  std::vector<std::string> res;
+  const char *regions = std::getenv("VTKH_PROFILE_REGIONS");
+  if(regions == nullptr)
+  {
+    return res;
+  }
+  std::stringstream ss(regions);
+  std::string name;
+  while(std::getline(ss, name, ','))
+  {
+    if(!name.empty())
+    {
+      res.push_back(name);
+    }
+  }
+  return res;
+}
+
+//
+// one perf event group per thread, read with a single system call
+//
+class PerfCounters
+{
+public:
+  PerfCounters()
+    : m_leader(-1), m_num_open(0)
+  {
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      m_fds[i] = -1;
+      m_index[i] = -1;
+    }
+  }
+
+  ~PerfCounters()
+  {
+    Close();
+  }
+
+  bool IsOpen() const
+  {
+    return m_leader != -1;
+  }
+
+  // counters the hardware or the kernel do not allow are left out
+  bool Open()
+  {
+#ifdef __linux__
+    const unsigned long long configs[Profiler::NUM_COUNTERS] =
+      { PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES };
+
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      // this thread on any cpu
+      const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, m_leader, 0);
+      if(fd < 0)
+      {
+        continue;
+      }
+      m_fds[i] = static_cast<int>(fd);
+      m_index[i] = m_num_open++;
+      if(m_leader == -1)
+      {
+        m_leader = m_fds[i];
+      }
+    }
+#endif
+    return IsOpen();
+  }
+
+  void Close()
+  {
+#ifdef __linux__
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      if(m_fds[i] != -1)
+      {
+        close(m_fds[i]);
+      }
+    }
+#endif
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      m_fds[i] = -1;
+      m_index[i] = -1;
+    }
+    m_leader = -1;
+    m_num_open = 0;
+  }
+
+  // -1 for the counters that are not open
+  void Read(long long values[Profiler::NUM_COUNTERS]) const
+  {
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      values[i] = -1;
+    }
+#ifdef __linux__
+    if(m_leader == -1)
+    {
+      return;
+    }
+    // nr followed by one value per counter in the group
+    unsigned long long buffer[1 + Profiler::NUM_COUNTERS];
+    const ssize_t bytes = read(m_leader, buffer, sizeof(buffer));
+    if(bytes < static_cast<ssize_t>(sizeof(unsigned long long) * (1 + m_num_open)))
+    {
+      return;
+    }
+    for(int i = 0; i < Profiler::NUM_COUNTERS; ++i)
+    {
+      if(m_index[i] != -1)
+      {
+        values[i] = static_cast<long long>(buffer[1 + m_index[i]]);
+      }
+    }
+#endif
+  }
+
+protected:
+  PerfCounters(PerfCounters const &);
+  int m_fds[Profiler::NUM_COUNTERS];
+  int m_index[Profiler::NUM_COUNTERS];
+  int m_leader;
+  int m_num_open;
+};
+
+// sorts children right after their parent
+std::string path_key(const std::string &path)
+{
+  std::string key = path;
+  std::replace(key.begin(), key.end(), '/', '\x01');
+  return key;
+}
+
+} // namespace detail
+
+bool Profiler::Enabled = detail::profile_env_flag("VTKH_PROFILE");
+
+struct Profiler::ThreadProfile
+{
+  struct Frame
+  {
+    std::string m_path;
+    bool m_record;
+    std::chrono::steady_clock::time_point m_start;
+    long long m_counters[NUM_COUNTERS];
+  };
+
+  struct Totals
+  {
+    long long m_calls;
+    double m_time;
+    long long m_counters[NUM_COUNTERS];
+  };
+
+  std::vector<Frame> m_stack;
+  detail::PerfCounters m_perf;
+  bool m_perf_tried;
+  // guards the totals, which are read and reset by other threads
+  std::mutex m_lock;
+  std::map<std::string, Totals> m_totals;
+
+  ThreadProfile()
+    : m_perf_tried(false)
+  {}
+};
+
+struct Profiler::InternalsType
+{
+  std::mutex m_lock;
+  std::vector<std::shared_ptr<ThreadProfile>> m_threads;
+  std::atomic<bool> m_counters;
+  std::atomic<bool> m_has_regions;
+  std::set<std::string> m_regions;
+
+  bool IsListed(const std::string &name)
+  {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_regions.find(name) != m_regions.end();
+  }
+};
+
+Profiler::Profiler()
+  : m_internals(new InternalsType)
+{
+  m_internals->m_counters = detail::profile_env_flag("VTKH_PROFILE_COUNTERS");
+  m_internals->m_has_regions = false;
+  SetRegions(detail::profile_env_regions());
+}
+
+Profiler::~Profiler()
+{
+}
+
+Profiler *
+Profiler::GetInstance()
+{
+  static Profiler instance;
+  return &instance;
+}
+
+Profiler::ThreadProfile *
+Profiler::GetThreadProfile()
+{
+  // the totals outlive the thread, the counters do not
+  struct Owner
+  {
+    std::shared_ptr<ThreadProfile> m_profile;
+    ~Owner()
+    {
+      if(m_profile != nullptr)
+      {
+        m_profile->m_perf.Close();
+      }
+    }
+  };
+  thread_local Owner owner;
+  if(owner.m_profile == nullptr)
+  {
+    owner.m_profile = std::make_shared<ThreadProfile>();
+    std::lock_guard<std::mutex> guard(m_internals->m_lock);
+    m_internals->m_threads.push_back(owner.m_profile);
+  }
+  return owner.m_profile.get();
+}
+
+void
+Profiler::SetEnabled(bool enabled)
+{
+  Enabled = enabled;
+}
+
+void
+Profiler::SetCountersEnabled(bool enabled)
+{
+  if(enabled)
+  {
+    // find out if the counters can be opened at all
+    detail::PerfCounters test;
+    if(!test.Open())
+    {
+      std::cerr<<"Warning: vtkh profiler could not open hardware counters. "
+               <<"Check /proc/sys/kernel/perf_event_paranoid\n";
+      enabled = false;
+    }
+  }
+  m_internals->m_counters = enabled;
+}
+
+bool
+Profiler::GetCountersEnabled() const
+{
+  return m_internals->m_counters;
+}
+
+void
+Profiler::SetRegions(const std::vector<std::string> &names)
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  m_internals->m_regions.clear();
+  m_internals->m_regions.insert(names.begin(), names.end());
+  m_internals->m_has_regions = !m_internals->m_regions.empty();
+}
+
+void
+Profiler::AddRegion(const std::string &name)
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  m_internals->m_regions.insert(name);
+  m_internals->m_has_regions = true;
+}
+
+void
+Profiler::ClearRegions()
+{
+  SetRegions(std::vector<std::string>());
+}
+
+void
+Profiler::Begin(const std::string &name)
+{
+  ThreadProfile *profile = GetThreadProfile();
+  const bool counters = m_internals->m_counters;
+  if(counters && !profile->m_perf_tried)
+  {
+    profile->m_perf_tried = true;
+    profile->m_perf.Open();
+  }
+
+  ThreadProfile::Frame frame;
+  if(profile->m_stack.empty())
+  {
+    frame.m_path = name;
+    frame.m_record = false;
+  }
+  else
+  {
+    frame.m_path = profile->m_stack.back().m_path + "/" + name;
+    frame.m_record = profile->m_stack.back().m_record;
+  }
+
+  if(!frame.m_record)
+  {
+    frame.m_record = !m_internals->m_has_regions || m_internals->IsListed(name);
+  }
+
+  if(frame.m_record && counters)
+  {
+    profile->m_perf.Read(frame.m_counters);
+  }
+  else
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      frame.m_counters[i] = -1;
+    }
+  }
+  profile->m_stack.push_back(frame);
+  // start the clock last so the bookkeeping is not part of the region
+  profile->m_stack.back().m_start = std::chrono::steady_clock::now();
+}
+
+void
+Profiler::End()
+{
+  const auto end = std::chrono::steady_clock::now();
+  ThreadProfile *profile = GetThreadProfile();
+  if(profile->m_stack.empty())
+  {
+    return;
+  }
+
+  ThreadProfile::Frame &frame = profile->m_stack.back();
+  if(frame.m_record)
+  {
+    long long counters[NUM_COUNTERS];
+    if(frame.m_counters[0] != -1 || frame.m_counters[1] != -1 || frame.m_counters[2] != -1)
+    {
+      profile->m_perf.Read(counters);
+    }
+    else
+    {
+      for(int i = 0; i < NUM_COUNTERS; ++i)
+      {
+        counters[i] = -1;
+      }
+    }
+
+    const double time = std::chrono::duration<double>(end - frame.m_start).count();
+    std::lock_guard<std::mutex> guard(profile->m_lock);
+    auto it = profile->m_totals.find(frame.m_path);
+    if(it == profile->m_totals.end())
+    {
+      ThreadProfile::Totals totals;
+      totals.m_calls = 0;
+      totals.m_time = 0.;
+      for(int i = 0; i < NUM_COUNTERS; ++i)
+      {
+        totals.m_counters[i] = -1;
+      }
+      it = profile->m_totals.insert(std::make_pair(frame.m_path, totals)).first;
+    }
+    ThreadProfile::Totals &totals = it->second;
+    totals.m_calls++;
+    totals.m_time += time;
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      if(frame.m_counters[i] != -1 && counters[i] != -1)
+      {
+        totals.m_counters[i] = std::max(totals.m_counters[i], 0LL) +
+                               (counters[i] - frame.m_counters[i]);
+      }
+    }
+  }
+  profile->m_stack.pop_back();
+}
+
+std::vector<Profiler::Region>
+Profiler::GetRegions() const
+{
+  std::map<std::string, Region> merged;
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  for(auto &profile : m_internals->m_threads)
+  {
+    std::lock_guard<std::mutex> thread_guard(profile->m_lock);
+    for(const auto &totals : profile->m_totals)
+    {
+      const std::string key = detail::path_key(totals.first);
+      auto it = merged.find(key);
+      if(it == merged.end())
+      {
+        Region region;
+        region.m_path = totals.first;
+        region.m_depth = static_cast<int>(std::count(totals.first.begin(),
+                                                     totals.first.end(),
+                                                     '/'));
+        region.m_calls = 0;
+        region.m_time = 0.;
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+        {
+          region.m_counters[i] = -1;
+        }
+        it = merged.insert(std::make_pair(key, region)).first;
+      }
+      Region &region = it->second;
+      region.m_calls += totals.second.m_calls;
+      region.m_time += totals.second.m_time;
+      for(int i = 0; i < NUM_COUNTERS; ++i)
+      {
+        if(totals.second.m_counters[i] != -1)
+        {
+          region.m_counters[i] = std::max(region.m_counters[i], 0LL) +
+                                 totals.second.m_counters[i];
+        }
+      }
+    }
+  }
+
+  std::vector<Region> res;
+  for(const auto &region : merged)
+  {
+    res.push_back(region.second);
+  }
+  return res;
+}
+
+double
+Profiler::Region::GetIPC() const
+{
+  if(m_counters[CYCLES] <= 0 || m_counters[INSTRUCTIONS] < 0)
+  {
+    return 0.;
+  }
+  return static_cast<double>(m_counters[INSTRUCTIONS]) /
+         static_cast<double>(m_counters[CYCLES]);
+}
+
+void
+Profiler::Write(std::ostream &os) const
+{
+  std::vector<Region> regions = GetRegions();
+  os<<std::setw(10)<<"calls"
+    <<std::setw(14)<<"time"
+    <<std::setw(16)<<"cycles"
+    <<std::setw(16)<<"instructions"
+    <<std::setw(8)<<"ipc"
+    <<std::setw(14)<<"llc_misses"
+    <<"  region\n";
+  for(const auto &region : regions)
+  {
+    const size_t slash = region.m_path.rfind('/');
+    const std::string name = slash == std::string::npos
+                             ? region.m_path
+                             : region.m_path.substr(slash + 1);
+    os<<std::setw(10)<<region.m_calls
+      <<std::setw(14)<<std::fixed<<std::setprecision(6)<<region.m_time
+      <<std::setw(16)<<region.m_counters[CYCLES]
+      <<std::setw(16)<<region.m_counters[INSTRUCTIONS]
+      <<std::setw(8)<<std::setprecision(2)<<region.GetIPC()
+      <<std::setw(14)<<region.m_counters[LLC_MISSES]
+      <<"  "<<std::string(2 * region.m_depth, ' ')<<name<<"\n";
+  }
+  os.unsetf(std::ios_base::floatfield);
+}
+
+void
+Profiler::Reset()
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  for(auto &profile : m_internals->m_threads)
+  {
+    std::lock_guard<std::mutex> thread_guard(profile->m_lock);
+    profile->m_totals.clear();
+  }
+}
+
+} // namespace vtkh
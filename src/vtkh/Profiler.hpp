@@ -0,0 +1,139 @@
+#ifndef VTK_H_PROFILER_HPP
+#define VTK_H_PROFILER_HPP
+
+#include <vtkh/vtkh_exports.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace vtkh
+{
+
+//
+// Nested regions timed by call path, e.g. "Contour/Composite", with the
+// hardware counters of the calling thread (Linux perf_event_open) when
+// they are turned on. Every thread keeps its own stack and totals, so
+// regions opened in worker threads start their own paths. Times and
+// counters include the child regions.
+//
+// Profiling is off unless VTKH_PROFILE=1 is set or SetEnabled(true) is
+// called. VTKH_PROFILE_COUNTERS=1 adds the counters, and
+// VTKH_PROFILE_REGIONS=Contour,Composite only profiles the listed
+// regions and the regions under them.
+//
+//   {
+//     VTKH_PROFILE_SCOPE(this->GetName());
+//     ...
+//   }
+//
+class VTKH_API Profiler
+{
+public:
+  enum Counter
+  {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    NUM_COUNTERS
+  };
+
+  struct Region
+  {
+    std::string m_path;   // names separated by '/'
+    int m_depth;          // 0 for the regions without a parent
+    long long m_calls;
+    double m_time;        // seconds
+    // -1 when the counter was not measured
+    long long m_counters[NUM_COUNTERS];
+
+    // instructions per cycle, 0 without counters
+    double GetIPC() const;
+  };
+
+  static Profiler *GetInstance();
+  ~Profiler();
+
+  static bool IsEnabled() { return Enabled; }
+  void SetEnabled(bool enabled);
+  // false if perf_event_open is not available or not permitted
+  // (see /proc/sys/kernel/perf_event_paranoid)
+  void SetCountersEnabled(bool enabled);
+  bool GetCountersEnabled() const;
+  // only profile these regions and everything they call. An empty
+  // list profiles all regions
+  void SetRegions(const std::vector<std::string> &names);
+  void AddRegion(const std::string &name);
+  void ClearRegions();
+
+  void Begin(const std::string &name);
+  void End();
+
+  // the totals of all threads merged by path, parents before children
+  std::vector<Region> GetRegions() const;
+  void Write(std::ostream &os) const;
+  void Reset();
+
+protected:
+  Profiler();
+  Profiler(Profiler const &);
+
+  struct ThreadProfile;
+  struct InternalsType;
+
+  ThreadProfile *GetThreadProfile();
+
+  static bool Enabled;
+  std::shared_ptr<InternalsType> m_internals;
+};
+
+// RAII guard for one region. It only records the end of the region if
+// it recorded the beginning, so toggling profiling inside of a region
+// keeps the stacks balanced
+class VTKH_API ProfileRegion
+{
+public:
+  ProfileRegion()
+    : m_active(false)
+  {  }
+
+  explicit ProfileRegion(const std::string &name)
+    : m_active(false)
+  {
+    if(Profiler::IsEnabled())
+    {
+      Begin(name);
+    }
+  }
+
+  ~ProfileRegion()
+  {
+    if(m_active)
+    {
+      Profiler::GetInstance()->End();
+    }
+  }
+
+  void Begin(const std::string &name)
+  {
+    Profiler::GetInstance()->Begin(name);
+    m_active = true;
+  }
+
+protected:
+  ProfileRegion(ProfileRegion const &);
+  bool m_active;
+};
+
+#define VTKH_PROFILE_CONCAT_IMPL(a, b) a##b
+#define VTKH_PROFILE_CONCAT(a, b) VTKH_PROFILE_CONCAT_IMPL(a, b)
+// the name is only evaluated when profiling is on
+#define VTKH_PROFILE_SCOPE(name) \
+  vtkh::ProfileRegion VTKH_PROFILE_CONCAT(vtkh_profile_region_, __LINE__); \
+  if(vtkh::Profiler::IsEnabled()) \
+    VTKH_PROFILE_CONCAT(vtkh_profile_region_, __LINE__).Begin(name);
+
+} // namespace vtkh
+
+#endif //VTK_H_PROFILER_HPP
@@ -211,6 +211,14 @@ public:
     float Stop(const std::string &nm) {vt(nm); return timers[nm].Stop();}
     float Time(const std::string &nm) {vt(nm); return timers[nm].GetTime();}
     void Reset(const std::string &nm) {vt(nm); timers[nm].Reset();}
+    //Accumulated time of every timer on this rank.
+    std::map<std::string,double> timerTimes() const
+    {
+        std::map<std::string,double> res;
+        for (auto it = timers.begin(); it != timers.end(); it++)
+            res[it->first] = it->second.GetTime();
+        return res;
+    }
 
     //Counters.
     void AddCounter(const std::string &nm)
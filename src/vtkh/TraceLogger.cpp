@@ -0,0 +1,592 @@
+#include <vtkh/TraceLogger.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+const char TRACE_MAGIC[8] = {'V','T','K','H','T','R','C','1'};
+
+bool trace_env_enabled()
+{
+  const char *trace = std::getenv("VTKH_TRACE");
+  return trace != nullptr && std::atoi(trace) != 0;
+}
+
+// small ids are easier to read in trace viewers than std::thread ids
+int trace_thread_index()
+{
+  static std::atomic<int> next_index(0);
+  thread_local int index = next_index++;
+  return index;
+}
+
+template<typename T>
+void write_value(std::ostream &os, const T &value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_value(std::istream &is, T &value)
+{
+  is.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return static_cast<bool>(is);
+}
+
+std::string json_string(const std::string &value)
+{
+  std::stringstream ss;
+  ss<<"\"";
+  for(size_t i = 0; i < value.size(); ++i)
+  {
+    const char c = value[i];
+    if(c == '"' || c == '\\')
+    {
+      ss<<"\\"<<c;
+    }
+    else if(static_cast<unsigned char>(c) < 0x20)
+    {
+      ss<<"\\u"<<std::hex<<std::setw(4)<<std::setfill('0')<<static_cast<int>(c)
+        <<std::dec<<std::setfill(' ');
+    }
+    else
+    {
+      ss<<c;
+    }
+  }
+  ss<<"\"";
+  return ss.str();
+}
+
+} // namespace detail
+
+bool TraceLogger::Enabled = detail::trace_env_enabled();
+
+struct TraceLogger::InternalsType
+{
+  std::mutex m_lock;
+  // wakes the writer
+  std::condition_variable m_writer_cv;
+  // signals that events were written and room was made
+  std::condition_variable m_written_cv;
+  std::thread m_writer;
+  bool m_started;
+  bool m_stop;
+  bool m_flush_requested;
+
+  // events [m_head, m_head + m_count) are waiting to be written
+  std::vector<Event> m_ring;
+  size_t m_head;
+  size_t m_count;
+  long long m_recorded;
+  long long m_written;
+
+  std::map<std::string, int> m_ids;
+  // strings interned since the last chunk
+  std::vector<std::pair<int, std::string>> m_new_strings;
+
+  int m_rank;
+  std::string m_prefix;
+  int m_flush_ms;
+  std::ofstream m_file;
+  std::chrono::steady_clock::time_point m_start;
+  long long m_start_epoch;
+
+  int Intern(const std::string &name)
+  {
+    auto it = m_ids.find(name);
+    if(it != m_ids.end())
+    {
+      return it->second;
+    }
+    const int id = static_cast<int>(m_ids.size());
+    m_ids[name] = id;
+    m_new_strings.push_back(std::make_pair(id, name));
+    return id;
+  }
+
+  void Start()
+  {
+    m_started = true;
+    std::stringstream name;
+    name<<m_prefix<<"_"<<std::setfill('0')<<std::setw(6)<<m_rank<<".trace";
+    m_file.open(name.str().c_str(), std::ofstream::out | std::ofstream::binary);
+    if(!m_file.is_open())
+    {
+      std::cerr<<"Warning: could not open the vtkh trace file "<<name.str()<<"\n";
+    }
+    m_file.write(detail::TRACE_MAGIC, sizeof(detail::TRACE_MAGIC));
+    detail::write_value(m_file, m_rank);
+    detail::write_value(m_file, static_cast<int>(sizeof(Event)));
+    detail::write_value(m_file, m_start_epoch);
+    m_file.flush();
+    m_writer = std::thread(&InternalsType::Write, this);
+  }
+
+  void Record(const int type, const std::string *name, const long long value)
+  {
+    const long long time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - m_start).count();
+    const int thread = detail::trace_thread_index();
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    if(!m_started)
+    {
+      Start();
+    }
+    if(m_count == m_ring.size())
+    {
+      m_writer_cv.notify_one();
+      m_written_cv.wait(lock, [this] { return m_count < m_ring.size(); });
+    }
+
+    Event &event = m_ring[(m_head + m_count) % m_ring.size()];
+    event.m_time = time;
+    event.m_value = value;
+    event.m_name = name != nullptr ? Intern(*name) : -1;
+    event.m_thread = thread;
+    event.m_type = type;
+    event.m_pad = 0;
+    m_count++;
+    m_recorded++;
+
+    if(m_count >= m_ring.size() / 2)
+    {
+      m_writer_cv.notify_one();
+    }
+  }
+
+  // writes everything recorded so far. Recording continues into the
+  // free part of the ring while the chunk is written
+  void WriteChunk(std::unique_lock<std::mutex> &lock)
+  {
+    m_flush_requested = false;
+    std::vector<std::pair<int, std::string>> strings;
+    strings.swap(m_new_strings);
+    const size_t head = m_head;
+    const size_t count = m_count;
+    const size_t size = m_ring.size();
+    lock.unlock();
+
+    if(count > 0 || !strings.empty())
+    {
+      detail::write_value(m_file, static_cast<int>(strings.size()));
+      for(size_t i = 0; i < strings.size(); ++i)
+      {
+        detail::write_value(m_file, strings[i].first);
+        detail::write_value(m_file, static_cast<int>(strings[i].second.size()));
+        m_file.write(strings[i].second.data(), strings[i].second.size());
+      }
+      detail::write_value(m_file, static_cast<int>(count));
+      if(count > 0)
+      {
+        const size_t first = std::min(count, size - head);
+        m_file.write(reinterpret_cast<const char*>(&m_ring[head]), first * sizeof(Event));
+        m_file.write(reinterpret_cast<const char*>(&m_ring[0]), (count - first) * sizeof(Event));
+      }
+      m_file.flush();
+    }
+
+    lock.lock();
+    if(count > 0)
+    {
+      m_head = (head + count) % size;
+      m_count -= count;
+      m_written += count;
+    }
+    m_written_cv.notify_all();
+  }
+
+  void Write()
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    while(true)
+    {
+      m_writer_cv.wait_for(lock, std::chrono::milliseconds(m_flush_ms), [this]
+      {
+        return m_stop || m_flush_requested || m_count >= m_ring.size() / 2;
+      });
+      const bool stop = m_stop;
+      WriteChunk(lock);
+      if(stop && m_count == 0)
+      {
+        return;
+      }
+    }
+  }
+
+  void Flush()
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    if(!m_started)
+    {
+      return;
+    }
+    const long long target = m_recorded;
+    m_flush_requested = true;
+    m_writer_cv.notify_one();
+    m_written_cv.wait(lock, [this, target] { return m_written >= target; });
+  }
+};
+
+TraceLogger::TraceLogger()
+  : m_internals(new InternalsType)
+{
+  m_internals->m_started = false;
+  m_internals->m_stop = false;
+  m_internals->m_flush_requested = false;
+  m_internals->m_ring.resize(1 << 16);
+  m_internals->m_head = 0;
+  m_internals->m_count = 0;
+  m_internals->m_recorded = 0;
+  m_internals->m_written = 0;
+  m_internals->m_rank = 0;
+  m_internals->m_prefix = "vtkh_trace";
+  if(const char *prefix = std::getenv("VTKH_TRACE_PREFIX"))
+  {
+    m_internals->m_prefix = std::string(prefix);
+  }
+  m_internals->m_flush_ms = 1000;
+  m_internals->m_start = std::chrono::steady_clock::now();
+  m_internals->m_start_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+TraceLogger::~TraceLogger()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_internals->m_lock);
+    m_internals->m_stop = true;
+  }
+  m_internals->m_writer_cv.notify_one();
+  // the writer drains the ring before it exits
+  if(m_internals->m_writer.joinable())
+  {
+    m_internals->m_writer.join();
+  }
+}
+
+TraceLogger *
+TraceLogger::GetInstance()
+{
+  static TraceLogger instance;
+  return &instance;
+}
+
+void
+TraceLogger::SetEnabled(bool enabled)
+{
+  Enabled = enabled;
+  if(!enabled)
+  {
+    Flush();
+  }
+}
+
+void
+TraceLogger::SetRank(int rank)
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  m_internals->m_rank = rank;
+}
+
+void
+TraceLogger::SetPrefix(const std::string &prefix)
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  m_internals->m_prefix = prefix;
+}
+
+void
+TraceLogger::SetBufferSize(int num_events)
+{
+  // the ring can only be resized while it is empty
+  Flush();
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  if(m_internals->m_count == 0)
+  {
+    m_internals->m_ring.resize(num_events < 2 ? 2 : num_events);
+    m_internals->m_head = 0;
+  }
+}
+
+void
+TraceLogger::SetFlushInterval(int milliseconds)
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  m_internals->m_flush_ms = milliseconds < 1 ? 1 : milliseconds;
+}
+
+void
+TraceLogger::Begin(const std::string &name)
+{
+  m_internals->Record(BEGIN, &name, 0);
+}
+
+void
+TraceLogger::End()
+{
+  m_internals->Record(END, nullptr, 0);
+}
+
+void
+TraceLogger::AddInt(const std::string &key, long long value)
+{
+  m_internals->Record(INT_VALUE, &key, value);
+}
+
+void
+TraceLogger::AddFloat(const std::string &key, double value)
+{
+  long long bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  m_internals->Record(FLOAT_VALUE, &key, bits);
+}
+
+void
+TraceLogger::AddValue(const std::string &key, const std::string &value)
+{
+  int id;
+  {
+    std::lock_guard<std::mutex> guard(m_internals->m_lock);
+    id = m_internals->Intern(value);
+  }
+  m_internals->Record(STRING_VALUE, &key, id);
+}
+
+void
+TraceLogger::AddValue(const std::string &key, const char *value)
+{
+  AddValue(key, std::string(value));
+}
+
+void
+TraceLogger::Flush()
+{
+  m_internals->Flush();
+}
+
+namespace detail
+{
+
+struct TraceFile
+{
+  int m_rank;
+  long long m_start_epoch;
+  std::map<int, std::string> m_strings;
+  std::vector<TraceLogger::Event> m_events;
+};
+
+bool read_trace(const std::string &file_name, TraceFile &trace)
+{
+  std::ifstream is(file_name.c_str(), std::ifstream::binary);
+  char magic[8];
+  is.read(magic, sizeof(magic));
+  int event_size;
+  if(!is || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 ||
+     !read_value(is, trace.m_rank) ||
+     !read_value(is, event_size) ||
+     !read_value(is, trace.m_start_epoch) ||
+     event_size != static_cast<int>(sizeof(TraceLogger::Event)))
+  {
+    return false;
+  }
+
+  // a job that was killed can leave a partial chunk at the end
+  int num_strings;
+  while(read_value(is, num_strings))
+  {
+    for(int i = 0; i < num_strings; ++i)
+    {
+      int id, length;
+      if(!read_value(is, id) || !read_value(is, length))
+      {
+        return true;
+      }
+      std::string value(length, ' ');
+      is.read(&value[0], length);
+      trace.m_strings[id] = value;
+    }
+    int num_events;
+    if(!read_value(is, num_events))
+    {
+      return true;
+    }
+    const size_t offset = trace.m_events.size();
+    trace.m_events.resize(offset + num_events);
+    is.read(reinterpret_cast<char*>(&trace.m_events[offset]),
+            num_events * sizeof(TraceLogger::Event));
+    if(!is)
+    {
+      trace.m_events.resize(offset + is.gcount() / sizeof(TraceLogger::Event));
+      return true;
+    }
+  }
+  return true;
+}
+
+} // namespace detail
+
+void
+TraceLogger::ConvertToChromeTrace(const std::vector<std::string> &trace_files,
+                                  const std::string &json_file)
+{
+  std::vector<detail::TraceFile> traces(trace_files.size());
+  long long min_epoch = std::numeric_limits<long long>::max();
+  for(size_t i = 0; i < trace_files.size(); ++i)
+  {
+    if(!detail::read_trace(trace_files[i], traces[i]))
+    {
+      std::cerr<<"Warning: "<<trace_files[i]<<" is not a vtkh trace file\n";
+      traces[i].m_events.clear();
+      continue;
+    }
+    min_epoch = std::min(min_epoch, traces[i].m_start_epoch);
+  }
+
+  std::ofstream os(json_file.c_str());
+  os<<"{\"traceEvents\":[\n";
+  bool first = true;
+  os<<std::fixed<<std::setprecision(3);
+
+  for(auto &trace : traces)
+  {
+    // key/value pairs become the arguments of the enclosing region
+    struct Open
+    {
+      int m_name;
+      std::vector<std::string> m_args;
+    };
+    std::map<int, std::vector<Open>> stacks;
+    const long long offset = trace.m_start_epoch - min_epoch;
+
+    auto name_of = [&trace](const int id) -> std::string
+    {
+      auto it = trace.m_strings.find(id);
+      return it != trace.m_strings.end() ? it->second : std::string("unknown");
+    };
+
+    auto emit = [&](const char *phase,
+                    const std::string &name,
+                    const long long time,
+                    const int thread,
+                    const std::vector<std::string> *args)
+    {
+      if(!first)
+      {
+        os<<",\n";
+      }
+      first = false;
+      os<<"{\"name\":"<<detail::json_string(name)
+        <<",\"ph\":\""<<phase<<"\""
+        <<",\"ts\":"<<static_cast<double>(offset + time) / 1000.
+        <<",\"pid\":"<<trace.m_rank
+        <<",\"tid\":"<<thread;
+      if(phase[0] == 'i')
+      {
+        os<<",\"s\":\"t\"";
+      }
+      if(args != nullptr && !args->empty())
+      {
+        os<<",\"args\":{";
+        for(size_t a = 0; a < args->size(); ++a)
+        {
+          os<<(a == 0 ? "" : ",")<<(*args)[a];
+        }
+        os<<"}";
+      }
+      os<<"}";
+    };
+
+    long long last_time = 0;
+    for(const auto &event : trace.m_events)
+    {
+      last_time = std::max(last_time, event.m_time);
+      std::vector<Open> &stack = stacks[event.m_thread];
+      if(event.m_type == BEGIN)
+      {
+        Open open;
+        open.m_name = event.m_name;
+        stack.push_back(open);
+        emit("B", name_of(event.m_name), event.m_time, event.m_thread, nullptr);
+        continue;
+      }
+      if(event.m_type == END)
+      {
+        if(!stack.empty())
+        {
+          emit("E", name_of(stack.back().m_name), event.m_time, event.m_thread,
+               &stack.back().m_args);
+          stack.pop_back();
+        }
+        continue;
+      }
+
+      std::stringstream arg;
+      arg<<std::setprecision(17)<<detail::json_string(name_of(event.m_name))<<":";
+      if(event.m_type == INT_VALUE)
+      {
+        arg<<event.m_value;
+      }
+      else if(event.m_type == FLOAT_VALUE)
+      {
+        double value;
+        std::memcpy(&value, &event.m_value, sizeof(value));
+        if(value == value && value - value == 0.)
+        {
+          arg<<value;
+        }
+        else
+        {
+          // json has no nan or inf
+          arg<<"null";
+        }
+      }
+      else
+      {
+        arg<<detail::json_string(name_of(static_cast<int>(event.m_value)));
+      }
+
+      if(!stack.empty())
+      {
+        stack.back().m_args.push_back(arg.str());
+      }
+      else
+      {
+        std::vector<std::string> args(1, arg.str());
+        emit("i", name_of(event.m_name), event.m_time, event.m_thread, &args);
+      }
+    }
+
+    // regions left open by a job that was killed end with the last event
+    for(auto &stack : stacks)
+    {
+      while(!stack.second.empty())
+      {
+        emit("E", name_of(stack.second.back().m_name), last_time, stack.first,
+             &stack.second.back().m_args);
+        stack.second.pop_back();
+      }
+    }
+  }
+
+  os<<"\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+} // namespace vtkh
@@ -0,0 +1,127 @@
+#ifndef VTK_H_TRACE_LOGGER_HPP
+#define VTK_H_TRACE_LOGGER_HPP
+
+#include <vtkh/vtkh_exports.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vtkh
+{
+
+//
+// Streaming binary trace of the VTKH_DATA_OPEN / CLOSE / ADD entries.
+// Events are fixed size records kept in a bounded ring buffer that a
+// background thread appends to <prefix>_<rank>.trace, so memory does
+// not grow with the length of the run and a killed job keeps everything
+// up to the last flush. When the ring is full, recording waits for the
+// writer instead of dropping events.
+//
+// Tracing is off unless VTKH_TRACE=1 is set in the environment or
+// SetEnabled(true) is called. The prefix defaults to "vtkh_trace" and
+// can be set with VTKH_TRACE_PREFIX. ConvertToChromeTrace turns the
+// files of all ranks into one Chrome trace / Perfetto json file.
+//
+// File layout:
+//   char  magic[8]  "VTKHTRC1"
+//   int32 rank
+//   int32 event size in bytes
+//   int64 wall clock time of the first event in ns since the epoch
+//   chunks until the end of the file:
+//     int32 num_strings, then per string: int32 id, int32 length, chars
+//     int32 num_events,  then the events
+//
+class VTKH_API TraceLogger
+{
+public:
+  enum EventType
+  {
+    BEGIN,
+    END,
+    INT_VALUE,
+    FLOAT_VALUE,
+    STRING_VALUE
+  };
+
+  struct Event
+  {
+    long long m_time;   // ns since the first event
+    long long m_value;  // integer, bits of a double or a string id
+    int m_name;         // string id of the entry or key
+    int m_thread;       // small per process thread index
+    int m_type;         // EventType
+    int m_pad;
+  };
+
+  static TraceLogger *GetInstance();
+  ~TraceLogger();
+
+  static bool IsEnabled() { return Enabled; }
+  // turning tracing off flushes the events recorded so far
+  void SetEnabled(bool enabled);
+  // the rank is part of the file name, so it needs to be set
+  // before the first event is recorded
+  void SetRank(int rank);
+  void SetPrefix(const std::string &prefix);
+  // events kept in memory. Default 64k (2 MB)
+  void SetBufferSize(int num_events);
+  // the writer thread flushes at least this often. Default 1000 ms
+  void SetFlushInterval(int milliseconds);
+
+  void Begin(const std::string &name);
+  void End();
+
+  template<typename T>
+  void AddValue(const std::string &key, const T &value)
+  {
+    AddValue(key, value, std::is_arithmetic<T>());
+  }
+
+  void AddValue(const std::string &key, const std::string &value);
+  void AddValue(const std::string &key, const char *value);
+
+  // blocks until all events recorded so far are written
+  void Flush();
+
+  // merges the trace files of all ranks into one json file
+  static void ConvertToChromeTrace(const std::vector<std::string> &trace_files,
+                                   const std::string &json_file);
+protected:
+  TraceLogger();
+  TraceLogger(TraceLogger const &);
+
+  template<typename T>
+  void AddValue(const std::string &key, const T &value, std::true_type)
+  {
+    if(std::is_floating_point<T>::value)
+    {
+      AddFloat(key, static_cast<double>(value));
+    }
+    else
+    {
+      AddInt(key, static_cast<long long>(value));
+    }
+  }
+
+  template<typename T>
+  void AddValue(const std::string &key, const T &value, std::false_type)
+  {
+    std::stringstream ss;
+    ss<<value;
+    AddValue(key, ss.str());
+  }
+
+  void AddInt(const std::string &key, long long value);
+  void AddFloat(const std::string &key, double value);
+
+  static bool Enabled;
+  struct InternalsType;
+  std::shared_ptr<InternalsType> m_internals;
+};
+
+} // namespace vtkh
+
+#endif //VTK_H_TRACE_LOGGER_HPP
@@ -0,0 +1,517 @@
+#include <vtkh/compositing/CompositingKernels.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define VTKH_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+typedef void (*TwoImageKernel)(unsigned char *, float *,
+                               const unsigned char *, const float *,
+                               const int, const int);
+
+typedef void (*BackgroundKernel)(unsigned char *, const unsigned char *,
+                                 const int, const int);
+
+// pixels per task. Small enough to balance, large enough that
+// the threading overhead does not show up
+const int g_chunk_size = 16384;
+
+//---------------------------------------------------------------------------//
+// scalar reference kernels
+//---------------------------------------------------------------------------//
+void zbuffer_scalar(unsigned char *front_pixels,
+                    float *front_depths,
+                    const unsigned char *back_pixels,
+                    const float *back_depths,
+                    const int begin,
+                    const int end)
+{
+  for(int i = begin; i < end; ++i)
+  {
+    const float depth = back_depths[i];
+    if(depth > 1.f  || front_depths[i] < depth)
+    {
+      continue;
+    }
+    const int offset = i * 4;
+    front_depths[i] = depth;
+    front_pixels[offset + 0] = back_pixels[offset + 0];
+    front_pixels[offset + 1] = back_pixels[offset + 1];
+    front_pixels[offset + 2] = back_pixels[offset + 2];
+    front_pixels[offset + 3] = back_pixels[offset + 3];
+  }
+}
+
+void blend_scalar(unsigned char *front_pixels,
+                  float *front_depths,
+                  const unsigned char *back_pixels,
+                  const float *back_depths,
+                  const int begin,
+                  const int end)
+{
+  for(int i = begin; i < end; ++i)
+  {
+    const int offset = i * 4;
+    unsigned int alpha = front_pixels[offset + 3];
+    const unsigned int opacity = 255 - alpha;
+
+    front_pixels[offset + 0] +=
+      static_cast<unsigned char>(opacity * back_pixels[offset + 0] / 255);
+    front_pixels[offset + 1] +=
+      static_cast<unsigned char>(opacity * back_pixels[offset + 1] / 255);
+    front_pixels[offset + 2] +=
+      static_cast<unsigned char>(opacity * back_pixels[offset + 2] / 255);
+    front_pixels[offset + 3] +=
+      static_cast<unsigned char>(opacity * back_pixels[offset + 3] / 255);
+
+    float d1 = std::min(front_depths[i], 1.001f);
+    float d2 = std::min(back_depths[i], 1.001f);
+    float depth = std::min(d1,d2);
+    front_depths[i] = depth;
+  }
+}
+
+void background_scalar(unsigned char *pixels,
+                       const unsigned char *color,
+                       const int begin,
+                       const int end)
+{
+  for(int i = begin; i < end; ++i)
+  {
+    const int offset = i * 4;
+    const unsigned int opacity = 255 - static_cast<unsigned int>(pixels[offset + 3]);
+    pixels[offset + 0] += static_cast<unsigned char>(opacity * color[0] / 255);
+    pixels[offset + 1] += static_cast<unsigned char>(opacity * color[1] / 255);
+    pixels[offset + 2] += static_cast<unsigned char>(opacity * color[2] / 255);
+    pixels[offset + 3] += static_cast<unsigned char>(opacity * color[3] / 255);
+  }
+}
+
+#ifdef VTKH_X86_SIMD
+//---------------------------------------------------------------------------//
+// The blend kernels widen RGBA8 to 16 bit lanes and use the exact
+// identity x / 255 == (x + 1 + (x >> 8)) >> 8 for 0 <= x <= 255 * 255.
+// The sum is masked back to 8 bits so overflow wraps like the scalar code.
+//---------------------------------------------------------------------------//
+
+//---------------------------------------------------------------------------//
+// sse4.1
+//---------------------------------------------------------------------------//
+__attribute__((target("sse4.1")))
+static inline __m128i under_sse(const __m128i front, const __m128i back)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i max_alpha = _mm_set1_epi16(255);
+  const __m128i low_byte = _mm_set1_epi16(0x00FF);
+
+  __m128i f_lo = _mm_unpacklo_epi8(front, zero);
+  __m128i f_hi = _mm_unpackhi_epi8(front, zero);
+  __m128i b_lo = _mm_unpacklo_epi8(back, zero);
+  __m128i b_hi = _mm_unpackhi_epi8(back, zero);
+
+  // broadcast the alpha of each pixel to its four channels
+  __m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(f_lo, _MM_SHUFFLE(3,3,3,3)),
+                                     _MM_SHUFFLE(3,3,3,3));
+  __m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(f_hi, _MM_SHUFFLE(3,3,3,3)),
+                                     _MM_SHUFFLE(3,3,3,3));
+
+  __m128i x_lo = _mm_mullo_epi16(_mm_sub_epi16(max_alpha, a_lo), b_lo);
+  __m128i x_hi = _mm_mullo_epi16(_mm_sub_epi16(max_alpha, a_hi), b_hi);
+  x_lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x_lo, ones), _mm_srli_epi16(x_lo, 8)), 8);
+  x_hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x_hi, ones), _mm_srli_epi16(x_hi, 8)), 8);
+
+  __m128i r_lo = _mm_and_si128(_mm_add_epi16(f_lo, x_lo), low_byte);
+  __m128i r_hi = _mm_and_si128(_mm_add_epi16(f_hi, x_hi), low_byte);
+  return _mm_packus_epi16(r_lo, r_hi);
+}
+
+__attribute__((target("sse4.1")))
+void zbuffer_sse(unsigned char *front_pixels,
+                 float *front_depths,
+                 const unsigned char *back_pixels,
+                 const float *back_depths,
+                 const int begin,
+                 const int end)
+{
+  const __m128 one = _mm_set1_ps(1.f);
+  int i = begin;
+  for(; i + 4 <= end; i += 4)
+  {
+    __m128 back_depth = _mm_loadu_ps(back_depths + i);
+    __m128 front_depth = _mm_loadu_ps(front_depths + i);
+    // !(back > 1) && !(front < back)
+    __m128 take = _mm_and_ps(_mm_cmpngt_ps(back_depth, one),
+                             _mm_cmpnlt_ps(front_depth, back_depth));
+    _mm_storeu_ps(front_depths + i, _mm_blendv_ps(front_depth, back_depth, take));
+
+    __m128 front_color = _mm_castsi128_ps(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(front_pixels + i * 4)));
+    __m128 back_color = _mm_castsi128_ps(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(back_pixels + i * 4)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(front_pixels + i * 4),
+                     _mm_castps_si128(_mm_blendv_ps(front_color, back_color, take)));
+  }
+  zbuffer_scalar(front_pixels, front_depths, back_pixels, back_depths, i, end);
+}
+
+__attribute__((target("sse4.1")))
+void blend_sse(unsigned char *front_pixels,
+               float *front_depths,
+               const unsigned char *back_pixels,
+               const float *back_depths,
+               const int begin,
+               const int end)
+{
+  const __m128 max_depth = _mm_set1_ps(1.001f);
+  int i = begin;
+  for(; i + 4 <= end; i += 4)
+  {
+    __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i*>(front_pixels + i * 4));
+    __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i*>(back_pixels + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(front_pixels + i * 4), under_sse(front, back));
+
+    __m128 d1 = _mm_min_ps(_mm_loadu_ps(front_depths + i), max_depth);
+    __m128 d2 = _mm_min_ps(_mm_loadu_ps(back_depths + i), max_depth);
+    _mm_storeu_ps(front_depths + i, _mm_min_ps(d1, d2));
+  }
+  blend_scalar(front_pixels, front_depths, back_pixels, back_depths, i, end);
+}
+
+__attribute__((target("sse4.1")))
+void background_sse(unsigned char *pixels,
+                    const unsigned char *color,
+                    const int begin,
+                    const int end)
+{
+  int packed_color;
+  std::memcpy(&packed_color, color, 4);
+  const __m128i back = _mm_set1_epi32(packed_color);
+  int i = begin;
+  for(; i + 4 <= end; i += 4)
+  {
+    __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i * 4), under_sse(front, back));
+  }
+  background_scalar(pixels, color, i, end);
+}
+
+//---------------------------------------------------------------------------//
+// avx2. The byte unpack / pack instructions work within 128 bit lanes,
+// which keeps pixels in place since both directions use the same lanes
+//---------------------------------------------------------------------------//
+__attribute__((target("avx2")))
+static inline __m256i under_avx2(const __m256i front, const __m256i back)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i max_alpha = _mm256_set1_epi16(255);
+  const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+
+  __m256i f_lo = _mm256_unpacklo_epi8(front, zero);
+  __m256i f_hi = _mm256_unpackhi_epi8(front, zero);
+  __m256i b_lo = _mm256_unpacklo_epi8(back, zero);
+  __m256i b_hi = _mm256_unpackhi_epi8(back, zero);
+
+  __m256i a_lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(f_lo, _MM_SHUFFLE(3,3,3,3)),
+                                        _MM_SHUFFLE(3,3,3,3));
+  __m256i a_hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(f_hi, _MM_SHUFFLE(3,3,3,3)),
+                                        _MM_SHUFFLE(3,3,3,3));
+
+  __m256i x_lo = _mm256_mullo_epi16(_mm256_sub_epi16(max_alpha, a_lo), b_lo);
+  __m256i x_hi = _mm256_mullo_epi16(_mm256_sub_epi16(max_alpha, a_hi), b_hi);
+  x_lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x_lo, ones),
+                                            _mm256_srli_epi16(x_lo, 8)), 8);
+  x_hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x_hi, ones),
+                                            _mm256_srli_epi16(x_hi, 8)), 8);
+
+  __m256i r_lo = _mm256_and_si256(_mm256_add_epi16(f_lo, x_lo), low_byte);
+  __m256i r_hi = _mm256_and_si256(_mm256_add_epi16(f_hi, x_hi), low_byte);
+  return _mm256_packus_epi16(r_lo, r_hi);
+}
+
+__attribute__((target("avx2")))
+void zbuffer_avx2(unsigned char *front_pixels,
+                  float *front_depths,
+                  const unsigned char *back_pixels,
+                  const float *back_depths,
+                  const int begin,
+                  const int end)
+{
+  const __m256 one = _mm256_set1_ps(1.f);
+  int i = begin;
+  for(; i + 8 <= end; i += 8)
+  {
+    __m256 back_depth = _mm256_loadu_ps(back_depths + i);
+    __m256 front_depth = _mm256_loadu_ps(front_depths + i);
+    __m256 take = _mm256_and_ps(_mm256_cmp_ps(back_depth, one, _CMP_NGT_UQ),
+                                _mm256_cmp_ps(front_depth, back_depth, _CMP_NLT_UQ));
+    _mm256_storeu_ps(front_depths + i, _mm256_blendv_ps(front_depth, back_depth, take));
+
+    __m256 front_color = _mm256_castsi256_ps(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(front_pixels + i * 4)));
+    __m256 back_color = _mm256_castsi256_ps(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(back_pixels + i * 4)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(front_pixels + i * 4),
+                        _mm256_castps_si256(_mm256_blendv_ps(front_color, back_color, take)));
+  }
+  zbuffer_scalar(front_pixels, front_depths, back_pixels, back_depths, i, end);
+}
+
+__attribute__((target("avx2")))
+void blend_avx2(unsigned char *front_pixels,
+                float *front_depths,
+                const unsigned char *back_pixels,
+                const float *back_depths,
+                const int begin,
+                const int end)
+{
+  const __m256 max_depth = _mm256_set1_ps(1.001f);
+  int i = begin;
+  for(; i + 8 <= end; i += 8)
+  {
+    __m256i front = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(front_pixels + i * 4));
+    __m256i back = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(back_pixels + i * 4));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(front_pixels + i * 4),
+                        under_avx2(front, back));
+
+    __m256 d1 = _mm256_min_ps(_mm256_loadu_ps(front_depths + i), max_depth);
+    __m256 d2 = _mm256_min_ps(_mm256_loadu_ps(back_depths + i), max_depth);
+    _mm256_storeu_ps(front_depths + i, _mm256_min_ps(d1, d2));
+  }
+  blend_scalar(front_pixels, front_depths, back_pixels, back_depths, i, end);
+}
+
+__attribute__((target("avx2")))
+void background_avx2(unsigned char *pixels,
+                     const unsigned char *color,
+                     const int begin,
+                     const int end)
+{
+  int packed_color;
+  std::memcpy(&packed_color, color, 4);
+  const __m256i back = _mm256_set1_epi32(packed_color);
+  int i = begin;
+  for(; i + 8 <= end; i += 8)
+  {
+    __m256i front = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i * 4));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i * 4), under_avx2(front, back));
+  }
+  background_scalar(pixels, color, i, end);
+}
+
+//---------------------------------------------------------------------------//
+// avx512. Only the z-buffer benefits from the mask registers, the
+// blend kernels are bound by the same 16 bit arithmetic as avx2
+//---------------------------------------------------------------------------//
+__attribute__((target("avx512f,avx512bw")))
+void zbuffer_avx512(unsigned char *front_pixels,
+                    float *front_depths,
+                    const unsigned char *back_pixels,
+                    const float *back_depths,
+                    const int begin,
+                    const int end)
+{
+  const __m512 one = _mm512_set1_ps(1.f);
+  int i = begin;
+  for(; i + 16 <= end; i += 16)
+  {
+    __m512 back_depth = _mm512_loadu_ps(back_depths + i);
+    __m512 front_depth = _mm512_loadu_ps(front_depths + i);
+    __mmask16 take = _mm512_cmp_ps_mask(back_depth, one, _CMP_NGT_UQ) &
+                     _mm512_cmp_ps_mask(front_depth, back_depth, _CMP_NLT_UQ);
+    _mm512_mask_storeu_ps(front_depths + i, take, back_depth);
+    __m512i back_color = _mm512_loadu_si512(back_pixels + i * 4);
+    _mm512_mask_storeu_epi32(front_pixels + i * 4, take, back_color);
+  }
+  zbuffer_scalar(front_pixels, front_depths, back_pixels, back_depths, i, end);
+}
+#endif
+
+//---------------------------------------------------------------------------//
+// dispatch
+//---------------------------------------------------------------------------//
+CompositingKernels::InstructionSet DetectInstructionSet()
+{
+  CompositingKernels::InstructionSet res = CompositingKernels::SCALAR;
+#ifdef VTKH_X86_SIMD
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("sse4.1"))
+  {
+    res = CompositingKernels::SSE;
+  }
+  if(__builtin_cpu_supports("avx2"))
+  {
+    res = CompositingKernels::AVX2;
+  }
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+  {
+    res = CompositingKernels::AVX512;
+  }
+#endif
+  return res;
+}
+
+CompositingKernels::InstructionSet InitialInstructionSet()
+{
+  CompositingKernels::InstructionSet res = DetectInstructionSet();
+  if(const char *simd = std::getenv("VTKH_SIMD"))
+  {
+    std::string request(simd);
+    CompositingKernels::InstructionSet cap = res;
+    if(request == "scalar") cap = CompositingKernels::SCALAR;
+    else if(request == "sse") cap = CompositingKernels::SSE;
+    else if(request == "avx2") cap = CompositingKernels::AVX2;
+    else if(request == "avx512") cap = CompositingKernels::AVX512;
+    res = std::min(res, cap);
+  }
+  return res;
+}
+
+CompositingKernels::InstructionSet& ActiveInstructionSet()
+{
+  static CompositingKernels::InstructionSet instruction_set = InitialInstructionSet();
+  return instruction_set;
+}
+
+TwoImageKernel GetZBufferKernel()
+{
+  TwoImageKernel kernel = zbuffer_scalar;
+#ifdef VTKH_X86_SIMD
+  switch(ActiveInstructionSet())
+  {
+    case CompositingKernels::AVX512: kernel = zbuffer_avx512; break;
+    case CompositingKernels::AVX2:   kernel = zbuffer_avx2; break;
+    case CompositingKernels::SSE:    kernel = zbuffer_sse; break;
+    default: break;
+  }
+#endif
+  return kernel;
+}
+
+TwoImageKernel GetBlendKernel()
+{
+  TwoImageKernel kernel = blend_scalar;
+#ifdef VTKH_X86_SIMD
+  switch(ActiveInstructionSet())
+  {
+    case CompositingKernels::AVX512:
+    case CompositingKernels::AVX2:   kernel = blend_avx2; break;
+    case CompositingKernels::SSE:    kernel = blend_sse; break;
+    default: break;
+  }
+#endif
+  return kernel;
+}
+
+BackgroundKernel GetBackgroundKernel()
+{
+  BackgroundKernel kernel = background_scalar;
+#ifdef VTKH_X86_SIMD
+  switch(ActiveInstructionSet())
+  {
+    case CompositingKernels::AVX512:
+    case CompositingKernels::AVX2:   kernel = background_avx2; break;
+    case CompositingKernels::SSE:    kernel = background_sse; break;
+    default: break;
+  }
+#endif
+  return kernel;
+}
+
+template<typename Functor>
+void ForEachChunk(const int num_pixels, const Functor &functor)
+{
+  const int num_chunks = (num_pixels + g_chunk_size - 1) / g_chunk_size;
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for(int c = 0; c < num_chunks; ++c)
+  {
+    const int begin = c * g_chunk_size;
+    const int end = std::min(num_pixels, begin + g_chunk_size);
+    functor(begin, end);
+  }
+}
+
+} // namespace detail
+
+CompositingKernels::InstructionSet
+CompositingKernels::GetSupportedInstructionSet()
+{
+  return detail::DetectInstructionSet();
+}
+
+CompositingKernels::InstructionSet
+CompositingKernels::GetInstructionSet()
+{
+  return detail::ActiveInstructionSet();
+}
+
+void
+CompositingKernels::SetInstructionSet(InstructionSet instruction_set)
+{
+  detail::ActiveInstructionSet() = std::min(instruction_set, GetSupportedInstructionSet());
+}
+
+std::string
+CompositingKernels::GetInstructionSetName(InstructionSet instruction_set)
+{
+  std::string name = "scalar";
+  if(instruction_set == SSE) name = "sse";
+  else if(instruction_set == AVX2) name = "avx2";
+  else if(instruction_set == AVX512) name = "avx512";
+  return name;
+}
+
+void
+CompositingKernels::ZBuffer(unsigned char *front_pixels,
+                            float *front_depths,
+                            const unsigned char *back_pixels,
+                            const float *back_depths,
+                            const int num_pixels)
+{
+  detail::TwoImageKernel kernel = detail::GetZBufferKernel();
+  detail::ForEachChunk(num_pixels, [&](const int begin, const int end)
+  {
+    kernel(front_pixels, front_depths, back_pixels, back_depths, begin, end);
+  });
+}
+
+void
+CompositingKernels::Blend(unsigned char *front_pixels,
+                          float *front_depths,
+                          const unsigned char *back_pixels,
+                          const float *back_depths,
+                          const int num_pixels)
+{
+  detail::TwoImageKernel kernel = detail::GetBlendKernel();
+  detail::ForEachChunk(num_pixels, [&](const int begin, const int end)
+  {
+    kernel(front_pixels, front_depths, back_pixels, back_depths, begin, end);
+  });
+}
+
+void
+CompositingKernels::Background(unsigned char *pixels,
+                               const unsigned char color[4],
+                               const int num_pixels)
+{
+  detail::BackgroundKernel kernel = detail::GetBackgroundKernel();
+  detail::ForEachChunk(num_pixels, [&](const int begin, const int end)
+  {
+    kernel(pixels, color, begin, end);
+  });
+}
+
+} // namespace vtkh
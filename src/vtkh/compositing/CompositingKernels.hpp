@@ -0,0 +1,61 @@
+#ifndef VTKH_COMPOSITING_KERNELS_HPP
+#define VTKH_COMPOSITING_KERNELS_HPP
+
+#include <string>
+#include <vtkh/vtkh_exports.h>
+
+namespace vtkh
+{
+
+//
+// Pixel kernels shared by the image compositors. Pixels are RGBA8
+// (4 bytes per pixel) with a separate float depth per pixel.
+//
+// Each kernel is multi-threaded (when built with OpenMP) and runs the
+// widest SIMD implementation supported by the cpu. The instruction set
+// is detected the first time a kernel is called and can be capped with
+// SetInstructionSet or the VTKH_SIMD environment variable
+// (scalar, sse, avx2, avx512).
+//
+class VTKH_API CompositingKernels
+{
+public:
+  enum InstructionSet
+  {
+    SCALAR = 0,
+    SSE    = 1, // sse4.1
+    AVX2   = 2,
+    AVX512 = 3  // avx512f + avx512bw
+  };
+
+  // the widest instruction set the cpu supports
+  static InstructionSet GetSupportedInstructionSet();
+  // the instruction set used by the kernels
+  static InstructionSet GetInstructionSet();
+  // requests larger than what the cpu supports are clamped
+  static void SetInstructionSet(InstructionSet instruction_set);
+  static std::string GetInstructionSetName(InstructionSet instruction_set);
+
+  // keep the nearest fragment. Back fragments with depth > 1 are
+  // background and are ignored
+  static void ZBuffer(unsigned char *front_pixels,
+                      float *front_depths,
+                      const unsigned char *back_pixels,
+                      const float *back_depths,
+                      const int num_pixels);
+
+  // front to back blending of pre-multiplied colors
+  static void Blend(unsigned char *front_pixels,
+                    float *front_depths,
+                    const unsigned char *back_pixels,
+                    const float *back_depths,
+                    const int num_pixels);
+
+  // blend a constant color under every pixel
+  static void Background(unsigned char *pixels,
+                         const unsigned char color[4],
+                         const int num_pixels);
+};
+
+} // namespace vtkh
+#endif
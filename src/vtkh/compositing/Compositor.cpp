@@ -1,5 +1,6 @@
 #include "Compositor.hpp"
 #include <vtkh/compositing/ImageCompositor.hpp>
+#include <vtkh/Profiler.hpp>
 
 #include <assert.h>
 #include <algorithm>
@@ -164,6 +165,7 @@ Compositor::AddImage(const float *color_buffer,
 Image
 Compositor::Composite()
 {
+  VTKH_PROFILE_SCOPE("Compositor::Composite");
   assert(m_images.size() != 0);
 
   if(m_composite_mode == Z_BUFFER_SURFACE)
@@ -182,6 +184,24 @@ Compositor::Composite()
   return m_images[0];
 }
 
+void
+Compositor::CompositeBatch(std::vector<Image> &images)
+{
+  VTKH_PROFILE_SCOPE("Compositor::CompositeBatch");
+  assert(m_composite_mode == Z_BUFFER_SURFACE);
+  // nothing to do here in serial
+#ifdef VTKH_PARALLEL
+  vtkhdiy::mpi::communicator diy_comm;
+  diy_comm = vtkhdiy::mpi::communicator(MPI_Comm_f2c(GetMPICommHandle()));
+
+  RadixKCompositor compositor;
+  compositor.CompositeSurface(diy_comm, images);
+  m_log_stream<<compositor.GetTimingString();
+#else
+  (void) images;
+#endif
+}
+
 void
 Compositor::Cleanup()
 {
@@ -48,6 +48,12 @@ public:
 
     Image Composite();
 
+    // Z-buffer composites a batch of independent images (e.g., one per
+    // camera). All images share the same communication rounds, so the
+    // latency of each round is paid once per batch instead of once per
+    // image. Images are composited in place and are complete on rank 0.
+    void CompositeBatch(std::vector<Image> &images);
+
     virtual void         Cleanup();
 
     std::string          GetLogString();
@@ -6,6 +6,7 @@
 #include <vtkm/Bounds.h>
 
 #include <vtkh/vtkh_exports.h>
+#include <vtkh/compositing/CompositingKernels.hpp>
 
 namespace vtkh
 {
@@ -128,7 +129,7 @@ struct VTKH_API Image
                 color_buffer + size * 4,
                 &m_pixels[0]);
 
-#ifdef vtkh_USE_OPENMP
+#ifdef VTKH_USE_OPENMP
       #pragma omp parallel for
 #endif
       for(int i = 0; i < size; ++i)
@@ -151,19 +152,7 @@ struct VTKH_API Image
         bg_color[i] = static_cast<unsigned char>(color[i] * 255.f);
       }
 
-#ifdef VTKH_USE_OPENMP
-      #pragma omp parallel for
-#endif
-      for(int i = 0; i < size; ++i)
-      {
-        const int offset = i * 4;
-        unsigned int alpha = static_cast<unsigned int>(m_pixels[offset + 3]);
-        const float opacity = (255 - alpha);
-        m_pixels[offset + 0] += static_cast<unsigned char>(opacity * bg_color[0] / 255);
-        m_pixels[offset + 1] += static_cast<unsigned char>(opacity * bg_color[1] / 255);
-        m_pixels[offset + 2] += static_cast<unsigned char>(opacity * bg_color[2] / 255);
-        m_pixels[offset + 3] += static_cast<unsigned char>(opacity * bg_color[3] / 255);
-      }
+      CompositingKernels::Background(m_pixels.data(), bg_color, size);
     }
     //
     // Fill this image with a sub-region of another image
@@ -2,6 +2,7 @@
 #define VTKH_DIY_IMAGE_COMPOSITOR_HPP
 
 #include <vtkh/compositing/Image.hpp>
+#include <vtkh/compositing/CompositingKernels.hpp>
 #include <algorithm>
 
 #include<vtkh/vtkh_exports.h>
@@ -20,30 +21,11 @@ public:
     assert(front.m_bounds.X.Max == back.m_bounds.X.Max);
     assert(front.m_bounds.Y.Max == back.m_bounds.Y.Max);
     const int size = static_cast<int>(front.m_pixels.size() / 4);
-
-#ifdef VTKH_USE_OPENMP
-    #pragma omp parallel for
-#endif
-    for(int i = 0; i < size; ++i)
-    {
-      const int offset = i * 4;
-      unsigned int alpha = front.m_pixels[offset + 3];
-      const unsigned int opacity = 255 - alpha;
-
-      front.m_pixels[offset + 0] +=
-        static_cast<unsigned char>(opacity * back.m_pixels[offset + 0] / 255);
-      front.m_pixels[offset + 1] +=
-        static_cast<unsigned char>(opacity * back.m_pixels[offset + 1] / 255);
-      front.m_pixels[offset + 2] +=
-        static_cast<unsigned char>(opacity * back.m_pixels[offset + 2] / 255);
-      front.m_pixels[offset + 3] +=
-        static_cast<unsigned char>(opacity * back.m_pixels[offset + 3] / 255);
-
-      float d1 = std::min(front.m_depths[i], 1.001f);
-      float d2 = std::min(back.m_depths[i], 1.001f);
-      float depth = std::min(d1,d2);
-      front.m_depths[i] = depth;
-    }
+    CompositingKernels::Blend(front.m_pixels.data(),
+                              front.m_depths.data(),
+                              back.m_pixels.data(),
+                              back.m_depths.data(),
+                              size);
   }
 
 void ZBufferComposite(vtkh::Image &front, const vtkh::Image &image)
@@ -55,24 +37,11 @@ void ZBufferComposite(vtkh::Image &front, const vtkh::Image &image)
   assert(front.m_bounds.Y.Max == image.m_bounds.Y.Max);
 
   const int size = static_cast<int>(front.m_depths.size());
-
-#ifdef vtkh_USE_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < size; ++i)
-  {
-    const float depth = image.m_depths[i];
-    if(depth > 1.f  || front.m_depths[i] < depth)
-    {
-      continue;
-    }
-    const int offset = i * 4;
-    front.m_depths[i] = depth;
-    front.m_pixels[offset + 0] = image.m_pixels[offset + 0];
-    front.m_pixels[offset + 1] = image.m_pixels[offset + 1];
-    front.m_pixels[offset + 2] = image.m_pixels[offset + 2];
-    front.m_pixels[offset + 3] = image.m_pixels[offset + 3];
-  }
+  CompositingKernels::ZBuffer(front.m_pixels.data(),
+                              front.m_depths.data(),
+                              image.m_pixels.data(),
+                              image.m_depths.data(),
+                              size);
 }
 
 void OrderedComposite(std::vector<vtkh::Image> &images)
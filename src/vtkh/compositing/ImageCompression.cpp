@@ -0,0 +1,229 @@
+#include <vtkh/compositing/ImageCompression.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+// shorter runs of identical pixels stay in the literal runs since
+// breaking a literal run costs two extra run headers
+const int g_min_repeat = 3;
+
+bool InitialCompressionEnabled()
+{
+  bool enabled = true;
+  if(const char *env = std::getenv("VTKH_IMAGE_COMPRESSION"))
+  {
+    std::string value(env);
+    enabled = !(value == "0" || value == "off" || value == "false");
+  }
+  return enabled;
+}
+
+bool& CompressionEnabled()
+{
+  static bool enabled = InitialCompressionEnabled();
+  return enabled;
+}
+
+std::atomic<long long int> g_raw_bytes(0);
+std::atomic<long long int> g_sent_bytes(0);
+
+inline bool SamePixel(const unsigned char *pixels,
+                      const float *depths,
+                      const int pixel_bytes,
+                      const int a,
+                      const int b)
+{
+  return std::memcmp(depths + a, depths + b, sizeof(float)) == 0 &&
+         std::memcmp(pixels + a * pixel_bytes, pixels + b * pixel_bytes, pixel_bytes) == 0;
+}
+
+} // namespace detail
+
+void
+ImageCompression::SetEnabled(bool enabled)
+{
+  detail::CompressionEnabled() = enabled;
+}
+
+bool
+ImageCompression::GetEnabled()
+{
+  return detail::CompressionEnabled();
+}
+
+long long int
+ImageCompression::GetRawBytes()
+{
+  return detail::g_raw_bytes;
+}
+
+long long int
+ImageCompression::GetSentBytes()
+{
+  return detail::g_sent_bytes;
+}
+
+void
+ImageCompression::ResetCounters()
+{
+  detail::g_raw_bytes = 0;
+  detail::g_sent_bytes = 0;
+}
+
+void
+ImageCompression::AddCounts(long long int raw_bytes, long long int sent_bytes)
+{
+  detail::g_raw_bytes += raw_bytes;
+  detail::g_sent_bytes += sent_bytes;
+}
+
+bool
+ImageCompression::Encode(const unsigned char *pixels,
+                         const float *depths,
+                         const int num_pixels,
+                         const int pixel_bytes,
+                         std::vector<unsigned char> &buffer)
+{
+  buffer.clear();
+  if(!GetEnabled() || num_pixels == 0)
+  {
+    return false;
+  }
+
+  // (first pixel, number of pixels) copied into the message
+  std::vector<int> runs;
+  std::vector<std::pair<int,int>> stored;
+  int num_stored = 0;
+
+  int literal_start = 0;
+  int i = 0;
+  while(i < num_pixels)
+  {
+    int j = i + 1;
+    while(j < num_pixels && detail::SamePixel(pixels, depths, pixel_bytes, i, j))
+    {
+      ++j;
+    }
+
+    const int run = j - i;
+    if(run >= detail::g_min_repeat)
+    {
+      if(i > literal_start)
+      {
+        runs.push_back(i - literal_start);
+        stored.push_back(std::make_pair(literal_start, i - literal_start));
+        num_stored += i - literal_start;
+      }
+      runs.push_back(-run);
+      stored.push_back(std::make_pair(i, 1));
+      num_stored += 1;
+      literal_start = j;
+    }
+    i = j;
+  }
+
+  if(num_pixels > literal_start)
+  {
+    runs.push_back(num_pixels - literal_start);
+    stored.push_back(std::make_pair(literal_start, num_pixels - literal_start));
+    num_stored += num_pixels - literal_start;
+  }
+
+  const size_t raw_size = static_cast<size_t>(num_pixels) * (pixel_bytes + sizeof(float));
+  const size_t header_size = sizeof(int) * (runs.size() + 1);
+  const size_t pixel_size = static_cast<size_t>(num_stored) * pixel_bytes;
+  const size_t depth_size = static_cast<size_t>(num_stored) * sizeof(float);
+  const size_t total_size = header_size + pixel_size + depth_size;
+
+  if(total_size >= raw_size)
+  {
+    return false;
+  }
+
+  buffer.resize(total_size);
+  unsigned char *header = &buffer[0];
+  unsigned char *out_pixels = header + header_size;
+  unsigned char *out_depths = out_pixels + pixel_size;
+
+  const int num_runs = static_cast<int>(runs.size());
+  std::memcpy(header, &num_runs, sizeof(int));
+  std::memcpy(header + sizeof(int), &runs[0], sizeof(int) * runs.size());
+
+  const size_t num_copies = stored.size();
+  for(size_t c = 0; c < num_copies; ++c)
+  {
+    const int first = stored[c].first;
+    const int count = stored[c].second;
+    std::memcpy(out_pixels, pixels + first * pixel_bytes, count * pixel_bytes);
+    std::memcpy(out_depths, depths + first, count * sizeof(float));
+    out_pixels += count * pixel_bytes;
+    out_depths += count * sizeof(float);
+  }
+
+  return true;
+}
+
+void
+ImageCompression::Decode(const std::vector<unsigned char> &buffer,
+                         const int num_pixels,
+                         const int pixel_bytes,
+                         unsigned char *pixels,
+                         float *depths)
+{
+  const unsigned char *header = &buffer[0];
+  int num_runs;
+  std::memcpy(&num_runs, header, sizeof(int));
+  std::vector<int> runs(num_runs);
+  std::memcpy(&runs[0], header + sizeof(int), sizeof(int) * num_runs);
+
+  int num_stored = 0;
+  for(int r = 0; r < num_runs; ++r)
+  {
+    num_stored += runs[r] > 0 ? runs[r] : 1;
+  }
+
+  const size_t header_size = sizeof(int) * (num_runs + 1);
+  const unsigned char *in_pixels = header + header_size;
+  const unsigned char *in_depths = in_pixels + static_cast<size_t>(num_stored) * pixel_bytes;
+  assert(buffer.size() == header_size + num_stored * (pixel_bytes + sizeof(float)));
+
+  int pixel = 0;
+  for(int r = 0; r < num_runs; ++r)
+  {
+    const int run = runs[r];
+    if(run > 0)
+    {
+      std::memcpy(pixels + pixel * pixel_bytes, in_pixels, run * pixel_bytes);
+      std::memcpy(depths + pixel, in_depths, run * sizeof(float));
+      in_pixels += run * pixel_bytes;
+      in_depths += run * sizeof(float);
+      pixel += run;
+    }
+    else
+    {
+      float depth;
+      std::memcpy(&depth, in_depths, sizeof(float));
+      for(int i = 0; i < -run; ++i)
+      {
+        std::memcpy(pixels + (pixel + i) * pixel_bytes, in_pixels, pixel_bytes);
+        depths[pixel + i] = depth;
+      }
+      in_pixels += pixel_bytes;
+      in_depths += sizeof(float);
+      pixel -= run;
+    }
+  }
+  assert(pixel == num_pixels);
+  (void) num_pixels;
+}
+
+} //namespace  vtkh
@@ -0,0 +1,56 @@
+#ifndef VTKH_IMAGE_COMPRESSION_HPP
+#define VTKH_IMAGE_COMPRESSION_HPP
+
+#include <vector>
+#include <vtkh/vtkh_exports.h>
+
+namespace vtkh
+{
+
+//
+// Run length encoding used when images are sent between ranks.
+// Rendered images are mostly background, i.e., long runs of identical
+// color / depth values, so the encoded size scales with the number of
+// covered pixels instead of the size of the canvas. The encoding is
+// lossless and works for any number of bytes per pixel, so it is shared
+// by Image (RGBA8) and PayloadImage.
+//
+// Encoded layout:
+//   int32 num_runs
+//   int32 runs[num_runs]  (n > 0: n literal pixels follow,
+//                          n < 0: one pixel repeated -n times)
+//   pixel bytes of all stored pixels
+//   float depths of all stored pixels
+//
+class VTKH_API ImageCompression
+{
+public:
+  // compression is on by default. Can also be turned off by
+  // setting VTKH_IMAGE_COMPRESSION=0 in the environment
+  static void SetEnabled(bool enabled);
+  static bool GetEnabled();
+
+  // bytes the exchanged images would have used without compression
+  static long long int GetRawBytes();
+  // bytes actually sent
+  static long long int GetSentBytes();
+  static void ResetCounters();
+  static void AddCounts(long long int raw_bytes, long long int sent_bytes);
+
+  // returns false and leaves the buffer empty if compression is disabled
+  // or would not make the message smaller
+  static bool Encode(const unsigned char *pixels,
+                     const float *depths,
+                     const int num_pixels,
+                     const int pixel_bytes,
+                     std::vector<unsigned char> &buffer);
+
+  static void Decode(const std::vector<unsigned char> &buffer,
+                     const int num_pixels,
+                     const int pixel_bytes,
+                     unsigned char *pixels,
+                     float *depths);
+};
+
+} //namespace  vtkh
+#endif
@@ -2,6 +2,7 @@
 #define VTKH_MPI_COLLECT_HPP
 
 #include <vtkh/compositing/Image.hpp>
+#include <vtkh/compositing/ImageCompression.hpp>
 #include <diy/mpi.hpp>
 #include <sstream>
 
@@ -58,8 +59,24 @@ static void MPICollect(Image &image, MPI_Comm comm)
 
   if(rank != 0)
   {
-    MPI_Send(&image.m_pixels[0], pixels * 4, MPI_UNSIGNED_CHAR, 0, 0, comm);
-    MPI_Send(&image.m_depths[0], pixels, MPI_FLOAT, 0, 0, comm);
+    std::vector<unsigned char> encoded;
+    const long long int raw_bytes = static_cast<long long int>(pixels) * (4 + sizeof(float));
+    if(ImageCompression::Encode(image.m_pixels.data(),
+                                image.m_depths.data(),
+                                pixels,
+                                4,
+                                encoded))
+    {
+      // a single message with a tag that tells rank 0 how to read it
+      MPI_Send(&encoded[0], static_cast<int>(encoded.size()), MPI_UNSIGNED_CHAR, 0, 1, comm);
+      ImageCompression::AddCounts(raw_bytes, static_cast<long long int>(encoded.size()));
+    }
+    else
+    {
+      MPI_Send(&image.m_pixels[0], pixels * 4, MPI_UNSIGNED_CHAR, 0, 0, comm);
+      MPI_Send(&image.m_depths[0], pixels, MPI_FLOAT, 0, 0, comm);
+      ImageCompression::AddCounts(raw_bytes, raw_bytes);
+    }
   }
   else
   {
@@ -76,8 +93,24 @@ static void MPICollect(Image &image, MPI_Comm comm)
                      (inbound.Y.Max - inbound.Y.Min + 1);
 
       MPI_Status status;
-      MPI_Recv(&(incoming.m_pixels[0]), rec_size * 4, MPI_UNSIGNED_CHAR, i, 0, comm, &status);
-      MPI_Recv(&(incoming.m_depths[0]), rec_size, MPI_FLOAT, i, 0, comm, &status);
+      MPI_Probe(i, MPI_ANY_TAG, comm, &status);
+      if(status.MPI_TAG == 1)
+      {
+        int encoded_size;
+        MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &encoded_size);
+        std::vector<unsigned char> encoded(encoded_size);
+        MPI_Recv(&encoded[0], encoded_size, MPI_UNSIGNED_CHAR, i, 1, comm, &status);
+        ImageCompression::Decode(encoded,
+                                 rec_size,
+                                 4,
+                                 incoming.m_pixels.data(),
+                                 incoming.m_depths.data());
+      }
+      else
+      {
+        MPI_Recv(&(incoming.m_pixels[0]), rec_size * 4, MPI_UNSIGNED_CHAR, i, 0, comm, &status);
+        MPI_Recv(&(incoming.m_depths[0]), rec_size, MPI_FLOAT, i, 0, comm, &status);
+      }
       incoming.SubsetTo(final_image);
     }
   }
@@ -40,6 +40,9 @@
 //
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~//
 #include "PartialCompositor.hpp"
+#include "RadixSort.hpp"
+#include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
 #include <algorithm>
 #include <assert.h>
 #include <limits>
@@ -53,12 +56,105 @@
 namespace vtkh {
 namespace detail
 {
-template<template <typename> class PartialType, typename FloatType>
+
+//
+// depth part of the sort key. Absorption partials of the same
+// pixel can be blended in any order, so they only sort by pixel
+//
+template<typename FloatType>
+unsigned long long depth_key(const VolumePartial<FloatType> &partial)
+{
+  return RadixSort::DepthKey(partial.m_depth);
+}
+
+template<typename FloatType>
+unsigned long long depth_key(const AbsorptionPartial<FloatType> &)
+{
+  return 0;
+}
+
+template<typename FloatType>
+unsigned long long depth_key(const EmissionPartial<FloatType> &partial)
+{
+  return RadixSort::DepthKey(partial.m_depth);
+}
+
+//
+// Read access to the partials being composited. The partials are never
+// permuted: the sort only moves keys and indices, and compositing walks
+// the partials through the sorted indices.
+//
+template<typename PartialType>
+struct PartialSource
+{
+  typedef PartialType ResultType;
+  std::vector<PartialType> &m_partials;
+
+  PartialSource(std::vector<PartialType> &partials)
+    : m_partials(partials)
+  {
+  }
+
+  int size() const
+  {
+    return static_cast<int>(m_partials.size());
+  }
+
+  unsigned int pixel_key(const int index) const
+  {
+    return RadixSort::PixelKey(m_partials[index].m_pixel_id);
+  }
+
+  unsigned long long depth_key(const int index) const
+  {
+    return detail::depth_key(m_partials[index]);
+  }
+
+  const PartialType &get(const int index) const
+  {
+    return m_partials[index];
+  }
+};
+
+// structure of arrays form, only read for the partials that are output
+struct VolumeArraysSource
+{
+  typedef VolumePartial<float> ResultType;
+  const VolumePartialArrays &m_arrays;
+
+  VolumeArraysSource(const VolumePartialArrays &arrays)
+    : m_arrays(arrays)
+  {
+  }
+
+  int size() const
+  {
+    return m_arrays.size();
+  }
+
+  unsigned int pixel_key(const int index) const
+  {
+    return RadixSort::PixelKey(m_arrays.m_pixel_ids[index]);
+  }
+
+  unsigned long long depth_key(const int index) const
+  {
+    return RadixSort::DepthKey(m_arrays.m_depths[index]);
+  }
+
+  VolumePartial<float> get(const int index) const
+  {
+    return m_arrays.get(index);
+  }
+};
+
+template<typename PartialType, typename Source>
 void BlendPartials(const int &total_segments,
                    const int &total_partial_comps,
                    std::vector<int> &pixel_work_ids,
-                   std::vector<PartialType<FloatType>> &partials,
-                   std::vector<PartialType<FloatType>> &output_partials,
+                   const std::vector<int> &sort_index,
+                   Source &partials,
+                   std::vector<PartialType> &output_partials,
                    const int output_offset)
 {
   //
@@ -70,9 +166,9 @@ void BlendPartials(const int &total_segments,
   for(int i = 0; i < total_segments; ++i)
   {
     int current_index = pixel_work_ids[i];
-    PartialType<FloatType> result = partials[current_index];
+    PartialType result = partials.get(sort_index[current_index]);
     ++current_index;
-    PartialType<FloatType> next = partials[current_index];
+    PartialType next = partials.get(sort_index[current_index]);
     // TODO: we could just count the amount of work and make this a for loop(vectorize??)
     while(result.m_pixel_id == next.m_pixel_id)
     {
@@ -84,7 +180,7 @@ void BlendPartials(const int &total_segments,
         break;
       }
       ++current_index;
-      next = partials[current_index];
+      next = partials.get(sort_index[current_index]);
     }
     output_partials[output_offset + i] = result;
   }
@@ -93,15 +189,18 @@ void BlendPartials(const int &total_segments,
   //PartialType<FloatType>::composite_background(output_partials, background_values);
 
 }
+
 template<typename T>
 void
-BlendEmission(const int &total_segments,
+BlendPartials(const int &total_segments,
               const int &total_partial_comps,
               std::vector<int> &pixel_work_ids,
-              std::vector<EmissionPartial<T>> &partials,
+              const std::vector<int> &sort_index,
+              PartialSource<EmissionPartial<T>> &source,
               std::vector<EmissionPartial<T>> &output_partials,
               const int output_offset)
 {
+  std::vector<EmissionPartial<T>> &partials = source.m_partials;
   //
   // Perform the compositing and output the result in the output
   // This code computes the optical depth (total absorption)
@@ -113,9 +212,9 @@ BlendEmission(const int &total_segments,
   for(int i = 0; i < total_segments; ++i)
   {
     int current_index = pixel_work_ids[i];
-    EmissionPartial<T> result = partials[current_index];
+    EmissionPartial<T> result = partials[sort_index[current_index]];
     ++current_index;
-    EmissionPartial<T> next = partials[current_index];
+    EmissionPartial<T> next = partials[sort_index[current_index]];
     // TODO: we could just count the amount of work and make this a for loop(vectorize??)
     while(result.m_pixel_id == next.m_pixel_id)
     {
@@ -125,7 +224,7 @@ BlendEmission(const int &total_segments,
         break;
       }
       ++current_index;
-      next = partials[current_index];
+      next = partials[sort_index[current_index]];
     }
     output_partials[output_offset + i] = result;
   }
@@ -152,7 +251,8 @@ BlendEmission(const int &total_segments,
     //
     //  move forward to the end of the segment
     //
-    while(partials[current_index].m_pixel_id == partials[current_index + 1].m_pixel_id)
+    while(partials[sort_index[current_index]].m_pixel_id ==
+          partials[sort_index[current_index + 1]].m_pixel_id)
     {
       ++current_index;
       if(current_index == total_partial_comps - 1)
@@ -164,7 +264,7 @@ BlendEmission(const int &total_segments,
     // set the intensity emerging out of the last segment
     //
     output_partials[output_offset + i].m_emission_bins
-      = partials[current_index].m_emission_bins;
+      = partials[sort_index[current_index]].m_emission_bins;
 
     //
     // now move backwards accumulating absorption for each segment
@@ -174,11 +274,13 @@ BlendEmission(const int &total_segments,
     current_index--;
     while(current_index != segment_start - 1)
     {
-      partials[current_index].blend_absorption(partials[current_index + 1]);
+      EmissionPartial<T> &current = partials[sort_index[current_index]];
+      EmissionPartial<T> &front = partials[sort_index[current_index + 1]];
+      current.blend_absorption(front);
       // mult this segments emission by the absorption in front
-      partials[current_index].blend_emission(partials[current_index + 1]);
+      current.blend_emission(front);
       // add remaining emissed engery to the output
-      output_partials[output_offset + i].add_emission(partials[current_index]);
+      output_partials[output_offset + i].add_emission(current);
 
       --current_index;
     }
@@ -186,38 +288,107 @@ BlendEmission(const int &total_segments,
 
 
 }
-template<>
-void BlendPartials<EmissionPartial, float>(const int &total_segments,
-                                           const int &total_partial_comps,
-                                           std::vector<int> &pixel_work_ids,
-                                           std::vector<EmissionPartial<float>> &partials,
-                                           std::vector<EmissionPartial<float>> &output_partials,
-                                           const int output_offset)
+
+//
+// Sorts the partials by (pixel id, depth) and composites the partials
+// of every pixel into one output partial
+//
+template<typename Source>
+void CompositeSorted(Source &partials,
+                     std::vector<typename Source::ResultType> &output_partials)
 {
+  typedef typename Source::ResultType PartialType;
+  const int total_partial_comps = partials.size();
+  //
+  // Sort the (pixel id, depth) keys and the partial indices
+  //
+  std::vector<unsigned int> pixel_keys(total_partial_comps);
+  std::vector<unsigned long long> depth_keys(total_partial_comps);
+  std::vector<int> sort_index(total_partial_comps);
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < total_partial_comps; ++i)
+  {
+    pixel_keys[i] = partials.pixel_key(i);
+    depth_keys[i] = partials.depth_key(i);
+    sort_index[i] = i;
+  }
 
-  BlendEmission(total_segments,
-                total_partial_comps,
-                pixel_work_ids,
-                partials,
-                output_partials,
-                output_offset);
-}
+  RadixSort::SortByKey(pixel_keys, depth_keys, sort_index);
 
-template<>
-void BlendPartials<EmissionPartial, double>(const int &total_segments,
-                                            const int &total_partial_comps,
-                                            std::vector<int> &pixel_work_ids,
-                                            std::vector<EmissionPartial<double>> &partials,
-                                            std::vector<EmissionPartial<double>> &output_partials,
-                                            const int output_offset)
-{
+  //
+  // Find the segments of pixels with compositing work (more than
+  // one partial) and the unique pixels from the sorted keys
+  //
+  std::vector<unsigned char> work_flags(total_partial_comps);
+  std::vector<unsigned char> unique_flags(total_partial_comps);
+  const int n_minus_one =  total_partial_comps - 1;
 
-  BlendEmission(total_segments,
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < total_partial_comps; ++i)
+  {
+    const bool is_begining = i == 0 || pixel_keys[i] != pixel_keys[i-1];
+    const bool has_compositing_work = i != n_minus_one && pixel_keys[i] == pixel_keys[i+1];
+    work_flags[i] = is_begining && has_compositing_work ? 1 : 0;
+    unique_flags[i] = is_begining && !has_compositing_work ? 1 : 0;
+  }
+
+  std::vector<int> work_offsets;
+  std::vector<int> unique_offsets;
+  const int total_segments = RadixSort::ExclusiveScan(work_flags, work_offsets);
+  const int total_unique_pixels = RadixSort::ExclusiveScan(unique_flags, unique_offsets);
+
+  //
+  // find the pixel indexes that have compositing work
+  // and the ones that have NO compositing work
+  //
+  std::vector<int> pixel_work_ids(total_segments);
+  std::vector<int> unique_ids(total_unique_pixels);
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < total_partial_comps; ++i)
+  {
+    if(work_flags[i] == 1)
+    {
+      pixel_work_ids[work_offsets[i]] = i;
+    }
+    else if(unique_flags[i] == 1)
+    {
+      unique_ids[unique_offsets[i]] = i;
+    }
+  }
+
+  const int total_output_pixels = total_unique_pixels + total_segments;
+
+  output_partials.resize(total_output_pixels);
+
+  //
+  // Gather the unique pixels into the output
+  //
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < total_unique_pixels; ++i)
+  {
+    PartialType result = partials.get(sort_index[unique_ids[i]]);
+    output_partials[i] = result;
+  }
+
+  //
+  // perform compositing if there are more than
+  // one segment per ray
+  //
+  BlendPartials(total_segments,
                 total_partial_comps,
                 pixel_work_ids,
+                sort_index,
                 partials,
                 output_partials,
-                output_offset);
+                total_unique_pixels);
 }
 
 } // namespace detail
@@ -225,6 +396,9 @@ void BlendPartials<EmissionPartial, double>(const int &total_segments,
 //--------------------------------------------------------------------------------------------
 template<typename PartialType>
 PartialCompositor<PartialType>::PartialCompositor()
+  : m_mpi_comm_id(0),
+    m_redistribution_mode(BALANCED_PARTIALS),
+    m_imbalance(1.f)
 {
 
 }
@@ -306,7 +480,21 @@ PartialCompositor<PartialType>::merge(const std::vector<std::vector<PartialType>
   //
   global_min_pixel = min_pixel;
   global_max_pixel = max_pixel;
+  reduce_pixel_range(global_min_pixel, global_max_pixel);
+
+  delete[] offsets;
+  delete[] pixel_mins;
+  delete[] pixel_maxs;
 
+}
+
+//--------------------------------------------------------------------------------------------
+
+template<typename PartialType>
+void
+PartialCompositor<PartialType>::reduce_pixel_range(int &global_min_pixel,
+                                                   int &global_max_pixel)
+{
 #ifdef VTKH_PARALLEL
   MPI_Comm comm_handle = MPI_Comm_f2c(m_mpi_comm_id);
   int rank_min = global_min_pixel;
@@ -317,12 +505,10 @@ PartialCompositor<PartialType>::merge(const std::vector<std::vector<PartialType>
   MPI_Allreduce(&rank_max, &mpi_max, 1, MPI_INT, MPI_MAX, comm_handle);
   global_min_pixel = mpi_min;
   global_max_pixel = mpi_max;
+#else
+  (void) global_min_pixel;
+  (void) global_max_pixel;
 #endif
-
-  delete[] offsets;
-  delete[] pixel_mins;
-  delete[] pixel_maxs;
-
 }
 
 //--------------------------------------------------------------------------------------------
@@ -331,160 +517,16 @@ void
 PartialCompositor<PartialType>::composite_partials(std::vector<PartialType> &partials,
                                             std::vector<PartialType> &output_partials)
 {
+  VTKH_PROFILE_SCOPE("PartialCompositor::composite");
   const int total_partial_comps = partials.size();
   if(total_partial_comps == 0)
   {
     output_partials = partials;
     return;
   }
-  //
-  // Sort the composites
-  //
-  std::sort(partials.begin(), partials.end());
-  //
-  // Find the number of unique pixel_ids with work
-  //
-  std::vector<unsigned char> work_flags;
-  std::vector<unsigned char> unique_flags;
-  work_flags.resize(total_partial_comps);
-  unique_flags.resize(total_partial_comps);
-  //
-  // just check the first and last entries manualy to reduce the
-  // loop complexity
-  //
-  if(partials[0].m_pixel_id == partials[1].m_pixel_id)
-  {
-    work_flags[0] = 1;
-    unique_flags[0] = 0;
-  }
-  else
-  {
-    work_flags[0] = 0;
-    unique_flags[0] = 1;
-  }
-  if(partials[total_partial_comps-1].m_pixel_id != partials[total_partial_comps-2].m_pixel_id)
-  {
-    unique_flags[total_partial_comps-1] = 1;
-  }
-  else
-  {
-    unique_flags[total_partial_comps-1] = 0;
-  }
-  const int n_minus_one =  total_partial_comps - 1;
-
-#ifdef VTKH_USE_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 1; i < n_minus_one; ++i)
-  {
-    unsigned char work_flag = 0;
-    unsigned char unique_flag = 0;
-    bool is_begining = false;
-    if(partials[i].m_pixel_id != partials[i-1].m_pixel_id)
-    {
-      is_begining = true;
-    }
-
-    bool has_compositing_work = false;
-    if(partials[i].m_pixel_id == partials[i+1].m_pixel_id)
-    {
-      has_compositing_work = true;
-    }
-    if(is_begining && has_compositing_work)
-    {
-      work_flag  = 1;
-    }
-    if(is_begining && !has_compositing_work)
-    {
-      unique_flag = 1;
-    }
-
-    work_flags[i]  = work_flag;
-    unique_flags[i] = unique_flag;
-  }
-  // count the number of of unique pixels
-  int total_segments = 0;
-
-#ifdef VTKH_USE_OPENMP
-  #pragma omp parallel for shared(work_flags) reduction(+:total_segments)
-#endif
-  for(int i = 0; i < total_partial_comps; ++i)
-  {
-    total_segments += work_flags[i];
-  }
-
-  int total_unique_pixels = 0;
-#ifdef VTKH_USE_OPENMP
-  #pragma omp parallel for shared(unique_flags) reduction(+:total_unique_pixels)
-#endif
-  for(int i = 0; i < total_partial_comps; ++i)
-  {
-    total_unique_pixels += unique_flags[i];
-  }
-
-  if(total_segments ==  0)
-  {
-    //nothing to do
-  }
-
-  //
-  // find the pixel indexes that have compositing work
-  //
-  std::vector<int> pixel_work_ids;
-  pixel_work_ids.resize(total_segments);
-  int current_index = 0;
-  for(int i = 0;  i < total_partial_comps; ++i)
-  {
-    if(work_flags[i] == 1)
-    {
-      pixel_work_ids[current_index] = i;
-      ++current_index;
-    }
-  }
-
-  //
-  // find the pixel indexes that have NO compositing work
-  //
-  std::vector<int> unique_ids;
-  unique_ids.resize(total_unique_pixels);
-  current_index = 0;
-  for(int i = 0;  i < total_partial_comps; ++i)
-  {
-    if(unique_flags[i] == 1)
-    {
-      unique_ids[current_index] = i;
-      ++current_index;
-    }
-  }
-
-
-  const int total_output_pixels = total_unique_pixels + total_segments;
-
-  output_partials.resize(total_output_pixels);
-
-  //
-  // Gather the unique pixels into the output
-  //
-#ifdef VTKH_USE_OPENMP
-  #pragma omp parallel for
-#endif
-  for(int i = 0; i < total_unique_pixels; ++i)
-  {
-    PartialType result = partials[unique_ids[i]];
-    output_partials[i] = result;
-  }
-
-  //
-  // perform compositing if there are more than
-  // one segment per ray
-  //
-  detail::BlendPartials(total_segments,
-                        total_partial_comps,
-                        pixel_work_ids,
-                        partials,
-                        output_partials,
-                        total_unique_pixels);
 
+  detail::PartialSource<PartialType> source(partials);
+  detail::CompositeSorted(source, output_partials);
 }
 
 //--------------------------------------------------------------------------------------------
@@ -511,6 +553,18 @@ PartialCompositor<PartialType>::composite(std::vector<std::vector<PartialType>>
 
   merge(partial_images, partials, global_min_pixel, global_max_pixel);
 
+  composite_merged(partials, global_min_pixel, global_max_pixel, output_partials);
+}
+
+//--------------------------------------------------------------------------------------------
+
+template<typename PartialType>
+void
+PartialCompositor<PartialType>::composite_merged(std::vector<PartialType> &partials,
+                                                 const int global_min_pixel,
+                                                 const int global_max_pixel,
+                                                 std::vector<PartialType> &output_partials)
+{
   if(global_min_pixel > global_max_pixel)
   {
     // just bail
@@ -522,11 +576,41 @@ PartialCompositor<PartialType>::composite(std::vector<std::vector<PartialType>>
   //
   // Exchange partials with other ranks
   //
-  redistribute(partials,
-               comm_handle,
-               global_min_pixel,
-               global_max_pixel);
-  MPI_Barrier(comm_handle);
+  MPI_Comm comm_handle = MPI_Comm_f2c(m_mpi_comm_id);
+  int num_ranks;
+  MPI_Comm_size(comm_handle, &num_ranks);
+  std::vector<int> splits;
+  if(m_redistribution_mode == BALANCED_PARTIALS)
+  {
+    splits = balanced_splits(partials, comm_handle, global_min_pixel, global_max_pixel);
+  }
+  else
+  {
+    splits = even_splits(global_min_pixel, global_max_pixel, num_ranks);
+  }
+
+  redistribute(partials, comm_handle, splits);
+
+  //
+  // the gather of the per rank counts also replaces the barrier
+  // that followed the exchange
+  //
+  long long local_count = static_cast<long long>(partials.size());
+  std::vector<long long> counts(num_ranks);
+  MPI_Allgather(&local_count, 1, MPI_LONG_LONG, &counts[0], 1, MPI_LONG_LONG, comm_handle);
+
+  long long max_count = 0;
+  long long total_count = 0;
+  for(int i = 0; i < num_ranks; ++i)
+  {
+    max_count = std::max(max_count, counts[i]);
+    total_count += counts[i];
+  }
+  m_imbalance = total_count == 0 ? 1.f :
+    static_cast<vtkm::Float32>(max_count * num_ranks) / static_cast<vtkm::Float32>(total_count);
+
+  VTKH_DATA_ADD("redistributed_partials", local_count);
+  VTKH_DATA_ADD("partial_imbalance", m_imbalance);
 #endif
 
   const int  total_partial_comps = partials.size();
@@ -547,6 +631,84 @@ PartialCompositor<PartialType>::composite(std::vector<std::vector<PartialType>>
 #endif
 }
 
+//--------------------------------------------------------------------------------------------
+
+void
+composite_arrays(PartialCompositor<VolumePartial<vtkm::Float32>> &compositor,
+                 std::vector<VolumePartialArrays> &partial_images,
+                 std::vector<VolumePartial<vtkm::Float32>> &output_partials)
+{
+  //
+  // merge the partial images into one set of arrays
+  //
+  const int num_partial_images = static_cast<int>(partial_images.size());
+  std::vector<int> offsets(num_partial_images);
+  int total_partial_comps = 0;
+  for(int i = 0; i < num_partial_images; ++i)
+  {
+    offsets[i] = total_partial_comps;
+    total_partial_comps += partial_images[i].size();
+  }
+
+  VolumePartialArrays arrays;
+  arrays.resize(total_partial_comps);
+
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < num_partial_images; ++i)
+  {
+    const VolumePartialArrays &image = partial_images[i];
+    std::copy(image.m_pixel_ids.begin(), image.m_pixel_ids.end(),
+              arrays.m_pixel_ids.begin() + offsets[i]);
+    std::copy(image.m_depths.begin(), image.m_depths.end(),
+              arrays.m_depths.begin() + offsets[i]);
+    std::copy(image.m_colors.begin(), image.m_colors.end(),
+              arrays.m_colors.begin() + offsets[i] * 4);
+  }
+
+  int min_pixel = std::numeric_limits<int>::max();
+  int max_pixel = std::numeric_limits<int>::min();
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for reduction(min:min_pixel) reduction(max:max_pixel)
+#endif
+  for(int i = 0; i < total_partial_comps; ++i)
+  {
+    const int val = arrays.m_pixel_ids[i];
+    min_pixel = std::min(min_pixel, val);
+    max_pixel = std::max(max_pixel, val);
+  }
+
+  compositor.reduce_pixel_range(min_pixel, max_pixel);
+
+#ifdef VTKH_PARALLEL
+  //
+  // partials travel between ranks as structs, so they
+  // are built once here for the exchange
+  //
+  std::vector<VolumePartial<vtkm::Float32>> partials(total_partial_comps);
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < total_partial_comps; ++i)
+  {
+    partials[i] = arrays.get(i);
+  }
+  compositor.composite_merged(partials, min_pixel, max_pixel, output_partials);
+#else
+  if(min_pixel > max_pixel)
+  {
+    return;
+  }
+
+  VTKH_PROFILE_SCOPE("PartialCompositor::composite");
+  detail::VolumeArraysSource source(arrays);
+  detail::CompositeSorted(source, output_partials);
+#endif
+}
+
+//--------------------------------------------------------------------------------------------
+
 template<typename PartialType>
 void
 PartialCompositor<PartialType>::set_background(std::vector<vtkm::Float32> &background_values)
@@ -578,6 +740,27 @@ PartialCompositor<PartialType>::set_comm_handle(int mpi_comm_id)
   m_mpi_comm_id  = mpi_comm_id;
 }
 
+template<typename PartialType>
+void
+PartialCompositor<PartialType>::set_redistribution_mode(RedistributionMode mode)
+{
+  m_redistribution_mode = mode;
+}
+
+template<typename PartialType>
+typename PartialCompositor<PartialType>::RedistributionMode
+PartialCompositor<PartialType>::get_redistribution_mode() const
+{
+  return m_redistribution_mode;
+}
+
+template<typename PartialType>
+vtkm::Float32
+PartialCompositor<PartialType>::get_imbalance() const
+{
+  return m_imbalance;
+}
+
 //Explicit function instantiations
 template class VTKH_API PartialCompositor<VolumePartial<vtkm::Float32>>;
 template class VTKH_API PartialCompositor<VolumePartial<vtkm::Float64>>;
@@ -53,10 +53,32 @@
 
 namespace vtkh {
 
+template<typename PartialType>
+class PartialCompositor;
+
+// Composites float volume partials given in structure of arrays form.
+// Only the sort keys and the output partials are built, the inputs are
+// never converted to structs unless they have to be sent to another rank
+VTKH_API void
+composite_arrays(PartialCompositor<VolumePartial<vtkm::Float32>> &compositor,
+                 std::vector<VolumePartialArrays> &partial_images,
+                 std::vector<VolumePartial<vtkm::Float32>> &output_partials);
+
 template<typename PartialType>
 class VTKH_API PartialCompositor
 {
 public:
+  //
+  // How the image is split between ranks before compositing.
+  // EVEN_PIXELS gives each rank the same number of pixels,
+  // BALANCED_PARTIALS gives each rank about the same number of partials.
+  //
+  enum RedistributionMode
+  {
+    EVEN_PIXELS,
+    BALANCED_PARTIALS
+  };
+
   PartialCompositor();
   ~PartialCompositor();
   void
@@ -65,7 +87,15 @@ public:
   void set_background(std::vector<vtkm::Float32> &background_values);
   void set_background(std::vector<vtkm::Float64> &background_values);
   void set_comm_handle(int mpi_comm_id);
+  void set_redistribution_mode(RedistributionMode mode);
+  RedistributionMode get_redistribution_mode() const;
+  // max / mean partials per rank after the last redistribution
+  vtkm::Float32 get_imbalance() const;
 protected:
+  friend void composite_arrays(PartialCompositor<VolumePartial<vtkm::Float32>> &compositor,
+                               std::vector<VolumePartialArrays> &partial_images,
+                               std::vector<VolumePartial<vtkm::Float32>> &output_partials);
+
   void merge(const std::vector<std::vector<PartialType>> &in_partials,
              std::vector<PartialType> &partials,
              int &global_min_pixel,
@@ -74,8 +104,18 @@ protected:
   void composite_partials(std::vector<PartialType> &partials,
                           std::vector<PartialType> &output_partials);
 
+  // redistributes, composites and collects merged partials
+  void composite_merged(std::vector<PartialType> &partials,
+                        const int global_min_pixel,
+                        const int global_max_pixel,
+                        std::vector<PartialType> &output_partials);
+
+  void reduce_pixel_range(int &global_min_pixel, int &global_max_pixel);
+
   std::vector<typename PartialType::ValueType> m_background_values;
   int m_mpi_comm_id;
+  RedistributionMode m_redistribution_mode;
+  vtkm::Float32 m_imbalance;
 };
 
 }; // namespace rover
@@ -1,5 +1,6 @@
 #include "PayloadCompositor.hpp"
 #include <vtkh/compositing/PayloadImageCompositor.hpp>
+#include <vtkh/Profiler.hpp>
 
 #include <assert.h>
 #include <algorithm>
@@ -47,6 +48,7 @@ PayloadCompositor::AddImage(PayloadImage &image)
 PayloadImage
 PayloadCompositor::Composite()
 {
+  VTKH_PROFILE_SCOPE("PayloadCompositor::Composite");
   assert(m_images.size() != 0);
   // nothing to do here in serial. Images were composited as
   // they were added to the compositor
@@ -62,6 +64,22 @@ PayloadCompositor::Composite()
   return m_images[0];
 }
 
+void
+PayloadCompositor::CompositeBatch(std::vector<PayloadImage> &images)
+{
+  VTKH_PROFILE_SCOPE("PayloadCompositor::CompositeBatch");
+  // nothing to do here in serial
+#ifdef VTKH_PARALLEL
+  vtkhdiy::mpi::communicator diy_comm;
+  diy_comm = vtkhdiy::mpi::communicator(MPI_Comm_f2c(GetMPICommHandle()));
+
+  RadixKCompositor compositor;
+  compositor.CompositeSurface(diy_comm, images);
+#else
+  (void) images;
+#endif
+}
+
 
 } // namespace vtkh
 
@@ -18,6 +18,11 @@ public:
     void AddImage(PayloadImage &image);
 
     PayloadImage Composite();
+
+    // Z-buffer composites a batch of independent images (e.g., one per
+    // camera) in one set of communication rounds. Images are composited
+    // in place and are complete on rank 0.
+    void CompositeBatch(std::vector<PayloadImage> &images);
 protected:
     std::vector<PayloadImage>  m_images;
 };
@@ -1,6 +1,7 @@
 #ifndef VTKH_DIY_PAYLOAD_IMAGE_HPP
 #define VTKH_DIY_PAYLOAD_IMAGE_HPP
 
+#include <limits>
 #include <sstream>
 #include <vector>
 #include <vtkm/Bounds.h>
@@ -55,6 +56,27 @@ struct VTKH_API PayloadImage
       m_orig_rank = -1;
     }
 
+    //
+    // An image that covers bounds but holds no pixels. Ranks without
+    // data composite with these instead of full background images, so
+    // they cost neither memory nor bandwidth.
+    //
+    void InitEmpty(const vtkm::Bounds &bounds, const int payload_bytes)
+    {
+      m_orig_bounds = bounds;
+      m_bounds = bounds;
+      m_orig_rank = -1;
+      m_payload_bytes = payload_bytes;
+      m_default_value = vtkm::Nan32();
+      m_payloads.clear();
+      m_depths.clear();
+    }
+
+    bool IsEmpty() const
+    {
+      return m_depths.empty();
+    }
+
     int GetNumberOfPixels() const
     {
       return static_cast<int>(m_depths.size());
@@ -99,6 +121,13 @@ struct VTKH_API PayloadImage
       assert(sub_region.X.Max <= image.m_bounds.X.Max);
       assert(sub_region.Y.Max <= image.m_bounds.Y.Max);
 
+      if(image.IsEmpty())
+      {
+        m_payloads.clear();
+        m_depths.clear();
+        return;
+      }
+
       const int s_dx  = m_bounds.X.Max - m_bounds.X.Min + 1;
       const int s_dy  = m_bounds.Y.Max - m_bounds.Y.Min + 1;
 
@@ -152,6 +181,19 @@ struct VTKH_API PayloadImage
       const int start_x = m_bounds.X.Min - image.m_bounds.X.Min;
       const int start_y = m_bounds.Y.Min - image.m_bounds.Y.Min;
 
+      if(IsEmpty())
+      {
+        // nobody had data here, so this is background
+        for(int y = 0; y < s_dy; ++y)
+        {
+          const int copy_to = (y + start_y) * dx + start_x;
+          std::fill(&image.m_depths[copy_to],
+                    &image.m_depths[copy_to] + s_dx,
+                    static_cast<float>(std::numeric_limits<int>::max()));
+        }
+        return;
+      }
+
 #ifdef VTKH_USE_OPENMP
         #pragma omp parallel for
 #endif
@@ -20,6 +20,18 @@ void ZBufferComposite(vtkh::PayloadImage &front, const vtkh::PayloadImage &image
   {
     std::cout<<"very bad\n";
   }
+
+  // images without pixels (ranks without data) add nothing
+  if(image.IsEmpty())
+  {
+    return;
+  }
+  if(front.IsEmpty())
+  {
+    front.m_payloads = image.m_payloads;
+    front.m_depths = image.m_depths;
+    return;
+  }
   assert(front.m_depths.size() == front.m_payloads.size() / front.m_payload_bytes);
   assert(front.m_bounds.X.Min == image.m_bounds.X.Min);
   assert(front.m_bounds.Y.Min == image.m_bounds.Y.Min);
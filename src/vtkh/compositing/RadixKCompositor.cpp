@@ -31,6 +31,52 @@ void DepthComposite<Image>(Image &front, Image &back)
   compositor.ZBufferComposite(front, back);
 }
 
+//
+// create a balanced set of pixel ranges along the current dim
+//
+static std::vector<vtkhdiy::DiscreteBounds>
+split_bounds(const vtkm::Bounds &bounds, const int current_dim, const int group_size)
+{
+  vtkhdiy::DiscreteBounds image_bounds = VTKMBoundsToDIY(bounds);
+  int range_length = image_bounds.max[current_dim] - image_bounds.min[current_dim];
+  int base_step = range_length / group_size;
+  int rem = range_length % group_size;
+  std::vector<int> bucket_sizes(group_size, base_step);
+  for(int i  = 0; i < rem; ++i)
+  {
+    bucket_sizes[i]++;
+  }
+
+  int count = 0;
+  for(int i  = 0; i < group_size; ++i)
+  {
+    count += bucket_sizes[i];
+  }
+  assert(count == range_length);
+
+  std::vector<vtkhdiy::DiscreteBounds> subset_bounds(group_size, image_bounds);
+  int min_pixel = image_bounds.min[current_dim];
+  for(int i = 0; i < group_size; ++i)
+  {
+    subset_bounds[i].min[current_dim] = min_pixel;
+    subset_bounds[i].max[current_dim] = min_pixel + bucket_sizes[i];
+    min_pixel += bucket_sizes[i];
+  }
+
+  //debug
+  if(group_size > 1)
+  {
+    for(int i = 1; i < group_size; ++i)
+    {
+      assert(subset_bounds[i-1].max[current_dim] == subset_bounds[i].min[current_dim]);
+    }
+
+    assert(subset_bounds[0].min[current_dim] == image_bounds.min[current_dim]);
+    assert(subset_bounds[group_size-1].max[current_dim] == image_bounds.max[current_dim]);
+  }
+  return subset_bounds;
+}
+
 template<typename ImageType>
 void reduce_images(void *b,
                    const vtkhdiy::ReduceProxy &proxy,
@@ -64,56 +110,101 @@ void reduce_images(void *b,
   const int group_size = proxy.out_link().size();
   const int current_dim = partners.dim(round);
 
-  //create balanced set of ranges for current dim
-  vtkhdiy::DiscreteBounds image_bounds = VTKMBoundsToDIY(image.m_bounds);
-  int range_length = image_bounds.max[current_dim] - image_bounds.min[current_dim];
-  int base_step = range_length / group_size;
-  int rem = range_length % group_size;
-  std::vector<int> bucket_sizes(group_size, base_step);
-  for(int i  = 0; i < rem; ++i)
+  std::vector<vtkhdiy::DiscreteBounds> subset_bounds
+    = split_bounds(image.m_bounds, current_dim, group_size);
+
+  std::vector<ImageType> out_images(group_size);
+  for(int i = 0; i < group_size; ++i)
   {
-    bucket_sizes[i]++;
-  }
+    out_images[i].SubsetFrom(image, DIYBoundsToVTKM(subset_bounds[i]));
+  } //for
 
-  int count = 0;
-  for(int i  = 0; i < group_size; ++i)
+  for(int i = 0; i < group_size; ++i)
   {
-    count += bucket_sizes[i];
+      if(proxy.out_link().target(i).gid == proxy.gid())
+      {
+        image.Swap(out_images[i]);
+      }
+      else
+      {
+        proxy.enqueue(proxy.out_link().target(i), out_images[i]);
+      }
+  } //for
+
+} // reduce images
+
+//
+// Batched version of reduce_images. Every image in the batch follows the
+// same swap schedule, so each round sends one message per partner that
+// carries the pieces of all images instead of one message per image.
+//
+template<typename ImageType>
+void reduce_image_batch(void *b,
+                        const vtkhdiy::ReduceProxy &proxy,
+                        const vtkhdiy::RegularSwapPartners &partners)
+{
+  ImageBatchBlock<ImageType> *block = reinterpret_cast<ImageBatchBlock<ImageType>*>(b);
+  unsigned int round = proxy.round();
+  std::vector<ImageType> &images = block->m_images;
+  const int num_images = static_cast<int>(images.size());
+
+  if(proxy.in_link().size() > 0)
+  {
+      for(int i = 0; i < proxy.in_link().size(); ++i)
+      {
+        int gid = proxy.in_link().target(i).gid;
+        if(gid == proxy.gid())
+        {
+          //skip revieving from self since we sent nothing
+          continue;
+        }
+        std::vector<ImageType> incoming;
+        proxy.dequeue(gid, incoming);
+        assert(incoming.size() == images.size());
+        // the images are independent, so the merges are spread
+        // over the batch
+#ifdef VTKH_USE_OPENMP
+        #pragma omp parallel for
+#endif
+        for(int n = 0; n < num_images; ++n)
+        {
+          DepthComposite(images[n], incoming[n]);
+        }
+      } // for in links
   }
-  assert(count == range_length);
 
-  std::vector<vtkhdiy::DiscreteBounds> subset_bounds(group_size, VTKMBoundsToDIY(image.m_bounds));
-  int min_pixel = image_bounds.min[current_dim];
-  for(int i = 0; i < group_size; ++i)
+  if(proxy.out_link().size() == 0)
   {
-    subset_bounds[i].min[current_dim] = min_pixel;
-    subset_bounds[i].max[current_dim] = min_pixel + bucket_sizes[i];
-    min_pixel += bucket_sizes[i];
+    return;
   }
 
-  //debug
-  if(group_size > 1)
+  const int group_size = proxy.out_link().size();
+  const int current_dim = partners.dim(round);
+
+  // out_images[partner][image]
+  std::vector<std::vector<ImageType>> out_images(group_size,
+                                                 std::vector<ImageType>(num_images));
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int n = 0; n < num_images; ++n)
   {
-    for(int i = 1; i < group_size; ++i)
+    std::vector<vtkhdiy::DiscreteBounds> subset_bounds
+      = split_bounds(images[n].m_bounds, current_dim, group_size);
+    for(int i = 0; i < group_size; ++i)
     {
-      assert(subset_bounds[i-1].max[current_dim] == subset_bounds[i].min[current_dim]);
+      out_images[i][n].SubsetFrom(images[n], DIYBoundsToVTKM(subset_bounds[i]));
     }
-
-    assert(subset_bounds[0].min[current_dim] == image_bounds.min[current_dim]);
-    assert(subset_bounds[group_size-1].max[current_dim] == image_bounds.max[current_dim]);
   }
 
-  std::vector<ImageType> out_images(group_size);
-  for(int i = 0; i < group_size; ++i)
-  {
-    out_images[i].SubsetFrom(image, DIYBoundsToVTKM(subset_bounds[i]));
-  } //for
-
   for(int i = 0; i < group_size; ++i)
   {
       if(proxy.out_link().target(i).gid == proxy.gid())
       {
-        image.Swap(out_images[i]);
+        for(int n = 0; n < num_images; ++n)
+        {
+          images[n].Swap(out_images[i][n]);
+        }
       }
       else
       {
@@ -121,7 +212,7 @@ void reduce_images(void *b,
       }
   } //for
 
-} // reduce images
+} // reduce image batch
 
 RadixKCompositor::RadixKCompositor()
 {
@@ -173,6 +264,51 @@ RadixKCompositor::CompositeImpl(vtkhdiy::mpi::communicator &diy_comm, ImageType
     }
 }
 
+template<typename ImageType>
+void
+RadixKCompositor::CompositeBatchImpl(vtkhdiy::mpi::communicator &diy_comm,
+                                     std::vector<ImageType> &images)
+{
+    if(images.size() == 0)
+    {
+      return;
+    }
+    // all images in the batch share the block decomposition. The
+    // pixel ranges are computed per image, so sizes may differ
+    vtkhdiy::DiscreteBounds global_bounds = VTKMBoundsToDIY(images[0].m_orig_bounds);
+
+    // tells diy to use one thread
+    const int num_threads = 1;
+    const int num_blocks = diy_comm.size();
+    const int magic_k = 8;
+
+    vtkhdiy::Master master(diy_comm, num_threads);
+
+    // create an assigner with one block per rank
+    vtkhdiy::ContiguousAssigner assigner(num_blocks, num_blocks);
+    AddImageBatchBlock<ImageType> create(master, images);
+    const int num_dims = 2;
+    vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> decomposer(num_dims, global_bounds, num_blocks);
+    decomposer.decompose(diy_comm.rank(), assigner, create);
+    vtkhdiy::RegularSwapPartners partners(decomposer,
+                                      magic_k,
+                                      false); // false == distance halving
+    vtkhdiy::reduce(master,
+                assigner,
+                partners,
+                reduce_image_batch<ImageType>);
+
+    vtkhdiy::all_to_all(master,
+                    assigner,
+                    CollectImageBatch<ImageType>(decomposer),
+                    magic_k);
+
+    if(diy_comm.rank() == 0)
+    {
+      master.prof.output(m_timing_log);
+    }
+}
+
 void
 RadixKCompositor::CompositeSurface(vtkhdiy::mpi::communicator &diy_comm, Image &image)
 {
@@ -185,6 +321,20 @@ RadixKCompositor::CompositeSurface(vtkhdiy::mpi::communicator &diy_comm, Payload
   CompositeImpl(diy_comm, image);
 }
 
+void
+RadixKCompositor::CompositeSurface(vtkhdiy::mpi::communicator &diy_comm,
+                                   std::vector<Image> &images)
+{
+  CompositeBatchImpl(diy_comm, images);
+}
+
+void
+RadixKCompositor::CompositeSurface(vtkhdiy::mpi::communicator &diy_comm,
+                                   std::vector<PayloadImage> &images)
+{
+  CompositeBatchImpl(diy_comm, images);
+}
+
 std::string
 RadixKCompositor::GetTimingString()
 {
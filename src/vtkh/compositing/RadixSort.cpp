@@ -0,0 +1,371 @@
+#include "RadixSort.hpp"
+
+#include <algorithm>
+
+#ifdef VTKH_USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+// below this size the threading overhead dominates
+const int RADIX_MIN_PARALLEL = 1 << 16;
+const int RADIX_BUCKETS = 256;
+
+int num_sort_threads(const int size)
+{
+#ifdef VTKH_USE_OPENMP
+  if(size >= RADIX_MIN_PARALLEL)
+  {
+    return omp_get_max_threads();
+  }
+#endif
+  (void) size;
+  return 1;
+}
+
+inline int radix_byte(const unsigned int *pixel_keys,
+                      const unsigned long long *depth_keys,
+                      const int i,
+                      const int pass)
+{
+  // depth bytes first, the pixel id is the most significant part
+  if(pass < 8)
+  {
+    return static_cast<int>((depth_keys[i] >> (8 * pass)) & 0xff);
+  }
+  return static_cast<int>((pixel_keys[i] >> (8 * (pass - 8))) & 0xff);
+}
+
+int significant_bits(unsigned long long value)
+{
+  int bits = 0;
+  while(value != 0)
+  {
+    value >>= 1;
+    bits++;
+  }
+  return bits;
+}
+
+// turns per thread bucket counts into scatter offsets. Bucket major,
+// thread minor so the scatter is stable
+void bucket_offsets(std::vector<int> &offsets, const int team, const int buckets)
+{
+  int running = 0;
+  for(int b = 0; b < buckets; ++b)
+  {
+    for(int t = 0; t < team; ++t)
+    {
+      const int count = offsets[t * buckets + b];
+      offsets[t * buckets + b] = running;
+      running += count;
+    }
+  }
+}
+
+// LSD radix sort of packed keys with 11 bit digits
+void sort_packed(std::vector<unsigned long long> &keys,
+                 std::vector<int> &index,
+                 const int key_bits)
+{
+  const int digit_bits = 11;
+  const int buckets = 1 << digit_bits;
+  const int size = static_cast<int>(keys.size());
+  const int num_passes = (key_bits + digit_bits - 1) / digit_bits;
+
+  std::vector<unsigned long long> keys_tmp(size);
+  std::vector<int> index_tmp(size);
+  unsigned long long *keys_in = &keys[0];
+  int *index_in = &index[0];
+  unsigned long long *keys_out = &keys_tmp[0];
+  int *index_out = &index_tmp[0];
+
+  const int num_threads = num_sort_threads(size);
+  std::vector<int> offsets(num_threads * buckets);
+
+  for(int pass = 0; pass < num_passes; ++pass)
+  {
+    const int shift = pass * digit_bits;
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+#ifdef VTKH_USE_OPENMP
+      // the team can be smaller than requested
+      const int tid = omp_get_thread_num();
+      const int team = omp_get_num_threads();
+#else
+      const int tid = 0;
+      const int team = 1;
+#endif
+      const int chunk = (size + team - 1) / team;
+      const int begin = std::min(size, tid * chunk);
+      const int end = std::min(size, begin + chunk);
+      int *counts = &offsets[tid * buckets];
+
+      std::fill(counts, counts + buckets, 0);
+      for(int i = begin; i < end; ++i)
+      {
+        counts[(keys_in[i] >> shift) & (buckets - 1)]++;
+      }
+
+#ifdef VTKH_USE_OPENMP
+      #pragma omp barrier
+      #pragma omp single
+#endif
+      bucket_offsets(offsets, team, buckets);
+
+      for(int i = begin; i < end; ++i)
+      {
+        const unsigned long long key = keys_in[i];
+        const int dest = counts[(key >> shift) & (buckets - 1)]++;
+        keys_out[dest] = key;
+        index_out[dest] = index_in[i];
+      }
+    }
+
+    std::swap(keys_in, keys_out);
+    std::swap(index_in, index_out);
+  }
+
+  if(keys_in != &keys[0])
+  {
+    keys.swap(keys_tmp);
+    index.swap(index_tmp);
+  }
+}
+
+} // namespace detail
+
+void
+RadixSort::SortByKey(std::vector<unsigned int> &pixel_keys,
+                     std::vector<unsigned long long> &depth_keys,
+                     std::vector<int> &index)
+{
+  const int size = static_cast<int>(pixel_keys.size());
+  if(size < 2)
+  {
+    return;
+  }
+
+  //
+  // find the range of the keys
+  //
+  unsigned int min_pixel = pixel_keys[0];
+  unsigned int max_pixel = pixel_keys[0];
+  unsigned long long min_depth = depth_keys[0];
+  unsigned long long max_depth = depth_keys[0];
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for reduction(min:min_pixel,min_depth) reduction(max:max_pixel,max_depth) if(size >= detail::RADIX_MIN_PARALLEL)
+#endif
+  for(int i = 0; i < size; ++i)
+  {
+    min_pixel = std::min(min_pixel, pixel_keys[i]);
+    max_pixel = std::max(max_pixel, pixel_keys[i]);
+    min_depth = std::min(min_depth, depth_keys[i]);
+    max_depth = std::max(max_depth, depth_keys[i]);
+  }
+
+  const int pixel_bits = detail::significant_bits(max_pixel - min_pixel);
+  const int depth_bits = detail::significant_bits(max_depth - min_depth);
+
+  if(pixel_bits + depth_bits == 0)
+  {
+    return;
+  }
+
+  if(pixel_bits + depth_bits <= 64)
+  {
+    //
+    // common case: both keys relative to their minimum fit in one
+    // 64 bit key (e.g. float depths or unused depths)
+    //
+    std::vector<unsigned long long> keys(size);
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel for if(size >= detail::RADIX_MIN_PARALLEL)
+#endif
+    for(int i = 0; i < size; ++i)
+    {
+      const unsigned long long pixel = pixel_keys[i] - min_pixel;
+      const unsigned long long depth = depth_keys[i] - min_depth;
+      keys[i] = depth_bits == 64 ? depth : (pixel << depth_bits) | depth;
+    }
+
+    detail::sort_packed(keys, index, pixel_bits + depth_bits);
+
+    const unsigned long long depth_mask =
+      depth_bits == 64 ? ~0ull : (1ull << depth_bits) - 1ull;
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel for if(size >= detail::RADIX_MIN_PARALLEL)
+#endif
+    for(int i = 0; i < size; ++i)
+    {
+      const unsigned long long pixel = depth_bits == 64 ? 0ull : keys[i] >> depth_bits;
+      pixel_keys[i] = static_cast<unsigned int>(pixel) + min_pixel;
+      depth_keys[i] = (keys[i] & depth_mask) + min_depth;
+    }
+    return;
+  }
+
+  //
+  // wide keys: sort by the depth bytes first and then by the
+  // pixel bytes, skipping bytes that are the same in every key
+  //
+  std::vector<int> passes;
+  for(int p = 0; p < 8; ++p)
+  {
+    if(8 * p < depth_bits) passes.push_back(p);
+  }
+  for(int p = 0; p < 4; ++p)
+  {
+    if(8 * p < pixel_bits) passes.push_back(8 + p);
+  }
+
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for if(size >= detail::RADIX_MIN_PARALLEL)
+#endif
+  for(int i = 0; i < size; ++i)
+  {
+    pixel_keys[i] -= min_pixel;
+    depth_keys[i] -= min_depth;
+  }
+
+  std::vector<unsigned int> pixel_tmp(size);
+  std::vector<unsigned long long> depth_tmp(size);
+  std::vector<int> index_tmp(size);
+
+  unsigned int *pixel_in = &pixel_keys[0];
+  unsigned long long *depth_in = &depth_keys[0];
+  int *index_in = &index[0];
+  unsigned int *pixel_out = &pixel_tmp[0];
+  unsigned long long *depth_out = &depth_tmp[0];
+  int *index_out = &index_tmp[0];
+
+  const int num_threads = detail::num_sort_threads(size);
+  std::vector<int> offsets(num_threads * detail::RADIX_BUCKETS);
+
+  for(size_t p = 0; p < passes.size(); ++p)
+  {
+    const int pass = passes[p];
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel num_threads(num_threads)
+#endif
+    {
+#ifdef VTKH_USE_OPENMP
+      // the team can be smaller than requested
+      const int tid = omp_get_thread_num();
+      const int team = omp_get_num_threads();
+#else
+      const int tid = 0;
+      const int team = 1;
+#endif
+      const int chunk = (size + team - 1) / team;
+      const int begin = std::min(size, tid * chunk);
+      const int end = std::min(size, begin + chunk);
+      int *counts = &offsets[tid * detail::RADIX_BUCKETS];
+
+      std::fill(counts, counts + detail::RADIX_BUCKETS, 0);
+      for(int i = begin; i < end; ++i)
+      {
+        counts[detail::radix_byte(pixel_in, depth_in, i, pass)]++;
+      }
+
+#ifdef VTKH_USE_OPENMP
+      #pragma omp barrier
+      #pragma omp single
+#endif
+      detail::bucket_offsets(offsets, team, detail::RADIX_BUCKETS);
+
+      for(int i = begin; i < end; ++i)
+      {
+        const int dest = counts[detail::radix_byte(pixel_in, depth_in, i, pass)]++;
+        pixel_out[dest] = pixel_in[i];
+        depth_out[dest] = depth_in[i];
+        index_out[dest] = index_in[i];
+      }
+    }
+
+    std::swap(pixel_in, pixel_out);
+    std::swap(depth_in, depth_out);
+    std::swap(index_in, index_out);
+  }
+
+  // an odd number of passes leaves the result in the scratch buffers
+  if(pixel_in != &pixel_keys[0])
+  {
+    pixel_keys.swap(pixel_tmp);
+    depth_keys.swap(depth_tmp);
+    index.swap(index_tmp);
+  }
+
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for if(size >= detail::RADIX_MIN_PARALLEL)
+#endif
+  for(int i = 0; i < size; ++i)
+  {
+    pixel_keys[i] += min_pixel;
+    depth_keys[i] += min_depth;
+  }
+}
+
+int
+RadixSort::ExclusiveScan(const std::vector<unsigned char> &flags,
+                         std::vector<int> &offsets)
+{
+  const int size = static_cast<int>(flags.size());
+  offsets.resize(size);
+  const int num_threads = detail::num_sort_threads(size);
+  std::vector<int> sums(num_threads + 1, 0);
+  int total = 0;
+
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel num_threads(num_threads)
+#endif
+  {
+#ifdef VTKH_USE_OPENMP
+    const int tid = omp_get_thread_num();
+    const int team = omp_get_num_threads();
+#else
+    const int tid = 0;
+    const int team = 1;
+#endif
+    const int chunk = (size + team - 1) / team;
+    const int begin = std::min(size, tid * chunk);
+    const int end = std::min(size, begin + chunk);
+
+    int sum = 0;
+    for(int i = begin; i < end; ++i)
+    {
+      sum += flags[i];
+    }
+    sums[tid + 1] = sum;
+
+#ifdef VTKH_USE_OPENMP
+    #pragma omp barrier
+    #pragma omp single
+#endif
+    {
+      for(int t = 0; t < team; ++t)
+      {
+        sums[t + 1] += sums[t];
+      }
+      total = sums[team];
+    }
+
+    int running = sums[tid];
+    for(int i = begin; i < end; ++i)
+    {
+      offsets[i] = running;
+      running += flags[i];
+    }
+  }
+
+  return total;
+}
+
+} // namespace vtkh
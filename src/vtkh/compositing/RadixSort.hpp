@@ -0,0 +1,60 @@
+#ifndef VTKH_RADIX_SORT_HPP
+#define VTKH_RADIX_SORT_HPP
+
+#include <cstring>
+#include <vector>
+#include <vtkh/vtkh_exports.h>
+
+namespace vtkh
+{
+
+//
+// Parallel primitives for the partial compositor. Keys are kept as
+// structure of arrays: a 32 bit pixel key, a 64 bit depth key and the
+// index of the partial they belong to.
+//
+// The sort is a stable, multi-threaded LSD radix sort. Keys are taken
+// relative to their minimum, so only the bits that vary are sorted. When
+// pixel and depth fit in 64 bits together (float depths or unused depths)
+// they are packed into one key and sorted with 11 bit digits, otherwise
+// the depth bytes and then the pixel bytes are sorted separately.
+//
+class VTKH_API RadixSort
+{
+public:
+  // maps signed integers / floats to unsigned keys with the same order
+  static unsigned int PixelKey(const int pixel_id)
+  {
+    return static_cast<unsigned int>(pixel_id) ^ 0x80000000u;
+  }
+
+  static unsigned long long DepthKey(const float depth)
+  {
+    unsigned int bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    return bits;
+  }
+
+  static unsigned long long DepthKey(const double depth)
+  {
+    unsigned long long bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    bits = (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+    return bits;
+  }
+
+  // sorts by (pixel key, depth key). The three arrays are permuted
+  // together, so index holds the original position of each key
+  static void SortByKey(std::vector<unsigned int> &pixel_keys,
+                        std::vector<unsigned long long> &depth_keys,
+                        std::vector<int> &index);
+
+  // writes the exclusive prefix sum of flags to offsets and
+  // returns the total
+  static int ExclusiveScan(const std::vector<unsigned char> &flags,
+                           std::vector<int> &offsets);
+};
+
+} // namespace vtkh
+#endif
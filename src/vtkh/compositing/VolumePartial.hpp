@@ -43,6 +43,7 @@
 #define rover_volume_block_h
 
 #include <limits>
+#include <vector>
 namespace vtkh {
 
 template<typename FloatType>
@@ -118,5 +119,40 @@ struct VolumePartial
 
 };
 
+//
+// Structure of arrays form of float volume partials, as produced by the
+// renderers. Colors hold the premultiplied rgba of each partial.
+//
+struct VolumePartialArrays
+{
+  std::vector<int>   m_pixel_ids;
+  std::vector<float> m_depths;
+  std::vector<float> m_colors;
+
+  int size() const
+  {
+    return static_cast<int>(m_pixel_ids.size());
+  }
+
+  void resize(const int size)
+  {
+    m_pixel_ids.resize(size);
+    m_depths.resize(size);
+    m_colors.resize(size * 4);
+  }
+
+  VolumePartial<float> get(const int index) const
+  {
+    VolumePartial<float> partial;
+    partial.m_pixel_id = m_pixel_ids[index];
+    partial.m_depth = m_depths[index];
+    partial.m_pixel[0] = m_colors[index * 4 + 0];
+    partial.m_pixel[1] = m_colors[index * 4 + 1];
+    partial.m_pixel[2] = m_colors[index * 4 + 2];
+    partial.m_alpha = m_colors[index * 4 + 3];
+    return partial;
+  }
+};
+
 } // namespace
 #endif
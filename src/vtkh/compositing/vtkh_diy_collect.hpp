@@ -64,5 +64,74 @@ struct CollectImages
   } // operator
 };
 
+//
+// Same as CollectImages, but every block carries a batch of
+// independent images that travel to the collection rank together
+//
+template<typename ImageType>
+struct CollectImageBatch
+{
+  const vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> &m_decomposer;
+
+  CollectImageBatch(const vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> &decomposer)
+    : m_decomposer(decomposer)
+  {}
+
+  void operator()(void *b, const vtkhdiy::ReduceProxy &proxy) const
+  {
+    ImageBatchBlock<ImageType> *block = reinterpret_cast<ImageBatchBlock<ImageType>*>(b);
+    std::vector<ImageType> &images = block->m_images;
+    const int num_images = static_cast<int>(images.size());
+
+    const int collection_rank = 0;
+    if(proxy.in_link().size() == 0)
+    {
+      if(proxy.gid() != collection_rank)
+      {
+        int dest_gid = collection_rank;
+        vtkhdiy::BlockID dest = proxy.out_link().target(dest_gid);
+
+        proxy.enqueue(dest, images);
+        for(int i = 0; i < num_images; ++i)
+        {
+          images[i].Clear();
+        }
+      }
+    } // if
+    else if(proxy.gid() == collection_rank)
+    {
+      std::vector<ImageType> final_images(num_images);
+      for(int i = 0; i < num_images; ++i)
+      {
+        final_images[i].InitOriginal(images[i]);
+        images[i].SubsetTo(final_images[i]);
+      }
+
+      for(int i = 0; i < proxy.in_link().size(); ++i)
+      {
+        int gid = proxy.in_link().target(i).gid;
+
+        if(gid == collection_rank)
+        {
+          continue;
+        }
+        std::vector<ImageType> incoming;
+        proxy.dequeue(gid, incoming);
+        assert(incoming.size() == images.size());
+        for(int n = 0; n < num_images; ++n)
+        {
+          incoming[n].SubsetTo(final_images[n]);
+        }
+      } // for
+
+      for(int i = 0; i < num_images; ++i)
+      {
+        images[i].Swap(final_images[i]);
+      }
+    } // else
+
+  } // operator
+};
+
 } // namespace vtkh
 #endif
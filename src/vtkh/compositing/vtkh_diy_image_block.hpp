@@ -2,6 +2,7 @@
 #define VTKH_DIY_IMAGE_BLOCK_HPP
 
 #include <vtkh/compositing/Image.hpp>
+#include <vtkh/compositing/ImageCompression.hpp>
 #include <vtkh/compositing/PayloadImage.hpp>
 #include <diy/master.hpp>
 
@@ -18,6 +19,16 @@ struct ImageBlock
   }
 };
 
+template<typename ImageType>
+struct ImageBatchBlock
+{
+  std::vector<ImageType> &m_images;
+  ImageBatchBlock(std::vector<ImageType> &images)
+    : m_images(images)
+  {
+  }
+};
+
 struct MultiImageBlock
 {
   std::vector<Image> &m_images;
@@ -54,6 +65,31 @@ struct AddImageBlock
   }
 };
 
+template<typename ImageType>
+struct AddImageBatchBlock
+{
+  std::vector<ImageType> &m_images;
+  const vtkhdiy::Master  &m_master;
+
+  AddImageBatchBlock(vtkhdiy::Master &master, std::vector<ImageType> &images)
+    : m_images(images),
+      m_master(master)
+  {
+  }
+  template<typename BoundsType, typename LinkType>
+  void operator()(int gid,
+                  const BoundsType &,  // local_bounds
+                  const BoundsType &,  // local_with_ghost_bounds
+                  const BoundsType &,  // domain_bounds
+                  const LinkType &link) const
+  {
+    ImageBatchBlock<ImageType> *block = new ImageBatchBlock<ImageType>(m_images);
+    LinkType *linked = new LinkType(link);
+    vtkhdiy::Master& master = const_cast<vtkhdiy::Master&>(m_master);
+    master.add(gid, block, linked);
+  }
+};
+
 struct AddMultiImageBlock
 {
   std::vector<Image> &m_images;
@@ -81,6 +117,63 @@ struct AddMultiImageBlock
   }
 };
 
+//
+// pixel and depth buffers go over the wire run length encoded
+// whenever that is smaller than the raw buffers
+//
+inline void save_pixels(vtkhdiy::BinaryBuffer &bb,
+                        const std::vector<unsigned char> &pixels,
+                        const std::vector<float> &depths,
+                        const int pixel_bytes)
+{
+  const int num_pixels = static_cast<int>(depths.size());
+  const long long int raw_bytes = static_cast<long long int>(pixels.size()) +
+                                  static_cast<long long int>(depths.size() * sizeof(float));
+  std::vector<unsigned char> encoded;
+  bool compressed = ImageCompression::Encode(pixels.data(),
+                                             depths.data(),
+                                             num_pixels,
+                                             pixel_bytes,
+                                             encoded);
+  vtkhdiy::save(bb, compressed);
+  if(compressed)
+  {
+    vtkhdiy::save(bb, num_pixels);
+    vtkhdiy::save(bb, encoded);
+    ImageCompression::AddCounts(raw_bytes, static_cast<long long int>(encoded.size()));
+  }
+  else
+  {
+    vtkhdiy::save(bb, pixels);
+    vtkhdiy::save(bb, depths);
+    ImageCompression::AddCounts(raw_bytes, raw_bytes);
+  }
+}
+
+inline void load_pixels(vtkhdiy::BinaryBuffer &bb,
+                        std::vector<unsigned char> &pixels,
+                        std::vector<float> &depths,
+                        const int pixel_bytes)
+{
+  bool compressed;
+  vtkhdiy::load(bb, compressed);
+  if(compressed)
+  {
+    int num_pixels;
+    std::vector<unsigned char> encoded;
+    vtkhdiy::load(bb, num_pixels);
+    vtkhdiy::load(bb, encoded);
+    pixels.resize(static_cast<size_t>(num_pixels) * pixel_bytes);
+    depths.resize(num_pixels);
+    ImageCompression::Decode(encoded, num_pixels, pixel_bytes, pixels.data(), depths.data());
+  }
+  else
+  {
+    vtkhdiy::load(bb, pixels);
+    vtkhdiy::load(bb, depths);
+  }
+}
+
 } //namespace  vtkh
 
 namespace vtkhdiy {
@@ -104,9 +197,8 @@ struct Serialization<vtkh::PayloadImage>
     vtkhdiy::save(bb, image.m_bounds.Y.Max);
     vtkhdiy::save(bb, image.m_bounds.Z.Max);
 
-    vtkhdiy::save(bb, image.m_payloads);
     vtkhdiy::save(bb, image.m_payload_bytes);
-    vtkhdiy::save(bb, image.m_depths);
+    vtkh::save_pixels(bb, image.m_payloads, image.m_depths, image.m_payload_bytes);
     vtkhdiy::save(bb, image.m_orig_rank);
   }
 
@@ -126,9 +218,8 @@ struct Serialization<vtkh::PayloadImage>
     vtkhdiy::load(bb, image.m_bounds.Y.Max);
     vtkhdiy::load(bb, image.m_bounds.Z.Max);
 
-    vtkhdiy::load(bb, image.m_payloads);
     vtkhdiy::load(bb, image.m_payload_bytes);
-    vtkhdiy::load(bb, image.m_depths);
+    vtkh::load_pixels(bb, image.m_payloads, image.m_depths, image.m_payload_bytes);
     vtkhdiy::load(bb, image.m_orig_rank);
   }
 };
@@ -152,8 +243,7 @@ struct Serialization<vtkh::Image>
     vtkhdiy::save(bb, image.m_bounds.Y.Max);
     vtkhdiy::save(bb, image.m_bounds.Z.Max);
 
-    vtkhdiy::save(bb, image.m_pixels);
-    vtkhdiy::save(bb, image.m_depths);
+    vtkh::save_pixels(bb, image.m_pixels, image.m_depths, 4);
     vtkhdiy::save(bb, image.m_orig_rank);
     vtkhdiy::save(bb, image.m_composite_order);
   }
@@ -174,8 +264,7 @@ struct Serialization<vtkh::Image>
     vtkhdiy::load(bb, image.m_bounds.Y.Max);
     vtkhdiy::load(bb, image.m_bounds.Z.Max);
 
-    vtkhdiy::load(bb, image.m_pixels);
-    vtkhdiy::load(bb, image.m_depths);
+    vtkh::load_pixels(bb, image.m_pixels, image.m_depths, 4);
     vtkhdiy::load(bb, image.m_orig_rank);
     vtkhdiy::load(bb, image.m_composite_order);
   }
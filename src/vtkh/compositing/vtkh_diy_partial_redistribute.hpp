@@ -47,21 +47,113 @@
 #include <diy/decomposition.hpp>
 #include <diy/master.hpp>
 #include <diy/reduce-operations.hpp>
+#include <algorithm>
 #include <map>
+#include <vector>
 
 namespace vtkh {
+
+//
+// Contiguous pixel ranges owned by each rank: rank r owns the pixels
+// in [splits[r], splits[r+1]). Ranks can own an empty range.
+//
+inline int split_owner(const std::vector<int> &splits, const int pixel)
+{
+  // number of interior splits <= pixel
+  auto begin = splits.begin() + 1;
+  auto end = splits.end() - 1;
+  return static_cast<int>(std::upper_bound(begin, end, pixel) - begin);
+}
+
+// the pixel range divided evenly
+inline std::vector<int> even_splits(const int min_pixel,
+                                    const int max_pixel,
+                                    const int num_ranks)
+{
+  const long long range = static_cast<long long>(max_pixel) - min_pixel + 1;
+  std::vector<int> splits(num_ranks + 1);
+  for(int r = 0; r <= num_ranks; ++r)
+  {
+    splits[r] = static_cast<int>(min_pixel + range * r / num_ranks);
+  }
+  return splits;
+}
+
+//
+// Pixel ranges with roughly the same number of partials per rank. The
+// partials are counted in spans of pixels and the counts are summed over
+// all ranks, so every rank computes the same splits.
+//
+template<typename PartialType>
+std::vector<int> balanced_splits(const std::vector<PartialType> &partials,
+                                 MPI_Comm comm,
+                                 const int min_pixel,
+                                 const int max_pixel)
+{
+  int num_ranks;
+  MPI_Comm_size(comm, &num_ranks);
+
+  const long long range = static_cast<long long>(max_pixel) - min_pixel + 1;
+  const int num_bins =
+    static_cast<int>(std::min(range, static_cast<long long>(std::max(1024, 64 * num_ranks))));
+
+  std::vector<long long> counts(num_bins, 0);
+  const int size = static_cast<int>(partials.size());
+  for(int i = 0; i < size; ++i)
+  {
+    const long long offset = partials[i].m_pixel_id - min_pixel;
+    counts[offset * num_bins / range]++;
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &counts[0], num_bins, MPI_LONG_LONG, MPI_SUM, comm);
+
+  long long total = 0;
+  for(int b = 0; b < num_bins; ++b)
+  {
+    total += counts[b];
+  }
+
+  if(total == 0)
+  {
+    return even_splits(min_pixel, max_pixel, num_ranks);
+  }
+
+  // first pixel of bin b
+  auto bin_start = [&](const long long b)
+  {
+    return static_cast<int>(min_pixel + (range * b + num_bins - 1) / num_bins);
+  };
+
+  std::vector<int> splits(num_ranks + 1, max_pixel + 1);
+  splits[0] = min_pixel;
+  int rank = 1;
+  long long sum = 0;
+  for(int b = 0; b < num_bins && rank < num_ranks; ++b)
+  {
+    sum += counts[b];
+    // close every rank whose share is covered by bins [0, b]
+    while(rank < num_ranks && sum * num_ranks >= total * rank)
+    {
+      splits[rank] = bin_start(b + 1);
+      rank++;
+    }
+  }
+
+  return splits;
+}
+
 //
 // Redistributes partial composites to the ranks that owns
-// that sectoon of the image. Currently, the domain is decomposed
-// in 1-D from min_pixel to max_pixel.
+// that section of the image. The image is decomposed in 1-D
+// by the pixel splits.
 //
 template<typename BlockType>
 struct Redistribute
 {
-  const vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> &m_decomposer;
+  const std::vector<int> &m_splits;
 
-  Redistribute(const vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> &decomposer)
-    : m_decomposer(decomposer)
+  Redistribute(const std::vector<int> &splits)
+    : m_splits(splits)
   {}
 
   void operator()(void *v_block, const vtkhdiy::ReduceProxy &proxy) const
@@ -78,9 +170,7 @@ struct Redistribute
 
       for(int i = 0; i < size; ++i)
       {
-        vtkhdiy::Point<int,DIY_MAX_DIM> point;
-        point[0] = block->m_partials[i].m_pixel_id;
-        int dest_gid = m_decomposer.point_to_gid(point);
+        int dest_gid = split_owner(m_splits, block->m_partials[i].m_pixel_id);
         vtkhdiy::BlockID dest = proxy.out_link().target(dest_gid);
         outgoing[dest].push_back(block->m_partials[i]);
       } //for
@@ -104,16 +194,12 @@ struct Redistribute
         int gid = proxy.in_link().target(i).gid;
         std::vector<typename BlockType::PartialType> incoming_partials;
         proxy.dequeue(gid, incoming_partials);
-        const int incoming_size = incoming_partials.size();
-        // TODO: make this a std::copy
-        for(int j = 0; j < incoming_size; ++j)
-        {
-          block->m_partials.push_back(incoming_partials[j]);
-        }
+        block->m_partials.insert(block->m_partials.end(),
+                                 incoming_partials.begin(),
+                                 incoming_partials.end());
       } // for
 
     } // else
-    MPI_Barrier(MPI_COMM_WORLD); //HACK
   } // operator
 };
 
@@ -121,15 +207,14 @@ struct Redistribute
 template<typename AddBlockType>
 void redistribute_detail(std::vector<typename AddBlockType::PartialType> &partials,
                          MPI_Comm comm,
-                         const int &domain_min_pixel,
-                         const int &domain_max_pixel)
+                         const std::vector<int> &splits)
 {
   typedef typename AddBlockType::Block Block;
 
   vtkhdiy::mpi::communicator world(comm);
   vtkhdiy::DiscreteBounds global_bounds;
-  global_bounds.min[0] = domain_min_pixel;
-  global_bounds.max[0] = domain_max_pixel;
+  global_bounds.min[0] = splits.front();
+  global_bounds.max[0] = splits.back() - 1;
 
   // tells diy to use all availible threads
   const int num_threads = 1;
@@ -142,10 +227,12 @@ void redistribute_detail(std::vector<typename AddBlockType::PartialType> &partia
   vtkhdiy::ContiguousAssigner assigner(num_blocks, num_blocks);
   AddBlockType create(master, partials);
 
+  // the decomposer only creates the blocks, partials
+  // are routed by the splits
   const int dims = 1;
   vtkhdiy::RegularDecomposer<vtkhdiy::DiscreteBounds> decomposer(dims, global_bounds, num_blocks);
   decomposer.decompose(world.rank(), assigner, create);
-  vtkhdiy::all_to_all(master, assigner, Redistribute<Block>(decomposer), magic_k);
+  vtkhdiy::all_to_all(master, assigner, Redistribute<Block>(splits), magic_k);
 }
 
 //
@@ -154,81 +241,68 @@ void redistribute_detail(std::vector<typename AddBlockType::PartialType> &partia
 template<typename T>
 void redistribute(std::vector<T> &partials,
                   MPI_Comm comm,
-                  const int &domain_min_pixel,
-                  const int &domain_max_pixel);
+                  const std::vector<int> &splits);
 // ----------------------------- VolumePartial Specialization------------------------------------------
 template<>
 void redistribute<VolumePartial<float>>(std::vector<VolumePartial<float>> &partials,
-                                                                           MPI_Comm comm,
-                                                                           const int &domain_min_pixel,
-                                                                           const int &domain_max_pixel)
+                                        MPI_Comm comm,
+                                        const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<VolumeBlock<float>>>(partials,
                                                     comm,
-                                                    domain_min_pixel,
-                                                    domain_max_pixel);
+                                                    splits);
 }
 
 template<>
 void redistribute<VolumePartial<double>>(std::vector<VolumePartial<double>> &partials,
-                                                                             MPI_Comm comm,
-                                                                             const int &domain_min_pixel,
-                                                                             const int &domain_max_pixel)
+                                         MPI_Comm comm,
+                                         const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<VolumeBlock<double>>>(partials,
                                                      comm,
-                                                     domain_min_pixel,
-                                                     domain_max_pixel);
+                                                     splits);
 }
 
 // ----------------------------- AbsorpPartial Specialization------------------------------------------
 template<>
 void redistribute<AbsorptionPartial<double>>(std::vector<AbsorptionPartial<double>> &partials,
                                              MPI_Comm comm,
-                                             const int &domain_min_pixel,
-                                             const int &domain_max_pixel)
+                                             const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<AbsorptionBlock<double>>>(partials,
                                                          comm,
-                                                         domain_min_pixel,
-                                                         domain_max_pixel);
+                                                         splits);
 }
 
 template<>
 void redistribute<AbsorptionPartial<float>>(std::vector<AbsorptionPartial<float>> &partials,
                                             MPI_Comm comm,
-                                            const int &domain_min_pixel,
-                                            const int &domain_max_pixel)
+                                            const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<AbsorptionBlock<float>>>(partials,
                                                         comm,
-                                                        domain_min_pixel,
-                                                        domain_max_pixel);
+                                                        splits);
 }
 
 // ----------------------------- EmissPartial Specialization------------------------------------------
 template<>
 void redistribute<EmissionPartial<double>>(std::vector<EmissionPartial<double>> &partials,
-                                          MPI_Comm comm,
-                                          const int &domain_min_pixel,
-                                          const int &domain_max_pixel)
+                                           MPI_Comm comm,
+                                           const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<EmissionBlock<double>>>(partials,
                                                        comm,
-                                                       domain_min_pixel,
-                                                       domain_max_pixel);
+                                                       splits);
 }
 
 template<>
 void redistribute<EmissionPartial<float>>(std::vector<EmissionPartial<float>> &partials,
-                                            MPI_Comm comm,
-                                            const int &domain_min_pixel,
-                                            const int &domain_max_pixel)
+                                          MPI_Comm comm,
+                                          const std::vector<int> &splits)
 {
   redistribute_detail<AddBlock<EmissionBlock<float>>>(partials,
                                                       comm,
-                                                      domain_min_pixel,
-                                                      domain_max_pixel);
+                                                      splits);
 }
 
 } //namespace rover
@@ -1,14 +1,155 @@
 #include <vtkh/filters/Filter.hpp>
 #include <vtkh/Error.hpp>
 #include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 namespace vtkh
 {
 
+namespace detail
+{
+
+// set in pool threads so nested filters do not wait on their own pool
+thread_local bool in_domain_worker = false;
+
+bool domain_parallel_env()
+{
+  const char *parallel = std::getenv("VTKH_DOMAIN_PARALLEL");
+  return parallel != nullptr && std::atoi(parallel) != 0;
+}
+
+vtkm::Id coalesce_cells_env()
+{
+  const char *cells = std::getenv("VTKH_COALESCE_CELLS");
+  if(cells == nullptr)
+  {
+    return 0;
+  }
+  const long long count = std::atoll(cells);
+  return count > 0 ? static_cast<vtkm::Id>(count) : 0;
+}
+
+int domain_thread_count()
+{
+  if(const char *threads = std::getenv("VTKH_DOMAIN_THREADS"))
+  {
+    const int count = std::atoi(threads);
+    if(count > 0)
+    {
+      return count;
+    }
+  }
+  const int count = static_cast<int>(std::thread::hardware_concurrency());
+  return count > 0 ? count : 1;
+}
+
+class DomainThreadPool
+{
+public:
+  static DomainThreadPool &GetInstance()
+  {
+    static DomainThreadPool pool(domain_thread_count());
+    return pool;
+  }
+
+  ~DomainThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> guard(m_lock);
+      m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for(auto &thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  int GetNumThreads() const
+  {
+    return static_cast<int>(m_threads.size());
+  }
+
+  // blocks until all tasks ran. Tasks must not throw
+  void Run(std::vector<std::function<void()>> &tasks)
+  {
+    std::unique_lock<std::mutex> lock(m_lock);
+    size_t remaining = tasks.size();
+    for(auto &task : tasks)
+    {
+      std::function<void()> *work = &task;
+      m_queue.push_back([this, work, &remaining]()
+      {
+        (*work)();
+        std::lock_guard<std::mutex> guard(m_lock);
+        if(--remaining == 0)
+        {
+          m_done_cv.notify_all();
+        }
+      });
+    }
+    m_work_cv.notify_all();
+    m_done_cv.wait(lock, [&remaining]() { return remaining == 0; });
+  }
+
+protected:
+  DomainThreadPool(const int num_threads)
+    : m_stop(false)
+  {
+    for(int i = 0; i < num_threads; ++i)
+    {
+      m_threads.push_back(std::thread(&DomainThreadPool::Work, this));
+    }
+  }
+
+  void Work()
+  {
+    // the device tracker is per thread. Each task is small, so it gets
+    // one core instead of a share of the device
+    vtkh::ForceSerial();
+    in_domain_worker = true;
+    while(true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_work_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if(m_queue.empty())
+        {
+          return;
+        }
+        task = std::move(m_queue.front());
+        m_queue.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex m_lock;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_done_cv;
+  std::deque<std::function<void()>> m_queue;
+  std::vector<std::thread> m_threads;
+  bool m_stop;
+};
+
+} // namespace detail
+
 Filter::Filter()
 {
   m_input = nullptr;
   m_output = nullptr;
+  m_domain_parallel = detail::domain_parallel_env();
+  m_domain_batch_cells = 100000;
+  m_coalesce_cells = detail::coalesce_cells_env();
 }
 
 Filter::~Filter()
@@ -30,6 +171,7 @@ Filter::GetOutput()
 DataSet*
 Filter::Update()
 {
+  VTKH_PROFILE_SCOPE(this->GetName());
   VTKH_DATA_OPEN(this->GetName());
 #ifdef VTKH_ENABLE_LOGGING
   VTKH_DATA_ADD("device", GetCurrentDevice());
@@ -47,9 +189,54 @@ Filter::Update()
     VTKH_DATA_ADD("in_topology", "unstructured");
   }
 #endif
-  PreExecute();
-  DoExecute();
-  PostExecute();
+  // many tiny domains are run as a few large ones and split back after
+  DataSet *input = m_input;
+  DataSet coalesced;
+  bool coalesce = m_coalesce_cells > 0 &&
+                  m_input != nullptr &&
+                  this->SupportsCoalesce();
+  bool added_id_field = false;
+  if(coalesce)
+  {
+    coalesced = m_input->Coalesce(m_coalesce_cells);
+    m_input = &coalesced;
+    // an empty list maps all fields, id field included
+    if(!m_map_fields.empty() &&
+       std::find(m_map_fields.begin(),
+                 m_map_fields.end(),
+                 DataSet::DOMAIN_ID_FIELD) == m_map_fields.end())
+    {
+      m_map_fields.push_back(DataSet::DOMAIN_ID_FIELD);
+      added_id_field = true;
+    }
+  }
+
+  try
+  {
+    PreExecute();
+    DoExecute();
+    PostExecute();
+  }
+  catch(...)
+  {
+    m_input = input;
+    if(added_id_field)
+    {
+      m_map_fields.erase(std::find(m_map_fields.begin(), m_map_fields.end(), DataSet::DOMAIN_ID_FIELD));
+    }
+    throw;
+  }
+
+  if(coalesce)
+  {
+    m_input = input;
+    if(added_id_field)
+    {
+      m_map_fields.erase(std::find(m_map_fields.begin(), m_map_fields.end(), DataSet::DOMAIN_ID_FIELD));
+    }
+    // the same domain list as the plain path, empty domains included
+    *m_output = m_output->Split(input->GetDomainIds());
+  }
 #ifdef VTKH_ENABLE_LOGGING
   long long int out_cells = this->m_output->GetNumberOfCells();
   VTKH_DATA_ADD("output_cells", out_cells);
@@ -82,6 +269,189 @@ Filter::ClearMapFields()
   m_map_fields.clear();
 }
 
+void
+Filter::SetDomainParallel(bool on)
+{
+  m_domain_parallel = on;
+}
+
+bool
+Filter::GetDomainParallel() const
+{
+  return m_domain_parallel;
+}
+
+void
+Filter::SetDomainBatchCells(vtkm::Id cells)
+{
+  m_domain_batch_cells = cells < 1 ? 1 : cells;
+}
+
+void
+Filter::SetCoalesceCells(vtkm::Id cells)
+{
+  m_coalesce_cells = cells < 0 ? 0 : cells;
+}
+
+vtkm::Id
+Filter::GetCoalesceCells() const
+{
+  return m_coalesce_cells;
+}
+
+bool
+Filter::SupportsCoalesce() const
+{
+  return false;
+}
+
+void
+Filter::ForEachDomain(const std::function<void(const int)> &work)
+{
+  const int num_domains = this->m_input->GetNumberOfDomains();
+
+  // device memory would have to come back to the host
+  bool parallel = m_domain_parallel &&
+                  !detail::in_domain_worker &&
+                  num_domains > 1 &&
+                  !IsCUDAEnabled();
+  int num_threads = 1;
+  if(parallel)
+  {
+    num_threads = detail::DomainThreadPool::GetInstance().GetNumThreads();
+    parallel = num_threads > 1;
+  }
+
+  if(!parallel)
+  {
+    for(int i = 0; i < num_domains; ++i)
+    {
+      work(i);
+    }
+    return;
+  }
+
+  std::vector<vtkm::Id> cells(num_domains);
+  std::vector<int> large;
+  vtkm::Id small_cells = 0;
+  for(int i = 0; i < num_domains; ++i)
+  {
+    cells[i] = this->m_input->GetDomain(i).GetCellSet().GetNumberOfCells();
+    if(cells[i] >= m_domain_batch_cells)
+    {
+      large.push_back(i);
+    }
+    else
+    {
+      small_cells += cells[i];
+    }
+  }
+
+  // a few batches per thread so uneven domains still balance
+  vtkm::Id batch_cells = small_cells / (4 * num_threads);
+  batch_cells = std::max(vtkm::Id(1), std::min(batch_cells, m_domain_batch_cells));
+
+  std::vector<std::exception_ptr> errors(num_domains);
+  std::vector<std::vector<int>> batches;
+  std::vector<int> batch;
+  vtkm::Id batch_size = 0;
+  for(int i = 0; i < num_domains; ++i)
+  {
+    if(cells[i] >= m_domain_batch_cells)
+    {
+      continue;
+    }
+    batch.push_back(i);
+    batch_size += cells[i];
+    if(batch_size >= batch_cells)
+    {
+      batches.push_back(batch);
+      batch.clear();
+      batch_size = 0;
+    }
+  }
+  if(!batch.empty())
+  {
+    batches.push_back(batch);
+  }
+
+  std::vector<std::function<void()>> tasks;
+  for(size_t b = 0; b < batches.size(); ++b)
+  {
+    const std::vector<int> *domains = &batches[b];
+    tasks.push_back([&work, &errors, domains]()
+    {
+      for(const int i : *domains)
+      {
+        try
+        {
+          work(i);
+        }
+        catch(...)
+        {
+          errors[i] = std::current_exception();
+        }
+      }
+    });
+  }
+
+  if(tasks.size() > 1)
+  {
+    detail::DomainThreadPool::GetInstance().Run(tasks);
+  }
+  else if(tasks.size() == 1)
+  {
+    tasks[0]();
+  }
+
+  for(const int i : large)
+  {
+    try
+    {
+      work(i);
+    }
+    catch(...)
+    {
+      errors[i] = std::current_exception();
+    }
+  }
+
+  for(int i = 0; i < num_domains; ++i)
+  {
+    if(errors[i] != nullptr)
+    {
+      std::rethrow_exception(errors[i]);
+    }
+  }
+}
+
+void
+Filter::MapDomains(const std::function<bool(vtkm::cont::DataSet &in,
+                                            vtkm::cont::DataSet &out)> &work,
+                   DataSet &output)
+{
+  const int num_domains = this->m_input->GetNumberOfDomains();
+  std::vector<vtkm::cont::DataSet> results(num_domains);
+  std::vector<vtkm::Id> domain_ids(num_domains);
+  // not vector<bool>, which packs bits that threads would share
+  std::vector<char> valid(num_domains, 0);
+
+  ForEachDomain([&](const int i)
+  {
+    vtkm::cont::DataSet dom;
+    this->m_input->GetDomain(i, dom, domain_ids[i]);
+    valid[i] = work(dom, results[i]) ? 1 : 0;
+  });
+
+  for(int i = 0; i < num_domains; ++i)
+  {
+    if(valid[i] != 0)
+    {
+      output.AddDomain(results[i], domain_ids[i]);
+    }
+  }
+}
+
 void
 Filter::PreExecute()
 {
@@ -6,6 +6,8 @@
 #include <vtkh/DataSet.hpp>
 #include <vtkm/filter/FieldSelection.h>
 
+#include <functional>
+
 namespace vtkh
 {
 
@@ -24,10 +26,28 @@ public:
 
   void ClearMapFields();
 
+  // Filters that support it run their independent per domain work on a
+  // pool of host threads (VTKH_DOMAIN_THREADS, default one per core).
+  // Off by default, VTKH_DOMAIN_PARALLEL=1 turns it on for all filters
+  void SetDomainParallel(bool on);
+  bool GetDomainParallel() const;
+  // small domains are batched into tasks of up to this many cells.
+  // Domains this big or bigger run one after the other with the full
+  // device. Default 100k
+  void SetDomainBatchCells(vtkm::Id cells);
+  // filters that work cell by cell first pack runs of domains smaller
+  // than this into explicit domains of up to this many cells (see
+  // DataSet::Coalesce) and split their output back to the input domains.
+  // 0, the default, turns it off. VTKH_COALESCE_CELLS sets the default
+  void SetCoalesceCells(vtkm::Id cells);
+  vtkm::Id GetCoalesceCells() const;
+
 protected:
   virtual void DoExecute() = 0;
   virtual void PreExecute();
   virtual void PostExecute();
+  // true for filters whose output domains can be split back by cell
+  virtual bool SupportsCoalesce() const;
 
   //@{
   /// These are all temporary methods added to gets things building again
@@ -46,6 +66,21 @@ protected:
   void PropagateMetadata();
 
   void CheckForRequiredField(const std::string &field_name);
+
+  // calls work(i) for every input domain. With domain parallel on, small
+  // domains run concurrently on the pool, each thread using the serial
+  // device. work must only touch state owned by domain i, and must not
+  // use MPI. The first exception, in domain order, is rethrown
+  void ForEachDomain(const std::function<void(const int)> &work);
+  // runs work on every input domain and adds the domains it returns true
+  // for to the output, with the input domain ids and in the input order
+  void MapDomains(const std::function<bool(vtkm::cont::DataSet &in,
+                                           vtkm::cont::DataSet &out)> &work,
+                  DataSet &output);
+
+  bool m_domain_parallel;
+  vtkm::Id m_domain_batch_cells;
+  vtkm::Id m_coalesce_cells;
 };
 
 } //namespace vtkh
@@ -382,18 +382,11 @@ void GhostStripper::DoExecute()
 {
   this->m_output = new DataSet();
 
-  const int num_domains = this->m_input->GetNumberOfDomains();
-
-  for(int i = 0; i < num_domains; ++i)
+  MapDomains([this](vtkm::cont::DataSet &dom, vtkm::cont::DataSet &out)
   {
-
-    vtkm::Id domain_id;
-    vtkm::cont::DataSet dom;
-    this->m_input->GetDomain(i, dom, domain_id);
-
     if(!dom.HasField(m_field_name))
     {
-      continue;
+      return false;
     }
 
     vtkm::cont::Field field = dom.GetField(m_field_name);
@@ -403,8 +396,8 @@ void GhostStripper::DoExecute()
        ghost_range.Max <= m_max_value)
     {
       // nothing to do here
-      m_output->AddDomain(dom, domain_id);
-      continue;
+      out = dom;
+      return true;
     }
 
 
@@ -432,18 +425,16 @@ void GhostStripper::DoExecute()
           vtkm::Id3 sample(1, 1, 1);
 
           vtkh::vtkmExtractStructured extract;
-          auto output = extract.Run(dom,
-                                    range,
-                                    sample,
-                                    this->GetFieldSelection());
-
-          m_output->AddDomain(output, domain_id);
+          out = extract.Run(dom,
+                            range,
+                            sample,
+                            this->GetFieldSelection());
           VTKH_DATA_CLOSE();
         }
         else
         {
           // All zones are valid so just pass through
-          m_output->AddDomain(dom, domain_id);
+          out = dom;
         }
       }
 
@@ -459,12 +450,10 @@ void GhostStripper::DoExecute()
                                   this->GetFieldSelection());
 
       vtkh::vtkmCleanGrid cleaner;
-      auto clout = cleaner.Run(tout, this->GetFieldSelection());
-      m_output->AddDomain(clout, domain_id);
+      out = cleaner.Run(tout, this->GetFieldSelection());
     }
-
-  }
-
+    return true;
+  }, *m_output);
 }
 
 std::string
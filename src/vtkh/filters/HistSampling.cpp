@@ -135,7 +135,8 @@ calculate_pdf(const vtkm::Int32 tot_points,
 
 HistSampling::HistSampling()
   : m_sample_percent(0.1f),
-    m_num_bins(128)
+    m_num_bins(128),
+    m_has_histogram(false)
 {
 
 }
@@ -165,6 +166,13 @@ HistSampling::SetNumBins(const int num_bins)
   m_num_bins = num_bins;
 }
 
+void
+HistSampling::SetHistogram(const Histogram::HistogramResult &histogram)
+{
+  m_histogram = histogram;
+  m_has_histogram = true;
+}
+
 void
 HistSampling::SetField(const std::string &field_name)
 {
@@ -272,9 +280,17 @@ void HistSampling::DoExecute()
 
   const int num_domains = input->GetNumberOfDomains();
 
-  Histogram histogrammer;
-  histogrammer.SetNumBins(m_num_bins);
-  Histogram::HistogramResult histogram = histogrammer.Run(*input,m_field_name);
+  Histogram::HistogramResult histogram;
+  if(m_has_histogram && !has_ghosts)
+  {
+    histogram = m_histogram;
+  }
+  else
+  {
+    Histogram histogrammer;
+    histogrammer.SetNumBins(m_num_bins);
+    histogram = histogrammer.Run(*input,m_field_name);
+  }
   //histogram.Print(std::cout);
 
   vtkm::Id numberOfBins = histogram.m_bins.GetNumberOfValues();
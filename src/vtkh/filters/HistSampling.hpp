@@ -4,6 +4,7 @@
 #include <vtkh/vtkh_exports.h>
 #include <vtkh/vtkh.hpp>
 #include <vtkh/filters/Filter.hpp>
+#include <vtkh/filters/Histogram.hpp>
 #include <vtkh/DataSet.hpp>
 
 namespace vtkh
@@ -20,6 +21,10 @@ public:
   void SetGhostField(const std::string &field_name);
   std::string GetField() const;
   void SetSamplingPercent(const float percent);
+  // use a global histogram of the field that was already computed
+  // (e.g. by a multi-field Histogram::Run) instead of building one.
+  // Ignored when a ghost field is set, since ghosts change the counts
+  void SetHistogram(const Histogram::HistogramResult &histogram);
 protected:
   void PreExecute() override;
   void PostExecute() override;
@@ -29,6 +34,8 @@ protected:
   std::string m_ghost_field;
   float m_sample_percent;
   int m_num_bins;
+  Histogram::HistogramResult m_histogram;
+  bool m_has_histogram;
 };
 
 } //namespace vtkh
@@ -1,9 +1,11 @@
 #include <vtkh/filters/Histogram.hpp>
 #include <vtkh/Error.hpp>
 #include <vtkh/Logger.hpp>
-#include <vtkh/utils/vtkm_array_utils.hpp>
 
-#include <vtkm/worklet/FieldHistogram.h>
+#include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
 
 #ifdef VTKH_PARALLEL
 #include <mpi.h>
@@ -15,28 +17,114 @@ namespace vtkh
 namespace detail
 {
 
-struct HistoFunctor
+// writes the global bin (field_offset + bin) of each value
+// to keys[value_offset + index]
+class BinKeys : public vtkm::worklet::WorkletMapField
 {
+protected:
+  vtkm::Float64 m_min;
+  vtkm::Float64 m_inv_delta;
+  vtkm::Id m_num_bins;
+  vtkm::Id m_field_offset;
+  vtkm::Id m_value_offset;
+public:
+  VTKM_CONT
+  BinKeys(const vtkm::Range &range,
+          const vtkm::Id num_bins,
+          const vtkm::Id field_offset,
+          const vtkm::Id value_offset)
+    : m_min(range.Min),
+      m_inv_delta(range.Length() > 0. ? num_bins / range.Length() : 0.),
+      m_num_bins(num_bins),
+      m_field_offset(field_offset),
+      m_value_offset(value_offset)
+  {}
+
+  typedef void ControlSignature(FieldIn, WholeArrayInOut);
+  typedef void ExecutionSignature(WorkIndex, _1, _2);
+
+  template<typename T, typename KeyPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &index, const T &value, KeyPortal &keys) const
+  {
+    vtkm::Id bin = static_cast<vtkm::Id>((static_cast<vtkm::Float64>(value) - m_min) * m_inv_delta);
+    bin = bin < 0 ? 0 : bin;
+    bin = bin >= m_num_bins ? m_num_bins - 1 : bin;
+    keys.Set(m_value_offset + index, m_field_offset + bin);
+  }
+};
 
+struct BinKeysFunctor
+{
+  vtkm::cont::ArrayHandle<vtkm::Id> m_keys;
   vtkm::Range m_range;
   vtkm::Id m_num_bins;
-
-  vtkm::cont::ArrayHandle<vtkm::Id> m_bins;
-  vtkm::Float64 m_bin_delta;
+  vtkm::Id m_field_offset;
+  vtkm::Id m_value_offset;
 
   template<typename T, typename S>
   void operator()(const vtkm::cont::ArrayHandle<T,S> &array)
   {
-    T bin_delta;
-    T min_range = static_cast<T>(m_range.Min);
-    T max_range = static_cast<T>(m_range.Max);
-
-    vtkm::worklet::FieldHistogram worklet;
-    worklet.Run(array,m_num_bins,min_range,max_range,bin_delta,m_bins);
-    m_bin_delta = static_cast<vtkm::Float64>(bin_delta);
+    BinKeys worklet(m_range, m_num_bins, m_field_offset, m_value_offset);
+    vtkm::worklet::DispatcherMapField<BinKeys>(worklet).Invoke(array, m_keys);
   }
 };
 
+// bins all fields of a domain: the keys of every field go into one array,
+// which is sorted once and counted against all field bins at once
+void bin_domain(const vtkm::cont::DataSet &dom,
+                const std::vector<std::string> &field_names,
+                const std::vector<vtkm::Range> &ranges,
+                const vtkm::Id num_bins,
+                std::vector<vtkm::Id> &bins)
+{
+  const size_t num_fields = field_names.size();
+  vtkm::Id num_values = 0;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    if(dom.HasField(field_names[f]))
+    {
+      num_values += dom.GetField(field_names[f]).GetNumberOfValues();
+    }
+  }
+
+  if(num_values == 0)
+  {
+    return;
+  }
+
+  BinKeysFunctor func;
+  func.m_keys.Allocate(num_values);
+  func.m_num_bins = num_bins;
+  func.m_value_offset = 0;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    if(!dom.HasField(field_names[f])) continue;
+
+    const vtkm::cont::Field &field = dom.GetField(field_names[f]);
+    func.m_range = ranges[f];
+    func.m_field_offset = static_cast<vtkm::Id>(f) * num_bins;
+    field.GetData().ResetTypes(vtkm::TypeListFieldScalar()).CastAndCall(func);
+    func.m_value_offset += field.GetNumberOfValues();
+  }
+
+  const vtkm::Id total_bins = static_cast<vtkm::Id>(num_fields) * num_bins;
+  vtkm::cont::Algorithm::Sort(func.m_keys);
+  vtkm::cont::ArrayHandle<vtkm::Id> upper;
+  vtkm::cont::Algorithm::UpperBounds(func.m_keys,
+                                     vtkm::cont::ArrayHandleCounting<vtkm::Id>(0, 1, total_bins),
+                                     upper);
+
+  auto portal = upper.ReadPortal();
+  vtkm::Id prev = 0;
+  for(vtkm::Id i = 0; i < total_bins; ++i)
+  {
+    const vtkm::Id count = portal.Get(i);
+    bins[i] += count - prev;
+    prev = count;
+  }
+}
+
 template<typename T>
 void reduce(T *array, int size);
 
@@ -129,69 +217,86 @@ Histogram::merge_histograms(std::vector<Histogram::HistogramResult> &histograms)
 
 Histogram::HistogramResult
 Histogram::Run(vtkh::DataSet &data_set, const std::string &field_name)
+{
+  std::vector<std::string> field_names(1, field_name);
+  std::map<std::string, HistogramResult> res = Run(data_set, field_names);
+  return res[field_name];
+}
+
+std::map<std::string, Histogram::HistogramResult>
+Histogram::Run(vtkh::DataSet &data_set, const std::vector<std::string> &field_names)
 {
   VTKH_DATA_OPEN("histogram");
   VTKH_DATA_ADD("device", GetCurrentDevice());
   VTKH_DATA_ADD("bins", m_num_bins);
+  VTKH_DATA_ADD("fields", field_names.size());
   VTKH_DATA_ADD("input_cells", data_set.GetNumberOfCells());
   VTKH_DATA_ADD("input_domains", data_set.GetNumberOfDomains());
 
-  if(!data_set.GetGlobalNumberOfDomains())
-  {
-    throw Error("Histogram: can't run since there is no data!");
-  }
+  // existence, components and ranges of all fields in one query. A
+  // given range skips the range reduction
+  DataSet::GlobalMetadata meta =
+    data_set.GetGlobalMetadata(field_names, !m_range.IsNonEmpty());
 
-  if(!data_set.GlobalFieldExists(field_name))
+  if(!meta.m_num_domains)
   {
-    throw Error("Histogram: field '"+field_name+"' does not exist");
+    throw Error("Histogram: can't run since there is no data!");
   }
 
-
-  vtkm::Range range;
-  if(m_range.IsNonEmpty())
+  const size_t num_fields = field_names.size();
+  std::vector<vtkm::Range> ranges(num_fields);
+  for(size_t f = 0; f < num_fields; ++f)
   {
-    range = m_range;
-  }
-  else
-  {
-    vtkm::cont::ArrayHandle<vtkm::Range> ranges = data_set.GetGlobalRange(field_name);
+    const std::string &field_name = field_names[f];
+    const DataSet::FieldMetadata &field = meta.m_fields[field_name];
+    if(!field.m_exists)
+    {
+      throw Error("Histogram: field '"+field_name+"' does not exist");
+    }
 
-    if(ranges.GetNumberOfValues() != 1)
+    if(m_range.IsNonEmpty())
+    {
+      ranges[f] = m_range;
+    }
+    else
     {
-      throw Error("Histogram: field must have a single component");
+      if(field.m_num_components != 1)
+      {
+        throw Error("Histogram: field must have a single component");
+      }
+      ranges[f] = field.m_ranges[0];
     }
-    range = ranges.ReadPortal().Get(0);
   }
 
   const int num_domains = data_set.GetNumberOfDomains();
-  std::vector<HistogramResult> local_histograms;
+  std::vector<vtkm::Id> bins(num_fields * m_num_bins, 0);
   for(int i = 0; i < num_domains; ++i)
   {
-    vtkm::Id domain_id;
-    vtkm::cont::DataSet dom;
-    data_set.GetDomain(i, dom, domain_id);
-    if(!dom.HasField(field_name)) continue;
-
-    vtkm::cont::Field field = dom.GetField(field_name);
-
-    detail::HistoFunctor hist;
-    hist.m_num_bins = m_num_bins;
-    hist.m_range = range;
-
-    field.GetData().ResetTypes(vtkm::TypeListFieldScalar()).CastAndCall(hist);
-    HistogramResult dom_hist;
-    dom_hist.m_bins = hist.m_bins;
-    dom_hist.m_bin_delta = hist.m_bin_delta;
-    dom_hist.m_range = range;
-    local_histograms.push_back(dom_hist);
+    detail::bin_domain(data_set.GetDomain(i), field_names, ranges, m_num_bins, bins);
   }
 
-  HistogramResult local = merge_histograms(local_histograms);
-  vtkm::Id * bin_ptr = GetVTKMPointer(local.m_bins);
-  detail::reduce(bin_ptr, m_num_bins);
+  // one collective for the bins of every field
+  if(!bins.empty())
+  {
+    detail::reduce(&bins[0], static_cast<int>(bins.size()));
+  }
+
+  std::map<std::string, HistogramResult> res;
+  for(size_t f = 0; f < num_fields; ++f)
+  {
+    HistogramResult &hist = res[field_names[f]];
+    hist.m_range = ranges[f];
+    hist.m_bin_delta = ranges[f].Length() / double(m_num_bins);
+    hist.m_bins.Allocate(m_num_bins);
+    auto portal = hist.m_bins.WritePortal();
+    for(int n = 0; n < m_num_bins; ++n)
+    {
+      portal.Set(n, bins[f * m_num_bins + n]);
+    }
+  }
 
   VTKH_DATA_CLOSE();
-  return local;
+  return res;
 }
 
 void
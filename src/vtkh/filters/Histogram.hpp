@@ -6,6 +6,7 @@
 #include <vtkh/filters/Filter.hpp>
 #include <vtkh/DataSet.hpp>
 
+#include <map>
 #include <vector>
 #include <iostream>
 
@@ -29,6 +30,13 @@ public:
 
   HistogramResult Run(vtkh::DataSet &data_set, const std::string &field_name);
 
+  // Histograms of several scalar fields at once. The global ranges come
+  // from one metadata query, each domain is binned for all fields in a
+  // single pass and the bins of every field are reduced in one collective.
+  // A range set with SetRange is used for all fields.
+  std::map<std::string, HistogramResult>
+  Run(vtkh::DataSet &data_set, const std::vector<std::string> &field_names);
+
   HistogramResult
   merge_histograms(std::vector<Histogram::HistogramResult> &histograms);
 
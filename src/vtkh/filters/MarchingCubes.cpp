@@ -129,6 +129,8 @@ void MarchingCubes::DoExecute()
   if(valid_field && is_cell_assoc)
   {
     Recenter recenter;
+    recenter.SetDomainParallel(m_domain_parallel);
+    recenter.SetDomainBatchCells(m_domain_batch_cells);
     recenter.SetInput(m_input);
     recenter.SetField(m_field_name);
     recenter.SetResultAssoc(vtkm::cont::Field::Association::POINTS);
@@ -137,29 +139,21 @@ void MarchingCubes::DoExecute()
     delete_input = true;
   }
 
-  const int num_domains = this->m_input->GetNumberOfDomains();
-  for(int i = 0; i < num_domains; ++i)
+  MapDomains([this](vtkm::cont::DataSet &dom, vtkm::cont::DataSet &out)
   {
-
-    vtkm::Id domain_id;
-    vtkm::cont::DataSet dom;
-    this->m_input->GetDomain(i, dom, domain_id);
-
     if(!dom.HasField(m_field_name))
     {
-      continue;
+      return false;
     }
 
     vtkh::vtkmMarchingCubes marcher;
 
-    auto dataset = marcher.Run(dom,
-                               m_field_name,
-                               m_iso_values,
-                               this->GetFieldSelection());
-
-    temp_data.AddDomain(dataset, domain_id);
-
-  }
+    out = marcher.Run(dom,
+                      m_field_name,
+                      m_iso_values,
+                      this->GetFieldSelection());
+    return true;
+  }, temp_data);
 
   CleanGrid cleaner;
   cleaner.SetInput(&temp_data);
@@ -173,6 +167,12 @@ void MarchingCubes::DoExecute()
   }
 }
 
+bool
+MarchingCubes::SupportsCoalesce() const
+{
+  return true;
+}
+
 std::string
 MarchingCubes::GetName() const
 {
@@ -28,6 +28,7 @@ public:
 protected:
   void PreExecute() override;
   void PostExecute() override;
+  bool SupportsCoalesce() const override;
   void DoExecute() override;
 
   std::vector<double> m_iso_values;
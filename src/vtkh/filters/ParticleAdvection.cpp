@@ -5,6 +5,11 @@
 #include <vtkm/worklet/ParticleAdvection.h>
 #include <vtkm/io/writer/VTKDataSetWriter.h>
 #include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayCopy.h>
+#include <vtkm/cont/ArrayHandleConstant.h>
+#include <vtkm/cont/CellSetExplicit.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/WorkletMapField.h>
 
 #include <vtkh/vtkh.hpp>
 #include <vtkh/Error.hpp>
@@ -32,6 +37,184 @@
 namespace vtkh
 {
 
+namespace detail
+{
+
+// out[out_offset + i] = in[i] + value_offset
+class AppendIndices : public vtkm::worklet::WorkletMapField
+{
+protected:
+  vtkm::Id m_value_offset;
+  vtkm::Id m_out_offset;
+public:
+  VTKM_CONT
+  AppendIndices(const vtkm::Id value_offset, const vtkm::Id out_offset)
+    : m_value_offset(value_offset),
+      m_out_offset(out_offset)
+  {
+  }
+
+  typedef void ControlSignature(FieldIn, WholeArrayInOut);
+  typedef void ExecutionSignature(WorkIndex, _1, _2);
+
+  template<typename PortalType>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &index, const vtkm::Id &value, PortalType &out) const
+  {
+    out.Set(m_out_offset + index, value + m_value_offset);
+  }
+}; //class AppendIndices
+
+// per point step, time and seed id of each polyline. The particle
+// holds the state at the last point of the line
+class TraceFields : public vtkm::worklet::WorkletMapField
+{
+protected:
+  vtkm::Id m_point_offset;
+  vtkm::FloatDefault m_step_size;
+public:
+  VTKM_CONT
+  TraceFields(const vtkm::Id point_offset, const vtkm::FloatDefault step_size)
+    : m_point_offset(point_offset),
+      m_step_size(step_size)
+  {
+  }
+
+  typedef void ControlSignature(FieldIn,
+                                WholeArrayIn,
+                                WholeArrayIn,
+                                WholeArrayInOut,
+                                WholeArrayInOut,
+                                WholeArrayInOut);
+  typedef void ExecutionSignature(WorkIndex, _1, _2, _3, _4, _5, _6);
+
+  template<typename OffsetsPortal,
+           typename ConnPortal,
+           typename StepPortal,
+           typename TimePortal,
+           typename IdPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &cell,
+                  const vtkm::Particle &particle,
+                  const OffsetsPortal &offsets,
+                  const ConnPortal &conn,
+                  StepPortal &steps,
+                  TimePortal &times,
+                  IdPortal &ids) const
+  {
+    const vtkm::Id start = offsets.Get(cell);
+    const vtkm::Id num_points = offsets.Get(cell + 1) - start;
+    for(vtkm::Id i = 0; i < num_points; ++i)
+    {
+      const vtkm::Id back = num_points - 1 - i;
+      const vtkm::Id point = m_point_offset + conn.Get(start + i);
+      steps.Set(point, particle.NumSteps - back);
+      times.Set(point, particle.Time - static_cast<vtkm::FloatDefault>(back) * m_step_size);
+      ids.Set(point, particle.ID);
+    }
+  }
+}; //class TraceFields
+
+// Appends the polylines of all results into a single explicit
+// cell set with device side copies. Returns false if there are no lines.
+bool MergeStreamlines(const std::vector<vtkm::worklet::StreamlineResult> &traces,
+                      const bool add_fields,
+                      const vtkm::FloatDefault step_size,
+                      vtkm::cont::DataSet &output)
+{
+  const vtkm::TopologyElementTagCell cell_tag;
+  const vtkm::TopologyElementTagPoint point_tag;
+
+  vtkm::Id num_points = 0;
+  vtkm::Id num_cells = 0;
+  vtkm::Id num_conn = 0;
+  for(const auto &trace : traces)
+  {
+    num_points += trace.Positions.GetNumberOfValues();
+    num_cells += trace.PolyLines.GetNumberOfCells();
+    num_conn += trace.PolyLines.GetConnectivityArray(cell_tag, point_tag).GetNumberOfValues();
+  }
+
+  if(num_cells == 0)
+  {
+    return false;
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Vec3f> positions;
+  vtkm::cont::ArrayHandle<vtkm::Id> connectivity;
+  vtkm::cont::ArrayHandle<vtkm::Id> offsets;
+  positions.Allocate(num_points);
+  connectivity.Allocate(num_conn);
+  offsets.Allocate(num_cells + 1);
+
+  vtkm::cont::ArrayHandle<vtkm::Id> steps;
+  vtkm::cont::ArrayHandle<vtkm::FloatDefault> times;
+  vtkm::cont::ArrayHandle<vtkm::Id> seed_ids;
+  if(add_fields)
+  {
+    steps.Allocate(num_points);
+    times.Allocate(num_points);
+    seed_ids.Allocate(num_points);
+  }
+
+  vtkm::Id point_offset = 0;
+  vtkm::Id cell_offset = 0;
+  vtkm::Id conn_offset = 0;
+  for(const auto &trace : traces)
+  {
+    const vtkm::Id trace_cells = trace.PolyLines.GetNumberOfCells();
+    if(trace_cells == 0)
+    {
+      continue;
+    }
+
+    const auto &trace_conn = trace.PolyLines.GetConnectivityArray(cell_tag, point_tag);
+    const auto &trace_offsets = trace.PolyLines.GetOffsetsArray(cell_tag, point_tag);
+    const vtkm::Id trace_points = trace.Positions.GetNumberOfValues();
+
+    vtkm::cont::Algorithm::CopySubRange(trace.Positions, 0, trace_points, positions, point_offset);
+
+    vtkm::worklet::DispatcherMapField<AppendIndices>(AppendIndices(point_offset, conn_offset))
+      .Invoke(trace_conn, connectivity);
+    // the last offset of this trace is overwritten with the same
+    // value by the first offset of the next one
+    vtkm::worklet::DispatcherMapField<AppendIndices>(AppendIndices(conn_offset, cell_offset))
+      .Invoke(trace_offsets, offsets);
+
+    if(add_fields)
+    {
+      vtkm::worklet::DispatcherMapField<TraceFields>(TraceFields(point_offset, step_size))
+        .Invoke(trace.Particles, trace_offsets, trace_conn, steps, times, seed_ids);
+    }
+
+    point_offset += trace_points;
+    cell_offset += trace_cells;
+    conn_offset += trace_conn.GetNumberOfValues();
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::UInt8> shapes;
+  vtkm::cont::Algorithm::Copy(
+    vtkm::cont::ArrayHandleConstant<vtkm::UInt8>(vtkm::CELL_SHAPE_POLY_LINE, num_cells),
+    shapes);
+
+  vtkm::cont::CellSetExplicit<> poly_lines;
+  poly_lines.Fill(num_points, shapes, connectivity, offsets);
+
+  output = vtkm::cont::DataSet();
+  output.AddCoordinateSystem(vtkm::cont::CoordinateSystem("coordinates", positions));
+  output.SetCellSet(poly_lines);
+
+  if(add_fields)
+  {
+    output.AddField(vtkm::cont::Field("steps", vtkm::cont::Field::Association::POINTS, steps));
+    output.AddField(vtkm::cont::Field("time", vtkm::cont::Field::Association::POINTS, times));
+    output.AddField(vtkm::cont::Field("seed_id", vtkm::cont::Field::Association::POINTS, seed_ids));
+  }
+  return true;
+}
+
+} // namespace detail
+
 static inline float
 rand01()
 {
@@ -50,8 +233,11 @@ ParticleAdvection::ParticleAdvection()
       stepSize(.01),
       maxSteps(1000),
       useThreadedVersion(false),
+      numWorkerThreads(1),
+      blockSelectionPolicy(ParticleBlockQueues::ROUND_ROBIN),
       gatherTraces(true),
       dumpOutputFiles(false),
+      addTraceFields(true),
       sleepUS(100),
       batchSize(-1),
       statsFile("particleAdvection.stats.txt")
@@ -104,9 +290,10 @@ void ParticleAdvection::TraceMultiThread(std::vector<ResultT> &traces)
   vtkh::ParticleAdvectionTask<ResultT> *task = new vtkh::ParticleAdvectionTask<ResultT>(mpiComm, boundsMap, this);
 
   //task->Init(active, totalNumSeeds, sleepUS, batchSize);
-  task->Init(active, totalNumSeeds, sleepUS);
+  task->Init(active, totalNumSeeds, sleepUS, numWorkerThreads);
   task->Go();
   task->results.Get(traces);
+  delete task;
 #endif
 }
 
@@ -171,6 +358,11 @@ void ParticleAdvection::TraceSingleThread(std::vector<ResultT> &traces)
   ParticleMessenger communicator(mpiComm, boundsMap);
   communicator.RegisterMessages(2, std::min(64, numRanks-1), 128, std::min(64, numRanks-1));
 
+  activeBlocks.Clear();
+  activeBlocks.SetPolicy(blockSelectionPolicy);
+  activeBlocks.Insert(active);
+  active.clear();
+
   int N = 0;
   while (true)
   {
@@ -192,7 +384,7 @@ void ParticleAdvection::TraceSingleThread(std::vector<ResultT> &traces)
           DBG("--Integrate:  ITA: "<<I<<" "<<T<<" "<<A<<std::endl);
           DBG("                   I= "<<I<<std::endl);
           if (!A.empty())
-              active.insert(active.end(), A.begin(), A.end());
+              activeBlocks.Insert(A);
       }
 
       std::vector<Particle> in;
@@ -201,7 +393,7 @@ void ParticleAdvection::TraceSingleThread(std::vector<ResultT> &traces)
       int numTerm = T.size() + numTermMessages;
 
       if (!in.empty())
-          active.insert(active.end(), in.begin(), in.end());
+          activeBlocks.Insert(in);
       if (!T.empty())
           terminated.insert(terminated.end(), T.begin(), T.end());
 
@@ -214,7 +406,7 @@ void ParticleAdvection::TraceSingleThread(std::vector<ResultT> &traces)
       if (N == totalNumSeeds)
           break;
 
-      if (active.empty())
+      if (activeBlocks.Empty())
       {
           TIMER_START("sleep");
           usleep(sleepUS);
@@ -222,7 +414,7 @@ void ParticleAdvection::TraceSingleThread(std::vector<ResultT> &traces)
           COUNTER_INC("naps", 1);
       }
   }
-  DBG("TIA: "<<terminated.size()<<" "<<inactive.size()<<" "<<active.size()<<std::endl);
+  DBG("TIA: "<<terminated.size()<<" "<<inactive.size()<<" "<<activeBlocks.Size()<<std::endl);
   DBG("RESULTS= "<<traces.size()<<std::endl);
 
   DBG("All done"<<std::endl);
@@ -288,122 +480,25 @@ void ParticleAdvection::DoExecute()
     this->TraceSeeds<vtkm::worklet::StreamlineResult>(particleTraces);
 
     this->m_output = new DataSet();
-    std::cout<<"All done: "<<particleTraces.size()<<std::endl;
 
-    if (!particleTraces.empty() && this->dumpOutputFiles)
+    vtkm::cont::DataSet lines;
+    if (detail::MergeStreamlines(particleTraces, addTraceFields, stepSize, lines))
     {
-        vtkm::Id totalNumPts = 0;
-        for (int i = 0; i < particleTraces.size(); i++)
-          totalNumPts += particleTraces[i].Positions.GetNumberOfValues();
-
-        vtkm::cont::ArrayHandle<vtkm::Vec3f> positions;
-        vtkm::cont::ArrayHandle<vtkm::Id> ids;
-        positions.Allocate(totalNumPts);
-        ids.Allocate(totalNumPts);
-        auto posPortal = positions.WritePortal();
-        auto idPortal = ids.WritePortal();
-
-        vtkm::Id idx = 0;
-        for (int i = 0; i < particleTraces.size(); i++)
-        {
-          auto parPortal = particleTraces[i].Particles.ReadPortal();
-          auto inP = particleTraces[i].Positions.ReadPortal();
-          vtkm::Id numPts = particleTraces[i].Positions.GetNumberOfValues();
-          vtkm::Id pid = 0; //parPortal.Get(i).ID;
-          for (int j = 0; j < numPts; j++, idx++)
-          {
-            posPortal.Set(idx, inP.Get(j));
-            idPortal.Set(idx, pid);
-          }
-        }
-
-        DumpTraces(positions, ids);
-    }
-
-#if 0
-    //Compact all the traces into a single dataset.
-    if (!particleTraces.empty())
-    {
-        //Collapse particle trace data into one set of polylines.
-        vtkm::Id totalNumPts = 0, totalNumCells = 0;
-        std::vector<vtkm::Id> offsets(particleTraces.size(), 0), numLines(particleTraces.size(),0);
-        for (int i = 0; i < particleTraces.size(); i++)
-        {
-            vtkm::Id n = particleTraces[i].Positions.GetNumberOfValues();
-            offsets[i] = n;
-            totalNumPts += n;
-            n = particleTraces[i].PolyLines.GetNumberOfCells();
-            totalNumCells += n;
-            numLines[i] = n;
-
-        }
-
-        //Append all the positions into one array.
-        vtkm::cont::ArrayHandle<vtkm::Vec<double, 3>> positions;
-        positions.Allocate(totalNumPts);
-        auto posPortal = positions.ReadPortal();
-        vtkm::Id idx = 0;
-        for (int i = 0; i < particleTraces.size(); i++)
-        {
-            auto inP = particleTraces[i].Positions.GetPortalConstControl();
-            for (int j = 0; j < offsets[i]; j++, idx++)
-                posPortal.Set(idx, inP.Get(j));
-        }
-
-        //Cell types are all lines...
-        vtkm::cont::ArrayHandle<vtkm::UInt8> cellTypes;
-        cellTypes.Allocate(totalNumCells);
-        vtkm::cont::ArrayHandleConstant<vtkm::UInt8> polyLineShape(vtkm::CELL_SHAPE_LINE, totalNumCells);
-        vtkm::cont::Algorithm::Copy(polyLineShape, cellTypes);
-
-        //Append all the conn and cellCounts.
-        vtkm::cont::ArrayHandle<vtkm::Id> connectivity;
-        vtkm::cont::ArrayHandle<vtkm::IdComponent> cellCounts;
-        connectivity.Allocate(totalNumPts);
-        cellCounts.Allocate(totalNumCells);
-        auto connPortal = connectivity.ReadPortal();
-        auto cntPortal = cellCounts.ReadPortal();
-
-        vtkm::Id offset = 0, connIdx = 0, cntIdx = 0;
-        for (int i = 0; i < particleTraces.size(); i++)
+        this->m_output->AddDomain(lines, rank);
+        if (this->dumpOutputFiles)
         {
-            if (i > 0)
-                offset = offsets[i-1];
-
-            vtkm::Id n = particleTraces[i].PolyLines.GetNumberOfCells();
+            vtkm::cont::ArrayHandle<vtkm::Vec3f> positions;
+            vtkm::cont::ArrayCopy(lines.GetCoordinateSystem().GetData(), positions);
             vtkm::cont::ArrayHandle<vtkm::Id> ids;
-
-            for (vtkm::Id j = 0; j < n; j++)
-            {
-                particleTraces[i].PolyLines.GetIndices(j, ids);
-                vtkm::Id nids = ids.GetNumberOfValues();
-                auto idsPortal = ids.ReadPortal();
-                for (vtkm::Id k = 0; k < nids; k++, connIdx++)
-                    connPortal.Set(connIdx, idsPortal.Get(k)+offset);
-                cntPortal.Set(cntIdx, nids);
-                cntIdx++;
-            }
+            if (addTraceFields)
+                lines.GetField("seed_id").GetData().CopyTo(ids);
+            DumpTraces(positions, ids);
         }
-
-        //Create a single polyLines cell set.
-        vtkm::cont::CellSetExplicit<> polyLines;
-        auto new_offsets = vtkm::cont::ConvertNumIndicesToOffsets(cellCounts);
-        polyLines.Fill(positions.GetNumberOfValues(), cellTypes, connectivity, new_offsets);
-
-        vtkm::cont::DataSet ds;
-        vtkm::cont::CoordinateSystem outputCoords("coordinates", positions);
-        ds.AddCoordinateSystem(outputCoords);
-        ds.SetCellSet(polyLines);
-        this->m_output->AddDomain(ds, rank);
-        if (this->dumpOutputFiles)
-            this->DumpTraces(positions);
     }
-    else
+    else if (this->dumpOutputFiles)
     {
-        if (this->dumpOutputFiles)
-            this->DumpSLOutput(NULL, rank, 0);
+        this->DumpSLOutput(NULL, rank, 0);
     }
-#endif
   }
 }
 
@@ -411,25 +506,7 @@ void ParticleAdvection::DoExecute()
 bool
 ParticleAdvection::GetActiveParticles(std::vector<Particle> &v)
 {
-    v.clear();
-    if (active.empty())
-        return false;
-
-    int workingBlockID = active.front().blockIds[0];
-
-    std::vector<Particle>::iterator listIt = active.begin();
-    while (listIt != active.end())
-    {
-      Particle p = *listIt;
-      if(workingBlockID == p.blockIds[0])
-      {
-        v.push_back(p);
-        listIt = active.erase(listIt);
-      }
-      else
-        listIt++;
-    }
-    return !v.empty();
+    return activeBlocks.Get(v);
 }
 
 std::string
@@ -12,6 +12,7 @@
 #include <vtkh/StatisticsDB.hpp>
 #include <vtkh/filters/Filter.hpp>
 #include <vtkh/filters/Particle.hpp>
+#include <vtkh/filters/ParticleBlockQueues.hpp>
 #include <vtkh/filters/communication/BoundsMap.hpp>
 #include <vtkh/filters/Integrator.hpp>
 #include <vtkh/DataSet.hpp>
@@ -62,6 +63,18 @@ public:
     useThreadedVersion = useThreaded;
   }
 
+  // number of advection threads per rank used by the threaded version
+  void SetNumberOfWorkerThreads(const int &n)
+  {
+    numWorkerThreads = n;
+  }
+
+  // order in which the single threaded version processes blocks
+  void SetBlockSelectionPolicy(ParticleBlockQueues::SelectionPolicy policy)
+  {
+    blockSelectionPolicy = policy;
+  }
+
   void SetGatherTraces(bool gTraces)
   {
     gatherTraces = gTraces;
@@ -72,6 +85,13 @@ public:
     dumpOutputFiles = dumpOutput;
   }
 
+  // add the per point fields "steps", "time" and "seed_id"
+  // to the streamline output
+  void SetAddTraceFields(bool addFields)
+  {
+    addTraceFields = addFields;
+  }
+
   void SetStatsFile(std::string& s) {statsFile = s;}
 
   void SetField(const std::string &field_name) {m_field_name = field_name;}
@@ -121,8 +141,11 @@ protected:
                   bool shrink=true);
 
   bool useThreadedVersion;
+  int numWorkerThreads;
+  ParticleBlockQueues::SelectionPolicy blockSelectionPolicy;
   bool gatherTraces;
   bool dumpOutputFiles;
+  bool addTraceFields;
   int sleepUS;
   int rank, numRanks;
   std::string m_field_name;
@@ -142,6 +165,8 @@ protected:
 
   //seed data
   std::vector<Particle> active, inactive, terminated;
+  // active particles of the single threaded version
+  ParticleBlockQueues activeBlocks;
   bool GetActiveParticles(std::vector<Particle> &v);
 
   void DumpTraces(int ts, const std::vector<vtkm::Vec<double,4>> &particleTraces);
@@ -5,8 +5,15 @@
 #include <vtkh/StatisticsDB.hpp>
 #include <vtkh/utils/ThreadSafeContainer.hpp>
 #include <vtkh/filters/ParticleAdvection.hpp>
+#include <vtkh/filters/ParticleWorkQueue.hpp>
 #include <vtkh/filters/communication/BoundsMap.hpp>
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #ifdef VTKH_ENABLE_LOGGING
 #define DBG(msg) vtkh::Logger::GetInstance("out")->GetStream()<<msg
 #define WDBG(msg) vtkh::Logger::GetInstance("wout")->GetStream()<<msg
@@ -22,9 +29,10 @@ class ParticleAdvectionTask
 {
 public:
     ParticleAdvectionTask(MPI_Comm comm, const vtkh::BoundsMap &bmap, ParticleAdvection *pa) :
-        numWorkerThreads(-1),
+        numWorkerThreads(1),
         done(false),
         begin(false),
+        workerSignal(false),
         communicator(comm, bmap),
         boundsMap(bmap),
         filter(pa),
@@ -33,19 +41,18 @@ public:
         m_Rank = vtkh::GetMPIRank();
         m_NumRanks = vtkh::GetMPISize();
         communicator.RegisterMessages(2, std::min(64, m_NumRanks-1), 128, std::min(64, m_NumRanks-1));
-        ADD_TIMER("worker_sleep");
-        ADD_COUNTER("worker_naps");
     }
     ~ParticleAdvectionTask()
     {
     }
 
-    void Init(const std::vector<Particle> &particles, int N, int _sleepUS)
+    void Init(const std::vector<Particle> &particles, int N, int _sleepUS, int numWorkers)
     {
-        numWorkerThreads = 1;
+        numWorkerThreads = std::max(1, numWorkers);
         TotalNumParticles = N;
         sleepUS = _sleepUS;
-        active.Assign(particles);
+        workQueue.Init(numWorkerThreads);
+        workQueue.Insert(particles);
         inactive.Clear();
         terminated.Clear();
     }
@@ -63,6 +70,7 @@ public:
         stateLock.Lock();
         done = true;
         stateLock.Unlock();
+        workQueue.SetDone();
     }
 
     bool GetBegin()
@@ -84,87 +92,118 @@ public:
     void Go()
     {
         DBG("Go_bm: "<<boundsMap<<std::endl);
-        DBG("actives= "<<active<<std::endl);
-
-#ifdef VTKH_USE_OPENMP
-        #pragma omp parallel sections num_threads(2)
-        {
-            #pragma omp section
-            #pragma omp parallel num_threads(1)
-            {
-                this->Manage();
-            }
+        DBG("actives= "<<workQueue.Size()<<std::endl);
 
-            #pragma omp section
-            #pragma omp parallel num_threads(numWorkerThreads)
-            #pragma omp master
-            {
-                this->Work();
-            }
-        }
-#else
-        workerThreads.push_back(std::thread(ParticleAdvectionTask::Worker, this));
+        // The manager (MPI exchange) runs on the calling thread and
+        // every worker gets its own thread
+        workerStats.clear();
+        workerStats.resize(numWorkerThreads);
+        for (int i = 0; i < numWorkerThreads; i++)
+            workerThreads.push_back(std::thread(ParticleAdvectionTask::Worker, this, i));
         this->Manage();
         for (auto &t : workerThreads)
             t.join();
+        workerThreads.clear();
+
+#ifdef ENABLE_STATISTICS
+        stats.insert(workerStats);
 #endif
     }
 
-#ifndef VTKH_USE_OPENMP
-    static void Worker(ParticleAdvectionTask *t)
+    static void Worker(ParticleAdvectionTask *t, int id)
     {
-      t->Work();
+      t->Work(id);
     }
-#endif
 
-    void Work()
+    void Work(int id)
     {
-      std::vector<ResultT> traces;
+        std::vector<ResultT> traces;
+
+        // every worker keeps its own stats. They are merged into the
+        // global StatisticsDB once the workers are joined
+        const std::string wid = "_w" + std::to_string(id);
+        vtkh::StatisticsDB &wstats = workerStats[id];
+        wstats.AddTimer("advect" + wid);
+        wstats.AddTimer("wait" + wid);
+        wstats.AddCounter("advectSteps" + wid);
+        wstats.AddCounter("particles" + wid);
+        wstats.AddCounter("batches" + wid);
+        wstats.AddCounter("steals" + wid);
+        wstats.AddCounter("waits" + wid);
 
-        while (!CheckDone())
+        std::vector<Particle> particles;
+        bool stolen, waited;
+        wstats.Start("wait" + wid);
+        while (workQueue.Get(id, particles, stolen, waited))
         {
-            std::vector<Particle> particles;
-            if (active.Get(particles))
-            {
-                std::vector<Particle> I, T, A;
+            wstats.Stop("wait" + wid);
+            if (stolen)
+                wstats.Increment("steals" + wid);
+            if (waited)
+                wstats.Increment("waits" + wid);
 
-                DataBlockIntegrator *blk = filter->GetBlock(particles[0].blockIds[0]);
+            std::vector<Particle> I, T, A;
 
-                TIMER_START("advect");
-                WDBG("WORKER: Integrate "<<particles<<" --> "<<std::endl);
-                int n = filter->InternalIntegrate<ResultT>(*blk, particles, I, T, A, traces);
-                TIMER_STOP("advect");
-                COUNTER_INC("advectSteps", n);
-                WDBG("TIA: "<<T<<" "<<I<<" "<<A<<std::endl<<std::endl);
+            const int blockId = particles[0].blockIds[0];
+            DataBlockIntegrator *blk = filter->GetBlock(blockId);
 
-                worker_terminated.Insert(T);
-                worker_active.Insert(A);
-                worker_inactive.Insert(I);
-            }
-            else
-            {
-                TIMER_START("worker_sleep");
-                usleep(sleepUS);
-                TIMER_STOP("worker_sleep");
-                COUNTER_INC("worker_naps", 1);
-            }
+            wstats.Start("advect" + wid);
+            WDBG("WORKER: Integrate "<<particles<<" --> "<<std::endl);
+            int n = filter->InternalIntegrate<ResultT>(*blk, particles, I, T, A, traces);
+            wstats.Stop("advect" + wid);
+            wstats.Increment("advectSteps" + wid, n);
+            wstats.Increment("particles" + wid, particles.size());
+            wstats.Increment("batches" + wid);
+            WDBG("TIA: "<<T<<" "<<I<<" "<<A<<std::endl<<std::endl);
+
+            // particles that are still in this block go straight back
+            // to the workers, everything else is handled by the manager
+            workQueue.Insert(A);
+            workQueue.Release(blockId);
+            worker_terminated.Insert(T);
+            worker_inactive.Insert(I);
+            if (!T.empty() || !I.empty())
+                NotifyManager();
+
+            wstats.Start("wait" + wid);
         }
+        wstats.Stop("wait" + wid);
         WDBG("WORKER is DONE"<<std::endl);
         results.Insert(traces);
     }
 
+    // wake the manager when workers produced particles it has to handle
+    void NotifyManager()
+    {
+        {
+            std::lock_guard<std::mutex> guard(workerSignalLock);
+            workerSignal = true;
+        }
+        workerSignalCV.notify_one();
+    }
+
+    // Wait until workers produce output or sleepUS elapsed. The
+    // timeout is needed to keep polling for MPI messages
+    void WaitForWorkers()
+    {
+        std::unique_lock<std::mutex> lock(workerSignalLock);
+        workerSignalCV.wait_for(lock,
+                                std::chrono::microseconds(sleepUS),
+                                [this] { return workerSignal; });
+        workerSignal = false;
+    }
+
     void Manage()
     {
         DBG("manage_bm: "<<boundsMap<<std::endl);
 
         int N = 0;
 
-        DBG("Begin TIA: "<<terminated<<" "<<inactive<<" "<<active<<std::endl);
-        MPI_Comm mpiComm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+        DBG("Begin TIA: "<<terminated<<" "<<inactive<<" "<<workQueue.Size()<<std::endl);
 
         while (true)
         {
-            DBG("MANAGE TIA: "<<terminated<<" "<<worker_inactive<<" "<<active<<std::endl<<std::endl);
+            DBG("MANAGE TIA: "<<terminated<<" "<<worker_inactive<<" "<<workQueue.Size()<<std::endl<<std::endl);
             std::vector<Particle> out, in, term;
             worker_inactive.Get(out);
             worker_terminated.Get(term);
@@ -174,7 +213,7 @@ public:
             int numTerm = term.size() + numTermMessages;
 
             if (!in.empty())
-                active.Insert(in);
+                workQueue.Insert(in);
             if (!term.empty())
                 terminated.Insert(term);
 
@@ -184,34 +223,34 @@ public:
             if (N == TotalNumParticles)
                 break;
 
-            if (active.Empty())
+            if (in.empty() && numTerm == 0)
             {
                 TIMER_START("sleep");
-                usleep(sleepUS);
+                WaitForWorkers();
                 TIMER_STOP("sleep");
                 COUNTER_INC("naps", 1);
                 communicator.CheckPendingSendRequests();
             }
         }
-        DBG("TIA: "<<terminated<<" "<<inactive<<" "<<active<<" WI= "<<worker_inactive<<std::endl);
+        DBG("TIA: "<<terminated<<" "<<inactive<<" "<<workQueue.Size()<<" WI= "<<worker_inactive<<std::endl);
         DBG("RESULTS= "<<results.Size()<<std::endl);
-        DBG("DONE_"<<m_Rank<<" "<<terminated<<" "<<active<<" "<<inactive<<std::endl);
+        DBG("DONE_"<<m_Rank<<" "<<terminated<<" "<<inactive<<std::endl);
         SetDone();
     }
 
     int m_Rank, m_NumRanks;
     int TotalNumParticles;
 
-#ifndef VTKH_USE_OPENMP
     std::vector<std::thread> workerThreads;
-#endif
+    std::vector<vtkh::StatisticsDB> workerStats;
 
     using ParticleList = vtkh::ThreadSafeContainer<Particle, std::vector>;
     using ResultsVec = vtkh::ThreadSafeContainer<ResultT, std::vector>;
 
     ParticleMessenger communicator;
-    ParticleList active, inactive, terminated;
-    ParticleList worker_active, worker_inactive, worker_terminated;
+    ParticleWorkQueue workQueue;
+    ParticleList inactive, terminated;
+    ParticleList worker_inactive, worker_terminated;
     ResultsVec results;
 
     int numWorkerThreads;
@@ -219,6 +258,11 @@ public:
 
     bool done, begin;
     vtkh::Mutex stateLock;
+
+    bool workerSignal;
+    std::mutex workerSignalLock;
+    std::condition_variable workerSignalCV;
+
     BoundsMap boundsMap;
     ParticleAdvection *filter;
 };
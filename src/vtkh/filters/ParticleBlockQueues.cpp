@@ -0,0 +1,174 @@
+#include <vtkh/filters/ParticleBlockQueues.hpp>
+
+#include <iterator>
+#include <limits>
+
+namespace vtkh
+{
+
+ParticleBlockQueues::ParticleBlockQueues()
+  : m_policy(ROUND_ROBIN),
+    m_last_block(0),
+    m_has_last_block(false),
+    m_size(0),
+    m_num_blocks(0)
+{
+}
+
+ParticleBlockQueues::ParticleBlockQueues(SelectionPolicy policy)
+  : m_policy(policy),
+    m_last_block(0),
+    m_has_last_block(false),
+    m_size(0),
+    m_num_blocks(0)
+{
+}
+
+void
+ParticleBlockQueues::SetPolicy(SelectionPolicy policy)
+{
+  m_policy = policy;
+  m_by_size.clear();
+  if(m_policy == LARGEST_FIRST)
+  {
+    for(auto &block : m_blocks)
+    {
+      if(!block.second.m_particles.empty())
+      {
+        m_by_size.insert(std::make_pair(block.second.m_particles.size(), block.first));
+      }
+    }
+  }
+}
+
+ParticleBlockQueues::SelectionPolicy
+ParticleBlockQueues::GetPolicy() const
+{
+  return m_policy;
+}
+
+void
+ParticleBlockQueues::Insert(const Particle &particle)
+{
+  const int id = particle.blockIds[0];
+  BlockQueue &block = m_blocks[id];
+  const size_t old_size = block.m_particles.size();
+
+  if(m_policy == LARGEST_FIRST && old_size > 0)
+  {
+    m_by_size.erase(std::make_pair(old_size, id));
+  }
+
+  block.m_particles.push_back(particle);
+  m_size++;
+
+  if(old_size == 0)
+  {
+    m_num_blocks++;
+  }
+  if(m_policy == LARGEST_FIRST)
+  {
+    m_by_size.insert(std::make_pair(old_size + 1, id));
+  }
+  if(!block.m_in_order)
+  {
+    block.m_in_order = true;
+    m_order.push_back(id);
+  }
+}
+
+int
+ParticleBlockQueues::NextRoundRobin()
+{
+  while(true)
+  {
+    const int id = m_order.front();
+    m_order.pop_front();
+    BlockQueue &block = m_blocks[id];
+    block.m_in_order = false;
+    if(!block.m_particles.empty())
+    {
+      return id;
+    }
+  }
+}
+
+int
+ParticleBlockQueues::NextLargest()
+{
+  // largest size, smallest block id on ties
+  auto last = std::prev(m_by_size.end());
+  const size_t size = last->first;
+  auto first = m_by_size.lower_bound(std::make_pair(size, std::numeric_limits<int>::min()));
+  return first->second;
+}
+
+bool
+ParticleBlockQueues::Get(std::vector<Particle> &particles)
+{
+  particles.clear();
+  if(m_size == 0)
+  {
+    return false;
+  }
+
+  int id;
+  if(m_policy == LARGEST_FIRST)
+  {
+    id = NextLargest();
+  }
+  else if(m_policy == LOCALITY &&
+          m_has_last_block &&
+          !m_blocks[m_last_block].m_particles.empty())
+  {
+    id = m_last_block;
+  }
+  else
+  {
+    id = NextRoundRobin();
+  }
+
+  BlockQueue &block = m_blocks[id];
+  if(m_policy == LARGEST_FIRST)
+  {
+    m_by_size.erase(std::make_pair(block.m_particles.size(), id));
+  }
+
+  particles.swap(block.m_particles);
+  m_size -= particles.size();
+  m_num_blocks--;
+  m_last_block = id;
+  m_has_last_block = true;
+  return true;
+}
+
+size_t
+ParticleBlockQueues::Size() const
+{
+  return m_size;
+}
+
+bool
+ParticleBlockQueues::Empty() const
+{
+  return m_size == 0;
+}
+
+size_t
+ParticleBlockQueues::GetNumberOfBlocks() const
+{
+  return m_num_blocks;
+}
+
+void
+ParticleBlockQueues::Clear()
+{
+  m_blocks.clear();
+  m_order.clear();
+  m_by_size.clear();
+  m_has_last_block = false;
+  m_size = 0;
+  m_num_blocks = 0;
+}
+
+} //namespace vtkh
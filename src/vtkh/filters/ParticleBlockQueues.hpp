@@ -0,0 +1,83 @@
+#ifndef VTK_H_PARTICLE_BLOCK_QUEUES_HPP
+#define VTK_H_PARTICLE_BLOCK_QUEUES_HPP
+
+#include <vtkh/vtkh_exports.h>
+#include <vtkh/filters/Particle.hpp>
+
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vtkh
+{
+
+//
+// Active particles bucketed by their current block (blockIds[0]).
+// Get hands out all particles of one block at a time. The block is
+// chosen by the selection policy without scanning the particles.
+//
+class VTKH_API ParticleBlockQueues
+{
+public:
+  enum SelectionPolicy
+  {
+    ROUND_ROBIN = 0, // blocks in the order they received particles
+    LARGEST_FIRST,   // the block with the most particles
+    LOCALITY         // keep working on the last block while it has
+                     // particles, round robin otherwise
+  };
+
+  ParticleBlockQueues();
+  ParticleBlockQueues(SelectionPolicy policy);
+
+  void SetPolicy(SelectionPolicy policy);
+  SelectionPolicy GetPolicy() const;
+
+  void Insert(const Particle &particle);
+
+  template <template <typename, typename> class Container,
+            typename Allocator=std::allocator<Particle>>
+  void Insert(const Container<Particle, Allocator> &particles)
+  {
+    for (auto it = particles.begin(); it != particles.end(); it++)
+      Insert(*it);
+  }
+
+  // replaces the contents of particles with the particles of the next
+  // block. Returns false if there are no active particles
+  bool Get(std::vector<Particle> &particles);
+
+  size_t Size() const;
+  bool Empty() const;
+  // number of blocks with active particles
+  size_t GetNumberOfBlocks() const;
+  void Clear();
+
+protected:
+  struct BlockQueue
+  {
+    BlockQueue() : m_in_order(false) {}
+    std::vector<Particle> m_particles;
+    bool m_in_order;
+  };
+
+  int NextRoundRobin();
+  int NextLargest();
+
+  SelectionPolicy m_policy;
+  std::unordered_map<int, BlockQueue> m_blocks;
+  // blocks in the order they became non-empty. May hold blocks that
+  // were emptied by another policy, those are skipped
+  std::deque<int> m_order;
+  // (size, block) of all non-empty blocks, only kept for LARGEST_FIRST
+  std::set<std::pair<size_t,int>> m_by_size;
+  int m_last_block;
+  bool m_has_last_block;
+  size_t m_size;
+  size_t m_num_blocks;
+};
+
+} //namespace vtkh
+#endif
@@ -0,0 +1,244 @@
+#include <vtkh/filters/ParticleWorkQueue.hpp>
+
+namespace vtkh
+{
+
+ParticleWorkQueue::ParticleWorkQueue()
+  : m_size(0),
+    m_done(false),
+    m_events(0)
+{
+  Init(1);
+}
+
+ParticleWorkQueue::~ParticleWorkQueue()
+{
+}
+
+void
+ParticleWorkQueue::Init(const int num_workers)
+{
+  const int workers = num_workers < 1 ? 1 : num_workers;
+  m_queues.clear();
+  for(int i = 0; i < workers; ++i)
+  {
+    m_queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+  }
+
+  std::lock_guard<std::mutex> guard(m_wait_lock);
+  m_size = 0;
+  m_done = false;
+  m_events = 0;
+}
+
+int
+ParticleWorkQueue::GetNumberOfWorkers() const
+{
+  return static_cast<int>(m_queues.size());
+}
+
+ParticleWorkQueue::WorkerQueue &
+ParticleWorkQueue::Owner(const int block)
+{
+  const int num_workers = GetNumberOfWorkers();
+  return *m_queues[(block < 0 ? -block : block) % num_workers];
+}
+
+void
+ParticleWorkQueue::Insert(const std::vector<Particle> &particles)
+{
+  if(particles.empty())
+  {
+    return;
+  }
+
+  const int num_workers = GetNumberOfWorkers();
+  std::vector<std::map<int, std::vector<Particle>>> batches(num_workers);
+  for(const auto &p : particles)
+  {
+    const int block = p.blockIds[0];
+    const int owner = (block < 0 ? -block : block) % num_workers;
+    batches[owner][block].push_back(p);
+  }
+
+  // count first so a worker can never take more than was counted
+  {
+    std::lock_guard<std::mutex> guard(m_wait_lock);
+    m_size += particles.size();
+  }
+
+  for(int i = 0; i < num_workers; ++i)
+  {
+    if(batches[i].empty())
+    {
+      continue;
+    }
+    WorkerQueue &queue = *m_queues[i];
+    std::lock_guard<std::mutex> guard(queue.m_lock);
+    for(auto &batch : batches[i])
+    {
+      std::vector<Particle> &block = queue.m_blocks[batch.first];
+      block.insert(block.end(), batch.second.begin(), batch.second.end());
+    }
+  }
+
+  // the event is only counted once the particles can be taken. A worker
+  // that saw the new count before the push would wait on it forever
+  {
+    std::lock_guard<std::mutex> guard(m_wait_lock);
+    m_events++;
+  }
+  m_wait.notify_all();
+}
+
+bool
+ParticleWorkQueue::Pop(WorkerQueue &queue,
+                       std::vector<Particle> &particles,
+                       const bool largest)
+{
+  std::lock_guard<std::mutex> guard(queue.m_lock);
+  if(queue.m_blocks.empty())
+  {
+    return false;
+  }
+
+  auto it = queue.m_blocks.end();
+  for(auto b = queue.m_blocks.begin(); b != queue.m_blocks.end(); ++b)
+  {
+    if(queue.m_in_flight.count(b->first) != 0)
+    {
+      continue;
+    }
+    if(it == queue.m_blocks.end() ||
+       (largest && b->second.size() > it->second.size()))
+    {
+      it = b;
+    }
+    if(!largest)
+    {
+      break;
+    }
+  }
+
+  if(it == queue.m_blocks.end())
+  {
+    return false;
+  }
+
+  queue.m_in_flight.insert(it->first);
+  particles.swap(it->second);
+  queue.m_blocks.erase(it);
+  return true;
+}
+
+void
+ParticleWorkQueue::Release(const int block)
+{
+  {
+    WorkerQueue &queue = Owner(block);
+    std::lock_guard<std::mutex> guard(queue.m_lock);
+    queue.m_in_flight.erase(block);
+  }
+
+  // particles of the block may have arrived while it was in flight
+  {
+    std::lock_guard<std::mutex> guard(m_wait_lock);
+    m_events++;
+  }
+  m_wait.notify_all();
+}
+
+bool
+ParticleWorkQueue::TryGet(const int worker,
+                          std::vector<Particle> &particles,
+                          bool &stolen)
+{
+  particles.clear();
+  stolen = false;
+
+  const int num_workers = GetNumberOfWorkers();
+  bool found = Pop(*m_queues[worker % num_workers], particles, false);
+
+  // steal the largest batch of the other workers, starting with the
+  // next worker so thieves spread over the victims
+  for(int i = 1; i < num_workers && !found; ++i)
+  {
+    found = Pop(*m_queues[(worker + i) % num_workers], particles, true);
+    stolen = found;
+  }
+
+  if(found)
+  {
+    std::lock_guard<std::mutex> guard(m_wait_lock);
+    m_size -= particles.size();
+  }
+  return found;
+}
+
+bool
+ParticleWorkQueue::Get(const int worker,
+                       std::vector<Particle> &particles,
+                       bool &stolen,
+                       bool &waited)
+{
+  waited = false;
+  while(true)
+  {
+    long int events;
+    {
+      std::lock_guard<std::mutex> guard(m_wait_lock);
+      events = m_events;
+    }
+
+    if(TryGet(worker, particles, stolen))
+    {
+      return true;
+    }
+
+    // nothing was free: either the queue is empty or all queued
+    // blocks are in flight. Sleep until particles are inserted or
+    // a block is released
+    std::unique_lock<std::mutex> lock(m_wait_lock);
+    if(m_done)
+    {
+      return false;
+    }
+    if(m_events == events)
+    {
+      waited = true;
+      m_wait.wait(lock, [this, events] { return m_done || m_events != events; });
+    }
+  }
+}
+
+void
+ParticleWorkQueue::SetDone()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_wait_lock);
+    m_done = true;
+  }
+  m_wait.notify_all();
+}
+
+bool
+ParticleWorkQueue::IsDone()
+{
+  std::lock_guard<std::mutex> guard(m_wait_lock);
+  return m_done;
+}
+
+size_t
+ParticleWorkQueue::Size()
+{
+  std::lock_guard<std::mutex> guard(m_wait_lock);
+  return m_size;
+}
+
+bool
+ParticleWorkQueue::Empty()
+{
+  return Size() == 0;
+}
+
+} //namespace vtkh
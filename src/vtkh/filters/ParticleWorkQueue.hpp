@@ -0,0 +1,96 @@
+#ifndef VTK_H_PARTICLE_WORK_QUEUE_HPP
+#define VTK_H_PARTICLE_WORK_QUEUE_HPP
+
+#include <vtkh/vtkh_exports.h>
+#include <vtkh/filters/Particle.hpp>
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace vtkh
+{
+
+//
+// Work queues shared by the particle advection worker threads.
+//
+// Every worker owns a queue of per-block particle batches. Particles are
+// routed to the worker that owns their block (blockId % numWorkers) so a
+// block tends to stay with one thread. Workers that run out of work steal
+// the largest batch of another worker, and idle workers block on a
+// condition variable until particles are inserted or the queue is done.
+// A block that was handed out is in flight: none of its particles are
+// handed to any worker until the worker calls Release for it, so a
+// block is never advected by two threads at once.
+//
+class VTKH_API ParticleWorkQueue
+{
+public:
+  ParticleWorkQueue();
+  ~ParticleWorkQueue();
+
+  void Init(const int num_workers);
+  int GetNumberOfWorkers() const;
+
+  // queues the particles by their current block (blockIds[0])
+  // and wakes idle workers
+  void Insert(const std::vector<Particle> &particles);
+
+  // Pops a batch of particles that all belong to the same block and marks
+  // the block as in flight. Blocks until work is available. Returns false
+  // once SetDone has been called.
+  // 'stolen' is set if the batch came from another worker's queue and
+  // 'waited' if the worker had to go to sleep
+  bool Get(const int worker,
+           std::vector<Particle> &particles,
+           bool &stolen,
+           bool &waited);
+
+  // non-blocking version of Get
+  bool TryGet(const int worker,
+              std::vector<Particle> &particles,
+              bool &stolen);
+
+  // hands a block returned by Get back to the queue so its
+  // particles can be taken again
+  void Release(const int block);
+
+  // wakes up and releases all workers
+  void SetDone();
+  bool IsDone();
+
+  size_t Size();
+  bool Empty();
+
+protected:
+  struct WorkerQueue
+  {
+    std::mutex m_lock;
+    // block id -> particles
+    std::map<int, std::vector<Particle>> m_blocks;
+    // blocks that are being advected by a worker
+    std::set<int> m_in_flight;
+  };
+
+  WorkerQueue &Owner(const int block);
+
+  bool Pop(WorkerQueue &queue,
+           std::vector<Particle> &particles,
+           const bool largest);
+
+  std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+  std::mutex m_wait_lock;
+  std::condition_variable m_wait;
+  // number of queued particles, the done flag and the number of inserts
+  // and releases (so idle workers notice when a block becomes free) are
+  // guarded by m_wait_lock
+  size_t m_size;
+  bool m_done;
+  long int m_events;
+};
+
+} //namespace vtkh
+#endif
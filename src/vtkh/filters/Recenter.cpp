@@ -49,15 +49,10 @@ void Recenter::SetResultAssoc(vtkm::cont::Field::Association assoc)
 void Recenter::DoExecute()
 {
   this->m_output = new DataSet();
-  const int num_domains = this->m_input->GetNumberOfDomains();
 
-  for(int i = 0; i < num_domains; ++i)
+  MapDomains([this](vtkm::cont::DataSet &dom, vtkm::cont::DataSet &out_data)
   {
-    vtkm::Id domain_id;
-    vtkm::cont::DataSet dom;
-    this->m_input->GetDomain(i, dom, domain_id);
-
-    vtkm::cont::DataSet out_data, temp;
+    vtkm::cont::DataSet temp;
     // Since there is no way to remove a field from a dataset
     // we have to iterate over the data set to create a shallow
     // copy of everything else
@@ -134,8 +129,8 @@ void Recenter::DoExecute()
 
     }
 
-    m_output->AddDomain(out_data, domain_id);
-  }
+    return true;
+  }, *m_output);
 }
 
 std::string
@@ -373,7 +373,6 @@ void
 Slice::DoExecute()
 {
   const std::string fname = "slice_field";
-  const int num_domains = this->m_input->GetNumberOfDomains();
   const int num_slices = this->m_points.size();
 
   if(num_slices == 0)
@@ -389,7 +388,7 @@ Slice::DoExecute()
     vtkh::DataSet temp_ds = *(this->m_input);
     // shallow copy the input so we don't propagate the slice field
     // to the input data set, since it might be used in other places
-    for(int i = 0; i < num_domains; ++i)
+    ForEachDomain([&](const int i)
     {
       vtkm::cont::DataSet &dom = temp_ds.GetDomain(i);
 
@@ -400,9 +399,13 @@ Slice::DoExecute()
       dom.AddField(vtkm::cont::Field(fname,
                                       vtkm::cont::Field::Association::POINTS,
                                       slice_field));
-    } // each domain
+    }); // each domain
 
     vtkh::MarchingCubes marcher;
+    marcher.SetDomainParallel(m_domain_parallel);
+    marcher.SetDomainBatchCells(m_domain_batch_cells);
+    // the input was already coalesced
+    marcher.SetCoalesceCells(0);
     marcher.SetInput(&temp_ds);
     marcher.SetIsoValue(0.);
     marcher.SetField(fname);
@@ -427,6 +430,12 @@ Slice::PostExecute()
   Filter::PostExecute();
 }
 
+bool
+Slice::SupportsCoalesce() const
+{
+  return true;
+}
+
 std::string
 Slice::GetName() const
 {
@@ -20,6 +20,7 @@ public:
 protected:
   void PreExecute() override;
   void PostExecute() override;
+  bool SupportsCoalesce() const override;
   void DoExecute() override;
   std::vector<vtkm::Vec<vtkm::Float32,3>> m_points;
   std::vector<vtkm::Vec<vtkm::Float32,3>> m_normals;
@@ -2,10 +2,7 @@
 #include <vtkh/Error.hpp>
 #include <vtkh/Logger.hpp>
 #include <vtkm/cont/Algorithm.h>
-#include <vtkm/cont/ArrayHandleCast.h>
-#include <vtkm/cont/Invoker.h>
-#include <vtkm/worklet/DispatcherMapField.h>
-#include <vtkm/worklet/WorkletMapField.h>
+#include <vtkm/cont/ArrayHandleTransform.h>
 #include <vector>
 
 #ifdef VTKH_PARALLEL
@@ -18,84 +15,113 @@ namespace vtkh
 namespace detail
 {
 
-class CopyToFloat : public vtkm::worklet::WorkletMapField
-{
-public:
-  typedef void ControlSignature(FieldIn, FieldOut);
-  typedef void ExecutionSignature(_1, _2);
+// combinable central moment accumulator:
+// (count, mean, M2, M3, M4, min, max)
+typedef vtkm::Vec<vtkm::Float64,7> Moments;
 
-  VTKM_CONT CopyToFloat()
-  { }
+VTKM_EXEC_CONT
+inline Moments EmptyMoments()
+{
+  return Moments(0., 0., 0., 0., 0.,
+                 vtkm::Infinity64(),
+                 vtkm::NegativeInfinity64());
+}
 
+struct ToMoments
+{
   template <typename T>
-  VTKM_EXEC void operator()(const T &in, vtkm::Float32 &out) const
+  VTKM_EXEC_CONT Moments operator()(const T &value) const
   {
-    out = static_cast<vtkm::Float32>(in);
+    const vtkm::Float64 x = static_cast<vtkm::Float64>(value);
+    return Moments(1., x, 0., 0., 0., x, x);
   }
 };
 
-class SubtractMean : public vtkm::worklet::WorkletMapField
+// pairwise update of the central moments (Pebay 2008), so partial
+// results of blocks, domains and ranks can be merged in any order
+struct CombineMoments
 {
-public:
-  // typedef void ControlSignature()
-  using ControlSignature = void(FieldIn, FieldOut);
-  using ExecutionSignature = _2(_1);
-  using InputDomain = _1;
-
-  vtkm::Float32 mean;
-
-  // define constructor to set mean as the input mean
-  VTKM_CONT SubtractMean(vtkm::Float32 mean) : mean(mean) { }
-
-  template <typename T>
-  VTKM_EXEC vtkm::Float32 operator()(T value) const
+  VTKM_EXEC_CONT Moments operator()(const Moments &a, const Moments &b) const
   {
-    return static_cast<vtkm::Float32>(value - this->mean);
+    const vtkm::Float64 na = a[0];
+    const vtkm::Float64 nb = b[0];
+    if(nb == 0.)
+    {
+      return a;
+    }
+    if(na == 0.)
+    {
+      return b;
+    }
+
+    const vtkm::Float64 n = na + nb;
+    const vtkm::Float64 delta = b[1] - a[1];
+    const vtkm::Float64 delta_n = delta / n;
+    const vtkm::Float64 delta_n2 = delta_n * delta_n;
+    const vtkm::Float64 term = delta * delta_n * na * nb;
+
+    Moments res;
+    res[0] = n;
+    res[1] = a[1] + delta_n * nb;
+    res[2] = a[2] + b[2] + term;
+    res[3] = a[3] + b[3]
+           + term * delta_n * (na - nb)
+           + 3. * delta_n * (na * b[2] - nb * a[2]);
+    res[4] = a[4] + b[4]
+           + term * delta_n2 * (na * na - na * nb + nb * nb)
+           + 6. * delta_n2 * (na * na * b[2] + nb * nb * a[2])
+           + 4. * delta_n * (na * b[3] - nb * a[3]);
+    res[5] = vtkm::Min(a[5], b[5]);
+    res[6] = vtkm::Max(a[6], b[6]);
+    return res;
   }
 };
-// create worklet class to exponentiate vector elements by power
-// Create a worklet
-class VecPow : public vtkm::worklet::WorkletMapField
-{
-public:
-  // take each element of the vector to the power p
-  // typedef void ControlSignature()
-  using ControlSignature = void(FieldIn, FieldOut);
-  using ExecutionSignature = _2(_1);
-  using InputDomain = _1;
-
-  int power;
 
-  // define constructor to set mean as the input mean
-  VTKM_CONT VecPow(int p) : power(p) { }
+struct MomentsFunctor
+{
+  Moments m_moments;
 
-  template <typename T>
-  VTKM_EXEC vtkm::Float32 operator()(T value) const
+  template<typename T, typename S>
+  void operator()(const vtkm::cont::ArrayHandle<T,S> &array)
   {
-    return static_cast<vtkm::Float32>(vtkm::Pow(value,this->power));
+    // one pass over the values
+    m_moments = vtkm::cont::Algorithm::Reduce(
+      vtkm::cont::make_ArrayHandleTransform(array, ToMoments()),
+      EmptyMoments(),
+      CombineMoments());
   }
 };
 
-// worklet class to divide by scalar
-class DivideByScalar : public vtkm::worklet::WorkletMapField
+#ifdef VTKH_PARALLEL
+void CombineRanks(void *in, void *inout, int *len, MPI_Datatype *)
 {
-public:
-  // typedef void ControlSignature()
-  using ControlSignature = void(FieldIn, FieldOut);
-  using ExecutionSignature = _2(_1);
-  using InputDomain = _1;
-
-  vtkm::Float32 scale;
-
-  // define constructor to set scale as the input scale
-  VTKM_CONT DivideByScalar(vtkm::Float32 s) : scale(s) { }
-
-  template <typename T>
-  VTKM_EXEC vtkm::Float32 operator()(T value) const
+  const Moments *a = static_cast<const Moments*>(in);
+  Moments *b = static_cast<Moments*>(inout);
+  for(int i = 0; i < *len; ++i)
   {
-    return static_cast<vtkm::Float32>(value/this->scale);
+    b[i] = CombineMoments()(a[i], b[i]);
   }
-};
+}
+#endif
+
+void ReduceMoments(Moments &moments)
+{
+#ifdef VTKH_PARALLEL
+  MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+  MPI_Datatype moments_type;
+  MPI_Type_contiguous(7, MPI_DOUBLE, &moments_type);
+  MPI_Type_commit(&moments_type);
+  MPI_Op op;
+  MPI_Op_create(&CombineRanks, 1, &op);
+
+  MPI_Allreduce(MPI_IN_PLACE, &moments[0], 1, moments_type, op, mpi_comm);
+
+  MPI_Op_free(&op);
+  MPI_Type_free(&moments_type);
+#else
+  (void) moments;
+#endif
+}
 
 } // namespace detail
 
@@ -121,9 +147,8 @@ Statistics::Result Statistics::Run(vtkh::DataSet &data_set, const std::string fi
   {
     throw Error("Statistics: field : '"+field_name+"' does not exist'");
   }
-  std::vector<vtkm::cont::ArrayHandle<vtkm::Float32>> fields;
-  int total_values = 0;
 
+  detail::Moments moments = detail::EmptyMoments();
   for(int i = 0; i < num_domains; ++i)
   {
     vtkm::Id domain_id;
@@ -132,82 +157,34 @@ Statistics::Result Statistics::Run(vtkh::DataSet &data_set, const std::string fi
     if(dom.HasField(field_name))
     {
       vtkm::cont::Field field = dom.GetField(field_name);
-      vtkm::cont::ArrayHandle<vtkm::Float32> float_field;
-      vtkm::worklet::DispatcherMapField<detail::CopyToFloat>(detail::CopyToFloat())
-        .Invoke(field.GetData().ResetTypes(vtkm::TypeListFieldScalar()), float_field);
-      fields.push_back(float_field);
-      total_values += float_field.GetNumberOfValues();
+      detail::MomentsFunctor func;
+      field.GetData().ResetTypes(vtkm::TypeListFieldScalar()).CastAndCall(func);
+      moments = detail::CombineMoments()(moments, func.m_moments);
     }
   }
 
-  Statistics::Result res;
-#ifdef VTKH_PARALLEL
-  MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-  MPI_Allreduce(MPI_IN_PLACE, &total_values, 1, MPI_INT, MPI_SUM, mpi_comm);
-#endif
-
-  // mean
-  vtkm::Float32 sum = 0;
-  for(size_t i = 0; i < fields.size(); ++i)
-  {
-    sum += vtkm::cont::Algorithm::Reduce(fields[i],0.0f,vtkm::Sum());
-  }
-
-#ifdef VTKH_PARALLEL
-  MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_FLOAT, MPI_SUM, mpi_comm);
-#endif
-  vtkm::Float32 mean = sum / vtkm::Float32(total_values);
-  res.mean = mean;
-
-  std::vector<vtkm::cont::ArrayHandle<vtkm::Float32>> unbiased_fields(fields.size());
-  std::vector<vtkm::cont::ArrayHandle<vtkm::Float32>> temp_fields(fields.size());
-
-  vtkm::cont::Invoker invoke;
-
-  // variance
-  vtkm::Float32 sum2 = 0;
-  for(size_t i = 0; i < fields.size(); ++i)
-  {
-    invoke(detail::SubtractMean(mean), fields[i], unbiased_fields[i]);
-    invoke(detail::VecPow(2),unbiased_fields[i],temp_fields[i]);
-    sum2 += vtkm::cont::Algorithm::Reduce(temp_fields[i],0.0f,vtkm::Sum());
-  }
-
-#ifdef VTKH_PARALLEL
-  MPI_Allreduce(MPI_IN_PLACE, &sum2, 1, MPI_FLOAT, MPI_SUM, mpi_comm);
-#endif
-
-  vtkm::Float32 variance = sum2 / vtkm::Float32(total_values - 1);
-  res.variance = variance;
-
-  // skewness
-  vtkm::Float32 sum3 = 0;
-  for(size_t i = 0; i < fields.size(); ++i)
-  {
-    invoke(detail::VecPow(3),unbiased_fields[i],temp_fields[i]);
-    sum3 += vtkm::cont::Algorithm::Reduce(temp_fields[i],0.0f,vtkm::Sum());
-  }
+  detail::ReduceMoments(moments);
 
-#ifdef VTKH_PARALLEL
-  MPI_Allreduce(MPI_IN_PLACE, &sum3, 1, MPI_FLOAT, MPI_SUM, mpi_comm);
-#endif
-  vtkm::Float32 skewness = (sum3/vtkm::Float32(total_values))/(vtkm::Pow(variance,1.5f));
-  res.skewness = skewness;
-
-  // kertosis
-  vtkm::Float32 sum4 = 0;
-  for(size_t i = 0; i < fields.size(); ++i)
+  const vtkm::Float64 n = moments[0];
+  Statistics::Result res;
+  res.count = static_cast<vtkm::Id>(n);
+  res.min = moments[5];
+  res.max = moments[6];
+  // the moments are accumulated in double, the result keeps float
+  const vtkm::Float64 variance = n > 1. ? moments[2] / (n - 1.) : 0.;
+  vtkm::Float64 skewness = 0.;
+  vtkm::Float64 kurtosis = 0.;
+  if(variance > 0.)
   {
-    invoke(detail::VecPow(4),unbiased_fields[i],temp_fields[i]);
-    sum4 += vtkm::cont::Algorithm::Reduce(temp_fields[i],0.0f,vtkm::Sum());
+    skewness = (moments[3] / n) / vtkm::Pow(variance, 1.5);
+    kurtosis = (moments[4] / n) / (variance * variance) - 3.0;
   }
+  res.mean = static_cast<vtkm::Float32>(moments[1]);
+  res.variance = static_cast<vtkm::Float32>(variance);
+  res.skewness = static_cast<vtkm::Float32>(skewness);
+  res.kurtosis = static_cast<vtkm::Float32>(kurtosis);
 
-#ifdef VTKH_PARALLEL
-  MPI_Allreduce(MPI_IN_PLACE, &sum4, 1, MPI_FLOAT, MPI_SUM, mpi_comm);
-#endif
-  vtkm::Float32 kurtosis = (sum4/vtkm::Float32(total_values))/vtkm::Pow(variance,2.f) - 3.0f;
-  res.kurtosis = kurtosis;
-
+  VTKH_DATA_ADD("values", res.count);
   VTKH_DATA_CLOSE();
   return res;
 }
@@ -18,8 +18,15 @@ public:
     vtkm::Float32 variance;
     vtkm::Float32 skewness;
     vtkm::Float32 kurtosis;
+    // min and max keep double precision to match the field range
+    vtkm::Id      count;
+    vtkm::Float64 min;
+    vtkm::Float64 max;
     void Print(std::ostream &out)
     {
+      out<<"Count   : "<<count<<"\n";
+      out<<"Min     : "<<min<<"\n";
+      out<<"Max     : "<<max<<"\n";
       out<<"Mean    : "<<mean<<"\n";
       out<<"Variance: "<<variance<<"\n";
       out<<"Skewness: "<<skewness<<"\n";
@@ -27,6 +34,8 @@ public:
     }
   };
 
+  // All moments are computed in a single pass over each domain
+  // and merged across domains and ranks with one reduction
   Statistics();
   ~Statistics();
   Statistics::Result Run(vtkh::DataSet &data_set, const std::string field_name);
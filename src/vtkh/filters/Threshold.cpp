@@ -71,28 +71,23 @@ void Threshold::DoExecute()
 {
 
   DataSet temp_data;
-  const int num_domains = this->m_input->GetNumberOfDomains();
 
-  for(int i = 0; i < num_domains; ++i)
+  MapDomains([this](vtkm::cont::DataSet &dom, vtkm::cont::DataSet &out)
   {
-    vtkm::Id domain_id;
-    vtkm::cont::DataSet dom;
-    this->m_input->GetDomain(i, dom, domain_id);
     if(!dom.HasField(m_field_name))
     {
-      continue;
+      return false;
     }
 
     vtkmThreshold thresholder;
 
-    auto data_set = thresholder.Run(dom,
-                                    m_field_name,
-                                    m_range.Min,
-                                    m_range.Max,
-                                    this->GetFieldSelection());
-
-    temp_data.AddDomain(data_set, domain_id);
-  }
+    out = thresholder.Run(dom,
+                          m_field_name,
+                          m_range.Min,
+                          m_range.Max,
+                          this->GetFieldSelection());
+    return true;
+  }, temp_data);
 
   CleanGrid cleaner;
   cleaner.SetInput(&temp_data);
@@ -101,6 +96,12 @@ void Threshold::DoExecute()
 
 }
 
+bool
+Threshold::SupportsCoalesce() const
+{
+  return true;
+}
+
 std::string
 Threshold::GetName() const
 {
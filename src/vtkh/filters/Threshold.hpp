@@ -28,6 +28,7 @@ public:
 protected:
   void PreExecute() override;
   void PostExecute() override;
+  bool SupportsCoalesce() const override;
   void DoExecute() override;
   vtkm::Range m_range;
   std::string m_field_name;
@@ -0,0 +1,446 @@
+#include <vtkh/filters/communication/BoundsMap.hpp>
+
+#include <cmath>
+
+#ifdef VTKH_PARALLEL
+#include <mpi.h>
+#endif
+
+namespace vtkh
+{
+
+namespace detail
+{
+
+// bins per block when the blocks do not form a regular grid
+const double g_bins_per_block = 1.0;
+const int g_max_bin_dim = 1024;
+
+inline bool Contains(const vtkm::Bounds &b, const vtkm::Vec3f &p)
+{
+  return p[0] >= b.X.Min && p[0] < b.X.Max &&
+         p[1] >= b.Y.Min && p[1] < b.Y.Max &&
+         p[2] >= b.Z.Min && p[2] < b.Z.Max;
+}
+
+inline const vtkm::Range& GetAxis(const vtkm::Bounds &b, const int axis)
+{
+  return axis == 0 ? b.X : (axis == 1 ? b.Y : b.Z);
+}
+
+// monotonic in x, so a point inside a block always lands in one
+// of the bins the block was added to
+inline int BinCoord(const double x,
+                    const double min,
+                    const double inv_width,
+                    const int dim)
+{
+  const double f = (x - min) * inv_width;
+  // also catches nan
+  if(!(f >= 0.))
+  {
+    return 0;
+  }
+  if(f >= static_cast<double>(dim))
+  {
+    return dim - 1;
+  }
+  return static_cast<int>(f);
+}
+
+} // namespace detail
+
+void
+BoundsMap::ClearIndex()
+{
+  m_block_ids.clear();
+  m_block_bounds.clear();
+  m_regular = false;
+  m_regular_blocks.clear();
+  m_bin_offsets.clear();
+  m_bin_blocks.clear();
+  for(int i = 0; i < 3; ++i)
+  {
+    m_splits[i].clear();
+    m_bin_dims[i] = 0;
+  }
+}
+
+void
+BoundsMap::Build()
+{
+  int size = bm.size();
+#ifdef VTKH_PARALLEL
+  int rank;
+  int procs;
+  MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &procs);
+  int *dom_counts = new int[procs];
+  int *box_counts = new int[procs];
+  MPI_Allgather(&size, 1, MPI_INT, dom_counts, 1, MPI_INT, comm);
+
+  // prefix sum to build incoming buffers offsets
+  int *box_offsets = new int[procs];
+  int *dom_offsets = new int[procs];
+  box_offsets[0] = 0;
+  dom_offsets[0] = 0;
+  box_counts[0] = dom_counts[0] * 6;
+  for(int i = 1; i < procs; ++i)
+  {
+    box_offsets[i] = box_offsets[i-1] + dom_counts[i-1] * 6;
+    dom_offsets[i] = dom_offsets[i-1] + dom_counts[i-1];
+    box_counts[i] = dom_counts[i] * 6;
+  }
+
+  int total_boxs = dom_offsets[procs - 1] + dom_counts[procs - 1];
+  double *box_send_buff = new double[size * 6];
+  int *dom_send_buff = new int[size];
+
+  int counter = 0;
+  for (auto it = bm.begin(); it != bm.end(); it++)
+  {
+     const int offset = counter * 6;
+     box_send_buff[offset + 0] = it->second.X.Min;
+     box_send_buff[offset + 1] = it->second.X.Max;
+     box_send_buff[offset + 2] = it->second.Y.Min;
+     box_send_buff[offset + 3] = it->second.Y.Max;
+     box_send_buff[offset + 4] = it->second.Z.Min;
+     box_send_buff[offset + 5] = it->second.Z.Max;
+     dom_send_buff[counter] = it->first;
+     counter++;
+  }
+
+  double *box_rec_buff = new double[total_boxs * 6];
+  int *dom_rec_buff = new int[total_boxs];
+  MPI_Allgatherv(box_send_buff, size*6, MPI_DOUBLE, box_rec_buff, box_counts, box_offsets, MPI_DOUBLE, comm);
+  MPI_Allgatherv(dom_send_buff, size, MPI_INT, dom_rec_buff, dom_counts, dom_offsets, MPI_INT, comm);
+
+  bm.clear();
+  m_rank_map.clear();
+
+  //build a map of rank that handles empty counts
+  int *rank_map = new int[total_boxs];
+  int idx = 0;
+  for(int i = 0; i < procs; ++i)
+  {
+    for(int d = 0; d < dom_counts[i]; ++d)
+    {
+      rank_map[idx] = i;
+      ++idx;
+    }
+  }
+
+  for(int i = 0; i < total_boxs; ++i)
+  {
+    const int offset = i * 6;
+    int dom_id = dom_rec_buff[i];
+    vtkm::Bounds &bounds = bm[dom_id];
+    bounds.X.Min = box_rec_buff[offset + 0];
+    bounds.X.Max = box_rec_buff[offset + 1];
+    bounds.Y.Min = box_rec_buff[offset + 2];
+    bounds.Y.Max = box_rec_buff[offset + 3];
+    bounds.Z.Min = box_rec_buff[offset + 4];
+    bounds.Z.Max = box_rec_buff[offset + 5];
+
+    m_rank_map[dom_id] = rank_map[i];
+  }
+
+  delete[] dom_send_buff;
+  delete[] dom_rec_buff;
+  delete[] box_send_buff;
+  delete[] box_rec_buff;
+  delete[] dom_offsets;
+  delete[] box_offsets;
+  delete[] dom_counts;
+  delete[] box_counts;
+  delete[] rank_map;
+#else
+  (void) size;
+#endif
+
+  //Get the global bounds.
+  globalBounds = vtkm::Bounds();
+  for (auto &it : bm)
+      globalBounds.Include(it.second);
+
+  BuildIndex();
+}
+
+void
+BoundsMap::BuildIndex()
+{
+  ClearIndex();
+
+  const int num_blocks = static_cast<int>(bm.size());
+  m_block_ids.reserve(num_blocks);
+  m_block_bounds.reserve(num_blocks);
+  for (auto &it : bm)
+  {
+    m_block_ids.push_back(it.first);
+    m_block_bounds.push_back(it.second);
+  }
+
+  if(num_blocks == 0)
+  {
+    return;
+  }
+
+  if(!BuildRegularIndex())
+  {
+    BuildBinIndex();
+  }
+}
+
+bool
+BoundsMap::BuildRegularIndex()
+{
+  const int num_blocks = static_cast<int>(m_block_ids.size());
+
+  // the unique block boundaries along each axis
+  int dims[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    std::vector<double> &splits = m_splits[axis];
+    splits.reserve(num_blocks * 2);
+    for(int i = 0; i < num_blocks; ++i)
+    {
+      const vtkm::Range &range = detail::GetAxis(m_block_bounds[i], axis);
+      splits.push_back(range.Min);
+      splits.push_back(range.Max);
+    }
+    std::sort(splits.begin(), splits.end());
+    splits.erase(std::unique(splits.begin(), splits.end()), splits.end());
+    dims[axis] = static_cast<int>(splits.size()) - 1;
+  }
+
+  const long long int num_cells =
+    static_cast<long long int>(dims[0]) * dims[1] * dims[2];
+
+  bool regular = num_cells == num_blocks;
+
+  // every block has to cover exactly one cell and every cell
+  // has to be covered once
+  if(regular)
+  {
+    m_regular_blocks.resize(num_cells, -1);
+    for(int i = 0; i < num_blocks && regular; ++i)
+    {
+      int cell[3];
+      for(int axis = 0; axis < 3 && regular; ++axis)
+      {
+        const vtkm::Range &range = detail::GetAxis(m_block_bounds[i], axis);
+        const std::vector<double> &splits = m_splits[axis];
+        auto lo = std::lower_bound(splits.begin(), splits.end(), range.Min);
+        cell[axis] = static_cast<int>(lo - splits.begin());
+        regular = cell[axis] < dims[axis] && splits[cell[axis] + 1] == range.Max;
+      }
+
+      if(regular)
+      {
+        const int index = (cell[2] * dims[1] + cell[1]) * dims[0] + cell[0];
+        regular = m_regular_blocks[index] == -1;
+        m_regular_blocks[index] = i;
+      }
+    }
+  }
+
+  if(!regular)
+  {
+    m_regular_blocks.clear();
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      m_splits[axis].clear();
+    }
+  }
+
+  m_regular = regular;
+  return regular;
+}
+
+void
+BoundsMap::BuildBinIndex()
+{
+  const int num_blocks = static_cast<int>(m_block_ids.size());
+
+  // pick roughly cubic bins so the total number of bins is about
+  // the number of blocks
+  double extents[3];
+  double volume = 1.;
+  int num_axes = 0;
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    extents[axis] = detail::GetAxis(globalBounds, axis).Length();
+    if(extents[axis] > 0.)
+    {
+      volume *= extents[axis];
+      num_axes++;
+    }
+  }
+
+  double bin_size = 0.;
+  if(num_axes > 0)
+  {
+    bin_size = std::pow(volume / (num_blocks * detail::g_bins_per_block),
+                        1. / static_cast<double>(num_axes));
+  }
+
+  int num_bins = 1;
+  double inv_width[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    int dim = 1;
+    if(extents[axis] > 0. && bin_size > 0.)
+    {
+      dim = static_cast<int>(std::ceil(extents[axis] / bin_size));
+      dim = std::max(1, std::min(dim, detail::g_max_bin_dim));
+    }
+    m_bin_dims[axis] = dim;
+    inv_width[axis] = extents[axis] > 0. ? dim / extents[axis] : 0.;
+    num_bins *= dim;
+  }
+
+  // counting pass then fill pass to get a compact bin -> blocks layout
+  std::vector<int> bin_ranges(num_blocks * 6);
+  m_bin_offsets.assign(num_bins + 1, 0);
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    int *range = &bin_ranges[i * 6];
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      const vtkm::Range &block = detail::GetAxis(m_block_bounds[i], axis);
+      const double min = detail::GetAxis(globalBounds, axis).Min;
+      range[axis * 2 + 0] = detail::BinCoord(block.Min, min, inv_width[axis], m_bin_dims[axis]);
+      range[axis * 2 + 1] = detail::BinCoord(block.Max, min, inv_width[axis], m_bin_dims[axis]);
+    }
+
+    for(int z = range[4]; z <= range[5]; ++z)
+      for(int y = range[2]; y <= range[3]; ++y)
+        for(int x = range[0]; x <= range[1]; ++x)
+        {
+          const int bin = (z * m_bin_dims[1] + y) * m_bin_dims[0] + x;
+          m_bin_offsets[bin + 1]++;
+        }
+  }
+
+  for(int i = 0; i < num_bins; ++i)
+  {
+    m_bin_offsets[i + 1] += m_bin_offsets[i];
+  }
+
+  m_bin_blocks.resize(m_bin_offsets[num_bins]);
+  std::vector<int> fill(m_bin_offsets.begin(), m_bin_offsets.end() - 1);
+  // blocks are added in block id order, so every bin is sorted by id
+  for(int i = 0; i < num_blocks; ++i)
+  {
+    const int *range = &bin_ranges[i * 6];
+    for(int z = range[4]; z <= range[5]; ++z)
+      for(int y = range[2]; y <= range[3]; ++y)
+        for(int x = range[0]; x <= range[1]; ++x)
+        {
+          const int bin = (z * m_bin_dims[1] + y) * m_bin_dims[0] + x;
+          m_bin_blocks[fill[bin]++] = i;
+        }
+  }
+}
+
+std::vector<int>
+BoundsMap::FindBlock(const vtkh::Particle &p,
+                     bool ignoreCurrentBlock) const
+{
+  std::vector<int> res;
+  const int ignore = (ignoreCurrentBlock && !p.blockIds.empty()) ? p.blockIds[0] : -1;
+  FindBlock(p.p.Pos, ignore, res);
+  return res;
+}
+
+void
+BoundsMap::FindBlock(const vtkm::Vec3f &point,
+                     const int ignoreBlock,
+                     std::vector<int> &res) const
+{
+  res.clear();
+  if(m_block_ids.empty())
+  {
+    return;
+  }
+
+  if(m_regular)
+  {
+    int cell[3];
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      const std::vector<double> &splits = m_splits[axis];
+      const double x = point[axis];
+      auto hi = std::upper_bound(splits.begin(), splits.end(), x);
+      cell[axis] = static_cast<int>(hi - splits.begin()) - 1;
+      if(cell[axis] < 0 || cell[axis] >= static_cast<int>(splits.size()) - 1)
+      {
+        return;
+      }
+    }
+
+    const int dimx = static_cast<int>(m_splits[0].size()) - 1;
+    const int dimy = static_cast<int>(m_splits[1].size()) - 1;
+    const int block = m_regular_blocks[(cell[2] * dimy + cell[1]) * dimx + cell[0]];
+    if(m_block_ids[block] != ignoreBlock)
+    {
+      res.push_back(m_block_ids[block]);
+    }
+    return;
+  }
+
+  int bin[3];
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    const vtkm::Range &range = detail::GetAxis(globalBounds, axis);
+    const double inv_width = range.Length() > 0. ? m_bin_dims[axis] / range.Length() : 0.;
+    bin[axis] = detail::BinCoord(point[axis], range.Min, inv_width, m_bin_dims[axis]);
+  }
+
+  const int b = (bin[2] * m_bin_dims[1] + bin[1]) * m_bin_dims[0] + bin[0];
+  for(int i = m_bin_offsets[b]; i < m_bin_offsets[b + 1]; ++i)
+  {
+    const int block = m_bin_blocks[i];
+    if(m_block_ids[block] != ignoreBlock &&
+       detail::Contains(m_block_bounds[block], point))
+    {
+      res.push_back(m_block_ids[block]);
+    }
+  }
+}
+
+void
+BoundsMap::FindBlockLinear(const vtkm::Vec3f &point,
+                           const int ignoreBlock,
+                           std::vector<int> &res) const
+{
+  res.clear();
+  for (auto it = bm.begin(); it != bm.end(); it++)
+  {
+    if (it->first != ignoreBlock && detail::Contains(it->second, point))
+    {
+      res.push_back(it->first);
+    }
+  }
+}
+
+void
+BoundsMap::FindBlockIDs(const std::vector<const Particle*> &particles,
+                        std::vector<std::vector<int>> &blockIDs,
+                        bool ignoreCurrentBlock) const
+{
+  const int size = static_cast<int>(particles.size());
+  blockIDs.resize(size);
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < size; ++i)
+  {
+    const Particle &p = *particles[i];
+    const int ignore = (ignoreCurrentBlock && !p.blockIds.empty()) ? p.blockIds[0] : -1;
+    FindBlock(p.p.Pos, ignore, blockIDs[i]);
+  }
+}
+
+} // namespace vtkh
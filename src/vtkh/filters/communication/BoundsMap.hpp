@@ -27,16 +27,28 @@ namespace vtkh
 class VTKH_API BoundsMap
 {
 public:
-  BoundsMap() {}
+  BoundsMap() { ClearIndex(); }
   BoundsMap(const BoundsMap &_bm)
-      : bm(_bm.bm), m_rank_map(_bm.m_rank_map), globalBounds(_bm.globalBounds)
+      : bm(_bm.bm), m_rank_map(_bm.m_rank_map), globalBounds(_bm.globalBounds),
+        m_block_ids(_bm.m_block_ids),
+        m_block_bounds(_bm.m_block_bounds),
+        m_regular(_bm.m_regular),
+        m_regular_blocks(_bm.m_regular_blocks),
+        m_bin_offsets(_bm.m_bin_offsets),
+        m_bin_blocks(_bm.m_bin_blocks)
   {
+    for(int i = 0; i < 3; ++i)
+    {
+      m_splits[i] = _bm.m_splits[i];
+      m_bin_dims[i] = _bm.m_bin_dims[i];
+    }
   }
 
   void Clear()
   {
     bm.clear();
     m_rank_map.clear();
+    ClearIndex();
   }
 
   void AddBlock(int id, const vtkm::Bounds &bounds)
@@ -54,34 +66,35 @@ public:
                     std::vector<std::vector<int>> &blockIDs,
                     bool ignoreCurrentBlock=true) const
   {
-      size_t sz = particles.size();
-      blockIDs.resize(sz);
-      auto pit = particles.begin();
-      auto oit = blockIDs.begin();
-      for ( ; pit != particles.end(); pit++, oit++)
-          *oit = FindBlock(*pit, ignoreCurrentBlock && !pit->blockIds.empty());
+      // gather the particles so the lookups can run in parallel
+      // for any kind of container
+      std::vector<const Particle*> ptrs;
+      ptrs.reserve(particles.size());
+      for (auto pit = particles.begin(); pit != particles.end(); pit++)
+          ptrs.push_back(&(*pit));
+      FindBlockIDs(ptrs, blockIDs, ignoreCurrentBlock);
   }
 
-    std::vector<int> FindBlock(const vtkh::Particle &p,
-                               bool ignoreCurrentBlock) const
-  {
-      std::vector<int> res;
-      for (auto it = bm.begin(); it != bm.end(); it++)
-      {
-          if (ignoreCurrentBlock && !p.blockIds.empty() && p.blockIds[0] == it->first)
-              continue;
-          if (p.p.Pos[0] >= it->second.X.Min &&
-              p.p.Pos[0] < it->second.X.Max &&
-              p.p.Pos[1] >= it->second.Y.Min &&
-              p.p.Pos[1] < it->second.Y.Max &&
-              p.p.Pos[2] >= it->second.Z.Min &&
-              p.p.Pos[2] < it->second.Z.Max)
-          {
-              res.push_back(it->first);
-          }
-      }
-      return res;
-  }
+  // all blocks containing the particle ordered by block id.
+  // If ignoreCurrentBlock is set, the block the particle is currently
+  // assigned to (p.blockIds[0]) is skipped
+  std::vector<int> FindBlock(const vtkh::Particle &p,
+                             bool ignoreCurrentBlock) const;
+
+  // all blocks containing the point ordered by block id.
+  // ignoreBlock is skipped (-1 to keep all blocks)
+  void FindBlock(const vtkm::Vec3f &point,
+                 const int ignoreBlock,
+                 std::vector<int> &res) const;
+
+  // the lookup without the spatial index (for testing / benchmarking)
+  void FindBlockLinear(const vtkm::Vec3f &point,
+                       const int ignoreBlock,
+                       std::vector<int> &res) const;
+
+  // true if the blocks tile a regular grid and lookups are a single
+  // binary search per axis
+  bool IsRegular() const { return m_regular; }
 
   int GetRank(const int &block_id)
   {
@@ -93,112 +106,37 @@ public:
     return rank;
   }
 
-  void Build()
-  {
-    int size = bm.size();
-#if VTKH_PARALLEL
-    int rank;
-    int procs;
-    MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-    MPI_Comm_rank(comm, &rank);
-    MPI_Comm_size(comm, &procs);
-    int *dom_counts = new int[procs];
-    int *box_counts = new int[procs];
-    MPI_Allgather(&size, 1, MPI_INT, dom_counts, 1, MPI_INT, comm);
-
-    // prefix sum to build incoming buffers offsets
-    int *box_offsets = new int[procs];
-    int *dom_offsets = new int[procs];
-    box_offsets[0] = 0;
-    dom_offsets[0] = 0;
-    box_counts[0] = dom_counts[0] * 6;
-    for(int i = 1; i < procs; ++i)
-    {
-      box_offsets[i] = box_offsets[i-1] + dom_counts[i-1] * 6;
-      dom_offsets[i] = dom_offsets[i-1] + dom_counts[i-1];
-      box_counts[i] = dom_counts[i] * 6;
-      //if(rank == 0) std::cout<<" box count "<<i<<" "<<box_counts[i]<<"\n";
-      //if(rank == 0) std::cout<<" dom_offset "<<i<<" "<<dom_offsets[i]<<"\n";
-      //if(rank == 0) std::cout<<" box_offsett "<<i<<" "<<box_offsets[i]<<"\n";
-    }
-
-    int total_boxs = dom_offsets[procs - 1] + dom_counts[procs - 1];
-    double *box_send_buff = new double[size * 6];
-    int *dom_send_buff = new int[size];
-
-    int counter = 0;
-    for (auto it = bm.begin(); it != bm.end(); it++)
-    {
-       const int offset = counter * 6;
-       box_send_buff[offset + 0] = it->second.X.Min;
-       box_send_buff[offset + 1] = it->second.X.Max;
-       box_send_buff[offset + 2] = it->second.Y.Min;
-       box_send_buff[offset + 3] = it->second.Y.Max;
-       box_send_buff[offset + 4] = it->second.Z.Min;
-       box_send_buff[offset + 5] = it->second.Z.Max;
-       dom_send_buff[counter] = it->first;
-       counter++;
-    }
-    //std::cout<<"total boxs "<<total_boxs<<"\n";
-    double *box_rec_buff = new double[total_boxs * 6];
-    int *dom_rec_buff = new int[total_boxs];
-    MPI_Allgatherv(box_send_buff, size*6, MPI_DOUBLE, box_rec_buff, box_counts, box_offsets, MPI_DOUBLE, comm);
-    MPI_Allgatherv(dom_send_buff, size, MPI_INT, dom_rec_buff, dom_counts, dom_offsets, MPI_INT, comm);
-
-    bm.clear();
-    m_rank_map.clear();
-
-    //build a map of rank that handles empty counts
-    int *rank_map = new int[total_boxs];
-    int idx = 0;
-    for(int i = 0; i < procs; ++i)
-    {
-      for(int d = 0; d < dom_counts[i]; ++d)
-      {
-        rank_map[idx] = i;
-        ++idx;
-      }
-    }
-
-    for(int i = 0; i < total_boxs; ++i)
-    {
-      const int offset = i * 6;
-      int dom_id = dom_rec_buff[i];
-      vtkm::Bounds &bounds = bm[dom_id];
-      bounds.X.Min = box_rec_buff[offset + 0];
-      bounds.X.Max = box_rec_buff[offset + 1];
-      bounds.Y.Min = box_rec_buff[offset + 2];
-      bounds.Y.Max = box_rec_buff[offset + 3];
-      bounds.Z.Min = box_rec_buff[offset + 4];
-      bounds.Z.Max = box_rec_buff[offset + 5];
-
-      m_rank_map[dom_id] = rank_map[i];
-    }
-
-    delete[] dom_send_buff;
-    delete[] dom_rec_buff;
-    delete[] box_send_buff;
-    delete[] box_rec_buff;
-    delete[] dom_offsets;
-    delete[] box_offsets;
-    delete[] dom_counts;
-    delete[] box_counts;
-    delete[] rank_map;
-#endif
-
-    //Get the global bounds.
-    for (auto &it : bm)
-        globalBounds.Include(it.second);
-
-    // Placeholder for more complex representatoin like a bvh that needs to
-    // be constructed
-  }
+  // gathers the blocks of all ranks and builds the spatial index
+  // used by FindBlock
+  void Build();
 
   std::map<int, vtkm::Bounds> bm; // map<dom_id, bounds>
   std::map<int, int> m_rank_map;  // map<dom_id,rank>
   vtkm::Bounds globalBounds;
 protected:
-
+  void FindBlockIDs(const std::vector<const Particle*> &particles,
+                    std::vector<std::vector<int>> &blockIDs,
+                    bool ignoreCurrentBlock) const;
+  void ClearIndex();
+  void BuildIndex();
+  bool BuildRegularIndex();
+  void BuildBinIndex();
+
+  // the blocks of bm flattened in block id order
+  std::vector<int>          m_block_ids;
+  std::vector<vtkm::Bounds> m_block_bounds;
+
+  // regular decompositions: the unique block boundaries along each axis
+  // and the block index of every cell they form
+  bool                m_regular;
+  std::vector<double> m_splits[3];
+  std::vector<int>    m_regular_blocks;
+
+  // everything else: a uniform grid of bins over the global bounds.
+  // bin b overlaps the blocks m_bin_blocks[m_bin_offsets[b]..m_bin_offsets[b+1])
+  int              m_bin_dims[3];
+  std::vector<int> m_bin_offsets;
+  std::vector<int> m_bin_blocks;
 };
 
 inline std::ostream &operator<<(std::ostream &os, const vtkh::BoundsMap &bm)
@@ -175,8 +175,13 @@ ParticleMessenger::ParticleSorter(std::vector<vtkh::Particle> &outData,
                                   std::vector<vtkh::Particle> &term,
                                   std::map<int, std::vector<Particle>> &sendData)
 {
-    for (auto &p : outData)
+    //Look up the blocks of all particles at once.
+    std::vector<std::vector<int>> blockIds;
+    boundsMap.FindBlockIDs(outData, blockIds, true);
+
+    for (size_t i = 0; i < outData.size(); i++)
     {
+        auto &p = outData[i];
         //If particle in wrong domain (took no steps), remove this ID, and use what is left below.
         //otherwise, compute a new set of block ids.
         DBG("ParticleSorter: "<<p<<std::endl);
@@ -188,7 +193,7 @@ ParticleMessenger::ParticleSorter(std::vector<vtkh::Particle> &outData,
         else
         {
             DBG("Find new blocks: "<<p<<" --> ");
-            p.blockIds = boundsMap.FindBlock(p, true);
+            p.blockIds.swap(blockIds[i]);
             DBG(p<<std::endl);
 
         }
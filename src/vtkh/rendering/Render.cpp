@@ -251,6 +251,18 @@ Render::Save()
   encoder.Save(m_image_name + ".png");
 }
 
+void
+Render::Save(ImageWriter &writer)
+{
+#ifdef VTKH_PARALLEL
+  if(vtkh::GetMPIRank() != 0) return;
+#endif
+  float* color_buffer = &GetVTKMPointer(m_canvas.GetColorBuffer())[0][0];
+  int height = m_canvas.GetHeight();
+  int width = m_canvas.GetWidth();
+  writer.Push(color_buffer, width, height, m_image_name + ".png");
+}
+
 vtkh::Render
 MakeRender(int width,
            int height,
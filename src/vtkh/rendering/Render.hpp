@@ -5,6 +5,7 @@
 #include <vtkh/vtkh_exports.h>
 #include <vtkh/DataSet.hpp>
 #include <vtkh/Error.hpp>
+#include <vtkh/utils/ImageWriter.hpp>
 
 #include <vtkm/rendering/Camera.h>
 #include <vtkm/rendering/CanvasRayTracer.h>
@@ -54,6 +55,8 @@ public:
                                                           const std::vector<vtkm::Range> &ranges,
                                                           const std::vector<vtkm::cont::ColorTable> &colors);
   void                            Save();
+  // queues the image on a background writer
+  void                            Save(ImageWriter &writer);
 protected:
   vtkm::rendering::Camera      m_camera;
   std::string                  m_image_name;
@@ -1,7 +1,9 @@
 #include "Renderer.hpp"
 #include <vtkh/compositing/Compositor.hpp>
+#include <vtkh/compositing/ImageCompression.hpp>
 
 #include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
 #include <vtkh/utils/vtkm_array_utils.hpp>
 #include <vtkh/utils/vtkm_dataset_info.hpp>
 #include <vtkh/utils/PNGEncoder.hpp>
@@ -98,8 +100,11 @@ vtkm::cont::ColorTable Renderer::GetColorTable() const
 void
 Renderer::Composite(const int &num_images)
 {
+  VTKH_PROFILE_SCOPE("Composite");
   VTKH_DATA_OPEN("Composite");
   m_compositor->SetCompositeMode(Compositor::Z_BUFFER_SURFACE);
+  // all images go through the same compositing rounds
+  std::vector<Image> images(num_images);
   for(int i = 0; i < num_images; ++i)
   {
     float* color_buffer = &GetVTKMPointer(m_renders[i].GetCanvas().GetColorBuffer())[0][0];
@@ -108,23 +113,30 @@ Renderer::Composite(const int &num_images)
     int height = m_renders[i].GetCanvas().GetHeight();
     int width = m_renders[i].GetCanvas().GetWidth();
 
-    m_compositor->AddImage(color_buffer,
-                           depth_buffer,
-                           width,
-                           height);
+    images[i].Init(color_buffer,
+                   depth_buffer,
+                   width,
+                   height);
+  }
 
-    Image result = m_compositor->Composite();
+  const long long int raw_bytes = ImageCompression::GetRawBytes();
+  const long long int sent_bytes = ImageCompression::GetSentBytes();
+  m_compositor->CompositeBatch(images);
+  VTKH_DATA_ADD("raw_bytes", ImageCompression::GetRawBytes() - raw_bytes);
+  VTKH_DATA_ADD("sent_bytes", ImageCompression::GetSentBytes() - sent_bytes);
 
+  for(int i = 0; i < num_images; ++i)
+  {
 #ifdef VTKH_PARALLEL
     if(vtkh::GetMPIRank() == 0)
     {
-      ImageToCanvas(result, m_renders[i].GetCanvas(), true);
+      ImageToCanvas(images[i], m_renders[i].GetCanvas(), true);
     }
 #else
-    ImageToCanvas(result, m_renders[i].GetCanvas(), true);
+    ImageToCanvas(images[i], m_renders[i].GetCanvas(), true);
 #endif
-    m_compositor->ClearImages();
   } // for image
+  VTKH_DATA_ADD("images", num_images);
   VTKH_DATA_CLOSE();
 }
 
@@ -134,11 +146,15 @@ Renderer::PreExecute()
   bool range_set = m_range.IsNonEmpty();
   Filter::CheckForRequiredField(m_field_name);
 
+  // bounds and range come from one batched metadata query
+  std::vector<std::string> field_names(1, m_field_name);
+  DataSet::GlobalMetadata meta = m_input->GetGlobalMetadata(field_names, !range_set);
+
   if(!range_set)
   {
     // we have not been given a range, so ask the data set
-    vtkm::cont::ArrayHandle<vtkm::Range> ranges = m_input->GetGlobalRange(m_field_name);
-    int num_components = ranges.GetNumberOfValues();
+    const std::vector<vtkm::Range> &ranges = meta.m_fields[m_field_name].m_ranges;
+    int num_components = static_cast<int>(ranges.size());
     //
     // current vtkm renderers only supports single component scalar fields
     //
@@ -150,7 +166,7 @@ Renderer::PreExecute()
       throw Error(msg.str());
     }
 
-    vtkm::Range global_range = ranges.ReadPortal().Get(0);
+    vtkm::Range global_range = ranges[0];
     // a min or max may be been set by the user, check to see
     if(m_range.Min == vtkm::Infinity64())
     {
@@ -163,12 +179,13 @@ Renderer::PreExecute()
     }
   }
 
-  m_bounds = m_input->GetGlobalBounds();
+  m_bounds = meta.m_bounds;
 }
 
 void
 Renderer::Update()
 {
+  VTKH_PROFILE_SCOPE(this->GetName());
   VTKH_DATA_OPEN(this->GetName());
 #ifdef VTKH_ENABLE_LOGGING
   long long int in_cells = this->m_input->GetNumberOfCells();
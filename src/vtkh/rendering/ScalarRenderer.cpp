@@ -1,9 +1,11 @@
 #include "ScalarRenderer.hpp"
 #include <vtkh/compositing/PayloadCompositor.hpp>
+#include <vtkh/compositing/PayloadImageCompositor.hpp>
 
 #include <vtkh/vtkh.hpp>
 
 #include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
 #include <vtkh/utils/vtkm_array_utils.hpp>
 #include <vtkh/utils/vtkm_dataset_info.hpp>
 #include <vtkh/utils/PNGEncoder.hpp>
@@ -14,6 +16,7 @@
   #include <mpi.h>
 #endif
 #include <assert.h>
+#include <limits>
 
 namespace vtkh
 {
@@ -49,11 +52,52 @@ filter_scalar_fields(vtkm::cont::DataSet &dataset)
   return res;
 }
 
+#ifdef VTKH_PARALLEL
+// rank 0 writes the output, so when it had no data it gets the
+// field names from the rank that did
+void SendFieldNames(std::vector<std::string> &names,
+                    const int source_rank,
+                    MPI_Comm comm)
+{
+  const int rank = vtkh::GetMPIRank();
+  if(rank == source_rank)
+  {
+    std::string packed;
+    for(size_t i = 0; i < names.size(); ++i)
+    {
+      packed += names[i];
+      packed.push_back('\0');
+    }
+    int size = static_cast<int>(packed.size());
+    MPI_Send(&size, 1, MPI_INT, 0, 0, comm);
+    MPI_Send(&packed[0], size, MPI_CHAR, 0, 0, comm);
+  }
+  else if(rank == 0)
+  {
+    int size;
+    MPI_Recv(&size, 1, MPI_INT, source_rank, 0, comm, MPI_STATUS_IGNORE);
+    std::vector<char> packed(size);
+    MPI_Recv(packed.data(), size, MPI_CHAR, source_rank, 0, comm, MPI_STATUS_IGNORE);
+    names.clear();
+    size_t start = 0;
+    for(int i = 0; i < size; ++i)
+    {
+      if(packed[i] == '\0')
+      {
+        names.push_back(std::string(&packed[start], &packed[i]));
+        start = i + 1;
+      }
+    }
+  }
+}
+#endif
+
 } // namespace detail
 
 ScalarRenderer::ScalarRenderer()
   : m_width(1024),
-    m_height(1024)
+    m_height(1024),
+    m_batch_size(10)
 {
 }
 
@@ -70,17 +114,63 @@ ScalarRenderer::GetName() const
 void
 ScalarRenderer::SetCamera(vtkmCamera &camera)
 {
-  m_camera = camera;
+  m_cameras.clear();
+  m_cameras.push_back(camera);
+}
+
+void
+ScalarRenderer::SetCameras(const std::vector<vtkmCamera> &cameras)
+{
+  m_cameras = cameras;
+}
+
+void
+ScalarRenderer::AddCamera(vtkmCamera &camera)
+{
+  m_cameras.push_back(camera);
+}
+
+void
+ScalarRenderer::ClearCameras()
+{
+  m_cameras.clear();
+}
+
+int
+ScalarRenderer::GetNumberOfCameras() const
+{
+  return static_cast<int>(m_cameras.size());
+}
+
+void
+ScalarRenderer::SetBatchSize(const int batch_size)
+{
+  if(batch_size < 1)
+  {
+    throw Error("Scalar Renderer: batch size must be greater than 0");
+  }
+  m_batch_size = batch_size;
+}
+
+int
+ScalarRenderer::GetBatchSize() const
+{
+  return m_batch_size;
 }
 
 void
 ScalarRenderer::PreExecute()
 {
+  if(m_cameras.size() == 0)
+  {
+    throw Error("Scalar Renderer: no cameras");
+  }
 }
 
 void
 ScalarRenderer::Update()
 {
+  VTKH_PROFILE_SCOPE(this->GetName());
   VTKH_DATA_OPEN(this->GetName());
 #ifdef VTKH_ENABLE_LOGGING
   long long int in_cells = this->m_input->GetNumberOfCells();
@@ -112,13 +202,10 @@ ScalarRenderer::DoExecute()
   // We could be processing AMR patches, numbering
   // in the 1000s, and with 100 images * 1000s amr
   // patches we could blow memory. We will set the input
-  // once and composite after every image (todo: batch images
-  // in groups of X).
+  // once and composite the images in batches of cameras.
   //
   std::vector<vtkm::rendering::ScalarRenderer> renderers;
-  std::vector<vtkm::Id> cell_counts;
   renderers.resize(num_domains);
-  cell_counts.resize(num_domains);
   for(int dom = 0; dom < num_domains; ++dom)
   {
     vtkm::cont::DataSet data_set;
@@ -128,83 +215,120 @@ ScalarRenderer::DoExecute()
     renderers[dom].SetInput(filtered);
     renderers[dom].SetWidth(m_width);
     renderers[dom].SetHeight(m_height);
+  }
 
-    // all the data sets better be the same
-    cell_counts.push_back(data_set.GetCellSet().GetNumberOfCells());
+  const int num_cameras = static_cast<int>(m_cameras.size());
+  int batch_start = 0;
+  while(batch_start < num_cameras)
+  {
+    const int batch_end = std::min(batch_start + m_batch_size, num_cameras);
+    RenderBatch(renderers, batch_start, batch_end);
+    batch_start = batch_end;
   }
+  VTKH_DATA_ADD("cameras", num_cameras);
+}
+
+void
+ScalarRenderer::RenderBatch(std::vector<vtkm::rendering::ScalarRenderer> &renderers,
+                            const int batch_start,
+                            const int batch_end)
+{
+  const int num_domains = static_cast<int>(renderers.size());
+  const int batch_size = batch_end - batch_start;
 
   // basic sanity checking
   int min_p = std::numeric_limits<int>::max();
   int max_p = std::numeric_limits<int>::min();
-  bool do_once = true;
 
   std::vector<std::string> field_names;
-  PayloadCompositor compositor;
-
-
-  int num_cells;
+  std::vector<PayloadImage> images(batch_size);
+  bool has_data = false;
 
-  //Bounds needed for parallel execution
-  float bounds[6]; 
-  for(int dom = 0; dom < num_domains; ++dom)
+  for(int cam = 0; cam < batch_size; ++cam)
   {
-    vtkm::cont::DataSet data_set;
-    vtkm::Id domain_id;
-    m_input->GetDomain(dom, data_set, domain_id);
-    num_cells = data_set.GetCellSet().GetNumberOfCells();
-
-    if(data_set.GetCellSet().GetNumberOfCells())
+    // composite the local domains
+    for(int dom = 0; dom < num_domains; ++dom)
     {
-	
-      Result res = renderers[dom].Render(m_camera);
-
-      field_names = res.ScalarNames;
-      PayloadImage *pimage = Convert(res);
-      min_p = std::min(min_p, pimage->m_payload_bytes);
-      max_p = std::max(max_p, pimage->m_payload_bytes);
-      compositor.AddImage(*pimage);
-      bounds[0] = pimage->m_bounds.X.Min;
-      bounds[1] = pimage->m_bounds.X.Max;
-      bounds[2] = pimage->m_bounds.Y.Min;
-      bounds[3] = pimage->m_bounds.Y.Max;
-      bounds[4] = pimage->m_bounds.Z.Min;
-      bounds[5] = pimage->m_bounds.Z.Max;
-      delete pimage;
+      vtkm::cont::DataSet data_set;
+      vtkm::Id domain_id;
+      m_input->GetDomain(dom, data_set, domain_id);
+
+      if(data_set.GetCellSet().GetNumberOfCells())
+      {
+        Result res = renderers[dom].Render(m_cameras[batch_start + cam]);
+
+        field_names = res.ScalarNames;
+        PayloadImage *pimage = Convert(res);
+        min_p = std::min(min_p, pimage->m_payload_bytes);
+        max_p = std::max(max_p, pimage->m_payload_bytes);
+        if(images[cam].GetNumberOfPixels() == 0)
+        {
+          images[cam] = std::move(*pimage);
+        }
+        else
+        {
+          PayloadImageCompositor compositor;
+          compositor.ZBufferComposite(images[cam], *pimage);
+        }
+        has_data = true;
+        delete pimage;
+      }
     }
   }
 
-  //Assume rank 0 has data, pass details to ranks with empty domains (no data).
+  // ranks without data only learn the payload size here, so all ranks
+  // agree on it and on the lowest rank that knows the field names
+  int first_data_rank = has_data ? vtkh::GetMPIRank() : std::numeric_limits<int>::max();
 #ifdef VTKH_PARALLEL
   MPI_Comm mpi_comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-  MPI_Bcast(bounds, 6, MPI_FLOAT, 0, mpi_comm);
-  MPI_Bcast(&max_p, 1, MPI_INT, 0, mpi_comm);
-  MPI_Bcast(&min_p, 1, MPI_INT, 0, mpi_comm);
+  int local[3] = {max_p, -min_p, -first_data_rank};
+  int global[3];
+  MPI_Allreduce(local, global, 3, MPI_INT, MPI_MAX, mpi_comm);
+  max_p = global[0];
+  min_p = -global[1];
+  first_data_rank = -global[2];
 #endif
-  
 
-  if(num_domains == 0 || num_cells == 0)
+  if(min_p != max_p)
   {
-    vtkm::Bounds b(bounds);
-    PayloadImage p(b, max_p);
-    int size = p.m_depths.size();
-    float depths[size];
-    for(int i = 0; i < size; i++)
-      depths[i] = std::numeric_limits<int>::max();
-    std::copy(depths, depths + size, &p.m_depths[0]);
-    compositor.AddImage(p);
+    throw Error("Scalar Renderer: mismatch in payload bytes");
   }
 
-  if(min_p != max_p)
+#ifdef VTKH_PARALLEL
+  if(first_data_rank != 0)
   {
-    throw Error("Scalar Renderer: mismatch in payload bytes");
+    detail::SendFieldNames(field_names, first_data_rank, mpi_comm);
+  }
+#endif
+
+  if(!has_data)
+  {
+    // zero pixel images: nothing is allocated or sent for this rank
+    // and the collection fills the background
+    vtkm::Bounds b;
+    b.X.Min = 1;
+    b.Y.Min = 1;
+    b.X.Max = m_width;
+    b.Y.Max = m_height;
+    for(int cam = 0; cam < batch_size; ++cam)
+    {
+      images[cam].InitEmpty(b, max_p);
+    }
   }
-  PayloadImage final_image = compositor.Composite();
+
+  // all cameras of the batch share the compositing rounds
+  PayloadCompositor compositor;
+  compositor.CompositeBatch(images);
+
   if(vtkh::GetMPIRank() == 0)
   {
-    Result final_result = Convert(final_image, field_names);
-    vtkm::cont::DataSet dset = final_result.ToDataSet();
-    const int domain_id = 0;
-    this->m_output->AddDomain(dset, domain_id);
+    for(int cam = 0; cam < batch_size; ++cam)
+    {
+      Result final_result = Convert(images[cam], field_names);
+      vtkm::cont::DataSet dset = final_result.ToDataSet();
+      const int domain_id = batch_start + cam;
+      this->m_output->AddDomain(dset, domain_id);
+    }
   }
 
 }
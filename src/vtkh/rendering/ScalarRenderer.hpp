@@ -25,6 +25,13 @@ public:
   virtual std::string GetName() const override;
 
   void SetCamera(vtkmCamera &camera);
+  // renders one image (output domain) per camera
+  void SetCameras(const std::vector<vtkmCamera> &cameras);
+  void AddCamera(vtkmCamera &camera);
+  void ClearCameras();
+  // number of cameras rendered and composited together
+  void SetBatchSize(const int batch_size);
+  int  GetBatchSize() const;
 
   int GetNumberOfCameras() const;
   vtkh::DataSet *GetInput();
@@ -34,13 +41,18 @@ protected:
 
   int m_width;
   int m_height;
+  int m_batch_size;
   // image related data with cinema support
-  vtkmCamera  m_camera;
+  std::vector<vtkmCamera> m_cameras;
   // methods
   virtual void PreExecute() override;
   virtual void PostExecute() override;
   virtual void DoExecute() override;
 
+  void RenderBatch(std::vector<vtkm::rendering::ScalarRenderer> &renderers,
+                   const int batch_start,
+                   const int batch_end);
+
   PayloadImage * Convert(Result &result);
   ScalarRenderer::Result Convert(PayloadImage &image, std::vector<std::string> &names);
   //void ImageToDataSet(Image &image, vtkm::rendering::Canvas &canvas, bool get_depth);
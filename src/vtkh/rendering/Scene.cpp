@@ -1,8 +1,18 @@
 #include <vtkh/rendering/Scene.hpp>
 #include <vtkh/rendering/MeshRenderer.hpp>
 #include <vtkh/rendering/VolumeRenderer.hpp>
+#include <vtkh/compositing/ImageCompression.hpp>
+#include <vtkh/utils/ImageWriter.hpp>
 #include <vtkh/utils/vtkm_array_utils.hpp>
 
+#include <vtkm/Matrix.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+
 #ifdef VTKH_PARALLEL
 #include <mpi.h>
 #endif
@@ -10,9 +20,166 @@
 namespace vtkh
 {
 
+namespace detail
+{
+
+//
+// Finds the pixels {x_min, y_min, x_max, y_max} (inclusive) covered by
+// the projection of the bounds. Empty bounds give an empty rectangle
+// (x_max < x_min). Bounds that reach behind the camera cover the canvas.
+//
+void screen_rect(const vtkm::Bounds &bounds,
+                 const vtkm::rendering::Camera &camera,
+                 const int width,
+                 const int height,
+                 int *rect)
+{
+  rect[0] = 0;
+  rect[1] = 0;
+  rect[2] = -1;
+  rect[3] = -1;
+  if(!bounds.IsNonEmpty())
+  {
+    return;
+  }
+
+  vtkm::Matrix<vtkm::Float32, 4, 4> projview =
+    vtkm::MatrixMultiply(camera.CreateProjectionMatrix(width, height),
+                         camera.CreateViewMatrix());
+
+  float x_min = std::numeric_limits<float>::max();
+  float y_min = std::numeric_limits<float>::max();
+  float x_max = std::numeric_limits<float>::lowest();
+  float y_max = std::numeric_limits<float>::lowest();
+  for(int i = 0; i < 8; ++i)
+  {
+    vtkm::Vec4f_32 corner(static_cast<float>(i & 1 ? bounds.X.Max : bounds.X.Min),
+                          static_cast<float>(i & 2 ? bounds.Y.Max : bounds.Y.Min),
+                          static_cast<float>(i & 4 ? bounds.Z.Max : bounds.Z.Min),
+                          1.f);
+    vtkm::Vec4f_32 p = vtkm::MatrixMultiply(projview, corner);
+    if(camera.GetMode() != vtkm::rendering::Camera::MODE_3D || p[3] <= 0.f)
+    {
+      rect[2] = width - 1;
+      rect[3] = height - 1;
+      return;
+    }
+    const float x = (p[0] / p[3] * 0.5f + 0.5f) * static_cast<float>(width);
+    const float y = (p[1] / p[3] * 0.5f + 0.5f) * static_cast<float>(height);
+    x_min = std::min(x_min, x);
+    y_min = std::min(y_min, y);
+    x_max = std::max(x_max, x);
+    y_max = std::max(y_max, y);
+  }
+
+  // leave a pixel of slack for rays through the pixel edges
+  const float w = static_cast<float>(width);
+  const float h = static_cast<float>(height);
+  rect[0] = static_cast<int>(std::floor(std::max(-1.f, std::min(w, x_min)))) - 1;
+  rect[1] = static_cast<int>(std::floor(std::max(-1.f, std::min(h, y_min)))) - 1;
+  rect[2] = static_cast<int>(std::ceil(std::max(-1.f, std::min(w, x_max)))) + 1;
+  rect[3] = static_cast<int>(std::ceil(std::max(-1.f, std::min(h, y_max)))) + 1;
+  rect[0] = std::max(rect[0], 0);
+  rect[1] = std::max(rect[1], 0);
+  rect[2] = std::min(rect[2], width - 1);
+  rect[3] = std::min(rect[3], height - 1);
+}
+
+int rect_size(const int *rect)
+{
+  if(rect[2] < rect[0] || rect[3] < rect[1])
+  {
+    return 0;
+  }
+  return (rect[2] - rect[0] + 1) * (rect[3] - rect[1] + 1);
+}
+
+//
+// appends the depths inside rect as
+//   int32 compressed
+//   int32 num_bytes
+//   run length encoded or raw depths
+//
+void pack_depths(const float *depths,
+                 const int width,
+                 const int *rect,
+                 std::vector<char> &buffer)
+{
+  const int size = rect_size(rect);
+  std::vector<float> tile(size);
+  if(size > 0)
+  {
+    const int dx = rect[2] - rect[0] + 1;
+    for(int y = rect[1]; y <= rect[3]; ++y)
+    {
+      std::memcpy(&tile[(y - rect[1]) * dx],
+                  depths + y * width + rect[0],
+                  dx * sizeof(float));
+    }
+  }
+
+  // depths only: a pixel size of zero bytes
+  std::vector<unsigned char> encoded;
+  const unsigned char *no_pixels = reinterpret_cast<const unsigned char*>(tile.data());
+  const int compressed = ImageCompression::Encode(no_pixels, tile.data(), size, 0, encoded);
+  const int num_bytes = compressed ? static_cast<int>(encoded.size())
+                                   : static_cast<int>(size * sizeof(float));
+  const char *bytes = compressed ? reinterpret_cast<const char*>(encoded.data())
+                                 : reinterpret_cast<const char*>(tile.data());
+
+  buffer.insert(buffer.end(),
+                reinterpret_cast<const char*>(&compressed),
+                reinterpret_cast<const char*>(&compressed) + sizeof(int));
+  buffer.insert(buffer.end(),
+                reinterpret_cast<const char*>(&num_bytes),
+                reinterpret_cast<const char*>(&num_bytes) + sizeof(int));
+  buffer.insert(buffer.end(), bytes, bytes + num_bytes);
+}
+
+// reads one tile written by pack_depths and returns the bytes consumed
+int unpack_depths(const char *buffer,
+                  const int *rect,
+                  const int width,
+                  float *depths)
+{
+  int compressed;
+  int num_bytes;
+  std::memcpy(&compressed, buffer, sizeof(int));
+  std::memcpy(&num_bytes, buffer + sizeof(int), sizeof(int));
+  const char *bytes = buffer + 2 * sizeof(int);
+
+  const int size = rect_size(rect);
+  std::vector<float> tile(size);
+  if(compressed)
+  {
+    std::vector<unsigned char> encoded(bytes, bytes + num_bytes);
+    unsigned char *no_pixels = reinterpret_cast<unsigned char*>(tile.data());
+    ImageCompression::Decode(encoded, size, 0, no_pixels, tile.data());
+  }
+  else if(size > 0)
+  {
+    std::memcpy(tile.data(), bytes, size * sizeof(float));
+  }
+
+  if(size > 0)
+  {
+    const int dx = rect[2] - rect[0] + 1;
+    for(int y = rect[1]; y <= rect[3]; ++y)
+    {
+      std::memcpy(depths + y * width + rect[0],
+                  &tile[(y - rect[1]) * dx],
+                  dx * sizeof(float));
+    }
+  }
+  return static_cast<int>(2 * sizeof(int)) + num_bytes;
+}
+
+} // namespace detail
+
 Scene::Scene()
   : m_has_volume(false),
-    m_batch_size(10)
+    m_batch_size(10),
+    m_async_save(true)
 {
 
 }
@@ -38,6 +205,18 @@ Scene::GetRenderBatchSize() const
   return m_batch_size;
 }
 
+void
+Scene::SetAsyncSave(bool on)
+{
+  m_async_save = on;
+}
+
+bool
+Scene::GetAsyncSave() const
+{
+  return m_async_save;
+}
+
 void
 Scene::AddRender(vtkh::Render &render)
 {
@@ -137,6 +316,16 @@ Scene::Render()
   // would consume 7GB of space. Not good on the GPU, where resources
   // are limited.
   //
+  // Images are saved by background writers, so encoding a batch
+  // overlaps with rendering the next one. At most one batch of
+  // images waits to be written, which bounds the extra memory.
+  //
+  std::unique_ptr<ImageWriter> writer;
+  if(m_async_save)
+  {
+    writer.reset(new ImageWriter(2, m_batch_size));
+  }
+
   const int render_size = m_renders.size();
   int batch_start = 0;
   while(batch_start < render_size)
@@ -234,26 +423,112 @@ Scene::Render()
       current_batch[i].RenderWorldAnnotations();
       current_batch[i].RenderScreenAnnotations(field_names, ranges, color_tables);
       current_batch[i].RenderBackground();
-      current_batch[i].Save();
+      if(writer)
+      {
+        current_batch[i].Save(*writer);
+      }
+      else
+      {
+        current_batch[i].Save();
+      }
     }
 
     batch_start = batch_end;
   } // while
+
+  if(writer)
+  {
+    writer->Wait();
+  }
 }
 
+//
+// The volume pass only needs the composited surface depths where the
+// local part of the volume can be seen. Every rank tells rank 0 the
+// screen rectangle of its local bounds and gets back only those depths,
+// run length encoded, instead of a broadcast of every depth buffer.
+//
 void Scene::SynchDepths(std::vector<vtkh::Render> &renders)
 {
 #ifdef VTKH_PARALLEL
-  int root = 0; // full images in rank 0
+  const int root = 0; // full images in rank 0
+  const int tag = 0;
   MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-  int num_ranks = vtkh::GetMPISize();
-  int rank = vtkh::GetMPIRank();
-  for(auto render : renders)
+  const int num_ranks = vtkh::GetMPISize();
+  const int rank = vtkh::GetMPIRank();
+  const int num_renders = static_cast<int>(renders.size());
+
+  // the volume renderer is always last
+  vtkm::Bounds bounds = m_renderers.back()->GetInput()->GetBounds();
+
+  std::vector<int> rects(num_renders * 4);
+  int local_size = 0;
+  for(int i = 0; i < num_renders; ++i)
+  {
+    vtkm::rendering::Canvas &canvas = renders[i].GetCanvas();
+    detail::screen_rect(bounds,
+                        renders[i].GetCamera(),
+                        canvas.GetWidth(),
+                        canvas.GetHeight(),
+                        &rects[i * 4]);
+    local_size += detail::rect_size(&rects[i * 4]);
+  }
+
+  std::vector<int> all_rects;
+  if(rank == root)
+  {
+    all_rects.resize(num_ranks * num_renders * 4);
+  }
+  MPI_Gather(rects.data(), num_renders * 4, MPI_INT,
+             all_rects.data(), num_renders * 4, MPI_INT,
+             root, comm);
+
+  if(rank == root)
+  {
+    std::vector<std::vector<char>> buffers(num_ranks);
+    std::vector<MPI_Request> requests;
+    for(int r = 0; r < num_ranks; ++r)
+    {
+      const int *rank_rects = &all_rects[r * num_renders * 4];
+      int rank_size = 0;
+      for(int i = 0; i < num_renders; ++i)
+      {
+        rank_size += detail::rect_size(&rank_rects[i * 4]);
+      }
+      // the root already has the depths
+      if(r == root || rank_size == 0)
+      {
+        continue;
+      }
+
+      for(int i = 0; i < num_renders; ++i)
+      {
+        vtkm::rendering::Canvas &canvas = renders[i].GetCanvas();
+        const float *depths = GetVTKMPointer(canvas.GetDepthBuffer());
+        detail::pack_depths(depths, canvas.GetWidth(), &rank_rects[i * 4], buffers[r]);
+      }
+      requests.push_back(MPI_Request());
+      MPI_Isend(buffers[r].data(), static_cast<int>(buffers[r].size()), MPI_CHAR,
+                r, tag, comm, &requests.back());
+    }
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+  }
+  else if(local_size > 0)
   {
-    vtkm::rendering::Canvas &canvas = render.GetCanvas();
-    const int image_size = canvas.GetWidth() * canvas.GetHeight();
-    float *depth_ptr = GetVTKMPointer(canvas.GetDepthBuffer());
-    MPI_Bcast( depth_ptr, image_size, MPI_FLOAT, 0, comm);
+    MPI_Status status;
+    MPI_Probe(root, tag, comm, &status);
+    int num_bytes;
+    MPI_Get_count(&status, MPI_CHAR, &num_bytes);
+    std::vector<char> buffer(num_bytes);
+    MPI_Recv(buffer.data(), num_bytes, MPI_CHAR, root, tag, comm, MPI_STATUS_IGNORE);
+
+    int offset = 0;
+    for(int i = 0; i < num_renders; ++i)
+    {
+      vtkm::rendering::Canvas &canvas = renders[i].GetCanvas();
+      float *depths = GetVTKMPointer(canvas.GetDepthBuffer());
+      offset += detail::unpack_depths(&buffer[offset], &rects[i * 4], canvas.GetWidth(), depths);
+    }
   }
 #endif
 }
@@ -17,6 +17,7 @@ private:
   std::vector<vtkh::Render>    m_renders;
   bool                         m_has_volume;
   int                          m_batch_size;
+  bool                         m_async_save;
 public:
  Scene();
  ~Scene();
@@ -28,6 +29,10 @@ public:
   void Save();
   void SetRenderBatchSize(int batch_size);
   int  GetRenderBatchSize() const;
+  // encode and write images in the background while the next
+  // batch renders. Render returns once all images are written.
+  void SetAsyncSave(bool on);
+  bool GetAsyncSave() const;
 protected:
   bool IsMesh(vtkh::Renderer *renderer);
   bool IsVolume(vtkh::Renderer *renderer);
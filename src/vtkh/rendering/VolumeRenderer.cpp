@@ -3,9 +3,12 @@
 #include <vtkh/utils/vtkm_array_utils.hpp>
 #include <vtkh/compositing/Compositor.hpp>
 #include <vtkh/Logger.hpp>
+#include <vtkh/Profiler.hpp>
 
 #include <vtkm/rendering/CanvasRayTracer.h>
 
+#include <algorithm>
+#include <map>
 #include <memory>
 
 #ifdef VTKH_PARALLEL
@@ -19,6 +22,12 @@
 #include <vtkm/rendering/raytracing/VolumeRendererStructured.h>
 #include <vtkm/rendering/raytracing/RayOperations.h>
 #include <vtkm/rendering/raytracing/Camera.h>
+#include <vtkm/cont/Algorithm.h>
+#include <vtkm/cont/ArrayHandleCounting.h>
+#include <vtkm/worklet/DispatcherMapField.h>
+#include <vtkm/worklet/DispatcherMapTopology.h>
+#include <vtkm/worklet/WorkletMapField.h>
+#include <vtkm/worklet/WorkletMapTopology.h>
 
 #include <vtkh/compositing/VolumePartial.hpp>
 
@@ -45,22 +54,6 @@ struct DepthOrder
   }
 };
 
-struct RankOrder
-{
-  inline bool operator()(const VisOrdering &lhs, const VisOrdering &rhs)
-  {
-    if(lhs.m_rank < rhs.m_rank)
-    {
-      return true;
-    }
-    else if(lhs.m_rank == rhs.m_rank)
-    {
-      return lhs.m_domain_index < rhs.m_domain_index;
-    }
-    return false;
-  }
-};
-
 vtkm::cont::ArrayHandle<vtkm::Vec4f_32>
 convert_table(const vtkm::cont::ColorTable& colorTable)
 {
@@ -94,6 +87,7 @@ class VolumeWrapper
 {
 protected:
   vtkm::cont::DataSet m_data_set;
+  vtkm::Bounds m_bounds;
   vtkm::Range m_scalar_range;
   std::string m_field_name;
   vtkm::Float32 m_sample_dist;
@@ -102,7 +96,8 @@ public:
   VolumeWrapper() = delete;
 
   VolumeWrapper(vtkm::cont::DataSet &data_set)
-   : m_data_set(data_set)
+   : m_data_set(data_set),
+     m_bounds(data_set.GetCoordinateSystem().GetBounds())
   {
   }
 
@@ -134,18 +129,125 @@ public:
   virtual void
   render(const vtkm::rendering::Camera &camera,
          vtkm::rendering::CanvasRayTracer &canvas,
-         std::vector<VolumePartial<float>> &partials) = 0;
+         VolumePartialArrays &partials) = 0;
 
 };
 
+// structure of arrays form of the partials of one domain
+struct PartialArrays
+{
+  vtkm::cont::ArrayHandle<vtkm::Id> m_pixel_ids;
+  vtkm::cont::ArrayHandle<vtkm::Float32> m_depths;
+  vtkm::cont::ArrayHandle<vtkm::Vec4f_32> m_colors;
+};
+
+// marks rays that contribute to the image
+class ActiveRays : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn, WholeArrayIn, FieldOut);
+  typedef void ExecutionSignature(_1, _2, _3);
+
+  template<typename ColorPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &ray,
+                  const ColorPortal &colors,
+                  vtkm::UInt8 &active) const
+  {
+    active = colors.Get(ray * 4 + 3) < 0.001f ? 0 : 1;
+  }
+};
+
+class GatherPartials : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn,
+                                WholeArrayIn,
+                                WholeArrayIn,
+                                WholeArrayIn,
+                                FieldOut,
+                                FieldOut,
+                                FieldOut);
+  typedef void ExecutionSignature(_1, _2, _3, _4, _5, _6, _7);
+
+  template<typename IdPortal, typename DepthPortal, typename ColorPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &ray,
+                  const IdPortal &pixel_ids,
+                  const DepthPortal &depths,
+                  const ColorPortal &colors,
+                  vtkm::Id &pixel_id,
+                  vtkm::Float32 &depth,
+                  vtkm::Vec4f_32 &color) const
+  {
+    pixel_id = pixel_ids.Get(ray);
+    depth = static_cast<vtkm::Float32>(depths.Get(ray));
+    const vtkm::Id offset = ray * 4;
+    color = vtkm::Vec4f_32(colors.Get(offset + 0),
+                           colors.Get(offset + 1),
+                           colors.Get(offset + 2),
+                           colors.Get(offset + 3));
+  }
+};
+
+// stream compaction of the rays with a non-zero contribution
+void compact_rays(const vtkm::Id num_rays,
+                  const vtkm::cont::ArrayHandle<vtkm::Id> &pixel_ids,
+                  const vtkm::cont::ArrayHandle<vtkm::Float32> &depths,
+                  const vtkm::cont::ArrayHandle<vtkm::Float32> &colors,
+                  PartialArrays &arrays)
+{
+  vtkm::cont::ArrayHandleCounting<vtkm::Id> rays(0, 1, num_rays);
+  vtkm::cont::ArrayHandle<vtkm::UInt8> active;
+  vtkm::worklet::DispatcherMapField<ActiveRays>().Invoke(rays, colors, active);
+
+  vtkm::cont::ArrayHandle<vtkm::Id> active_rays;
+  vtkm::cont::Algorithm::CopyIf(rays, active, active_rays);
+
+  vtkm::worklet::DispatcherMapField<GatherPartials>().Invoke(active_rays,
+                                                             pixel_ids,
+                                                             depths,
+                                                             colors,
+                                                             arrays.m_pixel_ids,
+                                                             arrays.m_depths,
+                                                             arrays.m_colors);
+}
+
+// appends the partials to the arrays the compositor consumes
+void arrays_to_host(const PartialArrays &arrays,
+                    VolumePartialArrays &partials)
+{
+  const int offset = partials.size();
+  const int size = static_cast<int>(arrays.m_pixel_ids.GetNumberOfValues());
+  partials.resize(offset + size);
+
+  auto pixel_ids = arrays.m_pixel_ids.ReadPortal();
+  auto depths = arrays.m_depths.ReadPortal();
+  auto colors = arrays.m_colors.ReadPortal();
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int p = 0; p < size; ++p)
+  {
+    const vtkm::Vec4f_32 color = colors.Get(p);
+    const int index = offset + p;
+    partials.m_pixel_ids[index] = static_cast<int>(pixel_ids.Get(p));
+    partials.m_depths[index] = depths.Get(p);
+    partials.m_colors[index * 4 + 0] = color[0];
+    partials.m_colors[index * 4 + 1] = color[1];
+    partials.m_colors[index * 4 + 2] = color[2];
+    partials.m_colors[index * 4 + 3] = color[3];
+  }
+}
+
 void vtkm_to_partials(vtkm::rendering::PartialVector32 &vtkm_partials,
-                      std::vector<VolumePartial<float>> &partials)
+                      VolumePartialArrays &partials)
 {
   const int num_vecs = vtkm_partials.size();
   std::vector<int> offsets;
   offsets.reserve(num_vecs);
 
-  int total_size = 0;
+  int total_size = partials.size();
   for(int i = 0; i < num_vecs; ++i)
   {
     const int size = vtkm_partials[i].PixelIds.GetNumberOfValues();
@@ -168,33 +270,76 @@ void vtkm_to_partials(vtkm::rendering::PartialVector32 &vtkm_partials,
 #endif
     for(int p = 0; p < size; ++p)
     {
-      VolumePartial<float> &partial = partials[offset+p];
-      partial.m_pixel[0] = colors.Get(p*4 + 0);
-      partial.m_pixel[1] = colors.Get(p*4 + 1);
-      partial.m_pixel[2] = colors.Get(p*4 + 2);
-      partial.m_alpha = colors.Get(p*4 + 3);
-      partial.m_pixel_id = pixel_ids.Get(p);
-      partial.m_depth = distances.Get(p);
+      const int index = offset + p;
+      partials.m_pixel_ids[index] = pixel_ids.Get(p);
+      partials.m_depths[index] = distances.Get(p);
+      partials.m_colors[index * 4 + 0] = colors.Get(p*4 + 0);
+      partials.m_colors[index * 4 + 1] = colors.Get(p*4 + 1);
+      partials.m_colors[index * 4 + 2] = colors.Get(p*4 + 2);
+      partials.m_colors[index * 4 + 3] = colors.Get(p*4 + 3);
     }
   }
 }
 
+// copies the rendered scalars into the array the tracer samples
+class CopyScalars : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn, FieldOut);
+  typedef void ExecutionSignature(_1, _2);
+
+  template<typename T>
+  VTKM_EXEC
+  void operator()(const T &in, vtkm::Float32 &out) const
+  {
+    out = static_cast<vtkm::Float32>(in);
+  }
+};
+
 class UnstructuredWrapper : public VolumeWrapper
 {
-  vtkm::rendering::ConnectivityProxy m_tracer;
+  // The proxy builds the face connectivity of the mesh and keeps its
+  // own copy of the data set, so it samples m_scalars instead of the
+  // input field. When the field changes but the geometry does not,
+  // only m_scalars is refilled and the connectivity is kept.
+  std::unique_ptr<vtkm::rendering::ConnectivityProxy> m_tracer;
+  vtkm::cont::ArrayHandle<vtkm::Float32> m_scalars;
+  std::string m_scalars_field;
+  vtkm::cont::Field::Association m_scalars_assoc;
+  bool m_scalars_valid;
 public:
   UnstructuredWrapper(vtkm::cont::DataSet &data_set)
     : VolumeWrapper(data_set),
-      m_tracer(data_set)
+      m_scalars_assoc(vtkm::cont::Field::Association::ANY),
+      m_scalars_valid(false)
+  {
+  }
+
+  // swaps in a data set with the same geometry (e.g. new field values)
+  void data_set(vtkm::cont::DataSet &data_set)
   {
+    m_data_set = data_set;
+    m_scalars_valid = false;
+  }
+
+  // estimate of the memory held by the cached rendering state
+  size_t bytes() const
+  {
+    size_t res = static_cast<size_t>(m_scalars.GetNumberOfValues()) * sizeof(vtkm::Float32);
+    if(m_tracer)
+    {
+      // face connectivity of the tracer
+      res += static_cast<size_t>(m_data_set.GetNumberOfCells()) * 12 * sizeof(vtkm::Id);
+    }
+    return res;
   }
 
   virtual void
   render(const vtkm::rendering::Camera &camera,
          vtkm::rendering::CanvasRayTracer &canvas,
-         std::vector<VolumePartial<float>> &partials) override
+         VolumePartialArrays &partials) override
   {
-    const vtkm::cont::CoordinateSystem &coords = m_data_set.GetCoordinateSystem();
+    bind_scalars();
 
     vtkm::rendering::raytracing::Camera rayCamera;
     vtkm::rendering::raytracing::Ray<vtkm::Float32> rays;
@@ -203,21 +348,49 @@ public:
 
     rayCamera.SetParameters(camera, width, height);
 
-    rayCamera.CreateRays(rays, coords.GetBounds());
+    rayCamera.CreateRays(rays, m_bounds);
     rays.Buffers.at(0).InitConst(0.f);
     vtkm::rendering::raytracing::RayOperations::MapCanvasToRays(rays, camera, canvas);
 
-    m_tracer.SetSampleDistance(m_sample_dist);
-    m_tracer.SetColorMap(m_color_map);
-    m_tracer.SetScalarField(m_field_name);
-    m_tracer.SetScalarRange(m_scalar_range);
+    m_tracer->SetSampleDistance(m_sample_dist);
+    m_tracer->SetColorMap(m_color_map);
+    m_tracer->SetScalarRange(m_scalar_range);
 
     vtkm::rendering::PartialVector32 vtkm_partials;
-    vtkm_partials = m_tracer.PartialTrace(rays);
+    vtkm_partials = m_tracer->PartialTrace(rays);
 
     vtkm_to_partials(vtkm_partials, partials);
   }
 
+protected:
+  void bind_scalars()
+  {
+    const std::string scalars_name = "vtkh_volume_scalars";
+    if(m_tracer && m_scalars_valid && m_scalars_field == m_field_name)
+    {
+      return;
+    }
+
+    const vtkm::cont::Field &field = m_data_set.GetField(m_field_name);
+    // refilling the array in place updates the copy held by the tracer
+    vtkm::worklet::DispatcherMapField<CopyScalars>()
+      .Invoke(field.GetData().ResetTypes(vtkm::TypeListFieldScalar()), m_scalars);
+    m_scalars_field = m_field_name;
+    m_scalars_valid = true;
+
+    // the tracer only has to be rebuilt when the field moves
+    // between points and cells
+    if(!m_tracer || m_scalars_assoc != field.GetAssociation())
+    {
+      m_scalars_assoc = field.GetAssociation();
+      vtkm::cont::DataSet tracer_data;
+      tracer_data.SetCellSet(m_data_set.GetCellSet());
+      tracer_data.AddCoordinateSystem(m_data_set.GetCoordinateSystem());
+      tracer_data.AddField(vtkm::cont::Field(scalars_name, m_scalars_assoc, m_scalars));
+      m_tracer.reset(new vtkm::rendering::ConnectivityProxy(tracer_data));
+      m_tracer->SetScalarField(scalars_name);
+    }
+  }
 };
 
 class StructuredWrapper : public VolumeWrapper
@@ -227,10 +400,11 @@ public:
     : VolumeWrapper(data_set)
   {
   }
+
   virtual void
   render(const vtkm::rendering::Camera &camera,
          vtkm::rendering::CanvasRayTracer &canvas,
-         std::vector<VolumePartial<float>> &partials) override
+         VolumePartialArrays &partials) override
   {
     const vtkm::cont::DynamicCellSet &cellset = m_data_set.GetCellSet();
     const vtkm::cont::Field &field = m_data_set.GetField(m_field_name);
@@ -242,7 +416,7 @@ public:
     vtkm::Int32 height = (vtkm::Int32) canvas.GetHeight();
     rayCamera.SetParameters(camera, width, height);
 
-    rayCamera.CreateRays(rays, coords.GetBounds());
+    rayCamera.CreateRays(rays, m_bounds);
     rays.Buffers.at(0).InitConst(0.f);
     vtkm::rendering::raytracing::RayOperations::MapCanvasToRays(rays, camera, canvas);
 
@@ -257,31 +431,385 @@ public:
 
     tracer.Render(rays);
 
-    // Convert the rays to partial composites
-    const int ray_size = rays.NumRays;
-    // partials use the max distance
-    auto depths = rays.MaxDistance.ReadPortal();
-    auto pixel_ids = rays.PixelIdx.ReadPortal();
-    auto colors = rays.Buffers.at(0).Buffer.ReadPortal();
-
-    // TODO: better way? we could do this in parallel if we
-    // don't check the alpha
-    partials.reserve(ray_size);
-    for(int i = 0; i < ray_size; ++i)
+    // Convert the rays to partial composites on the device
+    PartialArrays arrays;
+    compact_rays(rays.NumRays,
+                 rays.PixelIdx,
+                 rays.MaxDistance,
+                 rays.Buffers.at(0).Buffer,
+                 arrays);
+    arrays_to_host(arrays, partials);
+  }
+};
+
+// gathers a few coordinates without moving the whole array
+class GatherPoints : public vtkm::worklet::WorkletMapField
+{
+public:
+  typedef void ControlSignature(FieldIn, WholeArrayIn, FieldOut);
+  typedef void ExecutionSignature(_1, _2, _3);
+
+  template<typename PointPortal>
+  VTKM_EXEC
+  void operator()(const vtkm::Id &index,
+                  const PointPortal &points,
+                  vtkm::Vec3f_64 &point) const
+  {
+    const auto p = points.Get(index);
+    point = vtkm::Vec3f_64(p[0], p[1], p[2]);
+  }
+};
+
+VTKM_EXEC_CONT
+inline vtkm::UInt64 mix_bits(vtkm::UInt64 x)
+{
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+// a hash of the shape and point ids of every cell. Summed over the
+// cells it fingerprints shapes, connectivity and offsets at once
+class HashCells : public vtkm::worklet::WorkletVisitCellsWithPoints
+{
+public:
+  typedef void ControlSignature(CellSetIn, FieldOutCell);
+  typedef void ExecutionSignature(CellShape, PointIndices, WorkIndex, _2);
+
+  template<typename ShapeTag, typename IndicesType>
+  VTKM_EXEC
+  void operator()(const ShapeTag &shape,
+                  const IndicesType &indices,
+                  const vtkm::Id &index,
+                  vtkm::UInt64 &hash) const
+  {
+    vtkm::UInt64 h = mix_bits(static_cast<vtkm::UInt64>(index) ^
+                              (static_cast<vtkm::UInt64>(shape.Id) << 56));
+    const vtkm::IdComponent num_points = indices.GetNumberOfComponents();
+    for(vtkm::IdComponent i = 0; i < num_points; ++i)
+    {
+      h = mix_bits(h ^ static_cast<vtkm::UInt64>(indices[i]));
+    }
+    hash = h;
+  }
+};
+
+struct VolumeFingerprint
+{
+  vtkm::Id m_num_cells;
+  vtkm::Id m_num_points;
+  vtkm::UInt64 m_topology;
+  std::vector<vtkm::Vec3f_64> m_samples;
+
+  bool operator==(const VolumeFingerprint &other) const
+  {
+    return m_num_cells == other.m_num_cells &&
+           m_num_points == other.m_num_points &&
+           m_topology == other.m_topology &&
+           m_samples == other.m_samples;
+  }
+};
+
+VolumeFingerprint
+fingerprint(const vtkm::cont::DataSet &data_set)
+{
+  const int max_samples = 16;
+  const vtkm::cont::CoordinateSystem &coords = data_set.GetCoordinateSystem();
+
+  VolumeFingerprint res;
+  res.m_num_cells = data_set.GetCellSet().GetNumberOfCells();
+  res.m_num_points = coords.GetNumberOfPoints();
+
+  vtkm::cont::ArrayHandle<vtkm::UInt64> hashes;
+  vtkm::worklet::DispatcherMapTopology<HashCells>().Invoke(data_set.GetCellSet(), hashes);
+  res.m_topology = vtkm::cont::Algorithm::Reduce(hashes, vtkm::UInt64(0));
+
+  const vtkm::Id num_samples = std::min(res.m_num_points, vtkm::Id(max_samples));
+  if(num_samples == 0)
+  {
+    return res;
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Id> ids;
+  ids.Allocate(num_samples);
+  auto ids_portal = ids.WritePortal();
+  for(vtkm::Id i = 0; i < num_samples; ++i)
+  {
+    const vtkm::Id id = num_samples == 1 ? 0 : i * (res.m_num_points - 1) / (num_samples - 1);
+    ids_portal.Set(i, id);
+  }
+
+  vtkm::cont::ArrayHandle<vtkm::Vec3f_64> samples;
+  vtkm::worklet::DispatcherMapField<GatherPoints>().Invoke(ids, coords.GetData(), samples);
+  auto samples_portal = samples.ReadPortal();
+  for(vtkm::Id i = 0; i < num_samples; ++i)
+  {
+    res.m_samples.push_back(samples_portal.Get(i));
+  }
+  return res;
+}
+
+//
+// Rendering state of each unstructured domain, kept between SetInput
+// calls. Structured domains hold nothing that is expensive to rebuild,
+// so they are not cached.
+//
+class VolumeCache
+{
+public:
+  VolumeCache()
+    : m_memory_limit(size_t(1) << 30),
+      m_use_count(0),
+      m_hits(0),
+      m_misses(0)
+  {
+  }
+
+  void begin()
+  {
+    m_use_count++;
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  std::shared_ptr<UnstructuredWrapper>
+  get(const vtkm::Id domain_id, vtkm::cont::DataSet &data_set)
+  {
+    VolumeFingerprint print = fingerprint(data_set);
+
+    auto it = m_entries.find(domain_id);
+    if(it != m_entries.end() && it->second.m_fingerprint == print)
+    {
+      // a duplicate domain id cannot share the wrapper of
+      // a domain that is already in use
+      if(it->second.m_last_use != m_use_count)
+      {
+        m_hits++;
+        it->second.m_last_use = m_use_count;
+        it->second.m_wrapper->data_set(data_set);
+        return it->second.m_wrapper;
+      }
+    }
+
+    m_misses++;
+    std::shared_ptr<UnstructuredWrapper> wrapper
+      = std::make_shared<UnstructuredWrapper>(data_set);
+
+    if(it == m_entries.end() || it->second.m_last_use != m_use_count)
+    {
+      Entry &entry = m_entries[domain_id];
+      entry.m_fingerprint = print;
+      entry.m_wrapper = wrapper;
+      entry.m_last_use = m_use_count;
+    }
+    return wrapper;
+  }
+
+  // drops the least recently used entries until the cache fits or
+  // only the entries of the current input are left
+  void end()
+  {
+    size_t total = 0;
+    for(auto &entry : m_entries)
+    {
+      total += entry.second.m_wrapper->bytes();
+    }
+
+    // the entries of the current input are kept, even over the limit
+    while(total > m_memory_limit)
+    {
+      auto oldest = m_entries.end();
+      for(auto it = m_entries.begin(); it != m_entries.end(); ++it)
+      {
+        if(it->second.m_last_use != m_use_count &&
+           (oldest == m_entries.end() ||
+            it->second.m_last_use < oldest->second.m_last_use))
+        {
+          oldest = it;
+        }
+      }
+      if(oldest == m_entries.end())
+      {
+        break;
+      }
+      total -= oldest->second.m_wrapper->bytes();
+      m_entries.erase(oldest);
+    }
+  }
+
+  void clear()
+  {
+    m_entries.clear();
+  }
+
+  void memory_limit(const size_t bytes)
+  {
+    m_memory_limit = bytes;
+    end();
+  }
+
+  size_t memory_limit() const
+  {
+    return m_memory_limit;
+  }
+
+  int hits() const
+  {
+    return m_hits;
+  }
+
+  int misses() const
+  {
+    return m_misses;
+  }
+
+protected:
+  struct Entry
+  {
+    VolumeFingerprint m_fingerprint;
+    std::shared_ptr<UnstructuredWrapper> m_wrapper;
+    long int m_last_use;
+  };
+
+  std::map<vtkm::Id, Entry> m_entries;
+  size_t m_memory_limit;
+  long int m_use_count;
+  int m_hits;
+  int m_misses;
+};
+
+//
+// Bounds of every domain on every rank, in rank order. Visibility
+// orderings only depend on these bounds and the camera, so with the
+// table every rank finds the ordering of any camera on its own. The
+// table is exchanged again only when the bounds of a domain change.
+//
+class BoundsTable
+{
+public:
+  BoundsTable()
+    : m_valid(false)
+  {
+  }
+
+  // collective
+  void update(DataSet &input)
+  {
+    const int num_domains = static_cast<int>(input.GetNumberOfDomains());
+    std::vector<vtkm::Bounds> local(num_domains);
+    for(int dom = 0; dom < num_domains; ++dom)
     {
-      const int offset = i * 4;
-      float alpha = colors.Get(offset + 3);
-      if(alpha < 0.001f) continue;
-      VolumePartial<float> partial;
-      partial.m_pixel[0] = colors.Get(offset + 0);
-      partial.m_pixel[1] = colors.Get(offset + 1);
-      partial.m_pixel[2] = colors.Get(offset + 2);
-      partial.m_alpha = alpha;
-      partial.m_pixel_id = pixel_ids.Get(i);
-      partial.m_depth = depths.Get(i);
-      partials.push_back(std::move(partial));
+      local[dom] = input.GetDomainBounds(dom);
     }
+
+    int changed = !m_valid || local != m_local;
+#ifdef VTKH_PARALLEL
+    MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
+    MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+#endif
+    if(!changed)
+    {
+      return;
+    }
+
+    m_local = local;
+    m_valid = true;
+
+#ifdef VTKH_PARALLEL
+    const int num_ranks = vtkh::GetMPISize();
+    std::vector<int> counts(num_ranks);
+    MPI_Allgather(&num_domains, 1, MPI_INT, counts.data(), 1, MPI_INT, comm);
+
+    std::vector<double> local_values(num_domains * 6);
+    for(int dom = 0; dom < num_domains; ++dom)
+    {
+      pack(local[dom], &local_values[dom * 6]);
+    }
+
+    std::vector<int> value_counts(num_ranks);
+    std::vector<int> value_offsets(num_ranks);
+    int total = 0;
+    for(int i = 0; i < num_ranks; ++i)
+    {
+      value_counts[i] = counts[i] * 6;
+      value_offsets[i] = total * 6;
+      total += counts[i];
+    }
+
+    std::vector<double> values(total * 6);
+    MPI_Allgatherv(local_values.data(), num_domains * 6, MPI_DOUBLE,
+                   values.data(), value_counts.data(), value_offsets.data(), MPI_DOUBLE,
+                   comm);
+
+    m_bounds.resize(total);
+    m_ranks.resize(total);
+    m_indices.resize(total);
+    int index = 0;
+    for(int i = 0; i < num_ranks; ++i)
+    {
+      for(int c = 0; c < counts[i]; ++c)
+      {
+        unpack(&values[index * 6], m_bounds[index]);
+        m_ranks[index] = i;
+        m_indices[index] = c;
+        index++;
+      }
+    }
+#else
+    m_bounds = local;
+    m_ranks.assign(num_domains, 0);
+    m_indices.resize(num_domains);
+    for(int dom = 0; dom < num_domains; ++dom)
+    {
+      m_indices[dom] = dom;
+    }
+#endif
   }
+
+  const std::vector<vtkm::Bounds> &bounds() const
+  {
+    return m_bounds;
+  }
+
+  // owning rank of each domain
+  const std::vector<int> &ranks() const
+  {
+    return m_ranks;
+  }
+
+  // domain index on the owning rank
+  const std::vector<int> &indices() const
+  {
+    return m_indices;
+  }
+
+protected:
+  static void pack(const vtkm::Bounds &bounds, double *values)
+  {
+    values[0] = bounds.X.Min;
+    values[1] = bounds.X.Max;
+    values[2] = bounds.Y.Min;
+    values[3] = bounds.Y.Max;
+    values[4] = bounds.Z.Min;
+    values[5] = bounds.Z.Max;
+  }
+
+  static void unpack(const double *values, vtkm::Bounds &bounds)
+  {
+    bounds.X = vtkm::Range(values[0], values[1]);
+    bounds.Y = vtkm::Range(values[2], values[3]);
+    bounds.Z = vtkm::Range(values[4], values[5]);
+  }
+
+  bool m_valid;
+  std::vector<vtkm::Bounds> m_local;
+  std::vector<vtkm::Bounds> m_bounds;
+  std::vector<int> m_ranks;
+  std::vector<int> m_indices;
 };
 
 void partials_to_canvas(std::vector<VolumePartial<float>> &partials,
@@ -405,6 +933,8 @@ VolumeRenderer::VolumeRenderer()
   m_color_table.AddPointAlpha(.0f, .5);
   m_num_samples = 100.f;
   m_has_unstructured = false;
+  m_cache = std::make_shared<detail::VolumeCache>();
+  m_bounds_table = std::make_shared<detail::BoundsTable>();
 }
 
 VolumeRenderer::~VolumeRenderer()
@@ -415,6 +945,7 @@ VolumeRenderer::~VolumeRenderer()
 void
 VolumeRenderer::Update()
 {
+  VTKH_PROFILE_SCOPE(this->GetName());
   VTKH_DATA_OPEN(this->GetName());
 #ifdef VTKH_ENABLE_LOGGING
   VTKH_DATA_ADD("device", GetCurrentDevice());
@@ -431,6 +962,8 @@ VolumeRenderer::Update()
   {
     VTKH_DATA_ADD("in_topology", "unstructured");
   }
+  VTKH_DATA_ADD("cache_hits", m_cache->hits());
+  VTKH_DATA_ADD("cache_misses", m_cache->misses());
 #endif
 
   PreExecute();
@@ -553,7 +1086,7 @@ VolumeRenderer::RenderMultipleDomainsPerRank()
     = detail::convert_table(this->m_color_table);
 
   // render/domain/result
-  std::vector<std::vector<std::vector<VolumePartial<float>>>> render_partials;
+  std::vector<std::vector<VolumePartialArrays>> render_partials;
   render_partials.resize(total_renders);
   for(int i = 0; i < total_renders; ++i)
   {
@@ -562,7 +1095,7 @@ VolumeRenderer::RenderMultipleDomainsPerRank()
 
   for(int i = 0; i < num_domains; ++i)
   {
-    detail::VolumeWrapper *wrapper = m_wrappers[i];
+    detail::VolumeWrapper *wrapper = m_wrappers[i].get();
     wrapper->sample_distance(m_sample_dist);
     wrapper->color_map(color_map);
     wrapper->field(m_field_name);
@@ -584,7 +1117,7 @@ VolumeRenderer::RenderMultipleDomainsPerRank()
   for(int r = 0; r < total_renders; ++r)
   {
     std::vector<VolumePartial<float>> res;
-    compositor.composite(render_partials[r],res);
+    composite_arrays(compositor, render_partials[r], res);
     if(vtkh::GetMPIRank() == 0)
     {
       detail::partials_to_canvas(res,
@@ -687,146 +1220,42 @@ VolumeRenderer::Composite(const int &num_images)
 }
 
 void
-VolumeRenderer::DepthSort(int num_domains,
-                          std::vector<float> &min_depths,
+VolumeRenderer::DepthSort(const std::vector<float> &min_depths,
                           std::vector<int> &local_vis_order)
 {
-  if(min_depths.size() != num_domains)
+  const std::vector<int> &ranks = m_bounds_table->ranks();
+  const std::vector<int> &indices = m_bounds_table->indices();
+  const int total = static_cast<int>(ranks.size());
+  if(static_cast<int>(min_depths.size()) != total)
   {
     throw Error("min depths size does not equal the number of domains");
   }
-  if(local_vis_order.size() != num_domains)
-  {
-    throw Error("local vis order not equal to number of domains");
-  }
-#ifdef VTKH_PARALLEL
-  int root = 0;
-  MPI_Comm comm = MPI_Comm_f2c(vtkh::GetMPICommHandle());
-  int num_ranks = vtkh::GetMPISize();
-  int rank = vtkh::GetMPIRank();
-  int *domain_counts = NULL;
-  int *domain_offsets = NULL;
-  int *vis_order = NULL;
-  float *depths = NULL;
-
-  if(rank == root)
-  {
-    domain_counts = new int[num_ranks];
-    domain_offsets = new int[num_ranks];
-  }
-
-  MPI_Gather(&num_domains,
-             1,
-             MPI_INT,
-             domain_counts,
-             1,
-             MPI_INT,
-            root,
-             comm);
-
-  int depths_size = 0;
-  if(rank == root)
-  {
-    //scan for dispacements
-    domain_offsets[0] = 0;
-    for(int i = 1; i < num_ranks; ++i)
-    {
-      domain_offsets[i] = domain_offsets[i - 1] + domain_counts[i - 1];
-    }
-
-    for(int i = 0; i < num_ranks; ++i)
-    {
-      depths_size += domain_counts[i];
-    }
-
-    depths = new float[depths_size];
-
-  }
-
-  MPI_Gatherv(&min_depths[0],
-              num_domains,
-              MPI_FLOAT,
-              depths,
-              domain_counts,
-              domain_offsets,
-              MPI_FLOAT,
-              root,
-              comm);
-
-  if(rank == root)
-  {
-    std::vector<detail::VisOrdering> order;
-    order.resize(depths_size);
-
-    for(int i = 0; i < num_ranks; ++i)
-    {
-      for(int c = 0; c < domain_counts[i]; ++c)
-      {
-        int index = domain_offsets[i] + c;
-        order[index].m_rank = i;
-        order[index].m_domain_index = c;
-        order[index].m_minz = depths[index];
-      }
-    }
-
-    std::sort(order.begin(), order.end(), detail::DepthOrder());
-
-    for(int i = 0; i < depths_size; ++i)
-    {
-      order[i].m_order = i;
-    }
-
-    std::sort(order.begin(), order.end(), detail::RankOrder());
-
-    vis_order = new int[depths_size];
-    for(int i = 0; i < depths_size; ++i)
-    {
-      vis_order[i] = order[i].m_order;
-    }
-  }
-
-  MPI_Scatterv(vis_order,
-               domain_counts,
-               domain_offsets,
-               MPI_INT,
-               &local_vis_order[0],
-               num_domains,
-               MPI_INT,
-               root,
-               comm);
-
-  if(rank == root)
-  {
-    delete[] domain_counts;
-    delete[] domain_offsets;
-    delete[] vis_order;
-    delete[] depths;
-  }
-#else
 
   std::vector<detail::VisOrdering> order;
-  order.resize(num_domains);
-
-  for(int i = 0; i < num_domains; ++i)
+  order.resize(total);
+  for(int i = 0; i < total; ++i)
   {
-      order[i].m_rank = 0;
-      order[i].m_domain_index = i;
-      order[i].m_minz = min_depths[i];
+    order[i].m_rank = ranks[i];
+    order[i].m_domain_index = indices[i];
+    order[i].m_minz = min_depths[i];
   }
-  std::sort(order.begin(), order.end(), detail::DepthOrder());
 
-  for(int i = 0; i < num_domains; ++i)
-  {
-    order[i].m_order = i;
-  }
+  // every rank sorts the same list, so a stable sort gives
+  // all of them the same order
+  std::stable_sort(order.begin(), order.end(), detail::DepthOrder());
 
-  std::sort(order.begin(), order.end(), detail::RankOrder());
-
-  for(int i = 0; i < num_domains; ++i)
+#ifdef VTKH_PARALLEL
+  const int rank = vtkh::GetMPIRank();
+#else
+  const int rank = 0;
+#endif
+  for(int i = 0; i < total; ++i)
   {
-    local_vis_order[i] = order[i].m_order;
+    if(order[i].m_rank == rank)
+    {
+      local_vis_order[order[i].m_domain_index] = i;
+    }
   }
-#endif
 }
 
 void
@@ -848,19 +1277,25 @@ VolumeRenderer::FindVisibilityOrdering()
   // take the minimum z value. Then sort them while keeping
   // track of rank, then pass the list in.
   //
+  // The bounds of all domains are shared once, so the orderings
+  // of all cameras need no further communication.
+  //
+  m_bounds_table->update(*m_input);
+  const std::vector<vtkm::Bounds> &bounds = m_bounds_table->bounds();
+  const int total = static_cast<int>(bounds.size());
+
   std::vector<float> min_depths;
-  min_depths.resize(num_domains);
+  min_depths.resize(total);
 
   for(int i = 0; i < num_cameras; ++i)
   {
     const vtkm::rendering::Camera &camera = m_renders[i].GetCamera();
-    for(int dom = 0; dom < num_domains; ++dom)
+    for(int dom = 0; dom < total; ++dom)
     {
-      vtkm::Bounds bounds = this->m_input->GetDomainBounds(dom);
-      min_depths[dom] = FindMinDepth(camera, bounds);
+      min_depths[dom] = FindMinDepth(camera, bounds[dom]);
     }
 
-    DepthSort(num_domains, min_depths, m_visibility_orders[i]);
+    DepthSort(min_depths, m_visibility_orders[i]);
 
   } // for each camera
 }
@@ -868,6 +1303,7 @@ void VolumeRenderer::SetInput(DataSet *input)
 {
   Filter::SetInput(input);
   ClearWrappers();
+  m_cache->begin();
 
   int num_domains = static_cast<int>(m_input->GetNumberOfDomains());
   m_has_unstructured = false;
@@ -895,26 +1331,48 @@ void VolumeRenderer::SetInput(DataSet *input)
 
     if(structured)
     {
-      m_wrappers.push_back(new detail::StructuredWrapper(data_set));
+      m_wrappers.push_back(std::make_shared<detail::StructuredWrapper>(data_set));
     }
     else
     {
       m_has_unstructured = true;
-      m_wrappers.push_back(new detail::UnstructuredWrapper(data_set));
+      m_wrappers.push_back(m_cache->get(domain_id, data_set));
     }
   }
+
+  m_cache->end();
 }
 
 void VolumeRenderer::ClearWrappers()
 {
-  const int num_wrappers = m_wrappers.size();
-  for(int i = 0; i < num_wrappers; ++i)
-  {
-    delete m_wrappers[i];
-  }
   m_wrappers.clear();
 }
 
+void VolumeRenderer::InvalidateCache()
+{
+  m_cache->clear();
+}
+
+void VolumeRenderer::SetCacheMemoryLimit(const size_t bytes)
+{
+  m_cache->memory_limit(bytes);
+}
+
+size_t VolumeRenderer::GetCacheMemoryLimit() const
+{
+  return m_cache->memory_limit();
+}
+
+int VolumeRenderer::GetCacheHits() const
+{
+  return m_cache->hits();
+}
+
+int VolumeRenderer::GetCacheMisses() const
+{
+  return m_cache->misses();
+}
+
 std::string
 VolumeRenderer::GetName() const
 {
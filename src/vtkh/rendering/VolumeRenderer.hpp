@@ -5,11 +5,15 @@
 #include <vtkh/rendering/Renderer.hpp>
 #include <vtkm/rendering/MapperVolume.h>
 
+#include <memory>
+
 namespace vtkh {
 
 namespace detail
 {
   class VolumeWrapper;
+  class VolumeCache;
+  class BoundsTable;
 }
 
 class VTKH_API VolumeRenderer : public Renderer
@@ -25,6 +29,23 @@ public:
   virtual void SetInput(DataSet *input) override;
 
   virtual void SetColorTable(const vtkm::cont::ColorTable &color_table) override;
+
+  // The rendering state of unstructured domains (the face connectivity)
+  // is cached across SetInput calls and reused while the domain id,
+  // topology and coordinates of a domain are unchanged; only the scalars
+  // are refreshed. The check compares cell and point counts, a hash of
+  // the cell shapes and point ids and a sample of the coordinates, so
+  // points that move off the sampled ones without changing the topology
+  // must be followed by a call to InvalidateCache.
+  void InvalidateCache();
+  // cached state that is not used by the current input is dropped (least
+  // recently used first) to stay under this estimate. The state of the
+  // current input is always kept. Default 1 GB
+  void SetCacheMemoryLimit(const size_t bytes);
+  size_t GetCacheMemoryLimit() const;
+  // hits and misses of the unstructured domains of the last SetInput call
+  int GetCacheHits() const;
+  int GetCacheMisses() const;
 protected:
   virtual void Composite(const int &num_images) override;
   virtual void PreExecute() override;
@@ -36,8 +57,7 @@ protected:
 
   void CorrectOpacity();
   void FindVisibilityOrdering();
-  void DepthSort(int num_domains,
-                 std::vector<float> &min_depths,
+  void DepthSort(const std::vector<float> &min_depths,
                  std::vector<int> &local_vis_order);
   float FindMinDepth(const vtkm::rendering::Camera &camera,
                      const vtkm::Bounds &bounds) const;
@@ -50,7 +70,10 @@ protected:
   std::vector<std::vector<int>> m_visibility_orders;
 
   void ClearWrappers();
-  std::vector<detail::VolumeWrapper*> m_wrappers;
+  std::vector<std::shared_ptr<detail::VolumeWrapper>> m_wrappers;
+  std::shared_ptr<detail::VolumeCache> m_cache;
+  // bounds of all domains, kept across cycles for visibility ordering
+  std::shared_ptr<detail::BoundsTable> m_bounds_table;
 
 };
 
@@ -789,6 +789,16 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+vtk-h: compress one piece of a deflate stream. Pieces with last == 0 end
+with a sync flush instead of a final block, so pieces compressed
+independently can be concatenated into one deflate stream.
+*/
+unsigned lodepng_deflate_piece(unsigned char** out, size_t* outsize,
+                               const unsigned char* in, size_t insize,
+                               unsigned last,
+                               const LodePNGCompressSettings* settings);
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
@@ -0,0 +1,170 @@
+#include <vtkh/utils/ImageWriter.hpp>
+#include <vtkh/utils/PNGEncoder.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtkh
+{
+
+struct ImageWriter::InternalsType
+{
+  struct Image
+  {
+    std::vector<unsigned char> m_rgba;
+    int m_width;
+    int m_height;
+    std::string m_filename;
+  };
+
+  std::deque<Image> m_queue;
+  std::vector<std::thread> m_threads;
+  std::mutex m_lock;
+  // signals workers that images are queued or that they should stop
+  std::condition_variable m_work_cv;
+  // signals producers that room was made or images were written
+  std::condition_variable m_done_cv;
+  int m_num_threads;
+  int m_max_queued;
+  int m_in_flight;
+  long long m_written;
+  bool m_stop;
+
+  void Work()
+  {
+    while(true)
+    {
+      Image image;
+      {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_work_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if(m_queue.empty())
+        {
+          return;
+        }
+        image = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_in_flight++;
+      }
+      m_done_cv.notify_all();
+
+      PNGEncoder encoder;
+      encoder.Encode(&image.m_rgba[0], image.m_width, image.m_height);
+      encoder.Save(image.m_filename);
+
+      {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_in_flight--;
+        m_written++;
+      }
+      m_done_cv.notify_all();
+    }
+  }
+};
+
+ImageWriter::ImageWriter(const int num_threads, const int max_queued)
+  : m_internals(new InternalsType)
+{
+  m_internals->m_num_threads = num_threads < 1 ? 1 : num_threads;
+  m_internals->m_max_queued = max_queued < 1 ? 1 : max_queued;
+  m_internals->m_in_flight = 0;
+  m_internals->m_written = 0;
+  m_internals->m_stop = false;
+}
+
+ImageWriter::~ImageWriter()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_internals->m_lock);
+    m_internals->m_stop = true;
+  }
+  m_internals->m_work_cv.notify_all();
+  // workers drain the queue before they exit
+  for(auto &thread : m_internals->m_threads)
+  {
+    thread.join();
+  }
+}
+
+void
+ImageWriter::Push(const float *rgba_in,
+                  const int width,
+                  const int height,
+                  const std::string &filename)
+{
+  InternalsType::Image image;
+  image.m_width = width;
+  image.m_height = height;
+  image.m_filename = filename;
+
+  const int size = width * height * 4;
+  image.m_rgba.resize(size);
+  unsigned char *rgba = &image.m_rgba[0];
+#ifdef VTKH_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for(int i = 0; i < size; ++i)
+  {
+    rgba[i] = (unsigned char)(rgba_in[i] * 255.f);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_internals->m_lock);
+    // backpressure: wait for the writers to catch up
+    m_internals->m_done_cv.wait(lock, [this]
+    {
+      return static_cast<int>(m_internals->m_queue.size()) < m_internals->m_max_queued;
+    });
+    m_internals->m_queue.push_back(std::move(image));
+
+    // threads are started with the first image
+    if(m_internals->m_threads.empty())
+    {
+      for(int i = 0; i < m_internals->m_num_threads; ++i)
+      {
+        m_internals->m_threads.push_back(std::thread(&InternalsType::Work,
+                                                     m_internals.get()));
+      }
+    }
+  }
+  m_internals->m_work_cv.notify_one();
+}
+
+void
+ImageWriter::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_internals->m_lock);
+  m_internals->m_done_cv.wait(lock, [this]
+  {
+    return m_internals->m_queue.empty() && m_internals->m_in_flight == 0;
+  });
+}
+
+void
+ImageWriter::SetMaxQueued(const int max_queued)
+{
+  {
+    std::lock_guard<std::mutex> guard(m_internals->m_lock);
+    m_internals->m_max_queued = max_queued < 1 ? 1 : max_queued;
+  }
+  m_internals->m_done_cv.notify_all();
+}
+
+int
+ImageWriter::GetMaxQueued() const
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  return m_internals->m_max_queued;
+}
+
+long long
+ImageWriter::GetNumberOfWritten() const
+{
+  std::lock_guard<std::mutex> guard(m_internals->m_lock);
+  return m_internals->m_written;
+}
+
+} // namespace vtkh
@@ -0,0 +1,45 @@
+#ifndef VTKH_IMAGE_WRITER_HPP
+#define VTKH_IMAGE_WRITER_HPP
+
+#include <vtkh/vtkh_exports.h>
+#include <memory>
+#include <string>
+
+namespace vtkh
+{
+
+//
+// Encodes and saves png images on background threads. Push converts
+// the color buffer to 8 bit RGBA and queues the copy, so the caller can
+// reuse its buffers right away. At most max_queued images wait to be
+// written, Push blocks until there is room.
+//
+class VTKH_API ImageWriter
+{
+public:
+  ImageWriter(const int num_threads = 2, const int max_queued = 10);
+  // waits for the queued images
+  ~ImageWriter();
+  ImageWriter(const ImageWriter &) = delete;
+  ImageWriter &operator=(const ImageWriter &) = delete;
+
+  void Push(const float *rgba_in,
+            const int width,
+            const int height,
+            const std::string &filename);
+  // blocks until all images pushed so far are written
+  void Wait();
+
+  void SetMaxQueued(const int max_queued);
+  int  GetMaxQueued() const;
+  // number of images written since construction
+  long long GetNumberOfWritten() const;
+
+private:
+  struct InternalsType;
+  std::shared_ptr<InternalsType> m_internals;
+};
+
+} // namespace vtkh
+
+#endif
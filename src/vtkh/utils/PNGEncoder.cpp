@@ -2,7 +2,14 @@
 
 // standard includes
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
+
+#ifdef VTKH_USE_OPENMP
+#include <omp.h>
+#endif
 
 // thirdparty includes
 #include <lodepng.h>
@@ -12,7 +19,9 @@ namespace vtkh
 
 PNGEncoder::PNGEncoder()
 :m_buffer(NULL),
- m_buffer_size(0)
+ m_buffer_size(0),
+ m_compression_level(1),
+ m_fast_mode(false)
 {}
 
 PNGEncoder::~PNGEncoder()
@@ -20,37 +29,129 @@ PNGEncoder::~PNGEncoder()
     Cleanup();
 }
 
-void
-PNGEncoder::Encode(const unsigned char *rgba_in,
-                   const int width,
-                   const int height)
+namespace detail
 {
-    Cleanup();
 
-    // upside down relative to what lodepng wants
-    unsigned char *rgba_flip = new unsigned char[width * height *4];
+// pieces smaller than this are not worth a thread
+const size_t MIN_STRIPE_BYTES = 1 << 16;
 
-    for (int y=0; y<height; ++y)
+//
+// Deflate for lodepng that splits the filtered rows into horizontal
+// stripes and compresses them independently and in parallel. Each stripe
+// but the last ends with a sync flush, so the compressed stripes
+// concatenate into a single deflate stream (one IDAT stream).
+//
+unsigned stripe_deflate(unsigned char **out,
+                        size_t *outsize,
+                        const unsigned char *in,
+                        size_t insize,
+                        const LodePNGCompressSettings *settings)
+{
+    int num_stripes = 1;
+#ifdef VTKH_USE_OPENMP
+    num_stripes = omp_get_max_threads();
+#endif
+    const size_t max_stripes = insize / MIN_STRIPE_BYTES;
+    if(max_stripes < (size_t) num_stripes) num_stripes = (int) max_stripes;
+    if(num_stripes < 1) num_stripes = 1;
+
+    LodePNGCompressSettings stripe_settings = *settings;
+    stripe_settings.custom_deflate = 0;
+
+    const size_t stripe_size = (insize + num_stripes - 1) / num_stripes;
+    std::vector<unsigned char*> stripes(num_stripes, NULL);
+    std::vector<size_t> stripe_sizes(num_stripes, 0);
+    std::vector<unsigned> errors(num_stripes, 0);
+
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for(int i = 0; i < num_stripes; ++i)
     {
-        memcpy(&(rgba_flip[y*width*4]),
-               &(rgba_in[(height-y-1)*width*4]),
-               width*4);
+        const size_t begin = std::min(insize, i * stripe_size);
+        const size_t end = std::min(insize, begin + stripe_size);
+        const unsigned last = i == num_stripes - 1;
+        errors[i] = lodepng_deflate_piece(&stripes[i],
+                                          &stripe_sizes[i],
+                                          in + begin,
+                                          end - begin,
+                                          last,
+                                          &stripe_settings);
     }
- 
+
+    unsigned error = 0;
+    size_t total_size = 0;
+    for(int i = 0; i < num_stripes; ++i)
+    {
+        if(errors[i] != 0) error = errors[i];
+        total_size += stripe_sizes[i];
+    }
+
+    if(error == 0)
+    {
+        *out = (unsigned char*) malloc(total_size);
+        *outsize = total_size;
+        size_t offset = 0;
+        for(int i = 0; i < num_stripes; ++i)
+        {
+            memcpy(*out + offset, stripes[i], stripe_sizes[i]);
+            offset += stripe_sizes[i];
+        }
+    }
+
+    for(int i = 0; i < num_stripes; ++i)
+    {
+        free(stripes[i]);
+    }
+    return error;
+}
+
+} // namespace detail
+
+void
+PNGEncoder::EncodeRows(const unsigned char *rgba_rows,
+                       const int width,
+                       const int height)
+{
     vtkh::LodePNGState state;
     vtkh::lodepng_state_init(&state);
-    // use less aggressive compression
-    state.encoder.zlibsettings.btype = 2;
-    state.encoder.zlibsettings.use_lz77 = 0;
+
+    state.encoder.zlibsettings.custom_deflate = detail::stripe_deflate;
+    if(m_compression_level == 0)
+    {
+        state.encoder.zlibsettings.btype = 0;
+    }
+    else if(m_compression_level == 1)
+    {
+        // use less aggressive compression
+        state.encoder.zlibsettings.btype = 2;
+        state.encoder.zlibsettings.use_lz77 = 0;
+    }
+    else
+    {
+        state.encoder.zlibsettings.btype = 2;
+        state.encoder.zlibsettings.use_lz77 = 1;
+        state.encoder.zlibsettings.windowsize = 256u << (m_compression_level - 2);
+        state.encoder.zlibsettings.lazymatching = m_compression_level >= 5;
+        state.encoder.zlibsettings.nicematch = m_compression_level >= 8 ? 258 : 128;
+    }
+
+    if(m_fast_mode)
+    {
+        state.encoder.filter_strategy = LFS_ZERO;
+        state.encoder.auto_convert = 0;
+        state.info_png.color.colortype = LCT_RGBA;
+        state.info_png.color.bitdepth = 8;
+    }
 
     unsigned error = lodepng_encode(&m_buffer,
                                     &m_buffer_size,
-                                    &rgba_flip[0],
+                                    rgba_rows,
                                     width,
                                     height,
                                     &state);
 
-    delete [] rgba_flip;
+    lodepng_state_cleanup(&state);
 
     if(error)
     {
@@ -59,50 +160,78 @@ PNGEncoder::Encode(const unsigned char *rgba_in,
 }
 
 void
-PNGEncoder::Encode(const float *rgba_in,
+PNGEncoder::Encode(const unsigned char *rgba_in,
                    const int width,
                    const int height)
 {
     Cleanup();
 
     // upside down relative to what lodepng wants
-    unsigned char *rgba_flip = new unsigned char[width * height *4];
+    std::vector<unsigned char> rgba_flip(width * height * 4);
 
+#ifdef VTKH_USE_OPENMP
+    #pragma omp parallel for
+#endif
+    for (int y=0; y<height; ++y)
+    {
+        memcpy(&(rgba_flip[y*width*4]),
+               &(rgba_in[(height-y-1)*width*4]),
+               width*4);
+    }
 
-    for(int x = 0; x < width; ++x)
+    EncodeRows(&rgba_flip[0], width, height);
+}
+
+void
+PNGEncoder::Encode(const float *rgba_in,
+                   const int width,
+                   const int height)
+{
+    Cleanup();
+
+    // upside down relative to what lodepng wants. Rows are
+    // converted in memory order
+    std::vector<unsigned char> rgba_flip(width * height * 4);
+    const int row_size = width * 4;
 
 #ifdef VTKH_USE_OPENMP
-        #pragma omp parallel for
+    #pragma omp parallel for
 #endif
-        for (int y = 0; y < height; ++y)
+    for (int y = 0; y < height; ++y)
+    {
+        const float *in_row = rgba_in + (size_t) y * row_size;
+        unsigned char *out_row = &rgba_flip[(size_t) (height - y - 1) * row_size];
+        for(int i = 0; i < row_size; ++i)
         {
-            int inOffset = (y * width + x) * 4;
-            int outOffset = ((height - y - 1) * width + x) * 4;
-            rgba_flip[outOffset + 0] = (unsigned char)(rgba_in[inOffset + 0] * 255.f);
-            rgba_flip[outOffset + 1] = (unsigned char)(rgba_in[inOffset + 1] * 255.f);
-            rgba_flip[outOffset + 2] = (unsigned char)(rgba_in[inOffset + 2] * 255.f);
-            rgba_flip[outOffset + 3] = (unsigned char)(rgba_in[inOffset + 3] * 255.f);
+            out_row[i] = (unsigned char)(in_row[i] * 255.f);
         }
+    }
 
-    vtkh::LodePNGState state;
-    vtkh::lodepng_state_init(&state);
-    // use less aggressive compression
-    state.encoder.zlibsettings.btype = 2;
-    state.encoder.zlibsettings.use_lz77 = 0;
+    EncodeRows(&rgba_flip[0], width, height);
+}
 
-    unsigned error = lodepng_encode(&m_buffer,
-                                    &m_buffer_size,
-                                    &rgba_flip[0],
-                                    width,
-                                    height,
-                                    &state);
+void
+PNGEncoder::SetCompressionLevel(const int level)
+{
+    m_compression_level = std::max(0, std::min(9, level));
+}
 
-    delete [] rgba_flip;
+int
+PNGEncoder::GetCompressionLevel() const
+{
+    return m_compression_level;
+}
 
-    if(error)
-    {
-      std::cerr<<"lodepng_encode_memory failed\n";
-    }
+void
+PNGEncoder::SetFastMode(bool on)
+{
+    m_fast_mode = on;
+}
+
+bool
+PNGEncoder::GetFastMode() const
+{
+    return m_fast_mode;
 }
 
 void
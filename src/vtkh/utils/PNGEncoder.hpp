@@ -21,14 +21,30 @@ public:
                           const int height);
     void           Save(const std::string &filename);
 
+    // 0 stores the image uncompressed, 1 (default) only uses huffman
+    // coding and 2-9 add LZ77 matching with growing windows
+    void           SetCompressionLevel(const int level);
+    int            GetCompressionLevel() const;
+    // fast mode skips the per row filter search (no filter on every
+    // row) and the color type detection (always RGBA)
+    void           SetFastMode(bool on);
+    bool           GetFastMode() const;
+
     void          *PngBuffer();
     size_t         PngBufferSize();
 
     void           Cleanup();
 
 private:
+    // encodes rows that are already top to bottom
+    void           EncodeRows(const unsigned char *rgba_rows,
+                              const int width,
+                              const int height);
+
     unsigned char *m_buffer;
     size_t         m_buffer_size;
+    int            m_compression_level;
+    bool           m_fast_mode;
 };
 
 } // namespace vtkh